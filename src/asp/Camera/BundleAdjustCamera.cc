@@ -29,6 +29,8 @@
 #include <vw/FileIO/KML.h>
 #include <asp/Camera/CameraResectioning.h>
 
+#include <algorithm>
+#include <limits>
 #include <string>
 
 using namespace vw;
@@ -75,6 +77,49 @@ void asp::BAParams::record_points_to_kml(const std::string &kml_path,
     kml.close_kml();
 }
 
+void asp::BAParams::reorder_points(std::vector<int> const& order) {
+
+  if ((int)order.size() != m_num_points)
+    vw::vw_throw(vw::ArgumentErr() << "Expecting an order of " << m_num_points
+                 << " points, got " << order.size() << ".\n");
+
+  std::vector<int> slots(m_num_points, -1);
+  std::vector<double> points_vec(m_points_vec.size());
+  for (int slot = 0; slot < m_num_points; slot++) {
+    int ipt = order[slot];
+    if (ipt < 0 || ipt >= m_num_points || slots[ipt] >= 0)
+      vw::vw_throw(vw::ArgumentErr() << "Invalid point order. Each point index "
+                   << "must show up exactly once.\n");
+    slots[ipt] = slot;
+    double const* ptr = get_point_ptr(ipt);
+    for (int i = 0; i < m_params_per_point; i++)
+      points_vec[slot*m_params_per_point + i] = ptr[i];
+  }
+
+  m_points_vec.swap(points_vec);
+  m_point_slots.swap(slots);
+}
+
+void asp::camera_major_point_order(vw::ba::ControlNetwork const& cnet,
+                                   std::vector<int> & order) {
+
+  // The lowest index of a camera seeing each point. The points not
+  // seen by any camera go last.
+  const int num_points = cnet.size();
+  std::vector<std::pair<size_t, int>> keys(num_points);
+  for (int ipt = 0; ipt < num_points; ipt++) {
+    size_t first_cam = std::numeric_limits<size_t>::max();
+    for (auto measure = cnet[ipt].begin(); measure != cnet[ipt].end(); measure++)
+      first_cam = std::min(first_cam, size_t(measure->image_id()));
+    keys[ipt] = std::make_pair(first_cam, ipt);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  order.resize(num_points);
+  for (int slot = 0; slot < num_points; slot++)
+    order[slot] = keys[slot].second;
+}
+
 void pack_pinhole_to_arrays(vw::camera::PinholeModel const& camera,
                             int camera_index,
                             asp::BAParams & param_storage) {
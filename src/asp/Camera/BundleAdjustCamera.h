@@ -54,7 +54,7 @@ namespace asp {
 // Options shared by bundle_adjust and jitter_solve
 struct BaBaseOptions: public vw::GdalWriteOptions {
   std::string out_prefix, stereo_session, input_prefix, match_files_prefix,
-    clean_match_files_prefix, ref_dem, heights_from_dem, mapproj_dem;
+    clean_match_files_prefix, ref_dem, heights_from_dem, mapproj_dem, camera_cache_dir;
   int overlap_limit, min_matches, max_pairwise_matches, num_iterations,
     ip_edge_buffer_percent;
   bool match_first_to_last, single_threaded_cameras;
@@ -150,8 +150,12 @@ public:
       m_cameras_vec       (num_cameras*NUM_CAMERA_PARAMS, 0),
       m_intrinsics_vec    (0),
       m_outlier_points_vec(num_points, false),
+      m_point_slots       (num_points),
       m_rand_gen(std::time(0)) {
 
+        for (int i = 0; i < num_points; i++)
+          m_point_slots[i] = i;
+
         if (!using_intrinsics)
           return; // If we are not using intrinsics, nothing else to do.
 
@@ -203,6 +207,7 @@ public:
       m_cameras_vec       (other.m_cameras_vec.size()       ),
       m_intrinsics_vec    (other.m_intrinsics_vec.size()    ),
       m_outlier_points_vec(other.m_outlier_points_vec.size()),
+      m_point_slots       (other.m_point_slots),
       m_rand_gen(std::time(0)) {
     copy_points    (other);
     copy_cameras   (other);
@@ -220,8 +225,13 @@ public:
 
   /// Copy one set of values from another instance.
   void copy_points(BAParams const& other) {
-    for (size_t i=0; i<m_points_vec.size(); ++i)
-      m_points_vec[i] = other.m_points_vec[i];
+    if (m_point_slots == other.m_point_slots) {
+      for (size_t i=0; i<m_points_vec.size(); ++i)
+        m_points_vec[i] = other.m_points_vec[i];
+      return;
+    }
+    for (int i=0; i<m_num_points; ++i)
+      set_point(i, other.get_point(i));
   }
   void copy_cameras(BAParams const& other) {
     for (size_t i=0; i<m_cameras_vec.size(); ++i)
@@ -322,6 +332,7 @@ public:
   int params_per_point () const {return m_params_per_point;}
   int params_per_camera() const {return m_num_pose_params;}
 
+  /// The points, in the storage order set by reorder_points()
   std::vector<double> & get_point_vector() {
     return m_points_vec;
   }
@@ -333,11 +344,28 @@ public:
   }
   
   double* get_point_ptr(int point_index) {
-    return &(m_points_vec[point_index*m_params_per_point]);
+    return &(m_points_vec[m_point_slots[point_index]*m_params_per_point]);
   }
   double const* get_point_ptr(int point_index) const {
-    return &(m_points_vec[point_index*m_params_per_point]);
+    return &(m_points_vec[m_point_slots[point_index]*m_params_per_point]);
+  }
+
+  /// Change the number of points, such as after the control network
+  /// is rebuilt. The points are stored in their original order.
+  void resize_points(int num_points) {
+    m_num_points = num_points;
+    m_points_vec.resize(num_points*m_params_per_point, 0);
+    m_outlier_points_vec.resize(num_points, false);
+    m_point_slots.resize(num_points);
+    for (int i = 0; i < num_points; i++)
+      m_point_slots[i] = i;
   }
+
+  /// Store the points in memory in the given order, which lists each
+  /// point index once. The point indices stay the same, so they still
+  /// refer to the control network, but pointers to the points obtained
+  /// before are no longer valid.
+  void reorder_points(std::vector<int> const& order);
   
   double* get_camera_ptr(int cam_index) {
     return &(m_cameras_vec[cam_index*m_num_pose_params]);
@@ -461,6 +489,9 @@ private: // Variables
   std::vector<double> m_points_vec, m_cameras_vec, m_intrinsics_vec;
   std::vector<bool> m_outlier_points_vec;
 
+  // The position of each point in m_points_vec, in units of points
+  std::vector<int> m_point_slots;
+
 private: // Functions
 
   /// Compute the offset in m_intrinsics_vec to the requested data.
@@ -484,6 +515,15 @@ private: // Functions
   }
 }; // End class BAParams
 
+/// An order of the points in which those first seen by the same
+/// camera are next to each other, for use with
+/// BAParams::reorder_points(). The points seen by camera 0 come first,
+/// then the remaining points seen by camera 1, etc., each group in the
+/// original order, and then the points not seen by any camera. This way the
+/// points in the residuals for the same camera are close in memory.
+void camera_major_point_order(vw::ba::ControlNetwork const& cnet,
+                              std::vector<int> & order);
+
 } // end namespace asp
 
 /// Simple class to manage position/rotation information.
@@ -0,0 +1,442 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+/// \file BundleAdjustPartition.cc
+///
+
+#include <asp/Camera/BundleAdjustPartition.h>
+#include <asp/Camera/BundleAdjustCamera.h>
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Math/BBox.h>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <set>
+
+using namespace vw;
+
+namespace asp {
+
+double problem_cost(ceres::Problem::EvaluateOptions const& eval_options,
+                    ceres::Problem & problem) {
+  double cost = 0.0;
+  problem.Evaluate(eval_options, &cost, NULL, NULL, NULL);
+  return cost;
+}
+
+/// A residual block of the full problem, for use in partitioned bundle adjustment
+struct PartitionBlock {
+  ceres::CostFunction * cost_function; // owned by the full problem
+  ceres::LossFunction * loss_function; // same
+  std::vector<double*> params;
+  int partition; // -1 if its cameras are in more than one partition
+};
+
+/// Split the cameras into partitions of about the same size, with the
+/// cameras in each close to each other. Recursively split the cameras
+/// in two along the axis of most extent of their centers. The center
+/// of a camera is the mean of the points it sees, so cameras with
+/// overlapping footprints end up together.
+void bisect_cameras(std::vector<Vector3> const& centers, std::vector<int> cams,
+                    int num_parts, int first_part, std::vector<int> & part_of_cam) {
+
+  if (num_parts <= 1 || cams.size() <= 1) {
+    for (size_t it = 0; it < cams.size(); it++)
+      part_of_cam[cams[it]] = first_part;
+    return;
+  }
+
+  BBox3 box;
+  for (size_t it = 0; it < cams.size(); it++)
+    box.grow(centers[cams[it]]);
+  Vector3 extent = box.size();
+  int axis = 0;
+  for (int k = 1; k < 3; k++) {
+    if (extent[k] > extent[axis])
+      axis = k;
+  }
+
+  int left_parts = num_parts / 2;
+  size_t mid = (cams.size() * left_parts) / num_parts;
+  std::nth_element(cams.begin(), cams.begin() + mid, cams.end(),
+                   [&](int a, int b) { return centers[a][axis] < centers[b][axis]; });
+  
+  std::vector<int> left_cams(cams.begin(), cams.begin() + mid);
+  std::vector<int> right_cams(cams.begin() + mid, cams.end());
+  bisect_cameras(centers, left_cams, left_parts, first_part, part_of_cam);
+  bisect_cameras(centers, right_cams, num_parts - left_parts, first_part + left_parts,
+                 part_of_cam);
+}
+
+void copy_parameter_bounds(ceres::Problem const& src_problem, const double * src_params,
+                           ceres::Problem & dst_problem, double * dst_params) {
+  const double max_val = std::numeric_limits<double>::max();
+  int size = src_problem.ParameterBlockSize(src_params);
+  for (int i = 0; i < size; i++) {
+    double lower = src_problem.GetParameterLowerBound(src_params, i);
+    double upper = src_problem.GetParameterUpperBound(src_params, i);
+    if (lower > -max_val)
+      dst_problem.SetParameterLowerBound(dst_params, i, lower);
+    if (upper < max_val)
+      dst_problem.SetParameterUpperBound(dst_params, i, upper);
+  }
+}
+
+void accumulate_summary(ceres::Solver::Summary const& summary,
+                        ceres::Solver::Summary & total) {
+  total.num_successful_steps   += summary.num_successful_steps;
+  total.num_unsuccessful_steps += summary.num_unsuccessful_steps;
+  total.num_inner_iteration_steps += summary.num_inner_iteration_steps;
+  total.num_line_search_steps  += summary.num_line_search_steps;
+  total.iterations.insert(total.iterations.end(), summary.iterations.begin(),
+                          summary.iterations.end());
+  if (summary.termination_type == ceres::NO_CONVERGENCE)
+    total.termination_type = ceres::NO_CONVERGENCE;
+  else if (summary.termination_type == ceres::FAILURE &&
+           total.termination_type != ceres::NO_CONVERGENCE)
+    total.termination_type = ceres::FAILURE;
+}
+
+/// Solve for the cameras in one partition and the points seen only by
+/// them. The parameters are copied to local storage, so that several
+/// partitions can be solved at the same time, and the optimized ones
+/// are copied back at the end.
+class SolvePartitionTask: public vw::Task {
+  std::vector<PartitionBlock> const& m_blocks;
+  std::vector<size_t> m_block_indices;
+  std::set<double*> const& m_variable; // The parameters which can be optimized
+  ceres::Problem const& m_full_problem; // to look up the parameter bounds
+  ceres::Solver::Options m_options;
+  ceres::Solver::Summary & m_summary;
+public:
+  SolvePartitionTask(std::vector<PartitionBlock> const& blocks,
+                     std::vector<size_t> const& block_indices,
+                     std::set<double*> const& variable,
+                     ceres::Problem const& full_problem,
+                     ceres::Solver::Options const& options,
+                     ceres::Solver::Summary & summary):
+    m_blocks(blocks), m_block_indices(block_indices), m_variable(variable),
+    m_full_problem(full_problem), m_options(options), m_summary(summary) {}
+
+  virtual void operator()() {
+
+    // The local storage for the parameters
+    std::map<double*, size_t> offsets;
+    std::vector<double> local_params;
+    for (size_t it = 0; it < m_block_indices.size(); it++) {
+      PartitionBlock const& block = m_blocks[m_block_indices[it]];
+      std::vector<ceres::int32> const& sizes
+        = block.cost_function->parameter_block_sizes();
+      for (size_t p = 0; p < block.params.size(); p++) {
+        if (offsets.find(block.params[p]) != offsets.end())
+          continue;
+        offsets[block.params[p]] = local_params.size();
+        local_params.insert(local_params.end(), block.params[p],
+                            block.params[p] + sizes[p]);
+      }
+    }
+    if (local_params.empty())
+      return;
+
+    ceres::Problem::Options problem_options;
+    problem_options.cost_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    problem_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    ceres::Problem problem(problem_options);
+    bool has_variable = false;
+    for (size_t it = 0; it < m_block_indices.size(); it++) {
+      PartitionBlock const& block = m_blocks[m_block_indices[it]];
+      std::vector<double*> params(block.params.size());
+      for (size_t p = 0; p < block.params.size(); p++)
+        params[p] = &local_params[offsets[block.params[p]]];
+      problem.AddResidualBlock(block.cost_function, block.loss_function, params);
+    }
+    for (auto it = offsets.begin(); it != offsets.end(); it++) {
+      if (m_variable.find(it->first) == m_variable.end()) {
+        problem.SetParameterBlockConstant(&local_params[it->second]);
+      } else {
+        has_variable = true;
+        copy_parameter_bounds(m_full_problem, it->first, problem,
+                              &local_params[it->second]);
+      }
+    }
+    if (!has_variable)
+      return;
+    
+    ceres::Solve(m_options, &problem, &m_summary);
+
+    // Copy back only the parameters which were optimized
+    for (auto it = offsets.begin(); it != offsets.end(); it++) {
+      if (m_variable.find(it->first) == m_variable.end())
+        continue;
+      int size = problem.ParameterBlockSize(&local_params[it->second]);
+      std::copy(&local_params[it->second], &local_params[it->second] + size, it->first);
+    }
+  }
+};
+
+void solve_partitioned(ceres::Solver::Options const& options,
+                       ceres::Problem::EvaluateOptions const& eval_options,
+                       int num_partitions, int num_rounds, int num_threads,
+                       BAParams & param_storage,
+                       ceres::Problem & problem,
+                       ceres::Solver::Summary & summary,
+                       double & final_cost) {
+
+  const int num_cameras = param_storage.num_cameras();
+  double * cam_begin = param_storage.get_camera_ptr(0);
+  double * cam_end   = cam_begin + num_cameras * param_storage.params_per_camera();
+  std::vector<double> & point_vec = param_storage.get_point_vector();
+  double * pt_begin = &point_vec[0], * pt_end = pt_begin + point_vec.size();
+  
+  // Find the cameras and points in each residual block of the full problem
+  std::vector<ceres::ResidualBlockId> residual_blocks;
+  problem.GetResidualBlocks(&residual_blocks);
+  std::vector<PartitionBlock> blocks(residual_blocks.size());
+  std::vector<Vector3> centers(num_cameras);
+  std::vector<int> num_cam_points(num_cameras, 0);
+  for (size_t it = 0; it < residual_blocks.size(); it++) {
+    PartitionBlock & block = blocks[it];
+    block.cost_function = const_cast<ceres::CostFunction*>
+      (problem.GetCostFunctionForResidualBlock(residual_blocks[it]));
+    block.loss_function = const_cast<ceres::LossFunction*>
+      (problem.GetLossFunctionForResidualBlock(residual_blocks[it]));
+    problem.GetParameterBlocksForResidualBlock(residual_blocks[it], &block.params);
+
+    int icam = -1;
+    double * point = NULL;
+    for (size_t p = 0; p < block.params.size(); p++) {
+      double * ptr = block.params[p];
+      if (ptr >= cam_begin && ptr < cam_end)
+        icam = (ptr - cam_begin) / param_storage.params_per_camera();
+      else if (ptr >= pt_begin && ptr < pt_end)
+        point = ptr;
+      else if (!problem.IsParameterBlockConstant(ptr))
+        vw_throw(ArgumentErr() << "Partitioned bundle adjustment does not support "
+                 << "solving for intrinsics.\n");
+      // Else, such as the fixed intrinsics of pinhole and optical bar
+      // cameras. These are copied as constants to the partition problems.
+    }
+    if (icam >= 0 && point != NULL) {
+      centers[icam] += Vector3(point[0], point[1], point[2]);
+      num_cam_points[icam]++;
+    }
+  }
+  for (int icam = 0; icam < num_cameras; icam++) {
+    if (num_cam_points[icam] > 0)
+      centers[icam] /= num_cam_points[icam];
+  }
+
+  std::vector<int> part_of_cam(num_cameras, 0), all_cams(num_cameras);
+  for (int icam = 0; icam < num_cameras; icam++)
+    all_cams[icam] = icam;
+  bisect_cameras(centers, all_cams, num_partitions, 0, part_of_cam);
+
+  // The partition of each block and point. A point seen from more
+  // than one partition is shared, and so are blocks with cameras from
+  // more than one partition.
+  const int SHARED = -1, NONE = -2;
+  std::map<double*, int> part_of_point;
+  for (size_t it = 0; it < blocks.size(); it++) {
+    PartitionBlock & block = blocks[it];
+    block.partition = NONE;
+    for (size_t p = 0; p < block.params.size(); p++) {
+      double * ptr = block.params[p];
+      if (ptr < cam_begin || ptr >= cam_end)
+        continue;
+      int part = part_of_cam[(ptr - cam_begin) / param_storage.params_per_camera()];
+      block.partition = (block.partition == NONE || block.partition == part) ? part : SHARED;
+    }
+    if (block.partition == NONE)
+      continue;
+    for (size_t p = 0; p < block.params.size(); p++) {
+      double * ptr = block.params[p];
+      if (ptr < pt_begin || ptr >= pt_end)
+        continue;
+      auto pt_it = part_of_point.find(ptr);
+      if (pt_it == part_of_point.end())
+        part_of_point[ptr] = block.partition;
+      else if (pt_it->second != block.partition)
+        pt_it->second = SHARED;
+    }
+  }
+
+  // Blocks with only points, such as for GCP, go with their points.
+  // The separator cameras see shared points or share blocks with cameras
+  // from other partitions.
+  std::vector<bool> is_separator(num_cameras, false);
+  for (size_t it = 0; it < blocks.size(); it++) {
+    PartitionBlock & block = blocks[it];
+    bool is_shared = (block.partition == SHARED);
+    for (size_t p = 0; p < block.params.size(); p++) {
+      auto pt_it = part_of_point.find(block.params[p]);
+      if (pt_it == part_of_point.end())
+        continue;
+      if (block.partition == NONE)
+        block.partition = pt_it->second;
+      is_shared = is_shared || (pt_it->second == SHARED);
+    }
+    if (!is_shared)
+      continue;
+    for (size_t p = 0; p < block.params.size(); p++) {
+      double * ptr = block.params[p];
+      if (ptr >= cam_begin && ptr < cam_end)
+        is_separator[(ptr - cam_begin) / param_storage.params_per_camera()] = true;
+    }
+  }
+
+  // The parameters optimized in the partitions, and in the separator problem
+  std::set<double*> part_variable, sep_variable;
+  for (int icam = 0; icam < num_cameras; icam++) {
+    double * ptr = param_storage.get_camera_ptr(icam);
+    if (!problem.HasParameterBlock(ptr) || problem.IsParameterBlockConstant(ptr))
+      continue;
+    part_variable.insert(ptr);
+    if (is_separator[icam])
+      sep_variable.insert(ptr);
+  }
+  for (auto it = part_of_point.begin(); it != part_of_point.end(); it++) {
+    if (!problem.HasParameterBlock(it->first) || problem.IsParameterBlockConstant(it->first))
+      continue;
+    if (it->second == SHARED)
+      sep_variable.insert(it->first);
+    else
+      part_variable.insert(it->first);
+  }
+
+  std::vector<std::vector<size_t>> part_blocks(num_partitions);
+  std::vector<size_t> sep_blocks;
+  for (size_t it = 0; it < blocks.size(); it++) {
+    PartitionBlock const& block = blocks[it];
+    if (block.partition >= 0)
+      part_blocks[block.partition].push_back(it);
+    for (size_t p = 0; p < block.params.size(); p++) {
+      if (sep_variable.find(block.params[p]) != sep_variable.end()) {
+        sep_blocks.push_back(it);
+        break;
+      }
+    }
+  }
+
+  int num_separators = std::count(is_separator.begin(), is_separator.end(), true);
+  vw_out() << "Split the cameras into " << num_partitions << " partitions, with "
+           << num_separators << " cameras seeing points shared across partitions.\n";
+
+  // The partitions are solved in parallel, each with one thread,
+  // unless the cameras must be used from a single thread.
+  ceres::Solver::Options part_options = options;
+  part_options.minimizer_progress_to_stdout = false;
+  part_options.callbacks.clear();
+  part_options.update_state_every_iteration = false;
+  part_options.num_threads = 1;
+  part_options.linear_solver_type = ceres::SPARSE_SCHUR;
+  if (num_cameras / num_partitions < 100)
+    part_options.linear_solver_type = ceres::DENSE_SCHUR;
+  part_options.use_explicit_schur_complement = false;
+  part_options.preconditioner_type = ceres::JACOBI;
+  if (num_threads <= 0)
+    num_threads = 1;
+
+  ceres::Solver::Options sep_options = options;
+  sep_options.linear_solver_type = ceres::SPARSE_SCHUR;
+  if (num_separators < 100)
+    sep_options.linear_solver_type = ceres::DENSE_SCHUR;
+  sep_options.use_explicit_schur_complement = false;
+  sep_options.preconditioner_type = ceres::JACOBI;
+  
+  // Stop when the cost of the full problem decreases by less than this fraction
+  const double min_decrease = 1e-4;
+  double cost = problem_cost(eval_options, problem);
+
+  // The summary of all solves
+  vw::Stopwatch sw;
+  sw.start();
+  summary = ceres::Solver::Summary();
+  summary.minimizer_type    = options.minimizer_type;
+  summary.termination_type  = ceres::CONVERGENCE;
+  summary.initial_cost      = cost;
+  summary.num_parameter_blocks = problem.NumParameterBlocks();
+  summary.num_parameters    = problem.NumParameters();
+  summary.num_residual_blocks = problem.NumResidualBlocks();
+  summary.num_residuals     = problem.NumResiduals();
+  summary.linear_solver_type_given = part_options.linear_solver_type;
+  summary.linear_solver_type_used  = part_options.linear_solver_type;
+  summary.num_threads_given = num_threads;
+  summary.num_threads_used  = num_threads;
+  
+  for (int round = 0; round < num_rounds; round++) {
+    
+    FifoWorkQueue queue(num_threads);
+    std::vector<ceres::Solver::Summary> part_summaries(num_partitions);
+    for (int part = 0; part < num_partitions; part++) {
+      boost::shared_ptr<SolvePartitionTask> task
+        (new SolvePartitionTask(blocks, part_blocks[part], part_variable, problem,
+                                part_options, part_summaries[part]));
+      queue.add_task(task);
+    }
+    queue.join_all();
+    for (int part = 0; part < num_partitions; part++)
+      accumulate_summary(part_summaries[part], summary);
+    double part_cost = problem_cost(eval_options, problem);
+
+    // The separator problem works directly on the parameters
+    if (!sep_variable.empty()) {
+      ceres::Problem::Options problem_options;
+      problem_options.cost_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+      problem_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+      ceres::Problem sep_problem(problem_options);
+      for (size_t it = 0; it < sep_blocks.size(); it++) {
+        PartitionBlock const& block = blocks[sep_blocks[it]];
+        sep_problem.AddResidualBlock(block.cost_function, block.loss_function, block.params);
+      }
+      std::vector<double*> sep_params;
+      sep_problem.GetParameterBlocks(&sep_params);
+      for (size_t it = 0; it < sep_params.size(); it++) {
+        if (sep_variable.find(sep_params[it]) == sep_variable.end())
+          sep_problem.SetParameterBlockConstant(sep_params[it]);
+        else
+          copy_parameter_bounds(problem, sep_params[it], sep_problem, sep_params[it]);
+      }
+      ceres::Solver::Summary sep_summary;
+      ceres::Solve(sep_options, &sep_problem, &sep_summary);
+      accumulate_summary(sep_summary, summary);
+    }
+    
+    double new_cost = problem_cost(eval_options, problem);
+    vw_out() << "Partitioned solver round " << round << ": cost " << cost
+             << ", after the partitions: " << part_cost
+             << ", after the separators: " << new_cost << ".\n";
+    
+    bool small_change = (cost - new_cost <= min_decrease * cost);
+    cost = new_cost;
+    if (small_change)
+      break;
+  }
+
+  sw.stop();
+  final_cost = cost;
+  summary.final_cost = cost;
+  summary.total_time_in_seconds = sw.elapsed_seconds();
+  summary.message = "Partitioned solve: the cost of the full problem stopped decreasing "
+    "or the maximum number of rounds was reached.";
+}
+
+} // end namespace asp
@@ -0,0 +1,69 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+/// \file BundleAdjustPartition.h
+///
+/// Solving a bundle adjustment problem with very many cameras by
+/// splitting the cameras into partitions.
+
+#ifndef __ASP_CAMERA_BUNDLE_ADJUST_PARTITION_H__
+#define __ASP_CAMERA_BUNDLE_ADJUST_PARTITION_H__
+
+#include <ceres/ceres.h>
+
+namespace asp {
+
+  class BAParams;
+
+  /// The cost of the problem at the current parameters
+  double problem_cost(ceres::Problem::EvaluateOptions const& eval_options,
+                      ceres::Problem & problem);
+
+  /// Copy the bounds of a parameter block of one problem to the block of
+  /// another problem, if there are any bounds.
+  void copy_parameter_bounds(ceres::Problem const& src_problem, const double * src_params,
+                             ceres::Problem & dst_problem, double * dst_params);
+
+  /// Add the statistics of a solve to the summary of several solves
+  void accumulate_summary(ceres::Solver::Summary const& summary,
+                          ceres::Solver::Summary & total);
+
+  /// Bundle adjustment for very many cameras. The cameras are split into
+  /// partitions by where they see the ground. Each partition is solved
+  /// on its own, in parallel, with the points also seen from other
+  /// partitions kept fixed. Then the cameras seeing such shared points,
+  /// and the shared points themselves, are solved for, with everything
+  /// else fixed. This is repeated until the cost of the full problem
+  /// stops decreasing. Blocks with cameras from more than one partition,
+  /// such as the disparity blocks of --reference-terrain for consecutive
+  /// cameras, make their cameras separators, so they are solved in the
+  /// separator problem. The summary covers all these solves.
+  /// The camera and point parameter blocks must be stored in
+  /// param_storage. Up to num_rounds rounds are done, with the
+  /// partitions solved with num_threads threads. The cost of the full
+  /// problem is found with eval_options.
+  void solve_partitioned(ceres::Solver::Options const& options,
+                         ceres::Problem::EvaluateOptions const& eval_options,
+                         int num_partitions, int num_rounds, int num_threads,
+                         BAParams & param_storage,
+                         ceres::Problem & problem,
+                         ceres::Solver::Summary & summary,
+                         double & final_cost);
+
+} // end namespace asp
+
+#endif // __ASP_CAMERA_BUNDLE_ADJUST_PARTITION_H__
@@ -0,0 +1,258 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Cartography/CameraBBox.h>
+#include <asp/Camera/CameraBenchmark.h>
+#include <asp/Camera/CsmModel.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <cmath>
+
+using namespace vw;
+
+namespace asp {
+
+double CameraBenchmarkResult::calls_per_second() const {
+  if (seconds <= 0.0)
+    return 0.0;
+  return num_calls / seconds;
+}
+
+void camera_benchmark_samples(vw::camera::CameraModel const* cam,
+                              Vector2i const& image_size,
+                              vw::cartography::Datum const& datum,
+                              double height_above_datum, int num_samples,
+                              std::vector<Vector2> & pixels,
+                              std::vector<Vector3> & points) {
+
+  pixels.clear();
+  points.clear();
+  if (image_size.x() <= 0 || image_size.y() <= 0 || num_samples <= 0)
+    vw_throw(ArgumentErr() << "Cannot sample an empty image.\n");
+
+  double major_axis = datum.semi_major_axis() + height_above_datum;
+  double minor_axis = datum.semi_minor_axis() + height_above_datum;
+
+  // Pixel centers on a side x side grid
+  int side = std::max(int(ceil(sqrt(double(num_samples)))), 1);
+  for (int row = 0; row < side; row++) {
+    for (int col = 0; col < side; col++) {
+      Vector2 pix((col + 0.5) * image_size.x() / side,
+                  (row + 0.5) * image_size.y() / side);
+      try {
+        Vector3 ctr = cam->camera_center(pix);
+        Vector3 dir = cam->pixel_to_vector(pix);
+        Vector3 xyz = vw::cartography::datum_intersection(major_axis, minor_axis, ctr, dir);
+        if (xyz == Vector3())
+          continue; // the ray missed the datum
+        cam->point_to_pixel(xyz);
+        pixels.push_back(pix);
+        points.push_back(xyz);
+      } catch (...) {
+        continue;
+      }
+    }
+  }
+
+  if (pixels.empty())
+    vw_throw(ArgumentErr() << "Could not find any pixels whose rays intersect the datum.\n");
+}
+
+namespace {
+
+  enum CameraFunction {CAMERA_CENTER, PIXEL_TO_VECTOR, POINT_TO_PIXEL};
+
+  // Make num_calls calls of the given function, cycling through the
+  // samples starting at the given position. A sum of the results is
+  // kept so that the calls cannot be optimized away.
+  class CameraBenchmarkTask: public vw::Task, private boost::noncopyable {
+    vw::camera::CameraModel const* m_cam;
+    CameraFunction                 m_function;
+    std::vector<Vector2> const&    m_pixels;
+    std::vector<Vector3> const&    m_points;
+    size_t                         m_start;
+    double                         m_num_calls;
+    double                       & m_sum;
+
+  public:
+    CameraBenchmarkTask(vw::camera::CameraModel const* cam, CameraFunction function,
+                        std::vector<Vector2> const& pixels,
+                        std::vector<Vector3> const& points,
+                        size_t start, double num_calls, double & sum):
+      m_cam(cam), m_function(function), m_pixels(pixels), m_points(points),
+      m_start(start), m_num_calls(num_calls), m_sum(sum) {}
+
+    virtual void operator()() {
+      double sum = 0.0;
+      size_t num = m_pixels.size(), pos = m_start % num;
+      for (double call = 0; call < m_num_calls; call++) {
+        switch (m_function) {
+        case CAMERA_CENTER:   sum += m_cam->camera_center(m_pixels[pos])[0];   break;
+        case PIXEL_TO_VECTOR: sum += m_cam->pixel_to_vector(m_pixels[pos])[0]; break;
+        case POINT_TO_PIXEL:  sum += m_cam->point_to_pixel(m_points[pos])[0];  break;
+        }
+        pos++;
+        if (pos == num)
+          pos = 0;
+      }
+      m_sum = sum;
+    }
+  };
+
+  // Time making num_calls calls split among the given cameras, one
+  // thread per camera. Return the elapsed time in seconds.
+  double time_camera_calls(std::vector<vw::camera::CameraModel const*> const& cams,
+                           CameraFunction function,
+                           std::vector<Vector2> const& pixels,
+                           std::vector<Vector3> const& points,
+                           double num_calls) {
+
+    int num_threads = cams.size();
+    std::vector<double> sums(num_threads, 0.0);
+    vw::FifoWorkQueue queue(num_threads);
+    Stopwatch sw;
+    sw.start();
+    for (int it = 0; it < num_threads; it++) {
+      size_t start = (pixels.size() * it) / num_threads;
+      boost::shared_ptr<vw::Task>
+        task(new CameraBenchmarkTask(cams[it], function, pixels, points,
+                                     start, ceil(num_calls / num_threads), sums[it]));
+      queue.add_task(task);
+    }
+    queue.join_all();
+    sw.stop();
+
+    return sw.elapsed_seconds();
+  }
+
+} // end anonymous namespace
+
+void benchmark_camera(std::string const& model_name,
+                      boost::shared_ptr<vw::camera::CameraModel> cam,
+                      std::vector<Vector2> const& pixels,
+                      std::vector<Vector3> const& points,
+                      std::vector<int> const& thread_counts,
+                      double min_seconds,
+                      std::vector<CameraBenchmarkResult> & results) {
+
+  VW_ASSERT(pixels.size() == points.size() && !pixels.empty(),
+            ArgumentErr() << "benchmark_camera: Expecting as many pixels as points.\n");
+
+  // A CSM model may cache state when projecting, so each thread gets
+  // its own copy. Other models are shared among threads, as in stereo.
+  asp::CsmModel const* csm_model = dynamic_cast<asp::CsmModel const*>(cam.get());
+  bool single_threaded = (cam->type() == "Isis");
+
+  int max_threads = 1;
+  for (size_t it = 0; it < thread_counts.size(); it++)
+    max_threads = std::max(max_threads, thread_counts[it]);
+  std::vector<boost::shared_ptr<vw::camera::CameraModel>> copies;
+  std::vector<vw::camera::CameraModel const*> cams;
+  for (int it = 0; it < max_threads; it++) {
+    if (csm_model != NULL && it > 0) {
+      copies.push_back(csm_model->clone());
+      cams.push_back(copies.back().get());
+    } else {
+      cams.push_back(cam.get());
+    }
+  }
+
+  const char* function_names[] = {"camera_center", "pixel_to_vector", "point_to_pixel"};
+  CameraFunction functions[] = {CAMERA_CENTER, PIXEL_TO_VECTOR, POINT_TO_PIXEL};
+  for (int f = 0; f < 3; f++) {
+
+    // Make one pass over the samples with one thread to estimate how
+    // many calls fill the requested time.
+    double num_samples = pixels.size();
+    double elapsed = time_camera_calls(std::vector<vw::camera::CameraModel const*>(1, cams[0]),
+                                       functions[f], pixels, points, num_samples);
+    double num_calls = num_samples;
+    if (elapsed > 0.0)
+      num_calls = std::max(num_samples, ceil(num_samples * min_seconds / elapsed));
+
+    for (size_t t = 0; t < thread_counts.size(); t++) {
+      int num_threads = thread_counts[t];
+      if (num_threads <= 0)
+        vw_throw(ArgumentErr() << "The number of threads must be positive.\n");
+      if (single_threaded && num_threads > 1) {
+        vw_out(WarningMessage) << "Skipping timing " << model_name << " with "
+                               << num_threads << " threads, as this model "
+                               << "is not thread-safe.\n";
+        continue;
+      }
+
+      // Scale the number of calls with the thread count, to keep
+      // each measurement long enough to be accurate.
+      CameraBenchmarkResult result;
+      result.model       = model_name;
+      result.function    = function_names[f];
+      result.num_threads = num_threads;
+      result.num_calls   = num_threads * ceil(num_calls);
+      std::vector<vw::camera::CameraModel const*>
+        thread_cams(cams.begin(), cams.begin() + num_threads);
+      result.seconds = time_camera_calls(thread_cams, functions[f], pixels, points,
+                                         result.num_calls);
+      results.push_back(result);
+    }
+  }
+}
+
+void print_camera_benchmark(std::vector<CameraBenchmarkResult> const& results) {
+  vw_out() << std::left << std::setw(12) << "Model" << std::setw(18) << "Function"
+           << std::setw(10) << "Threads" << "Calls per second\n";
+  for (size_t it = 0; it < results.size(); it++) {
+    CameraBenchmarkResult const& r = results[it];
+    vw_out() << std::left << std::setw(12) << r.model << std::setw(18) << r.function
+             << std::setw(10) << r.num_threads << std::fixed << std::setprecision(0)
+             << r.calls_per_second() << "\n";
+  }
+}
+
+void write_camera_benchmark_json(std::string const& file,
+                                 std::vector<CameraBenchmarkResult> const& results) {
+
+  std::ofstream ofs(file.c_str());
+  if (!ofs.good())
+    vw_throw(ArgumentErr() << "Cannot write: " << file << "\n");
+
+  // The model and function names never need escaping
+  ofs << std::setprecision(10);
+  ofs << "{\n  \"results\": [\n";
+  for (size_t it = 0; it < results.size(); it++) {
+    CameraBenchmarkResult const& r = results[it];
+    ofs << "    {\"model\": \""       << r.model       << "\", "
+        << "\"function\": \""         << r.function    << "\", "
+        << "\"threads\": "            << r.num_threads << ", "
+        << "\"calls\": "              << r.num_calls   << ", "
+        << "\"seconds\": "            << r.seconds     << ", "
+        << "\"calls_per_second\": "   << r.calls_per_second() << "}"
+        << (it + 1 < results.size() ? "," : "") << "\n";
+  }
+  ofs << "  ]\n}\n";
+  ofs.close();
+}
+
+} // end namespace asp
@@ -0,0 +1,85 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file CameraBenchmark.h
+///
+/// Measure how many times per second the camera_center(),
+/// pixel_to_vector(), and point_to_pixel() functions of a camera
+/// model can be called, with a given number of threads sharing the
+/// model. Used by cam_test --benchmark and by the camera tests.
+
+#ifndef __ASP_CAMERA_CAMERA_BENCHMARK_H__
+#define __ASP_CAMERA_CAMERA_BENCHMARK_H__
+
+#include <vw/Math/Vector.h>
+#include <vw/Camera/CameraModel.h>
+#include <vw/Cartography/Datum.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <string>
+#include <vector>
+
+namespace asp {
+
+  /// The timing of one camera function for a given number of threads
+  struct CameraBenchmarkResult {
+    std::string model;    // such as "dg", "rpc", "csm"
+    std::string function; // "camera_center", "pixel_to_vector", or "point_to_pixel"
+    int         num_threads;
+    double      num_calls;
+    double      seconds;
+
+    double calls_per_second() const;
+  };
+
+  /// Sample about num_samples pixels on a regular grid over the image,
+  /// and for each find the ground point obtained by intersecting the
+  /// ray through that pixel with the datum, raised by the given height.
+  /// Pixels for which this fails, or whose ground point cannot be
+  /// projected back into the camera, are skipped.
+  void camera_benchmark_samples(vw::camera::CameraModel const* cam,
+                                vw::Vector2i const& image_size,
+                                vw::cartography::Datum const& datum,
+                                double height_above_datum, int num_samples,
+                                std::vector<vw::Vector2> & pixels,
+                                std::vector<vw::Vector3> & points);
+
+  /// Time the camera functions on the given samples for each of the
+  /// given thread counts, and append the results. Each measurement
+  /// lasts about min_seconds. CSM models are cloned for each thread,
+  /// and ISIS models, which are not thread-safe, are timed with one
+  /// thread only.
+  void benchmark_camera(std::string const& model_name,
+                        boost::shared_ptr<vw::camera::CameraModel> cam,
+                        std::vector<vw::Vector2> const& pixels,
+                        std::vector<vw::Vector3> const& points,
+                        std::vector<int> const& thread_counts,
+                        double min_seconds,
+                        std::vector<CameraBenchmarkResult> & results);
+
+  /// Print the results in a table
+  void print_camera_benchmark(std::vector<CameraBenchmarkResult> const& results);
+
+  /// Save the results as JSON, for tracking them over time
+  void write_camera_benchmark_json(std::string const& file,
+                                   std::vector<CameraBenchmarkResult> const& results);
+
+} // end namespace asp
+
+#endif // __ASP_CAMERA_CAMERA_BENCHMARK_H__
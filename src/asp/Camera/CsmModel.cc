@@ -16,6 +16,7 @@
 // __END_LICENSE__
 
 #include <vw/FileIO/FileUtils.h>
+#include <vw/Core/ThreadPool.h>
 
 #include <asp/Core/StereoSettings.h>
 #include <asp/Camera/CsmModel.h>
@@ -44,6 +45,7 @@
 #include <Eigen/Geometry>
 
 #include <streambuf>
+#include <limits>
 
 namespace dll = boost::dll;
 namespace fs = boost::filesystem;
@@ -648,6 +650,129 @@ Vector3 CsmModel::camera_center(Vector2 const& pix) const {
   return ecefCoordToVector(ecef);
 }
 
+// Copy-construct a CSM model of the given type, if gm_model is of that type
+template<class ModelT>
+bool cloneModelAux(csm::RasterGM const* gm_model,
+                   boost::shared_ptr<csm::RasterGM> & new_gm_model) {
+  ModelT const* specific_model = dynamic_cast<ModelT const*>(gm_model);
+  if (specific_model == NULL)
+    return false;
+  new_gm_model.reset(new ModelT(*specific_model));
+  return true;
+}
+
+boost::shared_ptr<CsmModel> CsmModel::clone() const {
+  throw_if_not_init();
+
+  boost::shared_ptr<CsmModel> model(new CsmModel);
+  model->m_desired_precision = m_desired_precision;
+  model->m_semi_major_axis   = m_semi_major_axis;
+  model->m_semi_minor_axis   = m_semi_minor_axis;
+  model->m_sun_position      = m_sun_position;
+
+  csm::RasterGM const* gm_model = m_gm_model.get();
+  if (!cloneModelAux<UsgsAstroFrameSensorModel>(gm_model, model->m_gm_model)     &&
+      !cloneModelAux<UsgsAstroLsSensorModel>(gm_model, model->m_gm_model)        &&
+      !cloneModelAux<UsgsAstroPushFrameSensorModel>(gm_model, model->m_gm_model) &&
+      !cloneModelAux<UsgsAstroSarSensorModel>(gm_model, model->m_gm_model)) {
+    // A model from a plugin. Go through the model state.
+    bool recreate_model = true;
+    model->setModelFromStateString(m_gm_model->getModelState(), recreate_model);
+  }
+
+  return model;
+}
+
+// Apply a CsmModel function to a range of inputs. Used for the batch
+// functions. When run in its own thread, the task must be given its
+// own clone of the model.
+template<class InT, class OutT>
+class CsmBatchTask: public vw::Task, private boost::noncopyable {
+  typedef OutT (CsmModel::*FuncT)(InT const&) const;
+  CsmModel const*             m_model;
+  boost::shared_ptr<CsmModel> m_clone; // if set, m_model points to it
+  FuncT                       m_func;
+  std::vector<InT>  const&    m_in;
+  std::vector<OutT>         & m_out;
+  size_t                      m_beg, m_end;
+  
+public:
+  CsmBatchTask(CsmModel const* model, boost::shared_ptr<CsmModel> clone, FuncT func,
+               std::vector<InT> const& in, std::vector<OutT> & out,
+               size_t beg, size_t end):
+    m_model(model), m_clone(clone), m_func(func), m_in(in), m_out(out),
+    m_beg(beg), m_end(end) {
+    if (m_clone)
+      m_model = m_clone.get();
+  }
+  
+  void operator()() {
+    OutT nan_val;
+    for (size_t c = 0; c < nan_val.size(); c++)
+      nan_val[c] = std::numeric_limits<double>::quiet_NaN();
+    
+    for (size_t it = m_beg; it < m_end; it++) {
+      try {
+        m_out[it] = ((*m_model).*m_func)(m_in[it]);
+      } catch (...) {
+        m_out[it] = nan_val;
+      }
+    }
+  }
+};
+
+template<class InT, class OutT>
+void csmBatchApply(CsmModel const& model, OutT (CsmModel::*func)(InT const&) const,
+                   std::vector<InT> const& in, std::vector<OutT> & out, int num_threads) {
+
+  out.resize(in.size());
+  if (in.empty())
+    return;
+  
+  num_threads = std::max(1, std::min(num_threads, int(in.size())));
+  if (num_threads == 1) {
+    // Use this model directly, with no copying
+    CsmBatchTask<InT, OutT> task(&model, boost::shared_ptr<CsmModel>(), func,
+                                 in, out, 0, in.size());
+    task();
+    return;
+  }
+
+  vw::FifoWorkQueue queue(num_threads);
+  size_t chunk = (in.size() + num_threads - 1) / num_threads;
+  for (size_t beg = 0; beg < in.size(); beg += chunk) {
+    size_t end = std::min(beg + chunk, in.size());
+    boost::shared_ptr<CsmBatchTask<InT, OutT>>
+      task(new CsmBatchTask<InT, OutT>(&model, model.clone(), func, in, out, beg, end));
+    queue.add_task(task);
+  }
+  queue.join_all();
+}
+
+void CsmModel::point_to_pixel(std::vector<vw::Vector3> const& points,
+                              std::vector<vw::Vector2>      & pixels, int num_threads) const {
+  throw_if_not_init();
+  typedef Vector2 (CsmModel::*FuncT)(Vector3 const&) const;
+  csmBatchApply(*this, static_cast<FuncT>(&CsmModel::point_to_pixel),
+                points, pixels, num_threads);
+}
+
+void CsmModel::pixel_to_vector(std::vector<vw::Vector2> const& pixels,
+                               std::vector<vw::Vector3>      & dirs, int num_threads) const {
+  throw_if_not_init();
+  typedef Vector3 (CsmModel::*FuncT)(Vector2 const&) const;
+  csmBatchApply(*this, static_cast<FuncT>(&CsmModel::pixel_to_vector),
+                pixels, dirs, num_threads);
+}
+
+void CsmModel::camera_center(std::vector<vw::Vector2> const& pixels,
+                             std::vector<vw::Vector3>      & centers, int num_threads) const {
+  throw_if_not_init();
+  typedef Vector3 (CsmModel::*FuncT)(Vector2 const&) const;
+  csmBatchApply(*this, static_cast<FuncT>(&CsmModel::camera_center),
+                pixels, centers, num_threads);
+}
+
 // Apply a transform to the model state in json format
 template<class ModelT>
 void applyTransformToState(ModelT const * model,
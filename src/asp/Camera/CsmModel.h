@@ -27,6 +27,8 @@
 #include <vw/Camera/CameraModel.h>
 #include <boost/shared_ptr.hpp>
 
+#include <vector>
+
 namespace csm {
   // Forward declarations
   class RasterGM; 
@@ -68,6 +70,23 @@ namespace asp {
       return vw::Quaternion<double>();
     }
 
+    /// Create a copy of this model owning its own copy of the underlying
+    /// CSM model, so that it can be used in a different thread. This
+    /// copies the model data directly rather than parsing a model state.
+    /// The usgscsm models store their ephemeris by value, so the clone
+    /// does not share it with this model.
+    boost::shared_ptr<CsmModel> clone() const;
+
+    // Batch versions of the functions above. If num_threads > 1, the
+    // work is split among that many threads, each with a clone of this
+    // model. Inputs for which the model fails produce NaN outputs.
+    void point_to_pixel (std::vector<vw::Vector3> const& points,
+                         std::vector<vw::Vector2>      & pixels, int num_threads = 1) const;
+    void pixel_to_vector(std::vector<vw::Vector2> const& pixels,
+                         std::vector<vw::Vector3>      & dirs, int num_threads = 1) const;
+    void camera_center  (std::vector<vw::Vector2> const& pixels,
+                         std::vector<vw::Vector3>      & centers, int num_threads = 1) const;
+
     /// Return true if the path has an extension compatible with CsmModel.
     static bool file_has_isd_extension(std::string const& path);
 
@@ -24,6 +24,9 @@
 #include <usgscsm/UsgsAstroLsSensorModel.h>
 #include <usgscsm/Utilities.h>
 
+#include <cmath>
+#include <limits>
+
 using namespace vw;
 
 namespace asp {
@@ -213,7 +216,8 @@ DGCameraModel::DGCameraModel
  bool                                                    correct_velocity,
  bool                                                    correct_atmosphere):
   DGCameraModelBase(position, velocity, pose, time, image_size, detector_origin, focal_length,
-                    mean_ground_elevation, correct_velocity, correct_atmosphere) {
+                    mean_ground_elevation, correct_velocity, correct_atmosphere),
+  m_correct_velocity_or_atmosphere(correct_velocity || correct_atmosphere) {
   
   datum = vw::cartography::Datum("WGS84"); // this sensor is used for Earth only
   
@@ -221,6 +225,49 @@ DGCameraModel::DGCameraModel
   // The cam_test.cc and jitter_solve.cc tools uses this assumption.
   // Soon the other implementation will go away and this will be the default.
   populateCsmModel();
+
+  if (stereo_settings().dg_interpolation_tables && !stereo_settings().dg_use_csm)
+    buildInterpTables();
+}
+
+// See the .h file for the documentation.
+bool DGCameraModel::buildInterpTables() {
+
+  // These are far below the accuracy of the ephemeris and attitude. The
+  // pose tolerance is a tenth of a millipixel at the DG focal length.
+  const double POSITION_TOL     = 1e-6; // meters, and meters per second for velocity
+  const double POSE_TOL         = 1e-10; // radians
+  const int    MAX_SUBDIVISIONS = 16;
+
+  // Position and velocity are sampled at the same times
+  double pos_t0 = m_position_func.get_t0(), pos_dt = m_position_func.get_dt();
+  int num_pos = (int)round((m_position_func.get_tend() - pos_t0) / pos_dt);
+  int num_poses = m_pose_func.m_pose_samples.size();
+
+  bool success = false;
+  try {
+    success
+      = num_pos > 0 && num_poses > 1 &&
+      build_linescan_table(m_position_func, pos_t0, pos_dt, num_pos,
+                           POSITION_TOL, MAX_SUBDIVISIONS, m_position_table) &&
+      build_linescan_table(m_velocity_func, pos_t0, pos_dt, num_pos,
+                           POSITION_TOL, MAX_SUBDIVISIONS, m_velocity_table) &&
+      build_linescan_table(m_pose_func, m_pose_func.m_t0, m_pose_func.m_dt, num_poses - 1,
+                           POSE_TOL, MAX_SUBDIVISIONS, m_pose_table);
+  } catch (...) {
+    success = false; // the grid went out of the range of an interpolant
+  }
+
+  if (!success) {
+    vw::vw_out(vw::WarningMessage) << "Could not build accurate enough interpolation "
+                                   << "tables for a DigitalGlobe camera. Using the "
+                                   << "original interpolation.\n";
+    m_position_table = CubicTable();
+    m_velocity_table = CubicTable();
+    m_pose_table     = PoseTable();
+  }
+
+  return success;
 }
   
 // This is a lengthy function that does many initializations  
@@ -398,6 +445,9 @@ vw::Vector3 DGCameraModel::get_camera_center_at_time(double time) const {
     csm::EcefCoord ecef = m_ls_model->getSensorPosition(time);
     return vw::Vector3(ecef.x, ecef.y, ecef.z);
   }
+
+  if (m_position_table.in_range(time))
+    return m_position_table(time);
   
   return m_position_func(time);
 }
@@ -407,6 +457,9 @@ vw::Vector3 DGCameraModel::get_camera_velocity_at_time(double time) const {
     csm::EcefVector ecef = m_ls_model->getSensorVelocity(time);
     return vw::Vector3(ecef.x, ecef.y, ecef.z);
   }
+
+  if (m_velocity_table.in_range(time))
+    return m_velocity_table(time);
   
   return m_velocity_func(time);
 }
@@ -440,6 +493,9 @@ vw::Quat DGCameraModel::get_camera_pose_at_time(double time) const {
     getQuaternions(time, q);
     return vw::Quat(q[3], q[0], q[1], q[2]); // go from (x, y, z, w) to (w, x, y, z)
   }
+
+  if (m_pose_table.in_range(time))
+    return m_pose_table(time);
   
   return m_pose_func(time);
 }
@@ -555,17 +611,92 @@ vw::Vector2 DGCameraModel::point_to_pixel(vw::Vector3 const& point) const {
 
 }
   
+// See the .h file for the documentation.
+bool DGCameraModel::point_to_pixel_newton(vw::Vector3 const& point, double starty,
+                                          vw::Vector2 & pix) const {
+
+  const double LINE_TOL = 1e-10;
+  const int    MAX_ITERATIONS = 50;
+  
+  double y = m_image_size.y()/2.0;
+  if (starty >= 0)
+    y = starty;
+
+  try {
+    // The time is a piecewise linear function of the line, so its
+    // derivative is nearly constant.
+    double dt_dy = m_time_func(y + 0.5) - m_time_func(y - 0.5);
+    double dt = m_pose_func.m_dt;
+    int num_poses = m_pose_func.m_pose_samples.size();
+    
+    for (int iter = 0; iter < MAX_ITERATIONS; iter++) {
+
+      double t = m_time_func(y);
+      vw::Quat q = get_camera_pose_at_time(t);
+      vw::Quat q_inv = inverse(q);
+      vw::Vector3 pt = q_inv.rotate(point - get_camera_center_at_time(t));
+      if (pt.z() <= 0.0)
+        return false;
+      
+      double err = pt.y() / pt.z() - m_detector_origin[1] / m_focal_length;
+
+      // The pose is a slerp between consecutive samples, so its angular
+      // velocity in the camera frame is constant on that interval. With
+      // the pose table this is a very good approximation.
+      int i = (int)floor((t - m_pose_func.m_t0) / dt);
+      i = std::max(0, std::min(i, num_poses - 2));
+      vw::Quat dq = inverse(m_pose_func.m_pose_samples[i]) * m_pose_func.m_pose_samples[i+1];
+      if (dq.w() < 0.0)
+        dq = vw::Quat(-dq.w(), -dq.x(), -dq.y(), -dq.z()); // the shortest path
+      vw::Vector3 omega = dq.axis_angle() / dt;
+
+      // Derivative of pt = R(t)^T * (point - C(t)) with respect to time
+      vw::Vector3 dpt = -cross_prod(omega, pt) - q_inv.rotate(get_camera_velocity_at_time(t));
+      double derr = dt_dy * (dpt.y() * pt.z() - pt.y() * dpt.z()) / (pt.z() * pt.z());
+      if (derr == 0.0 || std::isnan(derr))
+        return false;
+
+      double step = err / derr;
+      y -= step;
+      if (std::abs(step) < LINE_TOL)
+        break;
+      if (iter == MAX_ITERATIONS - 1)
+        return false;
+    }
+
+    // Solve for the sample now that we know the line
+    double t = m_time_func(y);
+    vw::Vector3 pt = inverse(get_camera_pose_at_time(t)).rotate(point -
+                                                                get_camera_center_at_time(t));
+    pt *= m_focal_length / pt.z();
+    pix = vw::Vector2(pt.x() - m_detector_origin[0], y);
+  } catch (...) {
+    return false; // went out of the range of the interpolants
+  }
+  
+  return !std::isnan(pix[0]) && !std::isnan(pix[1]);
+}
+
 // TODO(oalexan1): Wipe this and use the logic above, after much testing.  
 vw::Vector2 DGCameraModel::point_to_pixel(vw::Vector3 const& point, double starty) const {
 
   if (stereo_settings().dg_use_csm)
     vw::vw_throw(vw::ArgumentErr()
                  << "point_to_pixel(point, starty): Cannot be called in CSM mode.\n");
-    
+
+  // Without velocity aberration and atmospheric refraction correction
+  // the Newton solution is exact. Otherwise use it as the starting
+  // guess for the generic solver.
+  vw::Vector2 start;
+  bool success = point_to_pixel_newton(point, starty, start);
+  if (success && !m_correct_velocity_or_atmosphere)
+    return start;
+  
   // Use the uncorrected function to get a fast but good starting seed.
   vw::camera::CameraGenericLMA model(this, point);
   int status = -1;
-  vw::Vector2 start = point_to_pixel_uncorrected(point, starty);
+  if (!success)
+    start = point_to_pixel_uncorrected(point, starty);
   
   // Run the solver
   vw::Vector3 objective(0, 0, 0);
@@ -580,6 +711,27 @@ vw::Vector2 DGCameraModel::point_to_pixel(vw::Vector3 const& point, double start
   return solution;
 }
   
+// Project many points, using each solution to initialize the next one
+void DGCameraModel::point_to_pixel(std::vector<vw::Vector3> const& points,
+                                   std::vector<vw::Vector2>      & pixels) const {
+
+  double nan = std::numeric_limits<double>::quiet_NaN();
+  pixels.resize(points.size());
+  
+  double starty = -1.0;
+  for (size_t it = 0; it < points.size(); it++) {
+    try {
+      if (stereo_settings().dg_use_csm)
+        pixels[it] = point_to_pixel(points[it]);
+      else
+        pixels[it] = point_to_pixel(points[it], starty);
+      starty = pixels[it].y();
+    } catch (...) {
+      pixels[it] = vw::Vector2(nan, nan);
+    }
+  }
+}
+  
 // Camera pose
 vw::Quaternion<double> DGCameraModel::camera_pose(vw::Vector2 const& pix) const {
 
@@ -33,6 +33,8 @@
 #include <vw/Cartography/Datum.h>
 #include <vw/Math/EulerAngles.h>
 
+#include <asp/Camera/LinescanTables.h>
+
 // Forward declaration
 class UsgsAstroLsSensorModel;
 
@@ -302,6 +304,13 @@ namespace asp {
     
     // Override this implementation with a faster, more specialized implementation.
     virtual vw::Vector2 point_to_pixel(vw::Vector3 const& point, double starty) const;
+
+    /// Project many points. The solution for each point is used as the
+    /// initial guess for the next one, so this is fastest when consecutive
+    /// points project close to each other. Points which fail to project
+    /// get a NaN pixel.
+    void point_to_pixel(std::vector<vw::Vector3> const& points,
+                        std::vector<vw::Vector2>      & pixels) const;
     
     // Camera pose
     virtual vw::Quaternion<double> camera_pose(vw::Vector2 const& pix) const;
@@ -309,6 +318,14 @@ namespace asp {
     /// Gives the camera position in world coordinates.
     virtual vw::Vector3 camera_center(vw::Vector2 const& pix) const;
 
+    /// Resample the position, velocity, and pose interpolants onto
+    /// tables which are faster to evaluate, and use those from now on.
+    /// This is done in the constructor with --dg-interpolation-tables.
+    /// A table is not used if it cannot be made to agree with its
+    /// interpolant to within 1e-6 meters (or meters per second) and
+    /// 1e-10 radians. Return true if all tables are in use.
+    bool buildInterpTables();
+
     // CsmModel is ASP's wrapper around the CSM model. It holds a smart pointer
     // to the CSM linescan model, which is of type UsgsAstroLsSensorModel.
     boost::shared_ptr<CsmModel> m_csm_model; // wrapper
@@ -332,6 +349,20 @@ namespace asp {
     // given line. This is analogous to LinescanLMA logic.
     double errorFunc(double y, vw::Vector3 const& point) const;
 
+    // Find the line at which errorFunc() is zero with Newton's method,
+    // using the analytic derivatives of the position and pose
+    // interpolants, then the sample. This ignores velocity aberration
+    // and atmospheric refraction. Return false if the solver fails.
+    bool point_to_pixel_newton(vw::Vector3 const& point, double starty,
+                               vw::Vector2 & pix) const;
+
+    // If true, the Newton solution above is not exact and must be refined
+    bool m_correct_velocity_or_atmosphere;
+
+    // Faster versions of the interpolants, if built
+    CubicTable m_position_table, m_velocity_table;
+    PoseTable  m_pose_table;
+
     // Digital Globe implementation using CSM. Eventually this will
     // replace LinescanDGModel, and the class
     // PiecewiseAdjustedLinescanModel will go away as well.  Note that the
@@ -0,0 +1,79 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+/// \file LinescanModelPool.cc
+
+#include <asp/Camera/LinescanModelPool.h>
+
+#include <usgscsm/UsgsAstroLsSensorModel.h>
+
+#include <algorithm>
+
+namespace asp {
+
+const int NUM_XYZ_PARAMS  = 3;
+const int NUM_QUAT_PARAMS = 4;
+
+LsModelPool::LsModelPool(UsgsAstroLsSensorModel const* ls_model):
+  m_ls_model(ls_model), m_version(0) {}
+
+LsModelPool::Entry LsModelPool::acquire() {
+  Entry entry;
+  bool have_entry = false;
+  int version = 0;
+  {
+    vw::Mutex::Lock lock(m_mutex);
+    version = m_version;
+    if (!m_entries.empty()) {
+      entry = m_entries.back();
+      m_entries.pop_back();
+      have_entry = true;
+    }
+  }
+
+  if (!have_entry) {
+    entry.model.reset(new UsgsAstroLsSensorModel(*m_ls_model));
+  } else if (entry.version != version) {
+    // The model changed since this copy was last used
+    entry.model->m_quaternions = m_ls_model->m_quaternions;
+    entry.model->m_positions   = m_ls_model->m_positions;
+  }
+  entry.version = version;
+
+  return entry;
+}
+
+void LsModelPool::release(Entry const& entry, int begQuatIndex, int endQuatIndex,
+                          int begPosIndex, int endPosIndex) {
+  UsgsAstroLsSensorModel * model = entry.model.get();
+  std::copy(m_ls_model->m_quaternions.begin() + NUM_QUAT_PARAMS * begQuatIndex,
+            m_ls_model->m_quaternions.begin() + NUM_QUAT_PARAMS * endQuatIndex,
+            model->m_quaternions.begin() + NUM_QUAT_PARAMS * begQuatIndex);
+  std::copy(m_ls_model->m_positions.begin() + NUM_XYZ_PARAMS * begPosIndex,
+            m_ls_model->m_positions.begin() + NUM_XYZ_PARAMS * endPosIndex,
+            model->m_positions.begin() + NUM_XYZ_PARAMS * begPosIndex);
+
+  vw::Mutex::Lock lock(m_mutex);
+  m_entries.push_back(entry);
+}
+
+void LsModelPool::refresh() {
+  vw::Mutex::Lock lock(m_mutex);
+  m_version++;
+}
+
+} // end namespace asp
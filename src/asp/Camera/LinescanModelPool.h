@@ -0,0 +1,76 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+/// \file LinescanModelPool.h
+///
+/// Copies of a CSM linescan model, which can be modified while
+/// evaluating residuals, such as in jitter_solve, without copying the
+/// full model on every evaluation.
+
+#ifndef __STEREO_CAMERA_LINESCAN_MODEL_POOL_H__
+#define __STEREO_CAMERA_LINESCAN_MODEL_POOL_H__
+
+#include <vw/Core/Thread.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+class UsgsAstroLsSensorModel;
+
+namespace asp {
+
+  /// Each residual evaluation borrows a copy of the model, updates in
+  /// it only the few quaternions and positions it optimizes, and
+  /// returns it with these restored. So a copy agrees with the model
+  /// everywhere else. When the model changes, call refresh(). Then
+  /// each copy has all its quaternions and positions updated the
+  /// next time it is borrowed, so only once per change rather than
+  /// on every evaluation.
+  class LsModelPool {
+  public:
+    /// A borrowed copy, and the version of the model it agrees with
+    struct Entry {
+      boost::shared_ptr<UsgsAstroLsSensorModel> model;
+      int version;
+    };
+
+    LsModelPool(UsgsAstroLsSensorModel const* ls_model);
+
+    /// Borrow a copy of the model
+    Entry acquire();
+
+    /// Return a borrowed copy. The quaternions and positions in the
+    /// given index ranges, which the borrower may have modified, are
+    /// restored from the model.
+    void release(Entry const& entry, int begQuatIndex, int endQuatIndex,
+                 int begPosIndex, int endPosIndex);
+
+    /// Mark the copies as out of date, after the quaternions or
+    /// positions of the model changed
+    void refresh();
+
+  private:
+    UsgsAstroLsSensorModel const* m_ls_model;
+    std::vector<Entry> m_entries;
+    int m_version;
+    vw::Mutex m_mutex;
+  };
+
+} // end namespace asp
+
+#endif // __STEREO_CAMERA_LINESCAN_MODEL_POOL_H__
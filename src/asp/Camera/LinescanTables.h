@@ -0,0 +1,201 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+/// \file LinescanTables.h
+///
+/// Tables which stand in for the position, velocity, and pose
+/// interpolants of linescan cameras, and are faster to evaluate. The
+/// interpolants are resampled on a uniform time grid when the camera
+/// is loaded. Positions and velocities are stored as a cubic
+/// polynomial on each grid interval. Orientations are interpolated
+/// linearly between grid samples and normalized, which avoids the
+/// trigonometric functions of slerp. The grid is refined until the
+/// table agrees with the original interpolant to within a given
+/// tolerance, else the table is not used.
+
+#ifndef __STEREO_CAMERA_LINESCAN_TABLES_H__
+#define __STEREO_CAMERA_LINESCAN_TABLES_H__
+
+#include <vw/Math/Vector.h>
+#include <vw/Math/Quaternion.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace asp {
+
+  /// A vector-valued function of time, stored as a cubic polynomial on
+  /// each interval of a uniform grid.
+  class CubicTable {
+  public:
+    CubicTable(): m_t0(0.0), m_dt(1.0), m_num_intervals(0) {}
+
+    /// Resample a function on the grid starting at t0 with given
+    /// spacing and number of intervals. On each interval use the cubic
+    /// through the values of the function at the interval endpoints and
+    /// at the two points trisecting it.
+    template <class FuncT>
+    void build(FuncT const& func, double t0, double dt, int num_intervals) {
+      m_t0 = t0;
+      m_dt = dt;
+      m_num_intervals = num_intervals;
+      m_coeffs.resize(4 * num_intervals);
+
+      vw::Vector3 f0 = func(t0);
+      for (int it = 0; it < num_intervals; it++) {
+        double t = t0 + it * dt;
+        vw::Vector3 f1 = func(t + dt / 3.0);
+        vw::Vector3 f2 = func(t + 2.0 * dt / 3.0);
+        vw::Vector3 f3 = func(t0 + (it + 1) * dt);
+
+        // Newton forward differences, then the coefficients in the
+        // local coordinate s in [0, 1].
+        vw::Vector3 d1 = f1 - f0, d2 = f2 - 2.0 * f1 + f0, d3 = f3 - 3.0 * f2 + 3.0 * f1 - f0;
+        m_coeffs[4 * it + 0] = f0;
+        m_coeffs[4 * it + 1] = 3.0 * (d1 - d2 / 2.0 + d3 / 3.0);
+        m_coeffs[4 * it + 2] = 9.0 * (d2 - d3) / 2.0;
+        m_coeffs[4 * it + 3] = 27.0 * d3 / 6.0;
+
+        f0 = f3;
+      }
+    }
+
+    /// If the table is built and the time is within its range
+    bool in_range(double t) const {
+      return m_num_intervals > 0 && t >= m_t0 && t <= m_t0 + m_num_intervals * m_dt;
+    }
+
+    /// Evaluate the table. The time must be within its range.
+    vw::Vector3 operator()(double t) const {
+      double s = (t - m_t0) / m_dt;
+      int it = std::max(0, std::min(int(s), m_num_intervals - 1));
+      s -= it;
+      vw::Vector3 const* c = &m_coeffs[4 * it];
+      return c[0] + s * (c[1] + s * (c[2] + s * c[3]));
+    }
+
+    /// The largest distance from the function, checked halfway
+    /// between the points the cubics were fit to.
+    template <class FuncT>
+    double max_error(FuncT const& func) const {
+      double err = 0.0;
+      for (int it = 0; it < m_num_intervals; it++) {
+        for (double s: {1.0/6.0, 0.5, 5.0/6.0}) {
+          double t = m_t0 + (it + s) * m_dt;
+          double e = norm_2((*this)(t) - func(t));
+          if (std::isnan(e))
+            return e;
+          err = std::max(err, e);
+        }
+      }
+      return err;
+    }
+
+  private:
+    double m_t0, m_dt;
+    int    m_num_intervals;
+    std::vector<vw::Vector3> m_coeffs; // four per interval, starting with the constant term
+  };
+
+  /// An orientation as a function of time, sampled on a uniform grid.
+  /// The quaternions are interpolated linearly and normalized.
+  class PoseTable {
+  public:
+    PoseTable(): m_t0(0.0), m_dt(1.0), m_num_intervals(0) {}
+
+    template <class FuncT>
+    void build(FuncT const& func, double t0, double dt, int num_intervals) {
+      m_t0 = t0;
+      m_dt = dt;
+      m_num_intervals = num_intervals;
+      m_samples.resize(num_intervals + 1);
+      for (int it = 0; it <= num_intervals; it++) {
+        vw::Quat q = func(t0 + it * dt);
+        // Keep consecutive samples in the same hemisphere, so the
+        // interpolation takes the shortest path.
+        if (it > 0) {
+          vw::Quat const& p = m_samples[it - 1];
+          if (p.w() * q.w() + p.x() * q.x() + p.y() * q.y() + p.z() * q.z() < 0.0)
+            q = vw::Quat(-q.w(), -q.x(), -q.y(), -q.z());
+        }
+        m_samples[it] = q;
+      }
+    }
+
+    /// If the table is built and the time is within its range
+    bool in_range(double t) const {
+      return m_num_intervals > 0 && t >= m_t0 && t <= m_t0 + m_num_intervals * m_dt;
+    }
+
+    /// Evaluate the table. The time must be within its range.
+    vw::Quat operator()(double t) const {
+      double s = (t - m_t0) / m_dt;
+      int it = std::max(0, std::min(int(s), m_num_intervals - 1));
+      s -= it;
+      vw::Quat const& a = m_samples[it];
+      vw::Quat const& b = m_samples[it + 1];
+      double w = a.w() + s * (b.w() - a.w()), x = a.x() + s * (b.x() - a.x());
+      double y = a.y() + s * (b.y() - a.y()), z = a.z() + s * (b.z() - a.z());
+      double len = std::sqrt(w * w + x * x + y * y + z * z);
+      return vw::Quat(w / len, x / len, y / len, z / len);
+    }
+
+    /// The largest angle, in radians, between the rotations given by
+    /// the table and the function, checked between the samples.
+    template <class FuncT>
+    double max_error(FuncT const& func) const {
+      double err = 0.0;
+      for (int it = 0; it < m_num_intervals; it++) {
+        for (double s: {0.25, 0.5, 0.75}) {
+          double t = m_t0 + (it + s) * m_dt;
+          vw::Quat d = inverse(func(t)) * (*this)(t);
+          double sin_half = std::sqrt(d.x() * d.x() + d.y() * d.y() + d.z() * d.z());
+          double e = 2.0 * std::atan2(sin_half, std::abs(d.w()));
+          if (std::isnan(e))
+            return e;
+          err = std::max(err, e);
+        }
+      }
+      return err;
+    }
+
+  private:
+    double m_t0, m_dt;
+    int    m_num_intervals;
+    std::vector<vw::Quat> m_samples;
+  };
+
+  /// Build a table for a function sampled on the given grid. Each grid
+  /// interval is split into 1, 2, 4, ..., max_subdivisions pieces until
+  /// the table is within the tolerance of the function. If that does
+  /// not happen, the table is cleared and false is returned.
+  template <class TableT, class FuncT>
+  bool build_linescan_table(FuncT const& func, double t0, double dt, int num_intervals,
+                            double tol, int max_subdivisions, TableT & table) {
+    for (int k = 1; k <= max_subdivisions; k *= 2) {
+      table.build(func, t0, dt / k, num_intervals * k);
+      if (table.max_error(func) <= tol)
+        return true;
+    }
+    table = TableT();
+    return false;
+  }
+
+} // end namespace asp
+
+#endif // __STEREO_CAMERA_LINESCAN_TABLES_H__
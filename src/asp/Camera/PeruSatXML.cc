@@ -27,13 +27,10 @@
 #include <asp/Camera/XMLBase.h>
 #include <asp/Camera/TimeProcessing.h>
 
-#include <xercesc/parsers/XercesDOMParser.hpp>
-#include <xercesc/sax/HandlerBase.hpp>
 #include <xercesc/sax/SAXException.hpp>
 #include <xercesc/sax/SAXParseException.hpp>
 #include <xercesc/dom/DOMException.hpp>
 #include <xercesc/util/PlatformUtils.hpp>
-#include <xercesc/sax/ErrorHandler.hpp>
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
@@ -60,20 +57,23 @@ DOMElement* PeruSatXML::open_xml_file(std::string const& xml_path) {
   std::string err_message  = ""; // Filled in later on error
 
   try{
-    // Set up the XML parser if we have not already done so
+    // Set up the XML parser if we have not already done so. The long
+    // lists are read as the file is parsed and not kept in the tree.
     if (!m_parser.get()) {
-      m_parser.reset(new XercesDOMParser());
-      m_err_handler.reset(new HandlerBase());
-      m_parser->setValidationScheme(XercesDOMParser::Val_Always);
-      m_parser->setDoNamespaces(true);   
-      m_parser->setErrorHandler(m_err_handler.get());
+      m_parser.reset(new XmlUtils::StreamingParser());
+      m_parser->add_callback("Point_List", "Point",
+                             [this](DOMElement* node) { read_ephemeris_point(node); });
+      m_parser->add_callback("Quaternion_List", "Quaternion",
+                             [this](DOMElement* node) { read_quaternion(node); });
     }
 
+    // Reset data storage, as the lists are filled during parsing
+    m_position_logs.clear();
+    m_velocity_logs.clear();
+    m_quaternion_logs.clear();
+
     // Load the XML file
-    m_parser->parse(xml_path.c_str());
-    DOMDocument* doc  = m_parser->getDocument();
-    DOMElement * root = doc->getDocumentElement();
-    return root;
+    return m_parser->parse(xml_path);
 
   } catch (const XMLException& toCatch) {
     char* message = XMLString::transcode(toCatch.getMessage());
@@ -167,13 +167,9 @@ void PeruSatXML::read_times(xercesc::DOMElement* time) {
   
 void PeruSatXML::read_ephemeris(xercesc::DOMElement* ephemeris) {
 
-  // Reset data storage
-  m_positions.clear(); 
-  m_velocities.clear();
-
   xercesc::DOMElement* point_list = get_node<DOMElement>(ephemeris, "Point_List");
 
-  // Pick out the "Point" nodes
+  // Pick out the "Point" nodes not read during parsing
   DOMNodeList* children = point_list->getChildNodes();
   for (XMLSize_t i = 0; i < children->getLength(); i++) {
     
@@ -188,35 +184,48 @@ void PeruSatXML::read_ephemeris(xercesc::DOMElement* ephemeris) {
     if (tag.find("Point") == std::string::npos)
       continue;
 
-    // Get the three sub-nodes
-    std::string time_str, position_str, velocity_str;
-    Vector3 position_vec, velocity_vec;
-    
-    cast_xmlch(get_node<DOMElement>(curr_element, "LOCATION_XYZ")->getTextContent(), position_str);
-    cast_xmlch(get_node<DOMElement>(curr_element, "VELOCITY_XYZ")->getTextContent(), velocity_str);
-    cast_xmlch(get_node<DOMElement>(curr_element, "TIME")->getTextContent(),         time_str);
+    read_ephemeris_point(curr_element);
+  } // End loop through points
 
-    bool is_start_time = false;
-    double time = PeruSatXML::convert_time(time_str, is_start_time);
-    
-    std::string delimiters(",\t ");
-    position_vec = str_to_vec<Vector3>(position_str, delimiters);
-    velocity_vec = str_to_vec<Vector3>(velocity_str, delimiters);
+  // Convert the times, now that the start time is known
+  m_positions.clear(); 
+  m_velocities.clear();
+  VectorLogs const& positions  = m_position_logs[point_list];
+  VectorLogs const& velocities = m_velocity_logs[point_list];
+  bool is_start_time = false;
+  for (auto it = positions.begin(); it != positions.end(); it++)
+    m_positions.push_back(std::pair<double, Vector3>
+                          (PeruSatXML::convert_time(it->first, is_start_time), it->second));
+  for (auto it = velocities.begin(); it != velocities.end(); it++)
+    m_velocities.push_back(std::pair<double, Vector3>
+                           (PeruSatXML::convert_time(it->first, is_start_time), it->second));
+  m_position_logs.erase(point_list);
+  m_velocity_logs.erase(point_list);
+}
 
-    m_positions.push_back(std::pair<double, Vector3>(time, position_vec));
-    m_velocities.push_back(std::pair<double, Vector3>(time, velocity_vec));
-  } // End loop through points
-  
+void PeruSatXML::read_ephemeris_point(xercesc::DOMElement* point) {
+
+  // Get the three sub-nodes
+  std::string time_str, position_str, velocity_str;
+  cast_xmlch(get_node<DOMElement>(point, "LOCATION_XYZ")->getTextContent(), position_str);
+  cast_xmlch(get_node<DOMElement>(point, "VELOCITY_XYZ")->getTextContent(), velocity_str);
+  cast_xmlch(get_node<DOMElement>(point, "TIME")->getTextContent(),         time_str);
+
+  std::string delimiters(",\t ");
+  DOMNode const* point_list = point->getParentNode();
+  m_position_logs[point_list].push_back(std::make_pair(time_str,
+                                                       str_to_vec<Vector3>(position_str,
+                                                                           delimiters)));
+  m_velocity_logs[point_list].push_back(std::make_pair(time_str,
+                                                       str_to_vec<Vector3>(velocity_str,
+                                                                           delimiters)));
 }
   
 void PeruSatXML::read_attitudes(xercesc::DOMElement* attitudes) {
 
-  // Reset data storage
-  m_poses.clear();
-
   xercesc::DOMElement* quaternion_list = get_node<DOMElement>(attitudes, "Quaternion_List");
 
-  // Pick out the "Quaternion" nodes
+  // Pick out the "Quaternion" nodes not read during parsing
   DOMNodeList* children = quaternion_list->getChildNodes();
   for (XMLSize_t i = 0; i < children->getLength(); i++) {
     
@@ -230,29 +239,36 @@ void PeruSatXML::read_attitudes(xercesc::DOMElement* attitudes) {
     std::string tag(XMLString::transcode(curr_element->getTagName()));
     if (tag.find("Quaternion") == std::string::npos)
       continue;
-  
-    // Parse the time and 
-
-    std::pair<double, vw::Quaternion<double>> data;
-    std::string time_str;
-    cast_xmlch(get_node<DOMElement>(curr_element, "TIME")->getTextContent(), time_str);
 
-    bool is_start_time = false;
-    data.first = PeruSatXML::convert_time(time_str, is_start_time);
-    
-    double w, x, y, z;
-    cast_xmlch(get_node<DOMElement>(curr_element, "Q0")->getTextContent(), w);
-    cast_xmlch(get_node<DOMElement>(curr_element, "Q1")->getTextContent(), x);
-    cast_xmlch(get_node<DOMElement>(curr_element, "Q2")->getTextContent(), y);
-    cast_xmlch(get_node<DOMElement>(curr_element, "Q3")->getTextContent(), z);
-    data.second = vw::Quaternion<double>(w, x, y, z);
-
-    // Normalize the quaternions to remove any inaccuracy due to the
-    // limited precision used to save them on disk.
-    data.second = normalize(data.second);
-    
-    m_poses.push_back(data);
+    read_quaternion(curr_element);
   } // End loop through attitudes
+
+  // Convert the times, now that the start time is known
+  m_poses.clear();
+  QuaternionLogs const& quaternions = m_quaternion_logs[quaternion_list];
+  bool is_start_time = false;
+  for (auto it = quaternions.begin(); it != quaternions.end(); it++)
+    m_poses.push_back(std::pair<double, vw::Quaternion<double>>
+                      (PeruSatXML::convert_time(it->first, is_start_time), it->second));
+  m_quaternion_logs.erase(quaternion_list);
+}
+
+void PeruSatXML::read_quaternion(xercesc::DOMElement* quaternion) {
+
+  std::string time_str;
+  cast_xmlch(get_node<DOMElement>(quaternion, "TIME")->getTextContent(), time_str);
+
+  double w, x, y, z;
+  cast_xmlch(get_node<DOMElement>(quaternion, "Q0")->getTextContent(), w);
+  cast_xmlch(get_node<DOMElement>(quaternion, "Q1")->getTextContent(), x);
+  cast_xmlch(get_node<DOMElement>(quaternion, "Q2")->getTextContent(), y);
+  cast_xmlch(get_node<DOMElement>(quaternion, "Q3")->getTextContent(), z);
+
+  // Normalize the quaternions to remove any inaccuracy due to the
+  // limited precision used to save them on disk.
+  vw::Quaternion<double> q = normalize(vw::Quaternion<double>(w, x, y, z));
+
+  m_quaternion_logs[quaternion->getParentNode()].push_back(std::make_pair(time_str, q));
 }
 
 void PeruSatXML::read_look_angles(xercesc::DOMElement* look_angles) {
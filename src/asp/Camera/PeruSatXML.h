@@ -33,6 +33,8 @@
 #include <vw/Camera/Extrinsics.h>
 #include <asp/Core/Common.h>
 
+#include <list>
+#include <map>
 #include <vector>
 #include <string>
 
@@ -44,12 +46,15 @@
 XERCES_CPP_NAMESPACE_BEGIN
   class DOMDocument;
   class DOMElement;
-  class XercesDOMParser;
-  class ErrorHandler;
+  class DOMNode;
 XERCES_CPP_NAMESPACE_END
 
 namespace asp {
 
+  namespace XmlUtils {
+    class StreamingParser;
+  }
+
   class PeruSatXML {
   public:
 
@@ -84,6 +89,14 @@ namespace asp {
     void read_times       (xercesc::DOMElement* time);
     void read_ephemeris   (xercesc::DOMElement* ephemeris);
     void read_attitudes   (xercesc::DOMElement* attitudes);
+
+    // Read one ephemeris point or quaternion. These are called as soon
+    // as the parser reaches each item, and by the functions above for
+    // the items still in the tree. The times are converted later, as
+    // the items may be read before the start time.
+    void read_ephemeris_point(xercesc::DOMElement* point);
+    void read_quaternion     (xercesc::DOMElement* quaternion);
+
     void read_look_angles (xercesc::DOMElement* look_angles);
     void read_instr_biases(xercesc::DOMElement* instr_biases);
     void read_center_data (xercesc::DOMElement* geom_values);
@@ -106,9 +119,15 @@ namespace asp {
     std::list<std::pair<double, vw::Vector3>> m_positions;        // (time,   X/Y/Z)
     std::list<std::pair<double, vw::Vector3>> m_velocities;       // (time,   dX/dY/dZ)
     std::list<std::pair<double, vw::Quaternion<double>>> m_poses; // (time, quaternion)
+
+    // The lists as read, with the times not yet converted, for each
+    // list node, as the file may have other lists with the same tags
+    typedef std::list<std::pair<std::string, vw::Vector3>> VectorLogs; // (time, vector)
+    typedef std::list<std::pair<std::string, vw::Quaternion<double>>> QuaternionLogs;
+    std::map<xercesc::DOMNode const*, VectorLogs> m_position_logs, m_velocity_logs;
+    std::map<xercesc::DOMNode const*, QuaternionLogs> m_quaternion_logs;
     
-    boost::shared_ptr<xercesc::XercesDOMParser> m_parser;
-    boost::shared_ptr<xercesc::ErrorHandler>    m_err_handler;
+    boost::shared_ptr<XmlUtils::StreamingParser> m_parser;
     
   }; // End class PeruSatXML
 
@@ -28,13 +28,10 @@
 #include <asp/Camera/XMLBase.h>
 #include <asp/Camera/TimeProcessing.h>
 
-#include <xercesc/parsers/XercesDOMParser.hpp>
-#include <xercesc/sax/HandlerBase.hpp>
 #include <xercesc/sax/SAXException.hpp>
 #include <xercesc/sax/SAXParseException.hpp>
 #include <xercesc/dom/DOMException.hpp>
 #include <xercesc/util/PlatformUtils.hpp>
-#include <xercesc/sax/ErrorHandler.hpp>
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
@@ -61,20 +58,20 @@ DOMElement* PleiadesXML::open_xml_file(std::string const& xml_path) {
   std::string err_message  = ""; // Filled in later on error
 
   try{
-    // Set up the XML parser if we have not already done so
+    // Set up the XML parser if we have not already done so. The long
+    // lists are read as the file is parsed and not kept in the tree.
     if (!m_parser.get()) {
-      m_parser.reset(new XercesDOMParser());
-      m_err_handler.reset(new HandlerBase());
-      m_parser->setValidationScheme(XercesDOMParser::Val_Always);
-      m_parser->setDoNamespaces(true);   
-      m_parser->setErrorHandler(m_err_handler.get());
+      m_parser.reset(new XmlUtils::StreamingParser());
+      m_parser->add_callback("Point_List", "Point",
+                             [this](DOMElement* node) { read_ephemeris_point(node); });
     }
 
+    // Reset data storage, as the lists are filled during parsing
+    m_position_logs.clear();
+    m_velocity_logs.clear();
+
     // Load the XML file
-    m_parser->parse(xml_path.c_str());
-    DOMDocument* doc  = m_parser->getDocument();
-    DOMElement * root = doc->getDocumentElement();
-    return root;
+    return m_parser->parse(xml_path);
 
   } catch (const XMLException& toCatch) {
     char* message = XMLString::transcode(toCatch.getMessage());
@@ -170,17 +167,12 @@ void PleiadesXML::read_times(xercesc::DOMElement* time) {
   
 void PleiadesXML::read_ephemeris(xercesc::DOMElement* ephemeris) {
 
-  // Reset data storage
-  m_positions.clear(); 
-  m_velocities.clear();
-
   xercesc::DOMElement* ephemeris_used = get_node<DOMElement>(ephemeris, "EPHEMERIS_USED");
 
   xercesc::DOMElement* point_list = get_node<DOMElement>(ephemeris, "Point_List");
 
-  // Pick out the "Point" nodes
+  // Pick out the "Point" nodes not read during parsing
   DOMNodeList* children = point_list->getChildNodes();
-
   for (XMLSize_t i = 0; i < children->getLength(); i++) {
     
     // Check child node type
@@ -194,29 +186,47 @@ void PleiadesXML::read_ephemeris(xercesc::DOMElement* ephemeris) {
     if (tag.find("Point") == std::string::npos)
       continue;
 
-    // Get the three sub-nodes
-    std::string time_str, position_str, velocity_str;
-    Vector3 position_vec, velocity_vec;
-    
-    cast_xmlch(get_node<DOMElement>(curr_element, "LOCATION_XYZ")->getTextContent(), position_str);
-    cast_xmlch(get_node<DOMElement>(curr_element, "VELOCITY_XYZ")->getTextContent(), velocity_str);
-    cast_xmlch(get_node<DOMElement>(curr_element, "TIME")->getTextContent(),         time_str);
-
-    bool is_start_time = false;
-    double time = PleiadesXML::convert_time(time_str, is_start_time);
-    std::string delimiters(",\t ");
-    position_vec = str_to_vec<Vector3>(position_str, delimiters);
-    velocity_vec = str_to_vec<Vector3>(velocity_str, delimiters);
-
-    m_positions.push_back(std::pair<double, Vector3>(time, position_vec));
-    m_velocities.push_back(std::pair<double, Vector3>(time, velocity_vec));
+    read_ephemeris_point(curr_element);
   } // End loop through points
 
+  // Convert the times, now that the start time is known
+  m_positions.clear(); 
+  m_velocities.clear();
+  VectorLogs const& positions  = m_position_logs[point_list];
+  VectorLogs const& velocities = m_velocity_logs[point_list];
+  bool is_start_time = false;
+  for (auto it = positions.begin(); it != positions.end(); it++)
+    m_positions.push_back(std::pair<double, Vector3>
+                          (PleiadesXML::convert_time(it->first, is_start_time), it->second));
+  for (auto it = velocities.begin(); it != velocities.end(); it++)
+    m_velocities.push_back(std::pair<double, Vector3>
+                           (PleiadesXML::convert_time(it->first, is_start_time), it->second));
+  m_position_logs.erase(point_list);
+  m_velocity_logs.erase(point_list);
+
   // Sanity check
   if (m_positions.size() < 2)
   vw_throw(ArgumentErr() << "Expecting to read at least two positions from the xml .\n");  
 }
 
+void PleiadesXML::read_ephemeris_point(xercesc::DOMElement* point) {
+
+  // Get the three sub-nodes
+  std::string time_str, position_str, velocity_str;
+  cast_xmlch(get_node<DOMElement>(point, "LOCATION_XYZ")->getTextContent(), position_str);
+  cast_xmlch(get_node<DOMElement>(point, "VELOCITY_XYZ")->getTextContent(), velocity_str);
+  cast_xmlch(get_node<DOMElement>(point, "TIME")->getTextContent(),         time_str);
+
+  std::string delimiters(",\t ");
+  DOMNode const* point_list = point->getParentNode();
+  m_position_logs[point_list].push_back(std::make_pair(time_str,
+                                                       str_to_vec<Vector3>(position_str,
+                                                                           delimiters)));
+  m_velocity_logs[point_list].push_back(std::make_pair(time_str,
+                                                       str_to_vec<Vector3>(velocity_str,
+                                                                           delimiters)));
+}
+
 // Given a calendar time, find the midnight time. Just put zeros for hours, minutes, and seconds.
 // An input time looks like: 2022-04-13T22:46:31.4540000
 void calc_midnight_time(std::string const& start_time, std::string& midnight_time) {
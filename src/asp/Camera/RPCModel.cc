@@ -33,6 +33,33 @@ using namespace vw;
 
 namespace asp {
 
+  namespace {
+
+    // Evaluate the RPC cubic polynomial with the given 20 coefficients,
+    // in the term order of RPCModel::calculate_terms(), using Horner's
+    // scheme in x. This avoids forming the 20 terms explicitly.
+    inline double rpc_poly(const double * c, double x, double y, double z) {
+      double A = c[0] + z*(c[3] + z*(c[9] + c[19]*z))
+        + y*(c[2] + z*(c[6] + c[16]*z) + y*(c[8] + c[18]*z + c[15]*y));
+      double B = c[1] + z*(c[5] + c[13]*z) + y*(c[4] + c[10]*z + c[12]*y);
+      double C = c[7] + c[14]*y + c[17]*z;
+      return A + x*(B + x*(C + x*c[11]));
+    }
+
+    // The partial derivatives of rpc_poly() in x, y, and z
+    inline void rpc_poly_grad(const double * c, double x, double y, double z,
+                              double & dx, double & dy, double & dz) {
+      double B = c[1] + z*(c[5] + c[13]*z) + y*(c[4] + c[10]*z + c[12]*y);
+      double C = c[7] + c[14]*y + c[17]*z;
+      dx = B + x*(2.0*C + 3.0*c[11]*x);
+      dy = c[2] + z*(c[6] + c[16]*z) + y*(2.0*c[8] + 2.0*c[18]*z + 3.0*c[15]*y)
+        + x*(c[4] + c[10]*z + 2.0*c[12]*y + c[14]*x);
+      dz = c[3] + z*(2.0*c[9] + 3.0*c[19]*z + 2.0*c[13]*x + 2.0*c[16]*y)
+        + x*(c[5] + c[10]*y + c[17]*x) + y*(c[6] + c[18]*y);
+    }
+    
+  } // end anonymous namespace
+  
   void RPCModel::initialize(DiskImageResourceGDAL* resource) {
     // Extract the datum (by means of georeference)
     cartography::GeoReference georef;
@@ -565,6 +592,163 @@ namespace asp {
     return dir;
   }
 
+  void RPCModel::geodetic_to_pixel(int n, const double * lon, const double * lat,
+                                   const double * height, double * x, double * y) const {
+
+    const double * ln = &m_line_num_coeff[0];
+    const double * ld = &m_line_den_coeff[0];
+    const double * sn = &m_sample_num_coeff[0];
+    const double * sd = &m_sample_den_coeff[0];
+    
+    for (int i = 0; i < n; i++) {
+      double u = (lon[i]    - m_lonlatheight_offset[0]) / m_lonlatheight_scale[0];
+      double v = (lat[i]    - m_lonlatheight_offset[1]) / m_lonlatheight_scale[1];
+      double w = (height[i] - m_lonlatheight_offset[2]) / m_lonlatheight_scale[2];
+      x[i] = m_xy_scale[0] * rpc_poly(sn, u, v, w) / rpc_poly(sd, u, v, w) + m_xy_offset[0];
+      y[i] = m_xy_scale[1] * rpc_poly(ln, u, v, w) / rpc_poly(ld, u, v, w) + m_xy_offset[1];
+    }
+  }
+
+  void RPCModel::geodetic_to_pixel_Jacobian(int n, const double * lon, const double * lat,
+                                            const double * height, double * J) const {
+
+    const double * coeffs[4] = {&m_sample_num_coeff[0], &m_sample_den_coeff[0],
+                                &m_line_num_coeff[0],   &m_line_den_coeff[0]};
+    
+    for (int i = 0; i < n; i++) {
+      double u = (lon[i]    - m_lonlatheight_offset[0]) / m_lonlatheight_scale[0];
+      double v = (lat[i]    - m_lonlatheight_offset[1]) / m_lonlatheight_scale[1];
+      double w = (height[i] - m_lonlatheight_offset[2]) / m_lonlatheight_scale[2];
+
+      // Row 0 is the sample, row 1 is the line
+      for (int row = 0; row < 2; row++) {
+        const double * num = coeffs[2*row], * den = coeffs[2*row + 1];
+        double N = rpc_poly(num, u, v, w), D = rpc_poly(den, u, v, w);
+        double dN[3], dD[3];
+        rpc_poly_grad(num, u, v, w, dN[0], dN[1], dN[2]);
+        rpc_poly_grad(den, u, v, w, dD[0], dD[1], dD[2]);
+        for (int col = 0; col < 3; col++)
+          J[6*i + 3*row + col] = m_xy_scale[row] * (dN[col]*D - N*dD[col]) / (D*D)
+            / m_lonlatheight_scale[col];
+      }
+    }
+  }
+
+  void RPCModel::point_to_pixel(std::vector<vw::Vector3> const& points,
+                                std::vector<vw::Vector2>      & pixels) const {
+
+    int n = points.size();
+    std::vector<double> lon(n), lat(n), height(n), x(n), y(n);
+    for (int i = 0; i < n; i++) {
+      Vector3 llh = m_datum.cartesian_to_geodetic(points[i]);
+      lon[i] = llh[0]; lat[i] = llh[1]; height[i] = llh[2];
+    }
+
+    geodetic_to_pixel(n, &lon[0], &lat[0], &height[0], &x[0], &y[0]);
+
+    pixels.resize(n);
+    for (int i = 0; i < n; i++)
+      pixels[i] = Vector2(x[i], y[i]);
+  }
+
+  void RPCModel::image_to_ground(int n, const double * x, const double * y,
+                                 const double * height, double * lon, double * lat) const {
+
+    // See the single-point image_to_ground() for the details. Here
+    // Newton's method is done in normalized coordinates for all points at
+    // once, skipping the ones which converged.
+    double abs_tolerance = 1e-6;
+    std::vector<double> u(n), v(n), w(n), px(n), py(n);
+    std::vector<char> done(n, 0);
+    for (int i = 0; i < n; i++) {
+      px[i] = (x[i] - m_xy_offset[0]) / m_xy_scale[0];
+      py[i] = (y[i] - m_xy_offset[1]) / m_xy_scale[1];
+      u[i]  = (lon[i] - m_lonlatheight_offset[0]) / m_lonlatheight_scale[0];
+      v[i]  = (lat[i] - m_lonlatheight_offset[1]) / m_lonlatheight_scale[1];
+      w[i]  = (height[i] - m_lonlatheight_offset[2]) / m_lonlatheight_scale[2];
+      double len = sqrt(u[i]*u[i] + v[i]*v[i]);
+      if (len != len || len > 1.5) {
+        u[i] = 0.0;
+        v[i] = 0.0;
+      }
+    }
+
+    const double * ln = &m_line_num_coeff[0];
+    const double * ld = &m_line_den_coeff[0];
+    const double * sn = &m_sample_num_coeff[0];
+    const double * sd = &m_sample_den_coeff[0];
+
+    for (int iter = 0; iter < 10; iter++) {
+      for (int i = 0; i < n; i++) {
+        if (done[i])
+          continue;
+
+        double Ns = rpc_poly(sn, u[i], v[i], w[i]), Ds = rpc_poly(sd, u[i], v[i], w[i]);
+        double Nl = rpc_poly(ln, u[i], v[i], w[i]), Dl = rpc_poly(ld, u[i], v[i], w[i]);
+        double dNs[3], dDs[3], dNl[3], dDl[3];
+        rpc_poly_grad(sn, u[i], v[i], w[i], dNs[0], dNs[1], dNs[2]);
+        rpc_poly_grad(sd, u[i], v[i], w[i], dDs[0], dDs[1], dDs[2]);
+        rpc_poly_grad(ln, u[i], v[i], w[i], dNl[0], dNl[1], dNl[2]);
+        rpc_poly_grad(ld, u[i], v[i], w[i], dDl[0], dDl[1], dDl[2]);
+
+        // The Jacobian in normalized lon and lat, and its inverse
+        double J00 = (dNs[0]*Ds - Ns*dDs[0]) / (Ds*Ds);
+        double J01 = (dNs[1]*Ds - Ns*dDs[1]) / (Ds*Ds);
+        double J10 = (dNl[0]*Dl - Nl*dDl[0]) / (Dl*Dl);
+        double J11 = (dNl[1]*Dl - Nl*dDl[1]) / (Dl*Dl);
+        double det = J00*J11 - J01*J10;
+
+        double ex = Ns/Ds - px[i], ey = Nl/Dl - py[i];
+        u[i] -= ( J11*ex - J01*ey) / det;
+        v[i] -= (-J10*ex + J00*ey) / det;
+
+        if (sqrt(ex*ex + ey*ey) < abs_tolerance)
+          done[i] = 1;
+      }
+    }
+
+    for (int i = 0; i < n; i++) {
+      lon[i] = u[i] * m_lonlatheight_scale[0] + m_lonlatheight_offset[0];
+      lat[i] = v[i] * m_lonlatheight_scale[1] + m_lonlatheight_offset[1];
+    }
+  }
+
+  void RPCModel::point_and_dir(std::vector<vw::Vector2> const& pixels,
+                               std::vector<vw::Vector3>      & P,
+                               std::vector<vw::Vector3>      & dir) const {
+
+    // Same logic as the single-point point_and_dir()
+    const double VERT_SCALE_FACTOR = 0.9;
+    const double LONG_SCALE_UP = 10000;
+    double height_up = m_lonlatheight_offset[2] + m_lonlatheight_scale[2]*VERT_SCALE_FACTOR;
+    double height_dn = m_lonlatheight_offset[2] - m_lonlatheight_scale[2]*VERT_SCALE_FACTOR;
+
+    int n = pixels.size();
+    P.resize(n);
+    dir.resize(n);
+    if (n == 0)
+      return;
+    
+    std::vector<double> x(n), y(n), h_up(n, height_up), h_dn(n, height_dn);
+    std::vector<double> lon_up(n, m_lonlatheight_offset[0]), lat_up(n, m_lonlatheight_offset[1]);
+    for (int i = 0; i < n; i++) {
+      x[i] = pixels[i].x();
+      y[i] = pixels[i].y();
+    }
+
+    // The solution at the upper height is the guess for the lower one
+    image_to_ground(n, &x[0], &y[0], &h_up[0], &lon_up[0], &lat_up[0]);
+    std::vector<double> lon_dn = lon_up, lat_dn = lat_up;
+    image_to_ground(n, &x[0], &y[0], &h_dn[0], &lon_dn[0], &lat_dn[0]);
+
+    for (int i = 0; i < n; i++) {
+      Vector3 P_up = m_datum.geodetic_to_cartesian(Vector3(lon_up[i], lat_up[i], height_up));
+      Vector3 P_dn = m_datum.geodetic_to_cartesian(Vector3(lon_dn[i], lat_dn[i], height_dn));
+      dir[i] = normalize(P_dn - P_up);
+      P[i]   = P_up - dir[i]*LONG_SCALE_UP;
+    }
+  }
+
   std::ostream& operator<<(std::ostream& os, const RPCModel& rpc) {
     os << "RPC Model:"         << std::endl
        << "Line Numerator: "   << rpc.line_num_coeff()      << std::endl
@@ -37,6 +37,7 @@
 
 #include <string>
 #include <ostream>
+#include <vector>
 
 namespace vw {
   class DiskImageResourceGDAL;
@@ -129,6 +130,34 @@ namespace asp {
     /// and the direction of the ray going through that point.
     void point_and_dir(vw::Vector2 const& pix, vw::Vector3 & P, vw::Vector3 & dir ) const;
 
+    // Batch versions of the functions above. The inputs and outputs are
+    // arrays of length n, stored as structure-of-arrays, so that the
+    // polynomial evaluation loops can be vectorized by the compiler.
+
+    /// Project n points given by their lon, lat, and height.
+    void geodetic_to_pixel(int n, const double * lon, const double * lat,
+                           const double * height, double * x, double * y) const;
+
+    /// The Jacobian of geodetic_to_pixel() for n points. For each point,
+    /// 6 values are written to J, storing the 2x3 matrix row-major.
+    void geodetic_to_pixel_Jacobian(int n, const double * lon, const double * lat,
+                                    const double * height, double * J) const;
+
+    /// Project n points given in ECEF coordinates.
+    void point_to_pixel(std::vector<vw::Vector3> const& points,
+                        std::vector<vw::Vector2>      & pixels) const;
+
+    /// Find the lon and lat of n pixels at the given heights. On input,
+    /// lon and lat must have the initial guesses.
+    void image_to_ground(int n, const double * x, const double * y,
+                         const double * height, double * lon, double * lat) const;
+
+    /// Batch version of point_and_dir(), which is what pixel_to_vector()
+    /// and camera_center() use.
+    void point_and_dir(std::vector<vw::Vector2> const& pixels,
+                       std::vector<vw::Vector3>      & P,
+                       std::vector<vw::Vector3>      & dir) const;
+
   private:
     vw::cartography::Datum m_datum;
 
@@ -19,6 +19,9 @@
 #include <asp/Camera/RPCModelGen.h>
 #include <asp/Camera/RPCModel.h>
 #include <vw/Math/Geometry.h>
+#include <vw/Math/LinearAlgebra.h>
+
+#include <cmath>
 
 using namespace vw;
 
@@ -156,6 +159,74 @@ namespace asp {
     return status;
   }
 
+  bool linear_rpc_fit(double penalty_weight,
+                      Vector<double> const& normalized_geodetics,
+                      Vector<double> const& normalized_pixels,
+                      Vector<double>      & coeffs) {
+
+    // Each of the line and sample has 20 numerator and 19 denominator
+    // coefficients, as the 0-th degree denominator coefficient is 1.
+    // For a pixel coordinate u, the residual num(G) - u * den(G) is
+    // linear in these, with the term u moved to the right-hand side.
+    const int NUM_TERMS = 20, NUM_UNKNOWNS = 39;
+    int numPts = normalized_geodetics.size()/RPCModel::GEODETIC_COORD_SIZE;
+    
+    coeffs.set_size(RPCModel::NUM_RPC_COEFFS);
+    vw::Vector<int,20> coeff_order = RPCModel::get_coeff_order();
+    
+    // The line is the second pixel coordinate, and comes first among the coefficients
+    for (int coord = 0; coord < RPCModel::IMAGE_COORD_SIZE; coord++) {
+      int pix_index = RPCModel::IMAGE_COORD_SIZE - 1 - coord;
+      
+      Matrix<double> N(NUM_UNKNOWNS, NUM_UNKNOWNS);
+      Vector<double> rhs(NUM_UNKNOWNS), row(NUM_UNKNOWNS);
+      for (int p = 0; p < numPts; p++) {
+        Vector3 G = subvector(normalized_geodetics, RPCModel::GEODETIC_COORD_SIZE*p,
+                              RPCModel::GEODETIC_COORD_SIZE);
+        double u = normalized_pixels[RPCModel::IMAGE_COORD_SIZE*p + pix_index];
+        RPCModel::CoeffVec terms = RPCModel::calculate_terms(G);
+        for (int i = 0; i < NUM_TERMS; i++)
+          row[i] = terms[i];
+        for (int i = 1; i < NUM_TERMS; i++)
+          row[NUM_TERMS + i - 1] = -u * terms[i];
+        
+        // Accumulate the upper triangle of the normal equations
+        for (int i = 0; i < NUM_UNKNOWNS; i++) {
+          for (int j = i; j < NUM_UNKNOWNS; j++)
+            N(i, j) += row[i] * row[j];
+          rhs[i] += row[i] * u;
+        }
+      }
+      for (int i = 0; i < NUM_UNKNOWNS; i++)
+        for (int j = 0; j < i; j++)
+          N(i, j) = N(j, i);
+
+      // The penalty on the higher degree coefficients, as in RpcSolveLMA
+      for (int i = 4; i < NUM_TERMS; i++) {
+        double wt = penalty_weight * (coeff_order[i] - 1);
+        N(i, i) += wt * wt;
+        N(NUM_TERMS + i - 1, NUM_TERMS + i - 1) += wt * wt;
+      }
+
+      Vector<double> sol;
+      try {
+        sol = least_squares(N, rhs);
+      } catch (...) {
+        return false;
+      }
+      if (sol.size() != NUM_UNKNOWNS)
+        return false;
+      for (int i = 0; i < NUM_UNKNOWNS; i++) {
+        if (!std::isfinite(sol[i]))
+          return false;
+      }
+      
+      subvector(coeffs, coord * NUM_UNKNOWNS, NUM_UNKNOWNS) = sol;
+    }
+    
+    return true;
+  }
+  
   void gen_rpc(// Inputs
                double penalty_weight,
                std::string    const& output_prefix,
@@ -239,6 +310,23 @@ namespace asp {
     // for (size_t i = 0; i < startGuess.size(); i++) startGuess[i] = 0.0; // start with zero
     packCoeffs(line_num, line_den, samp_num, samp_den, startGuess);
 
+    // The linear least squares solution is usually a much better guess,
+    // so the solver below needs fewer iterations. Use whichever of the
+    // two guesses fits better.
+    Vector<double> linearGuess;
+    if (linear_rpc_fit(penalty_adjustment, normalized_geodetics, normalized_pixels,
+                       linearGuess)) {
+      double affine_error = norm_2(lma_model.difference(lma_model(startGuess),
+                                                        normalized_pixels));
+      double linear_error = norm_2(lma_model.difference(lma_model(linearGuess),
+                                                        normalized_pixels));
+      VW_OUT(DebugMessage, "asp") << "rpc_gen: affine guess error = " << affine_error
+                                  << ", linear least squares guess error = "
+                                  << linear_error << std::endl;
+      if (linear_error < affine_error)
+        startGuess = linearGuess;
+    }
+
     VW_OUT(DebugMessage, "asp") << "Initial guess for RPC coeffs: " << startGuess << std::endl;
     
     // Use the L-M solver to optimize the RPC model coefficient values.
@@ -257,6 +345,61 @@ namespace asp {
 
     unpackCoeffs(solution, line_num, line_den, samp_num, samp_den);
   }
-  
-  
+
+  void fit_rpc_to_points(// Inputs
+                         double penalty_weight,
+                         std::vector<Vector3> const& llh,
+                         std::vector<Vector2> const& pixels,
+                         BBox3 const& llh_box,
+                         BBox2 const& pixel_box,
+                         // Outputs
+                         Vector3 & llh_scale,
+                         Vector3 & llh_offset,
+                         Vector2 & pixel_scale,
+                         Vector2 & pixel_offset,
+                         RPCModel::CoeffVec & line_num,
+                         RPCModel::CoeffVec & line_den,
+                         RPCModel::CoeffVec & samp_num,
+                         RPCModel::CoeffVec & samp_den) {
+
+    if (llh.size() != pixels.size())
+      vw_throw( ArgumentErr() << "The number of ground points and pixels do not agree.\n");
+
+    llh_scale  = (llh_box.max() - llh_box.min())/2.0; // half range
+    llh_offset = (llh_box.max() + llh_box.min())/2.0; // center point
+
+    pixel_scale  = (pixel_box.max() - pixel_box.min())/2.0; // half range
+    pixel_offset = (pixel_box.max() + pixel_box.min())/2.0; // center point
+
+    Vector<double> normalized_llh;
+    Vector<double> normalized_pixels;
+    int num_total_pts = llh.size();
+    normalized_llh.set_size(RPCModel::GEODETIC_COORD_SIZE*num_total_pts);
+    normalized_pixels.set_size(RPCModel::IMAGE_COORD_SIZE*num_total_pts
+                               + RpcSolveLMA::NUM_PENALTY_TERMS);
+    for (size_t i = 0; i < normalized_pixels.size(); i++) {
+      // Important: The extra penalty terms are all set to zero here.
+      normalized_pixels[i] = 0.0;
+    }
+
+    // Form the arrays of normalized pixels and normalized llh
+    for (int pt = 0; pt < num_total_pts; pt++) {
+      // Normalize the pixel to -1 <> 1 range
+      Vector3 llh_n   = elem_quot(llh[pt]    - llh_offset,   llh_scale);
+      Vector2 pixel_n = elem_quot(pixels[pt] - pixel_offset, pixel_scale);
+      subvector(normalized_llh, RPCModel::GEODETIC_COORD_SIZE*pt,
+                RPCModel::GEODETIC_COORD_SIZE) = llh_n;
+      subvector(normalized_pixels, RPCModel::IMAGE_COORD_SIZE*pt,
+                RPCModel::IMAGE_COORD_SIZE   ) = pixel_n;
+    }
+
+    std::string output_prefix = "";
+    gen_rpc(// Inputs
+            penalty_weight, output_prefix,
+            normalized_llh, normalized_pixels,
+            llh_scale, llh_offset, pixel_scale, pixel_offset,
+            // Outputs
+            line_num, line_den, samp_num, samp_den);
+  }
+
 }
@@ -22,6 +22,9 @@
 
 #include <asp/Camera/RPCModel.h>
 #include <vw/Math/LevenbergMarquardt.h>
+#include <vw/Math/BBox.h>
+
+#include <vector>
 
 namespace asp {
 
@@ -135,6 +138,17 @@ namespace asp {
                               vw::Vector<double>      & final_params,
                               double              & norm_error);
   
+  /// Fit the RPC coefficients with linear least squares. The residual
+  /// for each pixel is multiplied by the RPC denominator, which makes
+  /// the problem linear in the coefficients, and the normal equations
+  /// are solved. The penalty terms are the same as for RpcSolveLMA.
+  /// This is a good starting guess for the nonlinear solver. Return
+  /// false if the solution is not valid.
+  bool linear_rpc_fit(double penalty_weight,
+                      vw::Vector<double> const& normalized_geodetics,
+                      vw::Vector<double> const& normalized_pixels,
+                      vw::Vector<double>      & coeffs);
+  
   void gen_rpc(// Inputs
                double penalty_weight,
                std::string    const& output_prefix,
@@ -149,6 +163,27 @@ namespace asp {
                RPCModel::CoeffVec & line_den,
                RPCModel::CoeffVec & samp_num,
                RPCModel::CoeffVec & samp_den);
+
+  /// Fit an RPC model to ground points, as longitude, latitude, and
+  /// height, and the pixels they project to. The offsets and scales
+  /// are the centers and half-sizes of the given boxes. This does not
+  /// depend on any camera, so it can be called for many cameras in
+  /// parallel.
+  void fit_rpc_to_points(// Inputs
+                         double penalty_weight,
+                         std::vector<vw::Vector3> const& llh,
+                         std::vector<vw::Vector2> const& pixels,
+                         vw::BBox3 const& llh_box,
+                         vw::BBox2 const& pixel_box,
+                         // Outputs
+                         vw::Vector3 & llh_scale,
+                         vw::Vector3 & llh_offset,
+                         vw::Vector2 & pixel_scale,
+                         vw::Vector2 & pixel_offset,
+                         RPCModel::CoeffVec & line_num,
+                         RPCModel::CoeffVec & line_den,
+                         RPCModel::CoeffVec & samp_num,
+                         RPCModel::CoeffVec & samp_den);
 }
 
 #endif //__STEREO_CAMERA_RPC_MODEL_GEN_H__
@@ -27,9 +27,9 @@
 #include <asp/Camera/XMLBase.h>
 #include <asp/Core/StereoSettings.h>
 
-#include <xercesc/parsers/XercesDOMParser.hpp>
-#include <xercesc/sax/HandlerBase.hpp>
+#include <xercesc/dom/DOMException.hpp>
 #include <xercesc/util/PlatformUtils.hpp>
+#include <xercesc/util/XMLException.hpp>
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
@@ -314,61 +314,60 @@ void asp::GeometricXML::printDebugInfo() const {
 void asp::EphemerisXML::parse_meta(xercesc::DOMElement* node) {
   cast_xmlch(get_node<DOMElement>(node, "STARTTIME"   )->getTextContent(), start_time);
   cast_xmlch(get_node<DOMElement>(node, "TIMEINTERVAL")->getTextContent(), time_interval);
+  parse_num_points(get_node<DOMElement>(node, "NUMPOINTS"));
+}
+
+void asp::EphemerisXML::parse_num_points(xercesc::DOMElement* node) {
   size_t num_points;
-  cast_xmlch(get_node<DOMElement>(node, "NUMPOINTS"   )->getTextContent(), num_points);
+  cast_xmlch(node->getTextContent(), num_points);
   satellite_position_vec.resize(num_points);
   velocity_vec.resize(num_points);
   satellite_position_covariance_vec.resize(num_points);
 }
 
-void asp::EphemerisXML::parse_eph_list(xercesc::DOMElement* node) {
-  DOMNodeList* children = node->getChildNodes();
-  size_t count = 0;
+void asp::EphemerisXML::parse_eph_point(xercesc::DOMElement* node) {
 
-  for (XMLSize_t i = 0; i < children->getLength(); i++) {
-    if (children->item(i)->getNodeType() == DOMNode::ELEMENT_NODE) {
-      DOMElement* element = dynamic_cast<DOMElement*>(children->item(i));
-      std::string buffer;
-      cast_xmlch(element->getTextContent(), buffer);
+  // The index, position, velocity, and the covariance
+  double vals[13] = {0};
+  size_t num_vals = XmlUtils::read_numbers(node, 13, vals);
+  if (num_vals < 7 || vals[0] < 0.5)
+    vw_throw(ArgumentErr() << "Failed to parse an ephemeris point.\n");
 
-      std::istringstream istr(buffer);
-      std::string index_b;
-      istr >> index_b;
-      size_t index;
-      try{
-        index = size_t(boost::lexical_cast<float>(index_b) + 0.5) - 1;
-      } catch (boost::bad_lexical_cast const& e) {
-        vw_throw(ArgumentErr() << "Failed to parse string: " << index_b << "\n");
-      }
+  // The points are indexed from 1, and the arrays were allocated
+  // from NUMPOINTS, which precedes the list.
+  size_t index = size_t(vals[0] + 0.5) - 1;
+  if (index >= satellite_position_vec.size())
+    vw_throw(ArgumentErr() << "Ephemeris point index " << index + 1
+             << " exceeds the number of points: " << satellite_position_vec.size() << ".\n");
 
-      istr >> satellite_position_vec[index][0]
-           >> satellite_position_vec[index][1]
-           >> satellite_position_vec[index][2]
-           >> velocity_vec[index][0]
-           >> velocity_vec[index][1]
-           >> velocity_vec[index][2];
-      istr >> satellite_position_covariance_vec[index][0]
-           >> satellite_position_covariance_vec[index][1]
-           >> satellite_position_covariance_vec[index][2]
-           >> satellite_position_covariance_vec[index][3]
-           >> satellite_position_covariance_vec[index][4]
-           >> satellite_position_covariance_vec[index][5];
+  for (int it = 0; it < 3; it++) {
+    satellite_position_vec[index][it] = vals[1 + it];
+    velocity_vec[index][it]           = vals[4 + it];
+  }
+  for (int it = 0; it < 6; it++)
+    satellite_position_covariance_vec[index][it] = vals[7 + it];
 
-      count++;
-    }
+  num_read_points++;
+}
+
+void asp::EphemerisXML::parse_eph_list(xercesc::DOMElement* node) {
+  DOMNodeList* children = node->getChildNodes();
+  for (XMLSize_t i = 0; i < children->getLength(); i++) {
+    if (children->item(i)->getNodeType() == DOMNode::ELEMENT_NODE)
+      parse_eph_point(dynamic_cast<DOMElement*>(children->item(i)));
   }
 
-  VW_ASSERT(count == satellite_position_vec.size(),
+  // This includes the points read as the file was parsed
+  VW_ASSERT(num_read_points == satellite_position_vec.size(),
             IOErr() << "Read incorrect number of points.");
 }
 
-asp::EphemerisXML::EphemerisXML() : BitChecker(2) {}
+asp::EphemerisXML::EphemerisXML() : BitChecker(2), num_read_points(0) {}
 
 void asp::EphemerisXML::parse(xercesc::DOMElement* node) {
   parse_meta(node);
   check_argument(0);
 
-  // TODO(oalexan1): This is slow to parse
   parse_eph_list(get_node<DOMElement>(node, "EPHEMLISTList"));
   check_argument(1);
 }
@@ -379,60 +378,58 @@ void asp::EphemerisXML::parse(xercesc::DOMElement* node) {
 void asp::AttitudeXML::parse_meta(xercesc::DOMElement* node) {
   cast_xmlch(get_node<DOMElement>(node, "STARTTIME"   )->getTextContent(), start_time);
   cast_xmlch(get_node<DOMElement>(node, "TIMEINTERVAL")->getTextContent(), time_interval);
+  parse_num_points(get_node<DOMElement>(node, "NUMPOINTS"));
+}
+
+void asp::AttitudeXML::parse_num_points(xercesc::DOMElement* node) {
   size_t num_points;
-  cast_xmlch(get_node<DOMElement>(node, "NUMPOINTS"   )->getTextContent(), num_points);
+  cast_xmlch(node->getTextContent(), num_points);
   satellite_quat_vec.resize(num_points);
   satellite_quat_covariance_vec.resize(num_points);
 }
 
-void asp::AttitudeXML::parse_att_list(xercesc::DOMElement* node) {
-  DOMNodeList* children = node->getChildNodes();
-  size_t count = 0;
-  Vector4 qbuf;
+void asp::AttitudeXML::parse_att_point(xercesc::DOMElement* node) {
 
-  for (XMLSize_t i = 0; i < children->getLength(); i++) {
-    if (children->item(i)->getNodeType() == DOMNode::ELEMENT_NODE) {
-      DOMElement* element = dynamic_cast<DOMElement*>(children->item(i));
-      std::string buffer;
-      cast_xmlch(element->getTextContent(), buffer);
+  // The index, the quaternion, and the upper-right portion of the
+  // 4x4 covariance matrix
+  double vals[15] = {0};
+  size_t num_vals = XmlUtils::read_numbers(node, 15, vals);
+  if (num_vals < 5 || vals[0] < 0.5)
+    vw_throw(ArgumentErr() << "Failed to parse an attitude point.\n");
 
-      std::istringstream istr(buffer);
-      std::string index_b;
-      istr >> index_b;
-      size_t index;
-      try {
-        index = size_t(boost::lexical_cast<float>(index_b) + 0.5) - 1;
-      } catch (boost::bad_lexical_cast const& e) {
-        vw_throw(ArgumentErr() << "Failed to parse string: " << index_b << "\n");
-      }
+  // The points are indexed from 1, and the arrays were allocated
+  // from NUMPOINTS, which precedes the list.
+  size_t index = size_t(vals[0] + 0.5) - 1;
+  if (index >= satellite_quat_vec.size())
+    vw_throw(ArgumentErr() << "Attitude point index " << index + 1
+             << " exceeds the number of points: " << satellite_quat_vec.size() << ".\n");
 
-      // Read the quaternion values for satellite orientation.
-      istr >> satellite_quat_vec[index][0]
-           >> satellite_quat_vec[index][1]
-           >> satellite_quat_vec[index][2]
-           >> satellite_quat_vec[index][3];
-      // Only the upper-right portion of the 4x4 covariance matrix is saved
-      istr >> satellite_quat_covariance_vec[index][0] >> satellite_quat_covariance_vec[index][1]
-           >> satellite_quat_covariance_vec[index][2] >> satellite_quat_covariance_vec[index][3]
-           >> satellite_quat_covariance_vec[index][4] >> satellite_quat_covariance_vec[index][5]
-           >> satellite_quat_covariance_vec[index][6] >> satellite_quat_covariance_vec[index][7]
-           >> satellite_quat_covariance_vec[index][8] >> satellite_quat_covariance_vec[index][9];
+  for (int it = 0; it < 4; it++)
+    satellite_quat_vec[index][it] = vals[1 + it];
+  for (int it = 0; it < 10; it++)
+    satellite_quat_covariance_vec[index][it] = vals[5 + it];
 
-      count++;
-    }
+  num_read_points++;
+}
+
+void asp::AttitudeXML::parse_att_list(xercesc::DOMElement* node) {
+  DOMNodeList* children = node->getChildNodes();
+  for (XMLSize_t i = 0; i < children->getLength(); i++) {
+    if (children->item(i)->getNodeType() == DOMNode::ELEMENT_NODE)
+      parse_att_point(dynamic_cast<DOMElement*>(children->item(i)));
   }
 
-  VW_ASSERT(count == satellite_quat_vec.size(),
+  // This includes the points read as the file was parsed
+  VW_ASSERT(num_read_points == satellite_quat_vec.size(),
             IOErr() << "Read incorrect number of points.");
 }
 
-asp::AttitudeXML::AttitudeXML() : BitChecker(2) {}
+asp::AttitudeXML::AttitudeXML() : BitChecker(2), num_read_points(0) {}
 
 void asp::AttitudeXML::parse(xercesc::DOMElement* node) {
   parse_meta(node);
   check_argument(0);
 
-  // TODO(oalexan1): This is slow to parse
   parse_att_list(get_node<DOMElement>(node, "ATTLISTList"));
   check_argument(1);
 }
@@ -455,20 +452,25 @@ void asp::RPCXML::parse_vector(xercesc::DOMElement* node,
 
 asp::RPCXML::RPCXML() : BitChecker(2) {}
 
+namespace {
+  // Do not keep in the tree the ephemeris and attitude lists of a
+  // Digital Globe file, which are most of the file, when only the
+  // other data is needed.
+  void skip_dg_lists(asp::XmlUtils::StreamingParser & parser) {
+    auto skip = [](DOMElement* /*node*/) {};
+    parser.add_callback("EPHEMLISTList", "EPHEMLIST", skip);
+    parser.add_callback("ATTLISTList",   "ATTLIST",   skip);
+  }
+}
+
 void asp::RPCXML::read_from_file(std::string const& name) {
-  boost::scoped_ptr<XercesDOMParser> parser(new XercesDOMParser());
-  parser->setValidationScheme(XercesDOMParser::Val_Always);
-  parser->setDoNamespaces(true);
-  boost::scoped_ptr<ErrorHandler> errHandler(new HandlerBase());
-  parser->setErrorHandler(errHandler.get());
+  XmlUtils::StreamingParser parser;
+  skip_dg_lists(parser);
 
-  DOMDocument* xmlDoc;
   DOMElement* elementRoot;
 
   try{
-    parser->parse(name.c_str());
-    xmlDoc = parser->getDocument();
-    elementRoot = xmlDoc->getDocumentElement();
+    elementRoot = parser.parse(name);
   }catch(...){
     vw_throw(ArgumentErr() << "XML file \"" << name << "\" is invalid.\n");
   }
@@ -721,16 +723,20 @@ void asp::read_xml(std::string const& filename,
     vw_throw(ArgumentErr() << "XML file \"" << filename << "\" does not exist.");
 
   try{
-    boost::scoped_ptr<XercesDOMParser> parser(new XercesDOMParser());
-    parser->setValidationScheme(XercesDOMParser::Val_Always);
-    parser->setDoNamespaces(true);
-    boost::scoped_ptr<ErrorHandler> errHandler(new HandlerBase());
-    parser->setErrorHandler(errHandler.get());
-
-    parser->parse(filename.c_str());
-
-    DOMDocument* xmlDoc = parser->getDocument();
-    DOMElement* elementRoot = xmlDoc->getDocumentElement();
+    // The ephemeris and attitude lists, which are most of the file, are
+    // read as they are parsed, into arrays allocated from the number of
+    // points, and not kept in the tree.
+    XmlUtils::StreamingParser parser;
+    parser.add_callback("EPH", "NUMPOINTS",
+                        [&eph](DOMElement* node) { eph.parse_num_points(node); }, true);
+    parser.add_callback("ATT", "NUMPOINTS",
+                        [&att](DOMElement* node) { att.parse_num_points(node); }, true);
+    parser.add_callback("EPHEMLISTList", "EPHEMLIST",
+                        [&eph](DOMElement* node) { eph.parse_eph_point(node); });
+    parser.add_callback("ATTLISTList", "ATTLIST",
+                        [&att](DOMElement* node) { att.parse_att_point(node); });
+
+    DOMElement* elementRoot = parser.parse(filename);
 
     try{ // This is optional information, not present in all XML files.
       rpc.parse_bbox(elementRoot); // Load the bounding box information.
@@ -758,6 +764,16 @@ void asp::read_xml(std::string const& filename,
     }
   } catch (const std::exception& e) {                
     vw_throw(ArgumentErr() << e.what() << " XML file \"" << filename << "\" is invalid.\n");
+  } catch (const XMLException& e) {
+    char* message = XMLString::transcode(e.getMessage());
+    std::string msg = message;
+    XMLString::release(&message);
+    vw_throw(ArgumentErr() << msg << " XML file \"" << filename << "\" is invalid.\n");
+  } catch (const DOMException& e) {
+    char* message = XMLString::transcode(e.getMessage());
+    std::string msg = message;
+    XMLString::release(&message);
+    vw_throw(ArgumentErr() << msg << " XML file \"" << filename << "\" is invalid.\n");
   }
 
 }
@@ -787,15 +803,9 @@ bool asp::read_WV_XML_corners(std::string const& xml_path,
                               std::vector<vw::Vector2> &lonlat_corners) {
 
   // Open and initialize the document
-  boost::scoped_ptr<XercesDOMParser> parser(new XercesDOMParser());
-  parser->setValidationScheme(XercesDOMParser::Val_Always);
-  parser->setDoNamespaces(true);
-  boost::scoped_ptr<ErrorHandler> errHandler(new HandlerBase());
-  parser->setErrorHandler(errHandler.get());
-
-  parser->parse(xml_path.c_str());
-  DOMDocument* xmlDoc      = parser->getDocument();
-  DOMElement * elementRoot = xmlDoc->getDocumentElement();
+  XmlUtils::StreamingParser parser;
+  skip_dg_lists(parser);
+  DOMElement * elementRoot = parser.parse(xml_path);
   
   const size_t NUM_CORNERS = 4;
   const size_t TOP_LEFT  = 0;
@@ -106,6 +106,8 @@ namespace asp {
   ///
   class EphemerisXML : public BitChecker {
 
+    size_t num_read_points;
+
     void parse_meta    ( xercesc::DOMElement* node );
     void parse_eph_list( xercesc::DOMElement* node );
 
@@ -114,6 +116,14 @@ namespace asp {
 
     void parse( xercesc::DOMElement* node );
 
+    /// Parse the NUMPOINTS element and allocate the points. Can be
+    /// called before or after the points are read.
+    void parse_num_points( xercesc::DOMElement* node );
+
+    /// Parse one EPHEMLIST element. Used by read_xml() to read each
+    /// point as soon as the parser reaches it.
+    void parse_eph_point( xercesc::DOMElement* node );
+
     std::string start_time;      // UTC
     double time_interval;        // seconds
 
@@ -134,6 +144,8 @@ namespace asp {
   /// 
   class AttitudeXML : public BitChecker {
 
+    size_t num_read_points;
+
     void parse_meta( xercesc::DOMElement* node );
     void parse_att_list( xercesc::DOMElement* node );
 
@@ -142,6 +154,14 @@ namespace asp {
 
     void parse( xercesc::DOMElement* node );
 
+    /// Parse the NUMPOINTS element and allocate the points. Can be
+    /// called before or after the points are read.
+    void parse_num_points( xercesc::DOMElement* node );
+
+    /// Parse one ATTLIST element. Used by read_xml() to read each
+    /// point as soon as the parser reaches it.
+    void parse_att_point( xercesc::DOMElement* node );
+
     std::string start_time;
     double time_interval;
 
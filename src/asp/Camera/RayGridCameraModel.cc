@@ -0,0 +1,176 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+/// \file RayGridCameraModel.cc
+///
+
+#include <vw/Math/Vector.h>
+#include <asp/Camera/RayGridCameraModel.h>
+
+#include <cmath>
+
+using namespace vw;
+
+namespace asp {
+
+namespace {
+  // Angle between two vectors, robust for small angles
+  double ray_angle(Vector3 const& a, Vector3 const& b) {
+    return atan2(norm_2(cross_prod(a, b)), dot_prod(a, b));
+  }
+}
+
+RayGridCameraModel::RayGridCameraModel(vw::camera::CameraModel const* exact_cam,
+                                       vw::BBox2i const& pixel_box, int grid_spacing,
+                                       double max_pixel_error, double max_center_error):
+  m_exact_cam(exact_cam), m_spacing(std::max(grid_spacing, 1)) {
+
+  if (pixel_box.empty() || pixel_box.width() <= 0 || pixel_box.height() <= 0)
+    return; // Everything will be done with the exact camera
+
+  // The grid nodes. The last one is always at the box max corner.
+  for (int x = pixel_box.min().x(); x < pixel_box.max().x(); x += m_spacing)
+    m_xs.push_back(x);
+  m_xs.push_back(pixel_box.max().x());
+  for (int y = pixel_box.min().y(); y < pixel_box.max().y(); y += m_spacing)
+    m_ys.push_back(y);
+  m_ys.push_back(pixel_box.max().y());
+
+  int nx = m_xs.size(), ny = m_ys.size();
+  m_ctrs.resize(nx * ny);
+  m_dirs.resize(nx * ny);
+  std::vector<char> good_node(nx * ny, 1);
+  for (int iy = 0; iy < ny; iy++) {
+    for (int ix = 0; ix < nx; ix++) {
+      int k = iy * nx + ix;
+      Vector2 pix(m_xs[ix], m_ys[iy]);
+      try {
+        m_ctrs[k] = m_exact_cam->camera_center(pix);
+        m_dirs[k] = m_exact_cam->pixel_to_vector(pix);
+      } catch (...) {
+        good_node[k] = 0;
+      }
+    }
+  }
+
+  // Validate each cell at its center, where bilinear interpolation
+  // error is the largest.
+  m_exact_cell.resize((nx - 1) * (ny - 1), 1);
+  for (int cy = 0; cy < ny - 1; cy++) {
+    for (int cx = 0; cx < nx - 1; cx++) {
+
+      int k00 = cy * nx + cx,       k10 = k00 + 1;
+      int k01 = (cy + 1) * nx + cx, k11 = k01 + 1;
+      if (!good_node[k00] || !good_node[k10] || !good_node[k01] || !good_node[k11])
+        continue;
+
+      // The local angle between rays through adjacent pixels
+      double ifov_x = ray_angle(m_dirs[k00], m_dirs[k10]) / (m_xs[cx + 1] - m_xs[cx]);
+      double ifov_y = ray_angle(m_dirs[k00], m_dirs[k01]) / (m_ys[cy + 1] - m_ys[cy]);
+      double ifov = std::min(ifov_x, ifov_y);
+      if (!(ifov > 0.0))
+        continue;
+
+      Vector2 pix(0.5 * (m_xs[cx] + m_xs[cx + 1]), 0.5 * (m_ys[cy] + m_ys[cy + 1]));
+      Vector3 exact_ctr, exact_dir;
+      try {
+        exact_ctr = m_exact_cam->camera_center(pix);
+        exact_dir = m_exact_cam->pixel_to_vector(pix);
+      } catch (...) {
+        continue;
+      }
+
+      Vector3 ctr, dir;
+      interp(cx, cy, 0.5, 0.5, ctr, dir);
+      double pixel_err  = ray_angle(dir, exact_dir) / ifov;
+      double center_err = norm_2(cross_prod(ctr - exact_ctr, normalize(exact_dir)));
+      if (pixel_err <= max_pixel_error && center_err <= max_center_error)
+        m_exact_cell[cy * (nx - 1) + cx] = 0;
+    }
+  }
+}
+
+int RayGridCameraModel::num_exact_cells() const {
+  int count = 0;
+  for (size_t it = 0; it < m_exact_cell.size(); it++)
+    count += m_exact_cell[it];
+  return count;
+}
+
+bool RayGridCameraModel::find_cell(vw::Vector2 const& pix, int & cx, int & cy,
+                                   double & wx, double & wy) const {
+  if (m_exact_cell.empty())
+    return false;
+
+  double x = pix.x(), y = pix.y();
+  if (!(x >= m_xs.front() && x <= m_xs.back() && y >= m_ys.front() && y <= m_ys.back()))
+    return false; // This also catches NaN
+
+  int nx = m_xs.size(), ny = m_ys.size();
+  cx = std::min(int((x - m_xs[0]) / m_spacing), nx - 2);
+  cy = std::min(int((y - m_ys[0]) / m_spacing), ny - 2);
+  if (m_exact_cell[cy * (nx - 1) + cx])
+    return false;
+
+  wx = (x - m_xs[cx]) / (m_xs[cx + 1] - m_xs[cx]);
+  wy = (y - m_ys[cy]) / (m_ys[cy + 1] - m_ys[cy]);
+  return true;
+}
+
+void RayGridCameraModel::interp(int cx, int cy, double wx, double wy,
+                                vw::Vector3 & ctr, vw::Vector3 & dir) const {
+  int nx = m_xs.size();
+  int k00 = cy * nx + cx,       k10 = k00 + 1;
+  int k01 = (cy + 1) * nx + cx, k11 = k01 + 1;
+  double w00 = (1.0 - wx) * (1.0 - wy), w10 = wx * (1.0 - wy);
+  double w01 = (1.0 - wx) * wy,         w11 = wx * wy;
+  ctr = w00 * m_ctrs[k00] + w10 * m_ctrs[k10] + w01 * m_ctrs[k01] + w11 * m_ctrs[k11];
+  dir = normalize(w00 * m_dirs[k00] + w10 * m_dirs[k10] +
+                  w01 * m_dirs[k01] + w11 * m_dirs[k11]);
+}
+
+vw::Vector2 RayGridCameraModel::point_to_pixel(vw::Vector3 const& point) const {
+  return m_exact_cam->point_to_pixel(point);
+}
+
+vw::Vector3 RayGridCameraModel::pixel_to_vector(vw::Vector2 const& pix) const {
+  int cx = 0, cy = 0;
+  double wx = 0.0, wy = 0.0;
+  if (!find_cell(pix, cx, cy, wx, wy))
+    return m_exact_cam->pixel_to_vector(pix);
+
+  Vector3 ctr, dir;
+  interp(cx, cy, wx, wy, ctr, dir);
+  return dir;
+}
+
+vw::Vector3 RayGridCameraModel::camera_center(vw::Vector2 const& pix) const {
+  int cx = 0, cy = 0;
+  double wx = 0.0, wy = 0.0;
+  if (!find_cell(pix, cx, cy, wx, wy))
+    return m_exact_cam->camera_center(pix);
+
+  Vector3 ctr, dir;
+  interp(cx, cy, wx, wy, ctr, dir);
+  return ctr;
+}
+
+vw::Quaternion<double> RayGridCameraModel::camera_pose(vw::Vector2 const& pix) const {
+  return m_exact_cam->camera_pose(pix);
+}
+
+} // end namespace asp
@@ -0,0 +1,90 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+/// \file RayGridCameraModel.h
+///
+/// A camera model which, within a given pixel box, returns camera
+/// centers and ray directions bilinearly interpolated from a grid
+/// sampled with an exact camera. Used to speed up triangulation with
+/// expensive cameras (ISIS, CSM, DG linescan).
+
+#ifndef __STEREO_CAMERA_RAY_GRID_CAMERA_MODEL_H__
+#define __STEREO_CAMERA_RAY_GRID_CAMERA_MODEL_H__
+
+#include <vw/Camera/CameraModel.h>
+#include <vw/Math/BBox.h>
+
+#include <vector>
+
+namespace asp {
+
+  /// The exact camera is sampled at grid nodes spaced grid_spacing
+  /// pixels apart within pixel_box. When the grid is built, the
+  /// interpolated ray at each grid cell center is compared with the
+  /// exact one. Cells where the direction error exceeds max_pixel_error
+  /// (measured in units of the local ray angle between adjacent
+  /// pixels) or the camera center error exceeds max_center_error
+  /// (in meters, measured perpendicular to the exact ray) are
+  /// flagged, and for pixels in those cells, as for any pixels
+  /// outside the box, the exact camera is invoked. Projection into
+  /// the camera always uses the exact model.
+  /// This class does not own the exact camera, which must outlive it.
+  class RayGridCameraModel: public vw::camera::CameraModel {
+  public:
+    RayGridCameraModel(vw::camera::CameraModel const* exact_cam,
+                       vw::BBox2i const& pixel_box, int grid_spacing,
+                       double max_pixel_error, double max_center_error);
+
+    virtual ~RayGridCameraModel() {}
+    virtual std::string type() const { return "RayGrid"; }
+
+    virtual vw::Vector2 point_to_pixel (vw::Vector3 const& point) const;
+    virtual vw::Vector3 pixel_to_vector(vw::Vector2 const& pix  ) const;
+    virtual vw::Vector3 camera_center  (vw::Vector2 const& pix  ) const;
+    virtual vw::Quaternion<double> camera_pose(vw::Vector2 const& pix) const;
+
+    /// The number of grid cells, and how many of them failed the error
+    /// check and will use the exact camera.
+    int num_cells      () const { return m_exact_cell.size(); }
+    int num_exact_cells() const;
+
+  private:
+
+    /// Find the cell containing the given pixel and the bilinear
+    /// weights in it. Return false if the exact camera must be used.
+    bool find_cell(vw::Vector2 const& pix, int & cx, int & cy,
+                   double & wx, double & wy) const;
+
+    /// Interpolate the grid values at the given cell and weights.
+    void interp(int cx, int cy, double wx, double wy,
+                vw::Vector3 & ctr, vw::Vector3 & dir) const;
+
+    vw::camera::CameraModel const* m_exact_cam;
+
+    // Grid node coordinates. The last node is at the box max corner,
+    // so it may be closer to the previous one than the spacing.
+    std::vector<double> m_xs, m_ys;
+    int m_spacing;
+
+    // Node values, stored row-major, and per-cell fallback flags
+    std::vector<vw::Vector3> m_ctrs, m_dirs;
+    std::vector<char> m_exact_cell;
+  };
+
+} // end namespace asp
+
+#endif //__STEREO_CAMERA_RAY_GRID_CAMERA_MODEL_H__
@@ -26,13 +26,10 @@
 #include <asp/Camera/RPCModel.h>
 #include <asp/Camera/XMLBase.h>
 
-#include <xercesc/parsers/XercesDOMParser.hpp>
-#include <xercesc/sax/HandlerBase.hpp>
 #include <xercesc/sax/SAXException.hpp>
 #include <xercesc/sax/SAXParseException.hpp>
 #include <xercesc/dom/DOMException.hpp>
 #include <xercesc/util/PlatformUtils.hpp>
-#include <xercesc/sax/ErrorHandler.hpp>
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
@@ -61,22 +58,26 @@ DOMElement* SpotXML::open_xml_file(std::string const& xml_path) {
   try{
     //std::cout << "Set XML parser\n";
   
-    // Set up the XML parser if we have not already done so
+    // Set up the XML parser if we have not already done so. The long
+    // lists are read as the file is parsed and not kept in the tree.
     if (!m_parser.get()) {
-      m_parser.reset(new XercesDOMParser());
-      m_errHandler.reset(new HandlerBase());
-      m_parser->setValidationScheme(XercesDOMParser::Val_Always);
-      m_parser->setDoNamespaces(true);   
-      m_parser->setErrorHandler(m_errHandler.get());
+      m_parser.reset(new XmlUtils::StreamingParser());
+      m_parser->add_callback("Look_Angles_List", "Look_Angles",
+                             [this](DOMElement* node) { read_look_angle(node); });
+      m_parser->add_callback("Points", "Point",
+                             [this](DOMElement* node) { read_ephemeris_point(node); });
+      m_parser->add_callback("Corrected_Attitude", "Angles",
+                             [this](DOMElement* node) { read_attitude_angles(node); });
     }
 
-    //std::cout << "Load XML\n";
+    // Reset data storage, as the lists are filled during parsing
+    look_angles.clear();
+    position_logs.clear();
+    velocity_logs.clear();
+    pose_logs.clear();
 
     // Load the XML file
-    m_parser->parse( xml_path.c_str() );
-    DOMDocument* xmlDoc      = m_parser->getDocument();
-    DOMElement * elementRoot = xmlDoc->getDocumentElement();
-    return elementRoot;
+    return m_parser->parse(xml_path);
 
   } catch (const XMLException& toCatch) {
     char* message = XMLString::transcode(toCatch.getMessage());
@@ -167,11 +168,9 @@ void SpotXML::parse_xml(xercesc::DOMElement* node) {
 
 void SpotXML::read_look_angles(xercesc::DOMElement* look_angles_node) {
 
-  // Set up the data storage
   const size_t num_cols = image_size.x();
   if (num_cols == 0)
     vw_throw(ArgumentErr() << "Did not load image size from SPOT XML file!\n");
-  look_angles.resize(image_size.x());
 
   // Dig two levels down
   xercesc::DOMElement* look_angle_node
@@ -179,10 +178,8 @@ void SpotXML::read_look_angles(xercesc::DOMElement* look_angles_node) {
   xercesc::DOMElement* look_angle_list_node
     = get_node<DOMElement>(look_angle_node, "Look_Angles_List");
 
-  // Pick out the "Angles" nodes
+  // Pick out the "Angles" nodes not read during parsing
   DOMNodeList* children = look_angle_list_node->getChildNodes();
-
-  size_t index = 0;
   const XMLSize_t num_children = children->getLength();
   for ( XMLSize_t i = 0; i < num_children; ++i ) {
     // Check child node type
@@ -190,48 +187,47 @@ void SpotXML::read_look_angles(xercesc::DOMElement* look_angles_node) {
     if ( curr_node->getNodeType() != DOMNode::ELEMENT_NODE )
       continue;
 
-    // Check the node name
-    DOMElement* curr_element = dynamic_cast<DOMElement*>( curr_node );
+    read_look_angle(dynamic_cast<DOMElement*>( curr_node ));
+  } // End loop through look angles
 
-    if (index >= num_cols)
-      vw_throw(ArgumentErr() << "More look angles than rows in SPOT XML file!\n");
-
-    // Look through the three nodes and assign each of them
-    // - In this function we do this a little more by hand to try and speed things up
-    DOMNodeList* sub_children = curr_element->getChildNodes();
-    for ( XMLSize_t j = 0; j < sub_children->getLength(); ++j ) {
-
-      DOMNode* child_node = sub_children->item(j);
-      if ( child_node->getNodeType() != DOMNode::ELEMENT_NODE )
-        continue;
-      DOMElement* child_element = dynamic_cast<DOMElement*>( child_node );
-      std::string tag2( XMLString::transcode(child_element->getTagName()) );
-      std::string text( XMLString::transcode(child_element->getTextContent()) );
-
-      if (tag2 == "DETECTOR_ID")
-        look_angles[index].first = atoi(text.c_str());
-      if (tag2 == "PSI_X")
-        look_angles[index].second.x() = atof(text.c_str());
-      if (tag2 == "PSI_Y")
-        look_angles[index].second.y() = atof(text.c_str());
-    }
+  if (look_angles.size() > num_cols)
+    vw_throw(ArgumentErr() << "More look angles than rows in SPOT XML file!\n");
+  if (look_angles.size() != num_cols)
+    vw_throw(ArgumentErr() << "Did not load the correct number of SPOT5 pixel look angles!\n");
+}
 
-    ++index;
+void SpotXML::read_look_angle(xercesc::DOMElement* look_angle_node) {
 
-  } // End loop through look angles
-  if (index != num_cols)
-    vw_throw(ArgumentErr() << "Did not load the correct number of SPOT5 pixel look angles!\n");
+  // Look through the three nodes and assign each of them
+  // - In this function we do this a little more by hand to try and speed things up
+  std::pair<int, vw::Vector2> look_angle;
+  DOMNodeList* sub_children = look_angle_node->getChildNodes();
+  for ( XMLSize_t j = 0; j < sub_children->getLength(); ++j ) {
+
+    DOMNode* child_node = sub_children->item(j);
+    if ( child_node->getNodeType() != DOMNode::ELEMENT_NODE )
+      continue;
+    DOMElement* child_element = dynamic_cast<DOMElement*>( child_node );
+    std::string tag2( XMLString::transcode(child_element->getTagName()) );
+    std::string text( XMLString::transcode(child_element->getTextContent()) );
+
+    if (tag2 == "DETECTOR_ID")
+      look_angle.first = atoi(text.c_str());
+    if (tag2 == "PSI_X")
+      look_angle.second.x() = atof(text.c_str());
+    if (tag2 == "PSI_Y")
+      look_angle.second.y() = atof(text.c_str());
+  }
+
+  look_angles.push_back(look_angle);
 }
 
 void SpotXML::read_ephemeris(xercesc::DOMElement* ephemeris_node) {
 
-  position_logs.clear(); // Reset data storage
-  velocity_logs.clear();
-
   // Dig one level down
   xercesc::DOMElement* points_node = get_node<DOMElement>(ephemeris_node, "Points");
 
-  // Pick out the "Point" nodes
+  // Pick out the "Point" nodes not read during parsing
   DOMNodeList* children = points_node->getChildNodes();
   for ( XMLSize_t i = 0; i < children->getLength(); ++i ) {
     // Check child node type
@@ -245,39 +241,39 @@ void SpotXML::read_ephemeris(xercesc::DOMElement* ephemeris_node) {
     if (tag.find("Point") == std::string::npos)
       continue;
 
-    // Get the three sub-nodes
-    xercesc::DOMElement* location_node = get_node<DOMElement>(curr_element, "Location");
-    xercesc::DOMElement* velocity_node = get_node<DOMElement>(curr_element, "Velocity");
-  
-    // Read in both sets of values
-    std::string time;
-    Vector3 position, velocity;
-    
-    cast_xmlch( get_node<DOMElement>(curr_element, "TIME" )->getTextContent(), time );
-    cast_xmlch( get_node<DOMElement>(location_node, "X")->getTextContent(), position.x() );
-    cast_xmlch( get_node<DOMElement>(location_node, "Y")->getTextContent(), position.y() );
-    cast_xmlch( get_node<DOMElement>(location_node, "Z")->getTextContent(), position.z() );
-    cast_xmlch( get_node<DOMElement>(velocity_node, "X")->getTextContent(), velocity.x() );
-    cast_xmlch( get_node<DOMElement>(velocity_node, "Y")->getTextContent(), velocity.y() );
-    cast_xmlch( get_node<DOMElement>(velocity_node, "Z")->getTextContent(), velocity.z() );
-    
-    position_logs.push_back(std::pair<std::string, Vector3>(time, position));
-    velocity_logs.push_back(std::pair<std::string, Vector3>(time, velocity));
-
-  } // End loop through corrected attitudes
+    read_ephemeris_point(curr_element);
+  } // End loop through points
 }
 
+void SpotXML::read_ephemeris_point(xercesc::DOMElement* point_node) {
 
+  // Get the three sub-nodes
+  xercesc::DOMElement* location_node = get_node<DOMElement>(point_node, "Location");
+  xercesc::DOMElement* velocity_node = get_node<DOMElement>(point_node, "Velocity");
 
-void SpotXML::read_attitude(xercesc::DOMElement* corrected_attitudes_node) {
+  // Read in both sets of values
+  std::string time;
+  Vector3 position, velocity;
 
-  pose_logs.clear(); // Reset data storage
+  cast_xmlch( get_node<DOMElement>(point_node,    "TIME")->getTextContent(), time );
+  cast_xmlch( get_node<DOMElement>(location_node, "X")->getTextContent(), position.x() );
+  cast_xmlch( get_node<DOMElement>(location_node, "Y")->getTextContent(), position.y() );
+  cast_xmlch( get_node<DOMElement>(location_node, "Z")->getTextContent(), position.z() );
+  cast_xmlch( get_node<DOMElement>(velocity_node, "X")->getTextContent(), velocity.x() );
+  cast_xmlch( get_node<DOMElement>(velocity_node, "Y")->getTextContent(), velocity.y() );
+  cast_xmlch( get_node<DOMElement>(velocity_node, "Z")->getTextContent(), velocity.z() );
+
+  position_logs.push_back(std::pair<std::string, Vector3>(time, position));
+  velocity_logs.push_back(std::pair<std::string, Vector3>(time, velocity));
+}
+
+void SpotXML::read_attitude(xercesc::DOMElement* corrected_attitudes_node) {
 
   // Dig one level down
   xercesc::DOMElement* corrected_attitude_node
     = get_node<DOMElement>(corrected_attitudes_node, "Corrected_Attitude");
 
-  // Pick out the "Angles" nodes
+  // Pick out the "Angles" nodes not read during parsing
   DOMNodeList* children = corrected_attitude_node->getChildNodes();
   for ( XMLSize_t i = 0; i < children->getLength(); ++i ) {
     // Check child node type
@@ -290,17 +286,21 @@ void SpotXML::read_attitude(xercesc::DOMElement* corrected_attitudes_node) {
     std::string tag( XMLString::transcode(curr_element->getTagName()) );
     if (tag.find("Angles") == std::string::npos)
       continue;
-  
-    std::pair<std::string, Vector3> data;
-    cast_xmlch( get_node<DOMElement>(curr_element, "YAW"  )->getTextContent(), data.second.x() );
-    cast_xmlch( get_node<DOMElement>(curr_element, "PITCH")->getTextContent(), data.second.y() );
-    cast_xmlch( get_node<DOMElement>(curr_element, "ROLL" )->getTextContent(), data.second.z() );
-    cast_xmlch( get_node<DOMElement>(curr_element, "TIME" )->getTextContent(), data.first );
-    pose_logs.push_back(data);
 
+    read_attitude_angles(curr_element);
   } // End loop through corrected attitudes
 }
 
+void SpotXML::read_attitude_angles(xercesc::DOMElement* angles_node) {
+
+  std::pair<std::string, Vector3> data;
+  cast_xmlch( get_node<DOMElement>(angles_node, "YAW"  )->getTextContent(), data.second.x() );
+  cast_xmlch( get_node<DOMElement>(angles_node, "PITCH")->getTextContent(), data.second.y() );
+  cast_xmlch( get_node<DOMElement>(angles_node, "ROLL" )->getTextContent(), data.second.z() );
+  cast_xmlch( get_node<DOMElement>(angles_node, "TIME" )->getTextContent(), data.first );
+  pose_logs.push_back(data);
+}
+
 void SpotXML::read_corners(xercesc::DOMElement* dataset_frame_node) {
 
   // Set up storage
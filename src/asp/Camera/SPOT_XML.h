@@ -45,12 +45,14 @@
 XERCES_CPP_NAMESPACE_BEGIN
   class DOMDocument;
   class DOMElement;
-  class XercesDOMParser;
-  class ErrorHandler;
 XERCES_CPP_NAMESPACE_END
 
 namespace asp {
 
+  namespace XmlUtils {
+    class StreamingParser;
+  }
+
   class SpotXML {
   public:
   
@@ -96,6 +98,14 @@ namespace asp {
     void read_look_angles(xercesc::DOMElement* look_angles_node);
     void read_ephemeris  (xercesc::DOMElement* ephemeris_node);
     void read_attitude   (xercesc::DOMElement* corrected_attitudes_node);
+
+    // Read one item of the long lists. These are called as soon as
+    // the parser reaches each item, and by the functions above for the
+    // items still in the tree.
+    void read_look_angle       (xercesc::DOMElement* look_angle_node);
+    void read_ephemeris_point  (xercesc::DOMElement* point_node);
+    void read_attitude_angles  (xercesc::DOMElement* angles_node);
+
     void read_corners    (xercesc::DOMElement* dataset_frame_node);
     void read_image_size (xercesc::DOMElement* raster_dims_node);
     void read_line_times (xercesc::DOMElement* sensor_config_node);
@@ -104,8 +114,7 @@ namespace asp {
     /// - All times are in seconds relative to May 5th, 2002 (when SPOT5 launched)
     double convert_time(std::string const& s) const;
 
-    boost::shared_ptr<xercesc::XercesDOMParser> m_parser;
-    boost::shared_ptr<xercesc::ErrorHandler>    m_errHandler;
+    boost::shared_ptr<XmlUtils::StreamingParser> m_parser;
     SecondsFromRef m_time_ref_functor;
 
   }; // End class SpotXML
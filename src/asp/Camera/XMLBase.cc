@@ -18,6 +18,131 @@
 
 #include <asp/Camera/XMLBase.h>
 
+#include <xercesc/dom/DOMConfiguration.hpp>
+#include <xercesc/dom/DOMDocument.hpp>
+#include <xercesc/dom/DOMImplementation.hpp>
+#include <xercesc/dom/DOMImplementationLS.hpp>
+#include <xercesc/dom/DOMImplementationRegistry.hpp>
+#include <xercesc/dom/DOMLSParserFilter.hpp>
+#include <xercesc/util/XMLUni.hpp>
+#include <xercesc/util/XMLUniDefs.hpp>
+
+#include <cstdlib>
+
 using namespace vw;
+using namespace xercesc;
+
+namespace asp {
+namespace XmlUtils {
+
+// Called by the parser on each element, once the element and all its
+// children are read
+class StreamingParser::Filter: public DOMLSParserFilter {
+public:
+
+  struct Entry {
+    XMLCh * parent_tag; // NULL if any parent
+    XMLCh * tag;
+    Callback callback;
+    bool keep;
+  };
+  std::vector<Entry> m_entries;
+
+  ~Filter() {
+    for (size_t it = 0; it < m_entries.size(); it++) {
+      if (m_entries[it].parent_tag != NULL)
+        XMLString::release(&m_entries[it].parent_tag);
+      XMLString::release(&m_entries[it].tag);
+    }
+  }
+
+  virtual FilterAction startElement(DOMElement* /*element*/) {
+    return DOMLSParserFilter::FILTER_ACCEPT;
+  }
+
+  virtual FilterAction acceptNode(DOMNode* node) {
+    DOMElement* element = dynamic_cast<DOMElement*>(node);
+    if (element == NULL)
+      return DOMLSParserFilter::FILTER_ACCEPT;
+
+    // Compare the tags without transcoding them, as this is done for
+    // every element in the file
+    for (size_t it = 0; it < m_entries.size(); it++) {
+      Entry const& entry = m_entries[it];
+      if (!XMLString::equals(element->getTagName(), entry.tag))
+        continue;
+      if (entry.parent_tag != NULL) {
+        DOMNode* parent = element->getParentNode();
+        if (parent == NULL || parent->getNodeType() != DOMNode::ELEMENT_NODE ||
+            !XMLString::equals(parent->getNodeName(), entry.parent_tag))
+          continue;
+      }
+      entry.callback(element);
+      // A rejected element is removed from the tree and released, so
+      // the parser can reuse its nodes for the next elements.
+      return entry.keep ? DOMLSParserFilter::FILTER_ACCEPT : DOMLSParserFilter::FILTER_REJECT;
+    }
+
+    return DOMLSParserFilter::FILTER_ACCEPT;
+  }
+
+  virtual DOMNodeFilter::ShowType getWhatToShow() const {
+    return DOMNodeFilter::SHOW_ELEMENT;
+  }
+};
+
+size_t read_numbers(DOMElement* element, size_t max_num, double* values) {
+
+  char* text = XMLString::transcode(element->getTextContent());
+  size_t num = 0;
+  const char* ptr = text;
+  while (num < max_num) {
+    char* end = NULL;
+    double val = strtod(ptr, &end);
+    if (end == ptr)
+      break; // no more numbers
+    values[num] = val;
+    num++;
+    ptr = end;
+  }
+  XMLString::release(&text);
+
+  return num;
+}
+
+StreamingParser::StreamingParser(): m_filter(new Filter) {
+  static const XMLCh ls_feature[] = {chLatin_L, chLatin_S, chNull};
+  DOMImplementation* impl = DOMImplementationRegistry::getDOMImplementation(ls_feature);
+  m_parser = dynamic_cast<DOMImplementationLS*>(impl)
+    ->createLSParser(DOMImplementationLS::MODE_SYNCHRONOUS, 0);
+  m_parser->getDomConfig()->setParameter(XMLUni::fgDOMNamespaces, true);
+  m_parser->setFilter(m_filter.get());
+}
+
+StreamingParser::~StreamingParser() {
+  m_parser->release(); // also releases the last parsed tree
+}
+
+void StreamingParser::add_callback(std::string const& parent_tag, std::string const& tag,
+                                   Callback const& callback, bool keep) {
+  Filter::Entry entry;
+  entry.parent_tag = NULL;
+  if (!parent_tag.empty())
+    entry.parent_tag = XMLString::transcode(parent_tag.c_str());
+  entry.tag      = XMLString::transcode(tag.c_str());
+  entry.callback = callback;
+  entry.keep     = keep;
+  m_filter->m_entries.push_back(entry);
+}
+
+DOMElement* StreamingParser::parse(std::string const& xml_path) {
+  DOMDocument* doc = m_parser->parseURI(xml_path.c_str());
+  if (doc == NULL || doc->getDocumentElement() == NULL)
+    vw_throw(IOErr() << "Could not parse: " << xml_path << ".\n");
+  return doc->getDocumentElement();
+}
+
+} // End namespace XmlUtils
+} // End namespace asp
 
 
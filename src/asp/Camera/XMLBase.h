@@ -26,14 +26,19 @@
 #include <vw/Core/Exception.h>
 #include <vw/Core/FundamentalTypes.h>
 
+#include <functional>
 #include <string>
+#include <vector>
 
 #include <boost/lexical_cast.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <bitset>
 
 
 #include <xercesc/dom/DOMElement.hpp>
+#include <xercesc/dom/DOMLSParser.hpp>
 #include <xercesc/dom/DOMNodeList.hpp>
 #include <xercesc/util/XMLString.hpp>
 #include <xercesc/util/Xerces_autoconf_config.hpp>
@@ -71,6 +76,41 @@ T* get_node( xercesc::DOMElement* element, std::string const& tag ) {
   return dynamic_cast<T*>(list->item(0));
 }
 
+/// Read up to max_num numbers separated by white space from the text
+/// of an element into the given array, and return how many were read.
+/// This is much faster than lexical_cast or streams for long lists.
+size_t read_numbers(xercesc::DOMElement* element, size_t max_num, double* values);
+
+/// Parses an XML file into a DOM tree, except for the elements
+/// with given tags, which are passed to a callback as soon as they
+/// are read, and then dropped from the tree. This is for the long
+/// lists of ephemeris and attitude samples in camera files, so the
+/// tree holds only the other data, which is small, and the samples
+/// are not looked up and copied around again.
+class StreamingParser: private boost::noncopyable {
+public:
+  typedef std::function<void(xercesc::DOMElement*)> Callback;
+
+  StreamingParser();
+  ~StreamingParser();
+
+  /// Pass to the callback the elements with this tag, and whose parent
+  /// has the given tag, if that is not empty. Unless keep is true, these
+  /// elements are then dropped from the tree.
+  void add_callback(std::string const& parent_tag, std::string const& tag,
+                    Callback const& callback, bool keep = false);
+
+  /// Parse a file and return the root of the tree. This is valid until
+  /// the next file is parsed or this object is destroyed. The Xerces
+  /// exceptions on invalid files are passed on.
+  xercesc::DOMElement* parse(std::string const& xml_path);
+
+private:
+  class Filter;
+  boost::shared_ptr<Filter> m_filter;
+  xercesc::DOMLSParser * m_parser;
+};
+
 } // End namespace XmlUtils 
 
 } // end namespace asp
@@ -0,0 +1,313 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+#include <vw/BundleAdjustment/ControlNetwork.h>
+#include <vw/Camera/PinholeModel.h>
+#include <asp/Camera/BundleAdjustCamera.h>
+#include <asp/Camera/BundleAdjustPartition.h>
+#include <asp/Tools/bundle_adjust_cost_functions.h>
+#include <test/Helpers.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace vw;
+using namespace vw::ba;
+
+TEST(BundleAdjustCamera, reorder_points) {
+
+  // Points seen by cameras {2}, {0, 1}, none, {1, 2}, {0}
+  int cams[5][2] = {{2, -1}, {0, 1}, {-1, -1}, {1, 2}, {0, -1}};
+  ControlNetwork cnet("test");
+  for (int ipt = 0; ipt < 5; ipt++) {
+    ControlPoint cp;
+    for (int it = 0; it < 2; it++) {
+      if (cams[ipt][it] >= 0)
+        cp.add_measure(ControlMeasure(10, 20, 1, 1, cams[ipt][it]));
+    }
+    cnet.add_control_point(cp);
+  }
+
+  std::vector<int> order;
+  asp::camera_major_point_order(cnet, order);
+  ASSERT_EQ(order.size(), 5u);
+  int expected[5] = {1, 4, 3, 0, 2};
+  for (int it = 0; it < 5; it++)
+    EXPECT_EQ(order[it], expected[it]);
+
+  asp::BAParams params(5, 3);
+  for (int ipt = 0; ipt < 5; ipt++)
+    params.set_point(ipt, Vector3(ipt, 10 * ipt, 100 * ipt));
+  asp::BAParams orig_params(params);
+
+  // The indices still refer to the same points, which are now stored in the new order
+  params.reorder_points(order);
+  for (int ipt = 0; ipt < 5; ipt++)
+    EXPECT_VECTOR_NEAR(params.get_point(ipt), orig_params.get_point(ipt), 1e-12);
+  EXPECT_EQ(params.get_point_vector()[3], 4.0);
+  EXPECT_EQ(params.get_point_ptr(1), &params.get_point_vector()[0]);
+
+  // Copying between different orders
+  orig_params.set_point(3, Vector3(7, 8, 9));
+  params.copy_points(orig_params);
+  EXPECT_VECTOR_NEAR(params.get_point(3), Vector3(7, 8, 9), 1e-12);
+  asp::BAParams params_copy(params);
+  EXPECT_VECTOR_NEAR(params_copy.get_point(3), Vector3(7, 8, 9), 1e-12);
+
+  order[0] = 4;
+  EXPECT_THROW(params.reorder_points(order), vw::ArgumentErr);
+}
+
+TEST(BundleAdjustCamera, AdjustedReprojectionJacobians) {
+
+  // A camera looking down the z axis
+  boost::shared_ptr<CameraModel> camera
+    (new PinholeModel(Vector3(100, 200, 300), math::identity_matrix<3>(),
+                      1000, 1000, 500, 500));
+  Vector2 observation(480, 510), pixel_sigma(2.0, 0.5);
+  Vector3 pt = camera->camera_center(observation)
+    + 1000 * camera->pixel_to_vector(observation) + Vector3(0.3, -0.2, 0.1);
+  double point[3] = {pt[0], pt[1], pt[2]};
+  double adjustment[6] = {0.5, -0.3, 0.2, 1e-3, -2e-3, 1.5e-3};
+  double const* parameters[2] = {point, adjustment};
+
+  AdjustedModelCheck check;
+  boost::shared_ptr<ceres::CostFunction> analytic
+    (BaAdjustedReprojectionError::Create(observation, pixel_sigma, camera, check, false));
+  ASSERT_TRUE(check.done && check.agrees);
+  ASSERT_TRUE(dynamic_cast<BaAdjustedReprojectionError*>(analytic.get()) != NULL);
+
+  boost::shared_ptr<CeresBundleModelBase> wrapper(new AdjustedCameraBundleModel(camera));
+  boost::shared_ptr<ceres::CostFunction> numeric
+    (BaReprojectionError::Create(observation, pixel_sigma, wrapper));
+
+  double analytic_res[2], numeric_res[2];
+  double analytic_jac0[6], analytic_jac1[12], numeric_jac0[6], numeric_jac1[12];
+  double * analytic_jac[2] = {analytic_jac0, analytic_jac1};
+  double * numeric_jac [2] = {numeric_jac0,  numeric_jac1};
+  ASSERT_TRUE(analytic->Evaluate(parameters, analytic_res, analytic_jac));
+  ASSERT_TRUE(numeric->Evaluate (parameters, numeric_res,  numeric_jac));
+
+  for (int r = 0; r < 2; r++)
+    EXPECT_NEAR(analytic_res[r], numeric_res[r], 1e-8);
+  for (int it = 0; it < 6; it++)
+    EXPECT_NEAR(analytic_jac0[it], numeric_jac0[it],
+                1e-5 * std::max(1.0, std::abs(numeric_jac0[it])));
+  for (int it = 0; it < 12; it++)
+    EXPECT_NEAR(analytic_jac1[it], numeric_jac1[it],
+                1e-5 * std::max(1.0, std::abs(numeric_jac1[it])));
+
+  // The check is not redone for the next observation in this camera
+  check.agrees = false;
+  boost::shared_ptr<ceres::CostFunction> next
+    (BaAdjustedReprojectionError::Create(observation, pixel_sigma, camera, check, false));
+  EXPECT_TRUE(dynamic_cast<BaAdjustedReprojectionError*>(next.get()) == NULL);
+}
+
+// Cameras along the x axis looking at points on a wavy surface. The
+// cameras have the given adjustments, and the observations are exact.
+void make_synthetic_problem(std::vector<boost::shared_ptr<CameraModel>> const& cameras,
+                            std::vector<Vector3> const& points,
+                            std::vector<std::vector<double>> const& adjustments,
+                            asp::BAParams & params, ceres::Problem & problem) {
+  std::vector<AdjustedModelCheck> model_checks(cameras.size());
+  for (size_t icam = 0; icam < cameras.size(); icam++) {
+    CameraAdjustment correction(&adjustments[icam][0]);
+    AdjustedCameraModel adj_cam(cameras[icam], correction.position(), correction.pose());
+    for (size_t ipt = 0; ipt < points.size(); ipt++) {
+      Vector2 pix = adj_cam.point_to_pixel(points[ipt]);
+      if (pix[0] < 0 || pix[0] > 1000 || pix[1] < 0 || pix[1] > 1000)
+        continue;
+      ceres::CostFunction * cost_function
+        = BaAdjustedReprojectionError::Create(pix, Vector2(1, 1), cameras[icam],
+                                              model_checks[icam], false);
+      problem.AddResidualBlock(cost_function, NULL, params.get_point_ptr(ipt),
+                               params.get_camera_ptr(icam));
+    }
+  }
+  problem.SetParameterBlockConstant(params.get_camera_ptr(0));
+}
+
+TEST(BundleAdjustCamera, PartitionedSolve) {
+
+  // The last camera sees no points, so it is not in the problem
+  int num_cameras = 9;
+  std::vector<boost::shared_ptr<CameraModel>> cameras;
+  std::vector<std::vector<double>> adjustments;
+  for (int icam = 0; icam < num_cameras; icam++) {
+    cameras.push_back(boost::shared_ptr<CameraModel>
+                      (new PinholeModel(Vector3(150 * icam + 1e5 * (icam == num_cameras - 1),
+                                                0, 0),
+                                        math::identity_matrix<3>(), 1000, 1000, 500, 500)));
+    std::vector<double> adj(6, 0.0);
+    if (icam > 0) {
+      for (int k = 0; k < 3; k++) {
+        adj[k]     = 0.5 * sin(icam + k);
+        adj[3 + k] = 1e-4 * cos(icam + 2 * k);
+      }
+    }
+    adjustments.push_back(adj);
+  }
+  std::vector<Vector3> points;
+  for (double x = -300; x <= 1350; x += 75)
+    for (double y = -300; y <= 300; y += 150)
+      points.push_back(Vector3(x, y, 1000 + 20 * sin(0.01 * (x + y))));
+
+  // Start with perturbed points and no camera adjustments
+  asp::BAParams params(points.size(), num_cameras);
+  for (size_t ipt = 0; ipt < points.size(); ipt++)
+    params.set_point(ipt, points[ipt] + Vector3(sin(ipt), cos(ipt), sin(2.0 * ipt)));
+  asp::BAParams part_params(params);
+
+  ceres::Problem problem, part_problem;
+  make_synthetic_problem(cameras, points, adjustments, params, problem);
+  make_synthetic_problem(cameras, points, adjustments, part_params, part_problem);
+  ASSERT_FALSE(problem.HasParameterBlock(params.get_camera_ptr(num_cameras - 1)));
+
+  ceres::Problem::EvaluateOptions eval_options;
+  double init_cost = 0.0;
+  problem.Evaluate(eval_options, &init_cost, NULL, NULL, NULL);
+  ASSERT_GT(init_cost, 1.0);
+
+  ceres::Solver::Options options;
+  options.gradient_tolerance  = 1e-16;
+  options.function_tolerance  = 1e-16;
+  options.parameter_tolerance = 1e-12;
+  options.max_num_iterations  = 100;
+  options.linear_solver_type  = ceres::DENSE_SCHUR;
+  ceres::Solver::Summary summary, part_summary;
+  ceres::Solve(options, &problem, &summary);
+
+  double part_cost = 0.0;
+  int num_partitions = 2, num_rounds = 50, num_threads = 2;
+  asp::solve_partitioned(options, eval_options, num_partitions, num_rounds, num_threads,
+                         part_params, part_problem, part_summary, part_cost);
+
+  // The partitioned solve gets as close to the minimum as the full solve
+  EXPECT_LT(summary.final_cost, 1e-6 * init_cost);
+  EXPECT_NEAR(part_cost, summary.final_cost, 1e-3 * init_cost);
+  double check_cost = 0.0;
+  part_problem.Evaluate(eval_options, &check_cost, NULL, NULL, NULL);
+  EXPECT_NEAR(part_cost, check_cost, 1e-10 * init_cost);
+  EXPECT_NEAR(part_summary.initial_cost, init_cost, 1e-10 * init_cost);
+}
+
+TEST(BundleAdjustCamera, SurrogateProjection) {
+
+  boost::shared_ptr<CameraModel> camera
+    (new PinholeModel(Vector3(100, 200, 300), math::identity_matrix<3>(),
+                      1000, 1000, 500, 500));
+  Vector2 observation(480, 510), pixel_sigma(1, 1);
+  Vector3 pt = camera->camera_center(observation) + 1000 * camera->pixel_to_vector(observation);
+  double point[3] = {pt[0], pt[1], pt[2]};
+  double adjustment[6] = {0.5, -0.3, 0.2, 1e-3, -2e-3, 1.5e-3};
+  double const* parameters[2] = {point, adjustment};
+
+  AdjustedModelCheck check;
+  bool camera_surrogate = true;
+  boost::shared_ptr<ceres::CostFunction> cost
+    (BaAdjustedReprojectionError::Create(observation, pixel_sigma, camera, check,
+                                         camera_surrogate));
+  BaAdjustedReprojectionError * adj_cost
+    = dynamic_cast<BaAdjustedReprojectionError*>(cost.get());
+  ASSERT_TRUE(adj_cost != NULL);
+
+  // At the point of linearization the two agree
+  double exact_res[2], surrogate_res[2], orig_res[2];
+  cost->Evaluate(parameters, exact_res, NULL);
+  std::copy(exact_res, exact_res + 2, orig_res);
+  adj_cost->fit_surrogate(point, adjustment);
+  cost->Evaluate(parameters, surrogate_res, NULL);
+  for (int r = 0; r < 2; r++)
+    EXPECT_NEAR(exact_res[r], surrogate_res[r], 1e-8);
+
+  // Nearby, the surrogate stays close to the exact camera
+  for (int k = 0; k < 3; k++) {
+    point[k]          += 0.1;
+    adjustment[k]     -= 0.1;
+    adjustment[3 + k] += 1e-5;
+  }
+  cost->Evaluate(parameters, surrogate_res, NULL);
+  adj_cost->clear_surrogate();
+  cost->Evaluate(parameters, exact_res, NULL);
+  for (int r = 0; r < 2; r++) {
+    EXPECT_GT(std::abs(exact_res[r] - orig_res[r]), 1e-2);
+    EXPECT_NEAR(exact_res[r], surrogate_res[r], 1e-3);
+  }
+}
+
+// A camera whose projection is far from linear, so that a linearized
+// version of it is a poor approximation away from where it was made.
+class SineCameraModel: public CameraModel {
+public:
+  virtual Vector2 point_to_pixel(Vector3 const& point) const {
+    return Vector2(100 * sin((point[0] + 78) / 50), 100 * sin((point[1] + 78) / 50));
+  }
+  virtual Vector3 pixel_to_vector(Vector2 const& pix) const {
+    return normalize(Vector3(1, 1, 1));
+  }
+  virtual Vector3 camera_center(Vector2 const& pix = Vector2()) const {
+    return Vector3();
+  }
+  virtual std::string type() const { return "Sine"; }
+};
+
+TEST(BundleAdjustCamera, SurrogateFallback) {
+
+  // The point is at the camera center and fixed. The observation is
+  // seen when the camera moves by 20 in x and y, while the projection
+  // starts close to a peak, where the linearization predicts a move by
+  // hundreds. So the solve with the linearized camera makes the exact
+  // cost increase.
+  boost::shared_ptr<CameraModel> camera(new SineCameraModel);
+  Vector2 observation(100 * sin(58.0 / 50), 100 * sin(58.0 / 50));
+  asp::BAParams param_storage(1, 1);
+  double * point  = param_storage.get_point_ptr(0);
+  double * adjustment = param_storage.get_camera_ptr(0);
+
+  AdjustedModelCheck check;
+  bool camera_surrogate = true;
+  ceres::CostFunction * cost_function
+    = BaAdjustedReprojectionError::Create(observation, Vector2(1, 1), camera, check,
+                                          camera_surrogate);
+  ceres::Problem problem;
+  problem.AddResidualBlock(cost_function, NULL, point, adjustment);
+  problem.SetParameterBlockConstant(point);
+  std::vector<CameraSurrogate> surrogates(1);
+  surrogates[0].cost_function = dynamic_cast<BaAdjustedReprojectionError*>(cost_function);
+  surrogates[0].point  = point;
+  surrogates[0].camera = adjustment;
+  ASSERT_TRUE(surrogates[0].cost_function != NULL);
+
+  ceres::Problem::EvaluateOptions eval_options;
+  double init_cost = asp::problem_cost(eval_options, problem);
+
+  ceres::Solver::Options options;
+  options.max_num_iterations = 100;
+  ceres::Solver::Summary summary;
+  double final_cost = 0.0;
+  int max_refits = 5, num_threads = 1;
+  double tolerance = 1e-3;
+  solve_with_camera_surrogates(options, eval_options, max_refits, tolerance, num_threads,
+                               surrogates, param_storage, problem, summary, final_cost);
+
+  // The solve with the exact camera was done, and it found the minimum
+  EXPECT_NE(std::string::npos, summary.message.find("exact cameras"));
+  EXPECT_LT(final_cost, 1e-6 * init_cost);
+  EXPECT_NEAR(final_cost, asp::problem_cost(eval_options, problem), 1e-10);
+  EXPECT_NEAR(init_cost, summary.initial_cost, 1e-10);
+}
@@ -0,0 +1,100 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+// Time the camera models for which there are sample files here. Set
+// ASP_CAMERA_BENCHMARK_JSON to a file name to save the results, and
+// ASP_CAMERA_BENCHMARK_SECONDS to make each measurement longer than
+// the short default used for testing. For other models use
+// cam_test --benchmark.
+
+#include <asp/Camera/CameraBenchmark.h>
+#include <asp/Camera/LinescanDGModel.h>
+#include <asp/Camera/LinescanSpotModel.h>
+#include <asp/Camera/RPCModel.h>
+#include <asp/Camera/RPC_XML.h>
+#include <vw/Camera/PinholeModel.h>
+#include <test/Helpers.h>
+#include <xercesc/util/PlatformUtils.hpp>
+
+#include <cstdlib>
+
+using namespace vw;
+using namespace asp;
+
+TEST(CameraBenchmark, Throughput) {
+
+  xercesc::XMLPlatformUtils::Initialize();
+
+  double seconds = 0.05;
+  if (getenv("ASP_CAMERA_BENCHMARK_SECONDS") != NULL)
+    seconds = atof(getenv("ASP_CAMERA_BENCHMARK_SECONDS"));
+
+  std::vector<int> thread_counts;
+  thread_counts.push_back(1);
+  thread_counts.push_back(2);
+
+  vw::cartography::Datum datum("WGS84");
+  std::vector<std::string> names;
+  std::vector<boost::shared_ptr<vw::camera::CameraModel>> cams;
+  std::vector<Vector2i> sizes;
+
+  // A pinhole camera 500 km above the equator, looking down
+  Matrix3x3 rot;
+  rot(0, 2) = -1; rot(1, 0) = 1; rot(2, 1) = -1;
+  Vector3 ctr(datum.semi_major_axis() + 500000.0, 0, 0);
+  names.push_back("pinhole");
+  cams.push_back(boost::shared_ptr<vw::camera::CameraModel>
+                 (new vw::camera::PinholeModel(ctr, rot, 5000, 5000, 500, 500)));
+  sizes.push_back(Vector2i(1000, 1000));
+
+  names.push_back("dg");
+  cams.push_back(load_dg_camera_model_from_xml("dg_example1.xml"));
+  sizes.push_back(Vector2i(35170, 23708));
+
+  RPCXML xml;
+  xml.read_from_file("dg_example1.xml");
+  names.push_back("rpc");
+  cams.push_back(boost::shared_ptr<vw::camera::CameraModel>(new RPCModel(*xml.rpc_ptr())));
+  sizes.push_back(Vector2i(35170, 23708));
+
+  names.push_back("spot5");
+  cams.push_back(load_spot5_camera_model_from_xml("spot_example1.xml"));
+  sizes.push_back(Vector2i(300, 96168));
+
+  std::vector<CameraBenchmarkResult> results;
+  for (size_t it = 0; it < cams.size(); it++) {
+    std::vector<Vector2> pixels;
+    std::vector<Vector3> points;
+    ASSERT_NO_THROW(camera_benchmark_samples(cams[it].get(), sizes[it], datum, 0.0,
+                                             100, pixels, points));
+    EXPECT_EQ(pixels.size(), points.size());
+    benchmark_camera(names[it], cams[it], pixels, points, thread_counts, seconds, results);
+  }
+
+  // Three functions for each model and thread count
+  ASSERT_EQ(cams.size() * 3 * thread_counts.size(), results.size());
+  for (size_t it = 0; it < results.size(); it++) {
+    EXPECT_GT(results[it].num_calls, 0);
+    EXPECT_GT(results[it].calls_per_second(), 0);
+  }
+
+  print_camera_benchmark(results);
+  if (getenv("ASP_CAMERA_BENCHMARK_JSON") != NULL)
+    write_camera_benchmark_json(getenv("ASP_CAMERA_BENCHMARK_JSON"), results);
+
+  xercesc::XMLPlatformUtils::Terminate();
+}
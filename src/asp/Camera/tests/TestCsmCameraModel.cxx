@@ -16,9 +16,12 @@
 // __END_LICENSE__
 
 #include <asp/Camera/CsmModel.h>
+#include <asp/Camera/LinescanDGModel.h>
+#include <xercesc/util/PlatformUtils.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <test/Helpers.h>
 #include <iomanip>
+#include <vector>
 
 using namespace vw;
 using namespace asp;
@@ -62,3 +65,39 @@ TEST(CSM_camera, basic_check) {
 
 
 
+TEST(CSM_camera, BatchPointToPixel) {
+
+  // The DG camera wraps a CSM linescan model
+  xercesc::XMLPlatformUtils::Initialize();
+  vw::CamPtr cam = vw::CamPtr(load_dg_camera_model_from_xml("dg_example1.xml"));
+  DGCameraModel const* dg_cam = dynamic_cast<DGCameraModel const*>(cam.get());
+  ASSERT_TRUE(dg_cam != 0);
+  CsmModel const& csm = *dg_cam->m_csm_model;
+
+  std::vector<Vector3> points;
+  for (size_t j = 0; j < 24000; j += 2000) {
+    for (size_t i = 0; i < 30000; i += 2000) {
+      Vector2 pix(i, j);
+      points.push_back(csm.camera_center(pix) + 2e4 * csm.pixel_to_vector(pix));
+    }
+  }
+
+  // The result must not depend on the number of threads
+  std::vector<Vector2> serial_pixels;
+  for (size_t it = 0; it < points.size(); it++)
+    serial_pixels.push_back(csm.point_to_pixel(points[it]));
+  for (int num_threads = 1; num_threads <= 8; num_threads *= 2) {
+    std::vector<Vector2> batch_pixels;
+    csm.point_to_pixel(points, batch_pixels, num_threads);
+    ASSERT_EQ(points.size(), batch_pixels.size());
+    for (size_t it = 0; it < points.size(); it++)
+      EXPECT_VECTOR_NEAR(serial_pixels[it], batch_pixels[it], 1e-10);
+  }
+
+  // A clone projects the same as the original
+  boost::shared_ptr<CsmModel> clone = csm.clone();
+  for (size_t it = 0; it < points.size(); it++)
+    EXPECT_VECTOR_NEAR(serial_pixels[it], clone->point_to_pixel(points[it]), 1e-10);
+
+  xercesc::XMLPlatformUtils::Terminate();
+}
@@ -16,17 +16,30 @@
 // __END_LICENSE__
 
 
+#include <asp/Camera/CsmModel.h>
 #include <asp/Camera/LinescanDGModel.h>
+#include <asp/Camera/LinescanModelPool.h>
 #include <asp/Camera/RPC_XML.h>
 #include <asp/Camera/XMLBase.h>
 #include <asp/Camera/RPCModel.h>
 #include <boost/scoped_ptr.hpp>
+#include <boost/lexical_cast.hpp>
 #include <test/Helpers.h>
 
+#include <vw/Core/Stopwatch.h>
+
 #include <vw/Stereo/StereoModel.h>
 
 #include <vw/Cartography/GeoTransform.h>
 
+#include <usgscsm/UsgsAstroLsSensorModel.h>
+
+#include <xercesc/parsers/XercesDOMParser.hpp>
+#include <xercesc/sax/HandlerBase.hpp>
+
+#include <fstream>
+#include <sstream>
+
 using namespace vw;
 using namespace asp;
 using namespace xercesc;
@@ -160,3 +173,339 @@ TEST(DGCameraModel, CreateCamera) {
   XMLPlatformUtils::Terminate();
 }
 
+
+TEST(DGCameraModel, BatchPointToPixel) {
+
+  xercesc::XMLPlatformUtils::Initialize();
+  
+  vw::CamPtr cam = vw::CamPtr(load_dg_camera_model_from_xml("dg_example1.xml"));
+  DGCameraModel const* dg_cam = dynamic_cast<DGCameraModel const*>(cam.get());
+  ASSERT_TRUE(dg_cam != 0);
+
+  // Points along image rows, as when projecting a DEM
+  std::vector<Vector2> pixels;
+  std::vector<Vector3> points;
+  for (size_t j = 0; j < 24000; j += 1000) {
+    for (size_t i = 0; i < 30000; i += 1000) {
+      Vector2 pix(i, j);
+      pixels.push_back(pix);
+      points.push_back(cam->camera_center(pix) + 2e4 * cam->pixel_to_vector(pix));
+    }
+  }
+
+  std::vector<Vector2> batch_pixels;
+  dg_cam->point_to_pixel(points, batch_pixels);
+  ASSERT_EQ(points.size(), batch_pixels.size());
+  for (size_t it = 0; it < points.size(); it++) {
+    EXPECT_VECTOR_NEAR(pixels[it], batch_pixels[it], 1e-1 /*pixels*/);
+    EXPECT_VECTOR_NEAR(cam->point_to_pixel(points[it]), batch_pixels[it], 1e-6);
+  }
+
+  XMLPlatformUtils::Terminate();
+}
+
+TEST(DGCameraModel, InterpTables) {
+
+  xercesc::XMLPlatformUtils::Initialize();
+  
+  vw::CamPtr cam = vw::CamPtr(load_dg_camera_model_from_xml("dg_example1.xml"));
+  DGCameraModel * dg_cam = dynamic_cast<DGCameraModel*>(cam.get());
+  ASSERT_TRUE(dg_cam != 0);
+
+  // Rays and projections with the original interpolation
+  std::vector<Vector2> pixels;
+  std::vector<Vector3> centers, dirs, points;
+  for (size_t j = 0; j < 24000; j += 1500) {
+    for (size_t i = 0; i < 30000; i += 1500) {
+      Vector2 pix(i + 0.3, j + 0.7);
+      pixels.push_back(pix);
+      centers.push_back(cam->camera_center(pix));
+      dirs.push_back(cam->pixel_to_vector(pix));
+      points.push_back(centers.back() + 2e4 * dirs.back());
+    }
+  }
+
+  EXPECT_TRUE(dg_cam->buildInterpTables());
+
+  for (size_t it = 0; it < pixels.size(); it++) {
+    EXPECT_VECTOR_NEAR(centers[it], cam->camera_center(pixels[it]), 1e-6);
+    EXPECT_VECTOR_NEAR(dirs[it], cam->pixel_to_vector(pixels[it]), 1e-9);
+    EXPECT_VECTOR_NEAR(pixels[it], cam->point_to_pixel(points[it]), 1e-3 /*pixels*/);
+  }
+
+  // The velocity table agrees too
+  double t = dg_cam->get_time_at_line(5000.5);
+  EXPECT_VECTOR_NEAR(dg_cam->get_velocity_func()(t), dg_cam->get_camera_velocity_at_time(t), 1e-6);
+
+  XMLPlatformUtils::Terminate();
+}
+
+// A copy of the linescan model borrowed from the pool projects the same
+// as a fresh copy of the model, also after the model changes.
+TEST(DGCameraModel, LinescanModelPool) {
+
+  xercesc::XMLPlatformUtils::Initialize();
+  
+  vw::CamPtr cam = vw::CamPtr(load_dg_camera_model_from_xml("dg_example1.xml"));
+  DGCameraModel * dg_cam = dynamic_cast<DGCameraModel*>(cam.get());
+  ASSERT_TRUE(dg_cam != 0);
+  UsgsAstroLsSensorModel * ls_model = dg_cam->m_ls_model.get();
+  ASSERT_TRUE(ls_model != 0);
+  int num_quat = ls_model->m_quaternions.size() / 4;
+  int num_pos  = ls_model->m_positions.size() / 3;
+
+  std::vector<csm::EcefCoord> points;
+  for (size_t j = 2000; j < 24000; j += 5000) {
+    for (size_t i = 2000; i < 30000; i += 5000) {
+      Vector3 P = cam->camera_center(Vector2(i, j)) + 2e4 * cam->pixel_to_vector(Vector2(i, j));
+      points.push_back(csm::EcefCoord(P[0], P[1], P[2]));
+    }
+  }
+
+  LsModelPool pool(ls_model);
+  double precision = asp::DEFAULT_CSM_DESIRED_PRECISISON;
+  for (int pass = 0; pass < 2; pass++) {
+
+    // Borrow a copy and modify it, as when evaluating a residual. On
+    // return, the modified quaternions and positions are restored.
+    LsModelPool::Entry entry = pool.acquire();
+    for (size_t it = 0; it < entry.model->m_positions.size(); it++)
+      entry.model->m_positions[it] += 50.0;
+    for (size_t it = 0; it < entry.model->m_quaternions.size(); it++)
+      entry.model->m_quaternions[it] *= 1.01;
+    pool.release(entry, 0, num_quat, 0, num_pos);
+
+    // Change the model outside the range the borrower modified
+    std::vector<csm::ImageCoord> prev_pixels;
+    UsgsAstroLsSensorModel prev_model(*ls_model);
+    for (size_t it = 0; it < points.size(); it++)
+      prev_pixels.push_back(prev_model.groundToImage(points[it], precision));
+    for (size_t it = 0; it < ls_model->m_positions.size(); it++)
+      ls_model->m_positions[it] += 10.0 * (pass + 1);
+    pool.refresh();
+
+    entry = pool.acquire();
+    UsgsAstroLsSensorModel fresh_model(*ls_model);
+    for (size_t it = 0; it < points.size(); it++) {
+      csm::ImageCoord fresh_pix = fresh_model.groundToImage(points[it], precision);
+      csm::ImageCoord pool_pix  = entry.model->groundToImage(points[it], precision);
+      EXPECT_NEAR(fresh_pix.line, pool_pix.line, 1e-8);
+      EXPECT_NEAR(fresh_pix.samp, pool_pix.samp, 1e-8);
+      // The change to the model is seen
+      EXPECT_GT(std::abs(fresh_pix.line - prev_pixels[it].line) +
+                std::abs(fresh_pix.samp - prev_pixels[it].samp), 1e-3);
+    }
+    pool.release(entry, 0, 0, 0, 0);
+  }
+
+  XMLPlatformUtils::Terminate();
+}
+
+// The ephemeris and attitude of a Digital Globe file
+struct DgLists {
+  std::string eph_start_time, att_start_time;
+  double eph_time_interval, att_time_interval;
+  std::vector<Vector3> positions, velocities;
+  std::vector<Vector<double, 6>> position_covariances;
+  std::vector<Vector<double, 4>> quats;
+  std::vector<Vector<double, 10>> quat_covariances;
+};
+
+// Read the number of points and the list items of the EPH or ATT
+// section with string streams, as done before the lists were read
+// while parsing. Each item has an index, then the given number of
+// values.
+void read_dg_list_from_tree(xercesc::DOMElement* node, std::string const& list_tag,
+                            std::string & start_time, double & time_interval,
+                            std::vector<std::vector<double>> & items) {
+  using namespace xercesc;
+  XmlUtils::cast_xmlch(XmlUtils::get_node<DOMElement>(node, "STARTTIME")->getTextContent(),
+                       start_time);
+  XmlUtils::cast_xmlch(XmlUtils::get_node<DOMElement>(node, "TIMEINTERVAL")->getTextContent(),
+                       time_interval);
+  size_t num_points = 0;
+  XmlUtils::cast_xmlch(XmlUtils::get_node<DOMElement>(node, "NUMPOINTS")->getTextContent(),
+                       num_points);
+  items.clear();
+  items.resize(num_points);
+
+  DOMNodeList* children = XmlUtils::get_node<DOMElement>(node, list_tag)->getChildNodes();
+  for (XMLSize_t i = 0; i < children->getLength(); i++) {
+    if (children->item(i)->getNodeType() != DOMNode::ELEMENT_NODE)
+      continue;
+    std::string buffer;
+    XmlUtils::cast_xmlch(dynamic_cast<DOMElement*>(children->item(i))->getTextContent(),
+                         buffer);
+    std::istringstream istr(buffer);
+    std::string index_b;
+    istr >> index_b;
+    size_t index = size_t(boost::lexical_cast<float>(index_b) + 0.5) - 1;
+    ASSERT_LT(index, items.size());
+    double val;
+    while (istr >> val)
+      items[index].push_back(val);
+  }
+}
+
+// Read a Digital Globe file from a full DOM tree, the way read_xml()
+// did before the lists were read while parsing. All sections are read,
+// so the time is comparable to that of read_xml(). The GEO, IMD, and
+// RPB sections are read with the current code, which accepts a full
+// tree, and the EPH and ATT lists with the former code.
+void read_dg_xml_from_tree(std::string const& xml_file, GeometricXML & geo,
+                           ImageXML & img, RPCXML & rpc, DgLists & lists) {
+  using namespace xercesc;
+  boost::scoped_ptr<XercesDOMParser> parser(new XercesDOMParser());
+  parser->setValidationScheme(XercesDOMParser::Val_Always);
+  parser->setDoNamespaces(true);
+  boost::scoped_ptr<ErrorHandler> errHandler(new HandlerBase());
+  parser->setErrorHandler(errHandler.get());
+  parser->parse(xml_file.c_str());
+  DOMElement* root = parser->getDocument()->getDocumentElement();
+
+  try {
+    rpc.parse_bbox(root);
+  } catch(...) {}
+
+  std::vector<std::vector<double>> eph_items, att_items;
+  DOMNodeList* children = root->getChildNodes();
+  for (XMLSize_t i = 0; i < children->getLength(); i++) {
+    if (children->item(i)->getNodeType() != DOMNode::ELEMENT_NODE)
+      continue;
+    DOMElement* element = dynamic_cast<DOMElement*>(children->item(i));
+    std::string tag;
+    XmlUtils::cast_xmlch(element->getTagName(), tag);
+    if (tag == "GEO")
+      geo.parse(element);
+    else if (tag == "IMD")
+      img.parse(element);
+    else if (tag == "RPB")
+      rpc.parse(element);
+    else if (tag == "EPH")
+      read_dg_list_from_tree(element, "EPHEMLISTList", lists.eph_start_time,
+                             lists.eph_time_interval, eph_items);
+    else if (tag == "ATT")
+      read_dg_list_from_tree(element, "ATTLISTList", lists.att_start_time,
+                             lists.att_time_interval, att_items);
+  }
+
+  // Position, velocity, and 6 covariances, then a quaternion and 10 covariances
+  for (size_t i = 0; i < eph_items.size(); i++) {
+    std::vector<double> const& v = eph_items[i];
+    ASSERT_GE(v.size(), 12u);
+    lists.positions.push_back(Vector3(v[0], v[1], v[2]));
+    lists.velocities.push_back(Vector3(v[3], v[4], v[5]));
+    Vector<double, 6> cov;
+    for (int c = 0; c < 6; c++)
+      cov[c] = v[6 + c];
+    lists.position_covariances.push_back(cov);
+  }
+  for (size_t i = 0; i < att_items.size(); i++) {
+    std::vector<double> const& v = att_items[i];
+    ASSERT_GE(v.size(), 14u);
+    lists.quats.push_back(Vector<double, 4>(v[0], v[1], v[2], v[3]));
+    Vector<double, 10> cov;
+    for (int c = 0; c < 10; c++)
+      cov[c] = v[4 + c];
+    lists.quat_covariances.push_back(cov);
+  }
+}
+
+// Compare the time to load Digital Globe files with the lists read
+// while parsing to that with a full DOM tree, and check that the
+// values are the same.
+TEST(DGCameraModel, XmlLoadTime) {
+
+  xercesc::XMLPlatformUtils::Initialize();
+
+  int num_reps = 2;
+  if (getenv("ASP_CAMERA_BENCHMARK_SECONDS") != NULL)
+    num_reps = 20;
+
+  std::vector<std::string> files;
+  files.push_back("dg_example1.xml");
+  files.push_back("dg_example3.xml");
+  files.push_back("wv_test1.xml");
+
+  for (size_t it = 0; it < files.size(); it++) {
+
+    double stream_seconds = 0.0, tree_seconds = 0.0;
+    for (int rep = 0; rep < num_reps; rep++) {
+      GeometricXML geo, tree_geo;
+      AttitudeXML  att;
+      EphemerisXML eph;
+      ImageXML     img, tree_img;
+      RPCXML       rpc, tree_rpc;
+      DgLists      tree;
+
+      Stopwatch sw;
+      sw.start();
+      read_xml(files[it], geo, att, eph, img, rpc);
+      sw.stop();
+      stream_seconds += sw.elapsed_seconds();
+
+      Stopwatch tree_sw;
+      tree_sw.start();
+      read_dg_xml_from_tree(files[it], tree_geo, tree_img, tree_rpc, tree);
+      tree_sw.stop();
+      tree_seconds += tree_sw.elapsed_seconds();
+
+      // The same values either way
+      EXPECT_EQ(eph.start_time, tree.eph_start_time);
+      EXPECT_EQ(att.start_time, tree.att_start_time);
+      EXPECT_EQ(eph.time_interval, tree.eph_time_interval);
+      EXPECT_EQ(att.time_interval, tree.att_time_interval);
+      ASSERT_EQ(eph.satellite_position_vec.size(), tree.positions.size());
+      ASSERT_EQ(att.satellite_quat_vec.size(), tree.quats.size());
+      for (size_t i = 0; i < eph.satellite_position_vec.size(); i++) {
+        EXPECT_VECTOR_NEAR(eph.satellite_position_vec[i], tree.positions[i], 1e-6);
+        EXPECT_VECTOR_NEAR(eph.velocity_vec[i], tree.velocities[i], 1e-9);
+        EXPECT_VECTOR_NEAR(eph.satellite_position_covariance_vec[i],
+                           tree.position_covariances[i], 1e-20);
+      }
+      for (size_t i = 0; i < att.satellite_quat_vec.size(); i++) {
+        EXPECT_VECTOR_NEAR(att.satellite_quat_vec[i], tree.quats[i], 1e-12);
+        EXPECT_VECTOR_NEAR(att.satellite_quat_covariance_vec[i],
+                           tree.quat_covariances[i], 1e-20);
+      }
+      EXPECT_EQ(img.tlc_vec.size(), tree_img.tlc_vec.size());
+      EXPECT_VECTOR_NEAR(geo.detector_origin, tree_geo.detector_origin, 1e-12);
+    }
+
+    vw_out() << files[it] << ": " << 1000.0 * stream_seconds / num_reps
+             << " ms per load while parsing, " << 1000.0 * tree_seconds / num_reps
+             << " ms with a full tree.\n";
+  }
+
+  xercesc::XMLPlatformUtils::Terminate();
+}
+
+// A point index past the declared number of points is an error.
+TEST(DGCameraModel, XmlPointOutOfRange) {
+
+  xercesc::XMLPlatformUtils::Initialize();
+
+  std::ifstream ifs("dg_example1.xml");
+  std::stringstream buffer;
+  buffer << ifs.rdbuf();
+  std::string text = buffer.str();
+  std::string declared = "<NUMPOINTS>840</NUMPOINTS>";
+  size_t pos = text.find(declared);
+  ASSERT_NE(pos, std::string::npos);
+  text.replace(pos, declared.size(), "<NUMPOINTS>839</NUMPOINTS>");
+
+  UnlinkName xml_file("dg_out_of_range.xml");
+  {
+    std::ofstream ofs(xml_file.c_str());
+    ofs << text;
+  }
+
+  GeometricXML geo;
+  AttitudeXML  att;
+  EphemerisXML eph;
+  ImageXML     img;
+  RPCXML       rpc;
+  EXPECT_THROW(read_xml(xml_file, geo, att, eph, img, rpc), ArgumentErr);
+
+  xercesc::XMLPlatformUtils::Terminate();
+}
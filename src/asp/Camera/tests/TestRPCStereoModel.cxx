@@ -29,7 +29,11 @@
 #include <asp/Camera/LinescanDGModel.h>
 #include <asp/Camera/RPCModel.h>
 #include <asp/Camera/RPCStereoModel.h>
+#include <asp/Camera/RPCModelGen.h>
 #include <asp/Core/StereoSettings.h>
+#include <vw/Camera/PinholeModel.h>
+#include <vw/Cartography/Datum.h>
+#include <vw/Core/ThreadPool.h>
 #include <xercesc/util/PlatformUtils.hpp>
 
 
@@ -192,6 +196,59 @@ TEST( StereoSessionRPC, InstantiateTest ) {
   xercesc::XMLPlatformUtils::Terminate();
 }
 
+TEST( StereoSessionRPC, BatchEvaluation ) {
+  xercesc::XMLPlatformUtils::Initialize();
+
+  RPCXML xml;
+  xml.read_from_file( "dg_example1.xml" );
+  RPCModel model( *xml.rpc_ptr() );
+
+  // Sample points in the valid region of the model
+  std::vector<double> lon, lat, height;
+  Vector3 off = model.lonlatheight_offset(), scale = model.lonlatheight_scale();
+  for (int i = -3; i <= 3; i++) {
+    for (int j = -3; j <= 3; j++) {
+      lon.push_back(off[0] + 0.25 * i * scale[0]);
+      lat.push_back(off[1] + 0.25 * j * scale[1]);
+      height.push_back(off[2] + 0.1 * (i - j) * scale[2]);
+    }
+  }
+  int n = lon.size();
+
+  // Projection and its Jacobian
+  std::vector<double> x(n), y(n), J(6*n);
+  model.geodetic_to_pixel(n, &lon[0], &lat[0], &height[0], &x[0], &y[0]);
+  model.geodetic_to_pixel_Jacobian(n, &lon[0], &lat[0], &height[0], &J[0]);
+  for (int i = 0; i < n; i++) {
+    Vector3 llh(lon[i], lat[i], height[i]);
+    EXPECT_VECTOR_NEAR( model.geodetic_to_pixel(llh), Vector2(x[i], y[i]), 1e-6 );
+    Matrix<double, 2, 3> Je = model.geodetic_to_pixel_Jacobian(llh);
+    for (int row = 0; row < 2; row++) {
+      for (int col = 0; col < 3; col++)
+        EXPECT_NEAR( Je(row, col), J[6*i + 3*row + col], 1e-6 * std::max(1.0, fabs(Je(row, col))) );
+    }
+  }
+
+  // Batch ECEF projection
+  std::vector<Vector3> points;
+  for (int i = 0; i < n; i++)
+    points.push_back(model.datum().geodetic_to_cartesian(Vector3(lon[i], lat[i], height[i])));
+  std::vector<Vector2> pixels;
+  model.point_to_pixel(points, pixels);
+  for (int i = 0; i < n; i++)
+    EXPECT_VECTOR_NEAR( model.point_to_pixel(points[i]), pixels[i], 1e-6 );
+
+  // Batch pixel to ray
+  std::vector<Vector3> P, dir;
+  model.point_and_dir(pixels, P, dir);
+  for (int i = 0; i < n; i++) {
+    EXPECT_VECTOR_NEAR( model.camera_center(pixels[i]),   P[i],   1e-3 );
+    EXPECT_VECTOR_NEAR( model.pixel_to_vector(pixels[i]), dir[i], 1e-8 );
+  }
+
+  xercesc::XMLPlatformUtils::Terminate();
+}
+
 TEST( StereoSessionRPC, CheckStereo ) {
 
   xercesc::XMLPlatformUtils::Initialize();
@@ -250,3 +307,133 @@ TEST( StereoSessionRPC, CheckRpcCrop ) {
 
   xercesc::XMLPlatformUtils::Terminate();
 }
+
+TEST(RPCModelGen, LinearFit) {
+
+  // A rational function with small nonlinear terms
+  RPCModel::CoeffVec line_num, line_den, samp_num, samp_den;
+  for (int i = 0; i < 20; i++) {
+    line_num[i] = 0.01 * std::sin(i + 1.0);
+    samp_num[i] = 0.01 * std::cos(i + 1.0);
+    line_den[i] = 0.002 * std::sin(2.0 * i);
+    samp_den[i] = 0.002 * std::cos(3.0 * i);
+  }
+  line_num[2] = 1.0; samp_num[1] = 1.0;
+  line_den[0] = 1.0; samp_den[0] = 1.0;
+
+  // Sample it on a grid, with the penalty terms at the end
+  const int n = 8;
+  int num_pts = n * n * n;
+  Vector<double> geodetics(3 * num_pts), pixels(2 * num_pts + RpcSolveLMA::NUM_PENALTY_TERMS);
+  int count = 0;
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      for (int k = 0; k < n; k++) {
+        Vector3 G(-1.0 + 2.0 * i / (n - 1), -1.0 + 2.0 * j / (n - 1), -1.0 + 2.0 * k / (n - 1));
+        subvector(geodetics, 3 * count, 3) = G;
+        subvector(pixels, 2 * count, 2)
+          = RPCModel::normalized_geodetic_to_normalized_pixel(G, line_num, line_den,
+                                                               samp_num, samp_den);
+        count++;
+      }
+    }
+  }
+
+  // With no penalty the linear fit recovers the function
+  Vector<double> coeffs, expected;
+  ASSERT_TRUE(linear_rpc_fit(0.0, geodetics, pixels, coeffs));
+  packCoeffs(line_num, line_den, samp_num, samp_den, expected);
+  EXPECT_VECTOR_NEAR(expected, coeffs, 1e-8);
+}
+
+// An RPC model fit to a camera
+struct RpcFit {
+  Vector3 llh_scale, llh_offset;
+  Vector2 pixel_scale, pixel_offset;
+  RPCModel::CoeffVec line_num, line_den, samp_num, samp_den;
+};
+
+void fit_rpc(std::vector<Vector3> const& llh, std::vector<Vector2> const& pixels,
+             RpcFit & fit) {
+  BBox3 llh_box;
+  BBox2 pixel_box;
+  for (size_t i = 0; i < llh.size(); i++) {
+    llh_box.grow(llh[i]);
+    pixel_box.grow(pixels[i]);
+  }
+  fit_rpc_to_points(0.03, llh, pixels, llh_box, pixel_box,
+                    fit.llh_scale, fit.llh_offset, fit.pixel_scale, fit.pixel_offset,
+                    fit.line_num, fit.line_den, fit.samp_num, fit.samp_den);
+}
+
+class FitRpcTask: public vw::Task {
+  std::vector<Vector3> const& m_llh;
+  std::vector<Vector2> const& m_pixels;
+  RpcFit & m_fit;
+public:
+  FitRpcTask(std::vector<Vector3> const& llh, std::vector<Vector2> const& pixels,
+             RpcFit & fit): m_llh(llh), m_pixels(pixels), m_fit(fit) {}
+  void operator()() { fit_rpc(m_llh, m_pixels, m_fit); }
+};
+
+// Fit several cameras at the same time, as cam2rpc does with
+// --batch-list, and check that this gives the same models as fitting
+// them one at a time, and that the models agree with the cameras.
+TEST(RPCModelGen, BatchFit) {
+
+  vw::cartography::Datum datum("WGS84");
+
+  // The same ground points for all cameras
+  std::vector<Vector3> llh;
+  const int n = 10;
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      for (int k = 0; k < n; k++)
+        llh.push_back(Vector3(-0.05 + 0.1 * i / (n - 1), -0.05 + 0.1 * j / (n - 1),
+                              1000.0 * k / (n - 1)));
+    }
+  }
+
+  // Pinhole cameras 500 km above the ground, looking down
+  const int num_cams = 4;
+  Matrix3x3 rot;
+  rot(0, 2) = -1; rot(1, 0) = 1; rot(2, 1) = -1;
+  std::vector<std::vector<Vector2>> pixels(num_cams);
+  for (int c = 0; c < num_cams; c++) {
+    Vector3 ctr = datum.geodetic_to_cartesian(Vector3(0.01 * c, -0.02 * c, 500000.0));
+    PinholeModel cam(ctr, rot, 5000.0 + 100.0 * c, 5000.0, 500.0, 500.0);
+    for (size_t i = 0; i < llh.size(); i++)
+      pixels[c].push_back(cam.point_to_pixel(datum.geodetic_to_cartesian(llh[i])));
+  }
+
+  std::vector<RpcFit> serial_fits(num_cams), parallel_fits(num_cams);
+  for (int c = 0; c < num_cams; c++)
+    fit_rpc(llh, pixels[c], serial_fits[c]);
+
+  vw::FifoWorkQueue queue(num_cams);
+  for (int c = 0; c < num_cams; c++) {
+    boost::shared_ptr<vw::Task> task(new FitRpcTask(llh, pixels[c], parallel_fits[c]));
+    queue.add_task(task);
+  }
+  queue.join_all();
+
+  for (int c = 0; c < num_cams; c++) {
+    RpcFit const& s = serial_fits[c];
+    RpcFit const& p = parallel_fits[c];
+    EXPECT_VECTOR_NEAR(s.line_num, p.line_num, 1e-14);
+    EXPECT_VECTOR_NEAR(s.line_den, p.line_den, 1e-14);
+    EXPECT_VECTOR_NEAR(s.samp_num, p.samp_num, 1e-14);
+    EXPECT_VECTOR_NEAR(s.samp_den, p.samp_den, 1e-14);
+
+    // The RPC model reproduces the camera
+    double max_err = 0.0;
+    for (size_t i = 0; i < llh.size(); i++) {
+      Vector3 llh_n = elem_quot(llh[i] - p.llh_offset, p.llh_scale);
+      Vector2 pix_n = RPCModel::normalized_geodetic_to_normalized_pixel
+        (llh_n, p.line_num, p.line_den, p.samp_num, p.samp_den);
+      Vector2 pix = elem_prod(pix_n, p.pixel_scale) + p.pixel_offset;
+      max_err = std::max(max_err, norm_2(pix - pixels[c][i]));
+    }
+    EXPECT_LT(max_err, 0.1);
+  }
+}
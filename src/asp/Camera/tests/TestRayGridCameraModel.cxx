@@ -0,0 +1,64 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+#include <vw/Camera/PinholeModel.h>
+#include <vw/Math/EulerAngles.h>
+#include <asp/Camera/RayGridCameraModel.h>
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace asp;
+
+TEST(RayGridCameraModel, interpolation) {
+
+  Matrix3x3 rot = vw::math::euler_to_rotation_matrix(0.1, -0.2, 0.3, "xyz");
+  vw::camera::PinholeModel exact_cam(Vector3(1e6, 2e6, 3e6), rot,
+                                     1000.0, 1000.0, 500.0, 400.0);
+
+  BBox2i box(10, 20, 700, 500);
+  int spacing = 16;
+  double max_pixel_error = 0.01, max_center_error = 0.01;
+  RayGridCameraModel grid_cam(&exact_cam, box, spacing, max_pixel_error, max_center_error);
+
+  EXPECT_GT(grid_cam.num_cells(), 0);
+  EXPECT_EQ(grid_cam.num_exact_cells(), 0);
+
+  // Inside the box the rays must agree to within a small fraction of a pixel
+  double ifov = 1.0/1000.0;
+  for (int i = 0; i < 50; i++) {
+    Vector2 pix(box.min().x() + 13.7 * i, box.min().y() + 9.9 * i);
+    Vector3 dir = grid_cam.pixel_to_vector(pix);
+    Vector3 exact_dir = exact_cam.pixel_to_vector(pix);
+    EXPECT_LT(norm_2(dir - exact_dir), max_pixel_error * ifov);
+    EXPECT_VECTOR_NEAR(grid_cam.camera_center(pix), exact_cam.camera_center(pix), 1e-6);
+  }
+
+  // Outside the box the exact camera is used
+  Vector2 pix(-5.5, 600.25);
+  EXPECT_VECTOR_NEAR(grid_cam.pixel_to_vector(pix), exact_cam.pixel_to_vector(pix), 1e-15);
+
+  // Projection is always exact
+  Vector3 xyz = exact_cam.camera_center(pix) + 1e4 * exact_cam.pixel_to_vector(pix);
+  EXPECT_VECTOR_NEAR(grid_cam.point_to_pixel(xyz), exact_cam.point_to_pixel(xyz), 1e-15);
+
+  // With an impossible error bound all cells fall back to the exact camera
+  RayGridCameraModel exact_grid_cam(&exact_cam, box, spacing, -1.0, -1.0);
+  EXPECT_EQ(exact_grid_cam.num_exact_cells(), exact_grid_cam.num_cells());
+  pix = Vector2(100.3, 200.7);
+  EXPECT_VECTOR_NEAR(exact_grid_cam.pixel_to_vector(pix),
+                     exact_cam.pixel_to_vector(pix), 1e-15);
+}
@@ -28,6 +28,8 @@
 #include <vw/BundleAdjustment/CameraRelation.h>
 #include <asp/Core/BundleAdjustUtils.h>
 
+#include <cstdint>
+#include <sstream>
 #include <string>
 
 using namespace vw;
@@ -680,3 +682,68 @@ std::string asp::csmStateFile(std::string const& adjustFile) {
 }
 
   
+
+namespace {
+  // Write a value to a binary file, in the native byte order
+  template <class T>
+  void write_binary_value(std::ostream & file, T const& val) {
+    file.write(reinterpret_cast<const char*>(&val), sizeof(T));
+  }
+
+  // Write a string to a binary file, preceded by its length
+  void write_binary_string(std::ostream & file, std::string const& str) {
+    write_binary_value(file, uint64_t(str.size()));
+    file.write(str.data(), str.size());
+  }
+}
+
+std::string asp::raw_pixels_residual_text(std::string const& name,
+                                          double const* residuals, size_t num_pixels) {
+  std::ostringstream os;
+  os.precision(18); // TODO(oalexan1): Replace here with 17
+  os << name << ", " << num_pixels << std::endl;
+  for (size_t i = 0; i < num_pixels; i++)
+    os << residuals[2*i] << ", " << residuals[2*i + 1] << std::endl;
+  return os.str();
+}
+
+void asp::write_raw_pixels_residual_binary(std::ostream & file, std::string const& name,
+                                           double const* residuals, size_t num_pixels) {
+  write_binary_string(file, name);
+  write_binary_value(file, uint64_t(num_pixels));
+  file.write(reinterpret_cast<const char*>(residuals), 2 * num_pixels * sizeof(double));
+}
+
+std::string asp::residual_map_header_text(std::string const& datum) {
+  return "# lon, lat, height_above_datum, mean_residual, num_observations\n# "
+    + datum + "\n";
+}
+
+std::string asp::residual_map_point_text(vw::Vector3 const& llh, double mean_residual,
+                                         int num_observations, int type) {
+  std::string comment = "";
+  if (type == 1)
+    comment = " # GCP";
+  else if (type == 2)
+    comment = " # from DEM";
+
+  std::ostringstream os;
+  os.precision(18); // TODO(oalexan1): Replace here by 17
+  os << llh[0] << ", " << llh[1] << ", " << llh[2] << ", " << mean_residual << ", "
+     << num_observations << comment << std::endl;
+  return os.str();
+}
+
+void asp::write_residual_map_header_binary(std::ostream & file, std::string const& datum) {
+  write_binary_string(file, datum);
+}
+
+void asp::write_residual_map_point_binary(std::ostream & file, vw::Vector3 const& llh,
+                                          double mean_residual, int num_observations,
+                                          int type) {
+  for (int c = 0; c < 3; c++)
+    write_binary_value(file, llh[c]);
+  write_binary_value(file, mean_residual);
+  write_binary_value(file, int32_t(num_observations));
+  write_binary_value(file, uint8_t(type));
+}
@@ -25,6 +25,7 @@
 #include <vw/Math/Quaternion.h>
 #include <vw/Math/BBox.h>
 
+#include <ostream>
 #include <string>
 #include <vector>
 #include <set>
@@ -189,6 +190,40 @@ namespace asp{
   
   // Manufacture a CSM state file from an adjust file
   std::string csmStateFile(std::string const& adjustFile);
+
+  // The residual files written by bundle_adjust. The binary ones use
+  // the native byte order, with each string preceded by its length as
+  // a 64-bit integer, and are converted to text by
+  // parse_residual_file.py.
+
+  // The text of one camera in the raw pixels residual file, having the
+  // name and the number of pixels, then the column and row residual of
+  // each pixel.
+  std::string raw_pixels_residual_text(std::string const& name,
+                                       double const* residuals, size_t num_pixels);
+
+  // Write the same as raw_pixels_residual_text() to a binary file, as
+  // the name, the number of pixels, and the residuals as doubles.
+  void write_raw_pixels_residual_binary(std::ostream & file, std::string const& name,
+                                        double const* residuals, size_t num_pixels);
+
+  // The header of the residual map text file. stereo_gui parses the
+  // datum from it.
+  std::string residual_map_header_text(std::string const& datum);
+
+  // One point of the residual map text file. The type is 1 for a GCP,
+  // 2 for a point from a DEM, and 0 otherwise.
+  std::string residual_map_point_text(vw::Vector3 const& llh, double mean_residual,
+                                      int num_observations, int type);
+
+  // Write the datum to the binary residual map
+  void write_residual_map_header_binary(std::ostream & file, std::string const& datum);
+
+  // Write a point to the binary residual map, as the longitude,
+  // latitude, height, and mean residual as doubles, the number of
+  // observations as a 32-bit integer, and the type as a byte.
+  void write_residual_map_point_binary(std::ostream & file, vw::Vector3 const& llh,
+                                       double mean_residual, int num_observations, int type);
 }
 
 #endif // __BUNDLE_ADJUST_UTILS_H__
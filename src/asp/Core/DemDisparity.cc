@@ -30,6 +30,7 @@
 #include <vw/FileIO/MatrixIO.h>
 #include <asp/Core/StereoSettings.h>
 #include <asp/Core/DemDisparity.h>
+#include <asp/Core/VirtualAlignedImages.h>
 
 #include <boost/filesystem/operations.hpp>
 namespace fs = boost::filesystem;
@@ -299,7 +300,9 @@ namespace asp {
     // Skip pixels to speed things up, particularly for ISIS and DG.
     int pixel_sample = 2;
 
-    DiskImageView<PixelGray<float> > left_image(opt.out_prefix+"-L.tif");
+    Vector2i left_image_size;
+    if (!asp::read_aligned_image_size(opt.out_prefix, "L", left_image_size))
+      vw_throw(ArgumentErr() << "dem_disparity: Cannot find the left aligned image.\n");
     DiskImageView<PixelGray<float> > left_image_sub(opt.out_prefix+"-L_sub.tif");
 
     std::string dem_file = stereo_settings().disparity_estimation_dem;
@@ -327,8 +330,8 @@ namespace asp {
         dem = create_mask(dem_disk_image, nodata_value);
     }
 
-    Vector2f downsample_scale( float(left_image_sub.cols()) / float(left_image.cols()),
-                               float(left_image_sub.rows()) / float(left_image.rows()));
+    Vector2f downsample_scale( float(left_image_sub.cols()) / float(left_image_size.x()),
+                               float(left_image_sub.rows()) / float(left_image_size.y()));
 
     Matrix<double> align_left_matrix  = math::identity_matrix<3>();
     Matrix<double> align_right_matrix = math::identity_matrix<3>();
@@ -20,6 +20,7 @@
 ///
 
 #include <asp/Core/EigenUtils.h>
+#include <asp/Core/PointCloudCollection.h>
 
 using namespace vw;
 using namespace vw::cartography;
@@ -569,6 +570,150 @@ vw::int64 load_pc_aux(std::string const& file_name,
   return num_total_points;
 }
 
+// If the lon-lat box of a collection block overlaps with the given
+// box, which may have its longitude in [0, 360].
+bool block_overlaps_box(asp::PointCloudBlock const& block, vw::BBox2 const& lonlat_box,
+                        vw::cartography::Datum const& datum) {
+
+  if (lonlat_box.empty())
+    return true;
+
+  vw::BBox2 block_box = asp::point_box_to_lonlat_box(block.point_box, datum);
+  for (int k = -1; k <= 1; k++) {
+    vw::BBox2 shifted_box = block_box + vw::Vector2(360.0 * k, 0.0);
+    if (shifted_box.intersects(lonlat_box))
+      return true;
+  }
+  return false;
+}
+
+vw::int64 load_pc_collection_aux(asp::PointCloudCollection const& collection,
+                                 std::int64_t num_points_to_load,
+                                 vw::BBox2 const& lonlat_box,
+                                 bool calc_shift,
+                                 vw::Vector3 & shift,
+                                 vw::cartography::GeoReference const& geo,
+                                 bool verbose, DoubleMatrix & data){
+
+  data.conservativeResize(DIM+1, num_points_to_load);
+
+  // Find the blocks to read, and the number of points in them. This
+  // is the number of points which the load ratio is based on.
+  std::vector<std::vector<vw::BBox2i>> boxes(collection.members.size());
+  vw::int64 num_total_points = 0;
+  double total_area = 0.0;
+  for (size_t m = 0; m < collection.members.size(); m++) {
+    asp::PointCloudMember const& member = collection.members[m];
+    for (size_t b = 0; b < member.blocks.size(); b++) {
+      if (!block_overlaps_box(member.blocks[b], lonlat_box, geo.datum()))
+        continue;
+      boxes[m].push_back(member.blocks[b].pixel_box);
+      num_total_points += member.blocks[b].num_points;
+      total_area += member.blocks[b].pixel_box.area();
+    }
+  }
+  double load_ratio = (double)num_points_to_load/std::max(1.0, (double)num_total_points);
+
+  bool shift_was_calc = false;
+  vw::int64 points_count = 0;
+
+  vw::TerminalProgressCallback tpc("asp", "\t--> ");
+  if (verbose) tpc.report_progress(0);
+
+  for (size_t m = 0; m < boxes.size(); m++) {
+    if (boxes[m].empty())
+      continue;
+
+    vw::ImageViewRef<vw::Vector3> point_cloud
+      = read_asp_point_cloud<DIM>(collection.members[m].file);
+
+    for (size_t b = 0; b < boxes[m].size(); b++) {
+      vw::BBox2i const& box = boxes[m][b];
+      for (std::int64_t j = box.min().y(); j < box.max().y(); j++) {
+        for (std::int64_t i = box.min().x(); i < box.max().x(); i++) {
+
+          if (points_count >= num_points_to_load)
+            break;
+
+          double r = (double)std::rand()/(double)RAND_MAX;
+          if (r > load_ratio)
+            continue;
+
+          vw::Vector3 xyz = point_cloud(i, j);
+          if ( xyz == vw::Vector3() || !(xyz == xyz) )
+            continue; // invalid and NaN check
+
+          if (calc_shift && !shift_was_calc){
+            shift = xyz;
+            shift_was_calc = true;
+          }
+
+          // Skip points outside the given box
+          if (!lonlat_box.empty()){
+            vw::Vector3 llh = geo.datum().cartesian_to_geodetic(xyz);
+            if ( !lonlat_box.contains(subvector(llh, 0, 2)))
+              continue;
+          }
+
+          for (std::int64_t row = 0; row < DIM; row++)
+            data(row, points_count) = xyz[row] - shift[row];
+          data(DIM, points_count) = 1;
+
+          points_count++;
+        }
+      }
+      if (verbose) tpc.report_incremental_progress(box.area() / std::max(total_area, 1.0));
+    }
+  }
+  if (verbose) tpc.report_finished();
+
+  data.conservativeResize(Eigen::NoChange, points_count);
+
+  return num_total_points;
+}
+
+void load_pc_collection(asp::PointCloudCollection const& collection,
+                        std::int64_t num_points_to_load,
+                        vw::BBox2 const& lonlat_box,
+                        bool calc_shift,
+                        vw::Vector3 & shift,
+                        vw::cartography::GeoReference const& geo,
+                        bool verbose, DoubleMatrix & data){
+
+  vw::int64 num_total_points = load_pc_collection_aux(collection, num_points_to_load,
+                                                      lonlat_box, calc_shift, shift,
+                                                      geo, verbose, data);
+
+  std::int64_t num_loaded_points = data.cols();
+  if (!lonlat_box.empty()                    &&
+      num_loaded_points < num_points_to_load &&
+      num_loaded_points < num_total_points){
+
+    // We loaded too few points. Try harder. Need some care here as to not run
+    // out of memory.
+    num_points_to_load = std::max(4*num_points_to_load, std::int64_t(10000000));
+    if (verbose)
+      vw::vw_out() << "Too few points were loaded. Trying again." << std::endl;
+    load_pc_collection_aux(collection, num_points_to_load, lonlat_box,
+                           calc_shift, shift, geo, verbose, data);
+  }
+
+}
+
+void load_pc_collection(std::string const& file_name,
+                        std::int64_t num_points_to_load,
+                        vw::BBox2 const& lonlat_box,
+                        bool calc_shift,
+                        vw::Vector3 & shift,
+                        vw::cartography::GeoReference const& geo,
+                        bool verbose, DoubleMatrix & data){
+
+  asp::PointCloudCollection collection;
+  collection.read(file_name);
+  load_pc_collection(collection, num_points_to_load, lonlat_box, calc_shift, shift,
+                     geo, verbose, data);
+}
+
 void load_pc(std::string const& file_name,
              std::int64_t num_points_to_load,
              vw::BBox2 const& lonlat_box,
@@ -577,6 +722,17 @@ void load_pc(std::string const& file_name,
              vw::cartography::GeoReference const& geo,
              bool verbose, DoubleMatrix & data){
 
+  // With an index, read only the blocks with points in the box
+  asp::PointCloudCollection index;
+  index.members.resize(1);
+  if (asp::read_point_cloud_index(file_name, index.members[0])) {
+    if (verbose)
+      vw::vw_out() << "Using the index: " << asp::point_cloud_index_file(file_name) << "\n";
+    load_pc_collection(index, num_points_to_load, lonlat_box, calc_shift, shift,
+                       geo, verbose, data);
+    return;
+  }
+
   vw::int64 num_total_points = load_pc_aux(file_name, num_points_to_load,
                                           lonlat_box, calc_shift, shift,
                                           geo, verbose, data);
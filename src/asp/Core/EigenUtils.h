@@ -73,6 +73,17 @@ void load_pc(std::string const& file_name,
              vw::cartography::GeoReference const& geo,
              bool verbose, DoubleMatrix & data);
 
+// Load the points of a point cloud collection, perhaps subsampling
+// them along the way. Only the blocks whose bounding box can overlap
+// with the given lon-lat box are read.
+void load_pc_collection(std::string const& file_name,
+                        std::int64_t num_points_to_load,
+                        vw::BBox2 const& lonlat_box,
+                        bool calc_shift,
+                        vw::Vector3 & shift,
+                        vw::cartography::GeoReference const& geo,
+                        bool verbose, DoubleMatrix & data);
+
 // Find the best-fitting plane to a set of points. It will throw an
 // error if called with less than 3 points.
 void bestFitPlane(const std::vector<Eigen::Vector3d>& points, Eigen::Vector3d& centroid,
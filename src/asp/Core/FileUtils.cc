@@ -15,15 +15,44 @@
 //  limitations under the License.
 // __END_LICENSE__
 
+#include <boost/cstdint.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
 
 #include <asp/Core/FileUtils.h>
 
+#include <iomanip>
+
 namespace asp{
 
   using namespace vw;
 
+  // The FNV-1a hash, which unlike std::hash is the same in all programs
+  static boost::uint64_t fnv1a_hash(std::string const& str) {
+    boost::uint64_t hash = 14695981039346656037ULL;
+    for (size_t it = 0; it < str.size(); it++) {
+      hash ^= (unsigned char)str[it];
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  std::string file_cache_key(std::string const& file) {
+    namespace fs = boost::filesystem;
+    
+    // The same file may be opened with different relative paths
+    fs::path path = fs::absolute(file);
+    boost::system::error_code ec;
+    fs::path canonical_path = fs::canonical(path, ec);
+    if (!ec)
+      path = canonical_path;
+
+    std::ostringstream os;
+    os << std::hex << std::setw(16) << std::setfill('0') << fnv1a_hash(path.string())
+       << std::dec << "_" << fs::file_size(path) << "_" << fs::last_write_time(path);
+    return os.str();
+  }
+
   bool is_latest_timestamp(std::string              const& test_file, 
                            std::vector<std::string> const& other_files) {
     if (!boost::filesystem::exists(test_file))
@@ -40,6 +40,12 @@ namespace asp {
                            std::string const& f1, std::string const& f2,
                            std::string const& f3, std::string const& f4);
 
+  /// A name for files caching data derived from the given file. It is
+  /// made of a hash of the full path of the file, its size, and its
+  /// modification time, so a changed file is never matched with stale
+  /// cached data.
+  std::string file_cache_key(std::string const& file);
+
   void read_1d_points(std::string const& file, std::vector<double> & points);
   void read_2d_points(std::string const& file, std::vector<vw::Vector2> & points);
   void read_3d_points(std::string const& file, std::vector<vw::Vector3> & points);
@@ -58,4 +58,77 @@ namespace asp {
     return;
   }
   
+  // Find the ranges of pixel values to be mapped to [0, 1]
+  void normalization_ranges(bool force_use_entire_range,
+                            bool individually_normalize,
+                            bool use_percentile_stretch,
+                            bool do_not_exceed_min_max,
+                            vw::Vector6f const& left_stats,
+                            vw::Vector6f const& right_stats,
+                            vw::Vector2 & left_range, vw::Vector2 & right_range){
+
+    // These arguments must contain: (min, max, mean, std)
+    VW_ASSERT(left_stats.size() == 6 && right_stats.size() == 6,
+              vw::ArgumentErr() << "Expecting a vector of size 6 in normalize_images()\n");
+
+    // If the input stats don't contain the stddev, must use the entire range version.
+    // - This should only happen when normalizing ISIS images for ip_matching purposes.
+    if ((left_stats[3] == 0) || (right_stats[3] == 0))
+      force_use_entire_range = true;
+
+    if (force_use_entire_range) { // Stretch between the min and max values
+      if (individually_normalize) {
+        left_range  = Vector2(left_stats [0], left_stats [1]);
+        right_range = Vector2(right_stats[0], right_stats[1]);
+      } else { // Normalize using the same stats
+        double low = std::min(left_stats[0], right_stats[0]);
+        double hi  = std::max(left_stats[1], right_stats[1]);
+        left_range  = Vector2(low, hi);
+        right_range = Vector2(low, hi);
+      }
+      return;
+    }
+
+    // Don't force the entire range
+    double left_min, left_max, right_min, right_max;
+    if (use_percentile_stretch) {
+      // Percentile stretch
+      left_min  = left_stats [4];
+      left_max  = left_stats [5];
+      right_min = right_stats[4];
+      right_max = right_stats[5];
+    } else {
+      // Two standard deviation stretch
+      left_min  = left_stats [2] - 2*left_stats [3];
+      left_max  = left_stats [2] + 2*left_stats [3];
+      right_min = right_stats[2] - 2*right_stats[3];
+      right_max = right_stats[2] + 2*right_stats[3];
+
+      if (do_not_exceed_min_max) {
+        // This is important for ISIS which may have special pixels beyond the min and max
+        left_min = std::max(left_min,   (double)left_stats[0]);
+        left_max = std::min(left_max,   (double)left_stats[1]);
+        right_min = std::max(right_min, (double)right_stats[0]);
+        right_max = std::min(right_max, (double)right_stats[1]);
+      }
+    }
+
+    if (individually_normalize) {
+      left_range  = Vector2(left_min,  left_max);
+      right_range = Vector2(right_min, right_max);
+    } else { // Normalize using the same stats
+      double low = std::min(left_min, right_min);
+      double hi  = std::max(left_max, right_max);
+      if (!do_not_exceed_min_max) {
+        left_range  = Vector2(low, hi);
+        right_range = Vector2(low, hi);
+      } else {
+        left_range  = Vector2(std::max(low, left_min),  std::min(hi, left_max));
+        right_range = Vector2(std::max(low, right_min), std::min(hi, right_max));
+      }
+    }
+
+    return;
+  }
+  
 }
@@ -0,0 +1,138 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Exception.h>
+#include <vw/FileIO/MatrixIO.h>
+#include <asp/Core/ImageStats.h>
+
+#include <algorithm>
+
+using namespace vw;
+
+namespace asp {
+
+void write_cached_stats(std::string const& cache_file,
+                        Vector<float32,6> const& stats, double tile_fraction) {
+  // The stats, followed by the tile fraction
+  Vector<float32> vals(7);
+  subvector(vals, 0, 6) = stats;
+  vals[6] = tile_fraction;
+  write_vector(cache_file, vals);
+}
+
+bool read_cached_stats(std::string const& cache_file, double tile_fraction,
+                       Vector<float32,6> & stats) {
+  Vector<float32> vals;
+  read_vector(vals, cache_file);
+  if (vals.size() != 7 || vals[6] != float32(tile_fraction))
+    return false;
+  stats = subvector(vals, 0, 6);
+  return true;
+}
+
+std::vector<BBox2i> stats_tiles(Vector2i const& image_size, int tile_size,
+                                double tile_fraction) {
+
+  if (tile_size <= 0)
+    vw_throw(ArgumentErr() << "The tile size must be positive.\n");
+  if (!(tile_fraction > 0.0 && tile_fraction <= 1.0))
+    vw_throw(ArgumentErr() << "The fraction of tiles to use for statistics "
+             << "must be positive and at most 1.\n");
+
+  std::vector<BBox2i> tiles;
+  int num_x = (image_size.x() + tile_size - 1) / tile_size;
+  int num_y = (image_size.y() + tile_size - 1) / tile_size;
+  if (num_x <= 0 || num_y <= 0)
+    return tiles;
+
+  // Groups of group_size x group_size tiles, one tile per group
+  int group_size = std::max(int(round(sqrt(1.0 / tile_fraction))), 1);
+
+  for (int gy = 0; gy < num_y; gy += group_size) {
+    for (int gx = 0; gx < num_x; gx += group_size) {
+
+      int wid = std::min(group_size, num_x - gx);
+      int hgt = std::min(group_size, num_y - gy);
+
+      int tx = gx, ty = gy;
+      if (group_size > 1) {
+        // Hash the group position to pick a tile in it. Always
+        // picking the same corner could alias with periodic structure.
+        unsigned int h = (unsigned int)(gx) * 73856093u ^ (unsigned int)(gy) * 19349663u;
+        h ^= h >> 13; h *= 0x5bd1e995u; h ^= h >> 15;
+        tx += h % wid;
+        ty += (h / wid) % hgt;
+      }
+
+      BBox2i tile(tx * tile_size, ty * tile_size, tile_size, tile_size);
+      tile.crop(BBox2i(0, 0, image_size.x(), image_size.y()));
+      tiles.push_back(tile);
+    }
+  }
+
+  return tiles;
+}
+
+int stats_sample_rate(std::vector<BBox2i> const& tiles, double target_num_samples) {
+  double num_pixels = 0.0;
+  for (size_t it = 0; it < tiles.size(); it++)
+    num_pixels += double(tiles[it].width()) * double(tiles[it].height());
+  if (target_num_samples <= 0.0)
+    return 1;
+  return std::max(int(ceil(sqrt(num_pixels / target_num_samples))), 1);
+}
+
+Vector<float32,6> stats_from_samples(std::vector<float> & samples) {
+
+  Vector<float32,6> result;
+  if (samples.empty())
+    return result;
+
+  double sum = 0.0;
+  float lo = samples[0], hi = samples[0];
+  for (size_t it = 0; it < samples.size(); it++) {
+    lo = std::min(lo, samples[it]);
+    hi = std::max(hi, samples[it]);
+    sum += samples[it];
+  }
+  double mean = sum / samples.size();
+  double sum2 = 0.0;
+  for (size_t it = 0; it < samples.size(); it++)
+    sum2 += (samples[it] - mean) * (samples[it] - mean);
+
+  result[0] = lo;
+  result[1] = hi;
+  result[2] = mean;
+  result[3] = sqrt(sum2 / samples.size());
+
+  // Percentiles, interpolating between the nearest samples
+  double pct[2] = {0.02, 0.98};
+  for (int k = 0; k < 2; k++) {
+    double pos = pct[k] * (samples.size() - 1);
+    size_t i0 = floor(pos);
+    std::nth_element(samples.begin(), samples.begin() + i0, samples.end());
+    double v0 = samples[i0], v1 = v0;
+    if (i0 + 1 < samples.size())
+      v1 = *std::min_element(samples.begin() + i0 + 1, samples.end());
+    result[4 + k] = v0 + (pos - i0) * (v1 - v0);
+  }
+
+  return result;
+}
+
+} // end namespace asp
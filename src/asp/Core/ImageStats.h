@@ -0,0 +1,164 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file ImageStats.h
+///
+/// Block-parallel image statistics. The image is split into tiles,
+/// optionally only a subset of them is read, and the pixels on a
+/// regular grid within those tiles are collected in parallel. The
+/// samples are always merged in the same order, so the results do
+/// not depend on the number of threads.
+
+#ifndef __ASP_CORE_IMAGE_STATS_H__
+#define __ASP_CORE_IMAGE_STATS_H__
+
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Core/Settings.h>
+#include <vw/Math/BBox.h>
+#include <vw/Math/Vector.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Image/PixelTypeInfo.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace asp {
+
+  /// Save the statistics of an image, together with the fraction of
+  /// the tiles they were computed from, so that they are not reused
+  /// for a different fraction.
+  void write_cached_stats(std::string const& cache_file,
+                          vw::Vector<vw::float32,6> const& stats, double tile_fraction);
+
+  /// Read the statistics saved with write_cached_stats(). Return false
+  /// if they were computed from a different fraction of the tiles, or
+  /// saved before the fraction was recorded.
+  bool read_cached_stats(std::string const& cache_file, double tile_fraction,
+                         vw::Vector<vw::float32,6> & stats);
+
+  /// Split an image of given size into tiles and return the ones to
+  /// read. If tile_fraction is less than 1, the tile grid is divided
+  /// into square groups of about 1/tile_fraction tiles, and one tile
+  /// is picked from each group. Its position in the group is
+  /// pseudo-random but depends only on the group, so the sampling is
+  /// stratified over the image and deterministic.
+  std::vector<vw::BBox2i> stats_tiles(vw::Vector2i const& image_size, int tile_size,
+                                      double tile_fraction);
+
+  /// The spacing of the pixels to sample in the given tiles so that
+  /// about target_num_samples pixels are collected.
+  int stats_sample_rate(std::vector<vw::BBox2i> const& tiles, double target_num_samples);
+
+  /// Find the min, max, mean, standard deviation, and the 2nd and
+  /// 98th percentiles of the given samples. The samples are reordered.
+  vw::Vector<vw::float32,6> stats_from_samples(std::vector<float> & samples);
+
+  /// Append the channels of a pixel to a list of samples. Invalid
+  /// pixels and NaN values are skipped.
+  template <class PixelT>
+  void add_stats_sample(PixelT const& pix, std::vector<float> & samples) {
+    typedef typename vw::CompoundChannelType<PixelT>::type channel_type;
+    for (size_t ch = 0; ch < vw::CompoundNumChannels<PixelT>::value; ch++) {
+      float val = vw::compound_select_channel<channel_type const&>(pix, ch);
+      if (!std::isnan(val))
+        samples.push_back(val);
+    }
+  }
+  template <class PixelT>
+  void add_stats_sample(vw::PixelMask<PixelT> const& pix, std::vector<float> & samples) {
+    if (is_valid(pix))
+      add_stats_sample(pix.child(), samples);
+  }
+
+  /// Collect the samples of one tile. Only pixels whose coordinates
+  /// are multiples of the sample rate are used, so the sampling grid
+  /// does not depend on the tiling.
+  template <class ViewT>
+  class StatsSamplingTask: public vw::Task, private boost::noncopyable {
+    ViewT const&         m_view;
+    vw::BBox2i           m_box;
+    int                  m_rate;
+    std::vector<float> & m_samples;
+
+  public:
+    StatsSamplingTask(ViewT const& view, vw::BBox2i const& box, int rate,
+                      std::vector<float> & samples):
+      m_view(view), m_box(box), m_rate(rate), m_samples(samples) {}
+
+    virtual void operator()() {
+      vw::Vector2i beg = m_rate * ((m_box.min() + vw::Vector2i(m_rate - 1, m_rate - 1)) / m_rate);
+      vw::BBox2i box(beg, m_box.max());
+      if (box.empty())
+        return;
+
+      vw::ImageView<typename ViewT::pixel_type> tile
+        = vw::subsample(vw::crop(m_view, box), m_rate);
+      m_samples.reserve(tile.cols() * tile.rows());
+      for (int row = 0; row < tile.rows(); row++)
+        for (int col = 0; col < tile.cols(); col++)
+          add_stats_sample(tile(col, row), m_samples);
+    }
+  };
+
+  /// Collect samples from an image in parallel, using the tiles
+  /// picked by stats_tiles() and the rate from stats_sample_rate().
+  /// Return the sample rate.
+  template <class ViewT>
+  int gather_stats_samples(vw::ImageViewBase<ViewT> const& view_base,
+                           int tile_size, double tile_fraction,
+                           double target_num_samples, std::vector<float> & samples) {
+
+    ViewT const& view = view_base.impl();
+    std::vector<vw::BBox2i> tiles
+      = stats_tiles(vw::Vector2i(view.cols(), view.rows()), tile_size, tile_fraction);
+    int rate = stats_sample_rate(tiles, target_num_samples);
+
+    std::vector<std::vector<float>> tile_samples(tiles.size());
+    vw::FifoWorkQueue queue(vw::vw_settings().default_num_threads());
+    for (size_t it = 0; it < tiles.size(); it++) {
+      boost::shared_ptr<vw::Task>
+        task(new StatsSamplingTask<ViewT>(view, tiles[it], rate, tile_samples[it]));
+      queue.add_task(task);
+    }
+    queue.join_all();
+
+    // Merge in tile order
+    size_t num_samples = 0;
+    for (size_t it = 0; it < tile_samples.size(); it++)
+      num_samples += tile_samples[it].size();
+    samples.clear();
+    samples.reserve(num_samples);
+    for (size_t it = 0; it < tile_samples.size(); it++) {
+      samples.insert(samples.end(), tile_samples[it].begin(), tile_samples[it].end());
+      std::vector<float>().swap(tile_samples[it]); // release the memory
+    }
+
+    return rate;
+  }
+
+} // end namespace asp
+
+#endif // __ASP_CORE_IMAGE_STATS_H__
@@ -17,25 +17,196 @@
 
 
 #include <asp/Core/MedianFilter.h>
-#include <vw/Math/Vector.h>
+#include <vw/Core/Exception.h>
+#include <vw/Image/Manipulation.h>
+
+#include <limits>
 
 using namespace vw;
 
-uint8 find_median_in_histogram(Vector<int, CALC_PIXEL_NUM_VALS> histogram,
-                               int kernSize) {
-  int acc = 0;
-  int acc_limit = kernSize * kernSize / 2;
+namespace asp {
+
+namespace {
+
+  // A window of distinct ranks in [0, num_ranks). Membership is kept
+  // per rank, and counts are kept per block and per superblock of
+  // ranks, so that long stretches of ranks not in the window can be
+  // skipped when the median moves. The median position is tracked
+  // incrementally, together with the number of ranks below it.
+  class RankWindow {
+    static const int BLOCK_SHIFT = 6;                   // 64 ranks per block
+    static const int SUPER_SHIFT = 12;                  // 4096 ranks per superblock
+    static const int BLOCK_MASK  = (1 << BLOCK_SHIFT) - 1;
+    static const int SUPER_MASK  = (1 << SUPER_SHIFT) - 1;
+
+    std::vector<unsigned char> m_in;
+    std::vector<int> m_block_count, m_super_count;
+    int m_count; // number of ranks in the window
+    int m_pos;   // current median candidate
+    int m_below; // number of ranks in the window less than m_pos
+
+  public:
+    RankWindow(int num_ranks):
+      m_in(num_ranks + 1, 0),
+      m_block_count((num_ranks >> BLOCK_SHIFT) + 1, 0),
+      m_super_count((num_ranks >> SUPER_SHIFT) + 1, 0),
+      m_count(0), m_pos(0), m_below(0) {}
+
+    int count() const { return m_count; }
+
+    void add(int r) {
+      if (r < 0)
+        return;
+      m_in[r] = 1;
+      m_block_count[r >> BLOCK_SHIFT]++;
+      m_super_count[r >> SUPER_SHIFT]++;
+      m_count++;
+      if (r < m_pos)
+        m_below++;
+    }
+
+    void remove(int r) {
+      if (r < 0)
+        return;
+      m_in[r] = 0;
+      m_block_count[r >> BLOCK_SHIFT]--;
+      m_super_count[r >> SUPER_SHIFT]--;
+      m_count--;
+      if (r < m_pos)
+        m_below--;
+    }
+
+    // Find the rank in the window which has exactly t window ranks
+    // less than it, with 0 <= t < count().
+    int select(int t) {
+
+      // Move down until no more than t ranks are below
+      while (m_below > t) {
+        if ((m_pos & SUPER_MASK) == 0 &&
+            m_below - m_super_count[(m_pos >> SUPER_SHIFT) - 1] > t) {
+          m_below -= m_super_count[(m_pos >> SUPER_SHIFT) - 1];
+          m_pos   -= (1 << SUPER_SHIFT);
+        } else if ((m_pos & BLOCK_MASK) == 0 &&
+                   m_below - m_block_count[(m_pos >> BLOCK_SHIFT) - 1] > t) {
+          m_below -= m_block_count[(m_pos >> BLOCK_SHIFT) - 1];
+          m_pos   -= (1 << BLOCK_SHIFT);
+        } else {
+          m_pos--;
+          m_below -= m_in[m_pos];
+        }
+      }
+
+      // Move up until landing on a rank in the window
+      while (m_below + m_in[m_pos] <= t) {
+        if ((m_pos & SUPER_MASK) == 0 &&
+            m_below + m_super_count[m_pos >> SUPER_SHIFT] <= t) {
+          m_below += m_super_count[m_pos >> SUPER_SHIFT];
+          m_pos   += (1 << SUPER_SHIFT);
+        } else if ((m_pos & BLOCK_MASK) == 0 &&
+                   m_below + m_block_count[m_pos >> BLOCK_SHIFT] <= t) {
+          m_below += m_block_count[m_pos >> BLOCK_SHIFT];
+          m_pos   += (1 << BLOCK_SHIFT);
+        } else {
+          m_below += m_in[m_pos];
+          m_pos++;
+        }
+      }
+
+      return m_pos;
+    }
+  };
+
+} // end anonymous namespace
+
+void median_filter_ranks(std::vector<int> const& ranks, int cols, int rows,
+                         int num_ranks, int kernel_size, bool skip_invalid_centers,
+                         std::vector<int> & lo_ranks, std::vector<int> & hi_ranks) {
 
-  uint8 i = 0;
+  VW_ASSERT(int(ranks.size()) == cols * rows,
+            ArgumentErr() << "median_filter_ranks: Size mismatch.\n");
 
-  for (;;) {
-    acc += histogram(i);
+  lo_ranks.assign(cols * rows, -1);
+  hi_ranks.assign(cols * rows, -1);
+  if (cols <= 0 || rows <= 0 || num_ranks <= 0)
+    return;
 
-    if (acc >= acc_limit)
+  int h = std::max(kernel_size, 1) / 2;
+  RankWindow win(num_ranks);
+
+  // Seed the window at the upper-left pixel
+  for (int row = 0; row <= std::min(h, rows - 1); row++)
+    for (int col = 0; col <= std::min(h, cols - 1); col++)
+      win.add(ranks[row * cols + col]);
+
+  // Traverse the image in serpentine order, so that the window
+  // changes by one row or column of pixels at each step.
+  int col = 0, row = 0, step = 1;
+  while (1) {
+
+    int k = row * cols + col;
+    int n = win.count();
+    if (n > 0 && !(skip_invalid_centers && ranks[k] < 0)) {
+      int t = (n - 1) / 2;
+      lo_ranks[k] = win.select(t);
+      hi_ranks[k] = (n % 2 == 1) ? lo_ranks[k] : win.select(t + 1);
+    }
+
+    int next_col = col + step;
+    if (next_col >= 0 && next_col < cols) {
+      int out_col = col - step * h, in_col = next_col + step * h;
+      bool do_out = (out_col >= 0 && out_col < cols);
+      bool do_in  = (in_col  >= 0 && in_col  < cols);
+      for (int r = std::max(row - h, 0); r <= std::min(row + h, rows - 1); r++) {
+        if (do_out) win.remove(ranks[r * cols + out_col]);
+        if (do_in)  win.add   (ranks[r * cols + in_col ]);
+      }
+      col = next_col;
+      continue;
+    }
+
+    if (row + 1 >= rows)
       break;
 
-    i++;
+    int out_row = row - h, in_row = row + 1 + h;
+    for (int c = std::max(col - h, 0); c <= std::min(col + h, cols - 1); c++) {
+      if (out_row >= 0)  win.remove(ranks[out_row * cols + c]);
+      if (in_row < rows) win.add   (ranks[in_row  * cols + c]);
+    }
+    row++;
+    step = -step;
   }
+}
+
+void disparity_median_filter(ImageView<PixelMask<Vector2f>> const& disp,
+                             int kernel_size,
+                             ImageView<PixelMask<Vector2f>> & out) {
 
-  return i;
+  out = copy(disp);
+  if (kernel_size <= 1)
+    return;
+
+  float nan = std::numeric_limits<float>::quiet_NaN();
+  ImageView<float> channel(disp.cols(), disp.rows()), filtered;
+  for (int ch = 0; ch < 2; ch++) {
+
+    for (int row = 0; row < disp.rows(); row++) {
+      for (int col = 0; col < disp.cols(); col++) {
+        if (is_valid(disp(col, row)))
+          channel(col, row) = disp(col, row).child()[ch];
+        else
+          channel(col, row) = nan;
+      }
+    }
+
+    fast_median_filter(channel, nan, kernel_size, true, filtered);
+
+    for (int row = 0; row < disp.rows(); row++) {
+      for (int col = 0; col < disp.cols(); col++) {
+        if (is_valid(out(col, row)))
+          out(col, row).child()[ch] = filtered(col, row);
+      }
+    }
+  }
 }
+
+} // end namespace asp
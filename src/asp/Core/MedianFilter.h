@@ -18,128 +18,95 @@
 
 /// \file MedianFilter.h
 ///
+/// Exact median filtering of floating-point images with nodata
+/// support. The image values are replaced by their ranks, and a
+/// window of ranks is slid over the image in a serpentine order,
+/// with a tiered histogram used to track the median. The per-pixel
+/// cost is linear in the kernel width, rather than growing with
+/// its area as when sorting each window.
 
 #ifndef __MEDIAN_FILTER_H__
 #define __MEDIAN_FILTER_H__
 
-#define CALC_PIXEL_NUM_VALS 256
-
-#include <vw/Core/Functors.h>
-#include <vw/Core/FundamentalTypes.h>
 #include <vw/Math/Vector.h>
-#include <vw/Math/BBox.h>
 #include <vw/Image/ImageView.h>
-#include <vw/Image/EdgeExtension.h>
-#include <vw/Image/PerPixelAccessorViews.h>
-
-namespace vw {
-
-  uint8 find_median_in_histogram(Vector<int, CALC_PIXEL_NUM_VALS> histogram,
-                                 int kernSize);
-
-  template<class ImageT>
-  ImageView<typename ImageT::pixel_type> fast_median_filter(ImageViewBase<ImageT> const& img,  int kernSize) {
-    typedef typename ImageT::pixel_type PixelT;
-
-    ImageView<uint8> src = pixel_cast_rescale<uint8>(img.impl());
-    ImageView<uint8> result(src.cols(), src.rows());
-
-    Vector<int, CALC_PIXEL_NUM_VALS> histogram;
-
-    // Seed histogram
-    for (int x = 0; x < kernSize; x++) {
-      for (int y = 0; y < kernSize; y++) {
-        histogram(src(x, y))++;
+#include <vw/Image/PixelMask.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace asp {
+
+  /// The core of the median filter. The input has one rank per pixel,
+  /// stored row-major, with the valid ranks being distinct values in
+  /// [0, num_ranks), and invalid pixels having a negative rank. For
+  /// each pixel, find the ranks of the lower and upper median of the
+  /// valid ranks in the kernel_size x kernel_size window around it,
+  /// clipped to the image. These are equal if the number of valid
+  /// ranks in the window is odd. They are set to -1 if the window has
+  /// no valid ranks, or if the pixel itself is invalid and
+  /// skip_invalid_centers is true.
+  void median_filter_ranks(std::vector<int> const& ranks, int cols, int rows,
+                           int num_ranks, int kernel_size, bool skip_invalid_centers,
+                           std::vector<int> & lo_ranks, std::vector<int> & hi_ranks);
+
+  /// Apply a median filter of the given kernel size to an image. NaN
+  /// values and values equal to nodata_val are ignored. If the number
+  /// of valid values in a window is even, the two middle ones are
+  /// averaged. Output pixels whose window has no valid values, and, if
+  /// skip_invalid_centers is true, output pixels at invalid input
+  /// pixels, are set to nodata_val. The result is exact for any
+  /// scalar pixel type, as no quantization is done.
+  template<class T>
+  void fast_median_filter(vw::ImageView<T> const& img, T nodata_val, int kernel_size,
+                          bool skip_invalid_centers, vw::ImageView<T> & out) {
+
+    int cols = img.cols(), rows = img.rows();
+    out.set_size(cols, rows);
+
+    // Sort the valid values, remembering where they came from
+    std::vector<std::pair<T, int>> vals;
+    vals.reserve(cols * rows);
+    for (int row = 0; row < rows; row++) {
+      for (int col = 0; col < cols; col++) {
+        T val = img(col, row);
+        if (std::isnan(val) || val == nodata_val)
+          continue;
+        vals.push_back(std::make_pair(val, row * cols + col));
       }
     }
-
-    bool goingRight = true;
-    int x = 0, y = 0;
-    //while (y <=src.rows() - kernSize) { //this was a bug
-    while (y < src.rows() - kernSize) {
-
-      result(x + kernSize / 2, y + kernSize / 2) = find_median_in_histogram(histogram, kernSize);
-
-      if (goingRight) {
-        if (x < src.cols() - kernSize) {
-          for (int i = 0; i < kernSize; i++) {
-            histogram(src(x, y + i))--;
-            histogram(src(x + kernSize, y + i))++;
-          }
-          x++;
-
-        }
-        else {
-          // Reached the right edge
-          for (int i = 0; i < kernSize; i++) {
-            histogram(src(x + i, y))--;
-            histogram(src(x + i, y + kernSize))++;
-          }
-          goingRight = false;
-          y++;
-        }
-      }
-      else {
-        if (x > 0) {
-          for (int i = 0; i < kernSize; i++) {
-            histogram(src(x - 1, y + i))++;
-            histogram(src(x + kernSize - 1, y + i))--;
-          }
-          x--;
-        }
-        else {
-          // Reached the left edge
-          for (int i = 0; i < kernSize; i++) {
-            histogram(src(x + i, y))--;
-            histogram(src(x + i, y + kernSize))++;
-          }
-          goingRight = true;
-          y++;
-        }
+    std::sort(vals.begin(), vals.end());
+
+    std::vector<int> ranks(cols * rows, -1);
+    for (size_t it = 0; it < vals.size(); it++)
+      ranks[vals[it].second] = it;
+
+    std::vector<int> lo_ranks, hi_ranks;
+    median_filter_ranks(ranks, cols, rows, vals.size(), kernel_size,
+                        skip_invalid_centers, lo_ranks, hi_ranks);
+
+    for (int row = 0; row < rows; row++) {
+      for (int col = 0; col < cols; col++) {
+        int k = row * cols + col;
+        if (lo_ranks[k] < 0)
+          out(col, row) = nodata_val;
+        else if (lo_ranks[k] == hi_ranks[k])
+          out(col, row) = vals[lo_ranks[k]].first;
+        else
+          out(col, row) = (vals[lo_ranks[k]].first + vals[hi_ranks[k]].first) / T(2);
       }
     }
-
-    return pixel_cast_rescale<PixelT>(result);
   }
 
-  template<class PixelT>
-  class MedianFilterFunctor:public ReturnFixedType<PixelT>
-  {
-    int m_kernel_width;
-    int m_kernel_height;
-
-  public:
-    MedianFilterFunctor(int kernel_width, int kernel_height):
-      m_kernel_width(kernel_width),
-      m_kernel_height(kernel_height){}
-
-    BBox2i work_area() const{ return BBox2i(Vector2i(-m_kernel_width/2, -m_kernel_height/2),
-                                            Vector2i(m_kernel_width/2, m_kernel_height/2));  }
-
-    template<class PixelAccessorT>
-    typename PixelAccessorT::pixel_type operator()(PixelAccessorT const& acc) const{
-
-      Vector<int, CALC_PIXEL_NUM_VALS> histogram;
-
-      // Seed histogram
-      for (int x = 0; x < m_kernel_width; x++) {
-        for (int y = 0; y < m_kernel_height; y++) {
-          histogram(*acc)++;
-        }
-      }
-      *acc = find_median_in_histogram(histogram, m_kernel_width);
-
-      return *acc;
-    }
-  };
-
-  template<class ViewT>
-  UnaryPerPixelAccessorView<EdgeExtensionView<ViewT, ZeroEdgeExtension>, MedianFilterFunctor<typename ViewT::pixel_type> >
-  my_median_filter(ImageViewBase<ViewT> const& input, int kernel_width, int kernel_height)
-  {
-    return UnaryPerPixelAccessorView<EdgeExtensionView<ViewT, ZeroEdgeExtension>, MedianFilterFunctor<typename ViewT::pixel_type> >(edge_extend(input, ZeroEdgeExtension()), MedianFilterFunctor<typename ViewT::pixel_type> (kernel_width, kernel_height));
-  }
+  /// Median filter for disparities. Each channel is filtered
+  /// separately, using only the valid disparities in the window.
+  /// Invalid disparities stay invalid.
+  void disparity_median_filter(vw::ImageView<vw::PixelMask<vw::Vector2f>> const& disp,
+                               int kernel_size,
+                               vw::ImageView<vw::PixelMask<vw::Vector2f>> & out);
 
-}
+} // end namespace asp
 
 #endif // __MEDIAN_FILTER_H__
@@ -36,10 +36,12 @@
 
 #include <asp/Core/SoftwareRenderer.h>
 #include <asp/Core/PointUtils.h>
+#include <asp/Core/MedianFilter.h>
 #include <boost/foreach.hpp>
 #include <boost/math/special_functions/next.hpp>
 #include <asp/Core/OrthoRasterizer.h>
 #include <valarray>
+#include <set>
 
 namespace asp{
 
@@ -273,27 +275,23 @@ namespace asp{
     if (half <= 0 || thresh <= 0)
       return;
 
-    int nc = image.cols(), nr = image.rows(); // shorten
     double nan = std::numeric_limits<double>::quiet_NaN();
 
-    ImageView<Vector3> image_out = copy(image);
+    ImageView<double> heights(image.cols(), image.rows()), medians;
+    for (int col = 0; col < image.cols(); col++)
+      for (int row = 0; row < image.rows(); row++)
+        heights(col, row) = image(col, row).z();
+
+    asp::fast_median_filter(heights, nan, 2*half + 1, true, medians);
 
+    ImageView<Vector3> image_out = copy(image);
     for (int col = 0; col < image.cols(); col++){
       for (int row = 0; row < image.rows(); row++){
 
         if (boost::math::isnan(image(col, row).z()))
           continue;
 
-        std::vector<double> vals;
-        for (int c = std::max(col-half, 0); c <= std::min(col+half, nc-1); c++){
-          for (int r = std::max(row-half, 0); r <= std::min(row+half, nr-1); r++){
-            if (boost::math::isnan(image(c, r).z()))
-              continue;
-            vals.push_back(image(c, r).z());
-          }
-        }
-        double median = vw::math::destructive_median(vals);
-        if (fabs(median - image(col, row).z()) > thresh){
+        if (fabs(medians(col, row) - image(col, row).z()) > thresh){
           image_out(col, row).z() = nan;
         }
       }
@@ -403,7 +401,8 @@ namespace asp{
    std::string const& filter,
    double default_grid_size_multiplier,
    std::int64_t * num_invalid_pixels, vw::Mutex *count_mutex,
-   const ProgressCallback& progress):
+   const ProgressCallback& progress,
+   std::vector<BBox2i> const& valid_blocks):
     // Ensure all members are initiated, even if to temporary values
     m_point_image(point_image), m_texture(ImageView<float>(1,1)),
     m_bbox(BBox3()), m_snapped_bbox(BBox3()), m_spacing(0.0), m_default_spacing(0.0),
@@ -466,6 +465,29 @@ namespace asp{
     sub_block_size = std::min(ASP_MAX_SUBBLOCK_SIZE, sub_block_size);
     std::vector<BBox2i> blocks = subdivide_bbox(m_point_image, m_block_size, m_block_size);
 
+    // If the blocks of the point image having points are known, skip
+    // the rest. The blocks here are aligned to the block size.
+    if (!valid_blocks.empty()) {
+      std::set<std::pair<int, int>> used;
+      for (size_t i = 0; i < valid_blocks.size(); i++) {
+        BBox2i const& b = valid_blocks[i];
+        if (b.empty())
+          continue;
+        for (int x = b.min().x()/m_block_size; x <= (b.max().x() - 1)/m_block_size; x++)
+          for (int y = b.min().y()/m_block_size; y <= (b.max().y() - 1)/m_block_size; y++)
+            used.insert(std::make_pair(x, y));
+      }
+      std::vector<BBox2i> used_blocks;
+      for (size_t i = 0; i < blocks.size(); i++) {
+        if (used.find(std::make_pair(blocks[i].min().x()/m_block_size,
+                                     blocks[i].min().y()/m_block_size)) != used.end())
+          used_blocks.push_back(blocks[i]);
+      }
+      VW_OUT(DebugMessage,"asp") << "Skipping " << blocks.size() - used_blocks.size()
+                                 << " empty blocks out of " << blocks.size() << ".\n";
+      blocks = used_blocks;
+    }
+
     // Find the bounding box of each subblock, stored in
     // m_point_image_boundaries, together with other info by
     // searching through the image.
@@ -109,7 +109,9 @@ namespace asp{
                         double  default_grid_size_multiplier,
                         std::int64_t * num_invalid_pixels,
                         vw::Mutex *count_mutex,
-                        const ProgressCallback& progress);
+                        const ProgressCallback& progress,
+                        // If not empty, only these blocks of the point image have points
+                        std::vector<BBox2i> const& valid_blocks = std::vector<BBox2i>());
 
     /// This must be called before the object can be used!
     void initialize_spacing(double spacing=0.0);
@@ -23,6 +23,7 @@
 #include <asp/Core/StereoSettings.h>
 #include <asp/Core/Common.h>
 #include <asp/Core/PhotometricOutlier.h>
+#include <asp/Core/VirtualAlignedImages.h>
 
 #include <vw/Image/AlgorithmFunctions.h>
 #include <vw/Image/Algorithms.h>
@@ -47,7 +48,8 @@ void asp::photometric_outlier_rejection(vw::GdalWriteOptions const& opt,
                                         std::string & output_disparity,
                                         int kernel_size) {
   // Projecting right into perspective of left
-  DiskImageView<PixelGray<float>> right_disk_image(prefix+"-R.tif");
+  ImageViewRef<PixelGray<float>> left_image, right_disk_image;
+  asp::open_aligned_images(prefix, left_image, right_disk_image);
   DiskImageView<PixelMask<Vector2f>> disparity_disk_image( input_disparity );
   stereo::DisparityTransform trans( disparity_disk_image );
 
@@ -64,7 +66,6 @@ void asp::photometric_outlier_rejection(vw::GdalWriteOptions const& opt,
   // Differencing Left and Projected Right
   ImageViewRef<PixelMask<PixelGray<float32>>> right_mask =
     create_mask(right_proj);
-  DiskImageView<PixelGray<float32>> left_image(prefix+"-L.tif");
   DiskCacheImageView<PixelGray<float>>
     diff( abs(apply_mask(copy_mask(left_image,right_mask))-right_proj),
           "tif", TerminalProgressCallback("asp","\tDifference:"),
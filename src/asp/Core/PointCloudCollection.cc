@@ -0,0 +1,418 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/FileIO/DiskImageUtils.h>
+#include <vw/Cartography/Datum.h>
+#include <asp/Core/PointUtils.h>
+#include <asp/Core/PointCloudCollection.h>
+#include <asp/Core/FileUtils.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+namespace fs = boost::filesystem;
+using namespace vw;
+
+namespace asp {
+
+namespace {
+  const std::string COLLECTION_HEADER = "asp_point_cloud_collection";
+  const int COLLECTION_VERSION = 1;
+}
+
+void PointCloudBlock::add_point(Vector3 const& xyz, double error) {
+  point_box.grow(xyz);
+  num_points++;
+  mean_error += error; // the sum for now
+  max_error = std::max(max_error, error);
+}
+
+void PointCloudBlock::finish() {
+  if (num_points > 0)
+    mean_error /= num_points;
+}
+
+void PointCloudCollection::write(std::string const& file) const {
+
+  std::ofstream ofs(file.c_str());
+  if (!ofs.good())
+    vw_throw(ArgumentErr() << "Cannot write: " << file << "\n");
+
+  // The file name is last on its line, so it can have spaces. Use
+  // absolute paths so that the collection can be used from any directory.
+  ofs << std::setprecision(17);
+  ofs << COLLECTION_HEADER << " " << COLLECTION_VERSION << "\n";
+  for (size_t m = 0; m < members.size(); m++) {
+    PointCloudMember const& mem = members[m];
+    ofs << "member " << mem.num_channels << " " << mem.size[0] << " " << mem.size[1]
+        << " " << mem.blocks.size() << " " << fs::absolute(mem.file).string() << "\n";
+    for (size_t b = 0; b < mem.blocks.size(); b++) {
+      PointCloudBlock const& blk = mem.blocks[b];
+      ofs << "block "
+          << blk.pixel_box.min().x() << " " << blk.pixel_box.min().y() << " "
+          << blk.pixel_box.width()   << " " << blk.pixel_box.height()  << " "
+          << blk.num_points;
+      for (int c = 0; c < 3; c++)
+        ofs << " " << blk.point_box.min()[c];
+      for (int c = 0; c < 3; c++)
+        ofs << " " << blk.point_box.max()[c];
+      ofs << " " << blk.mean_error << " " << blk.max_error << "\n";
+    }
+  }
+  ofs.close();
+}
+
+void PointCloudCollection::read(std::string const& file) {
+
+  std::ifstream ifs(file.c_str());
+  if (!ifs.good())
+    vw_throw(ArgumentErr() << "Cannot read: " << file << "\n");
+
+  std::string header;
+  int version = 0;
+  if (!(ifs >> header >> version) || header != COLLECTION_HEADER)
+    vw_throw(ArgumentErr() << "Not a point cloud collection: " << file << "\n");
+  if (version != COLLECTION_VERSION)
+    vw_throw(ArgumentErr() << "Unsupported point cloud collection version "
+             << version << " in: " << file << "\n");
+
+  members.clear();
+  std::string line;
+  std::getline(ifs, line); // finish the header line
+  while (std::getline(ifs, line)) {
+    std::istringstream is(line);
+    std::string key;
+    if (!(is >> key))
+      continue;
+
+    bool good = true;
+    if (key == "member") {
+      PointCloudMember mem;
+      size_t num_blocks = 0;
+      good = static_cast<bool>(is >> mem.num_channels >> mem.size[0] >> mem.size[1]
+                               >> num_blocks);
+      std::getline(is >> std::ws, mem.file);
+      good = good && !mem.file.empty();
+      mem.blocks.reserve(num_blocks);
+      members.push_back(mem);
+    } else if (key == "block") {
+      PointCloudBlock blk;
+      int x = 0, y = 0, w = 0, h = 0;
+      Vector3 lo, hi;
+      good = !members.empty() &&
+        static_cast<bool>(is >> x >> y >> w >> h >> blk.num_points
+                          >> lo[0] >> lo[1] >> lo[2] >> hi[0] >> hi[1] >> hi[2]);
+      blk.pixel_box = BBox2i(x, y, w, h);
+      blk.point_box = BBox3(lo, hi);
+      // The error statistics are optional
+      if (!(is >> blk.mean_error >> blk.max_error)) {
+        blk.mean_error = 0.0;
+        blk.max_error  = 0.0;
+      }
+      if (good)
+        members.back().blocks.push_back(blk);
+    } else {
+      continue; // Ignore unknown keys
+    }
+
+    if (!good)
+      vw_throw(ArgumentErr() << "Could not parse line: '" << line << "' in: " << file << "\n");
+  }
+
+  if (members.empty())
+    vw_throw(ArgumentErr() << "No point clouds are listed in: " << file << "\n");
+}
+
+std::vector<std::string> PointCloudCollection::files() const {
+  std::vector<std::string> files;
+  for (size_t m = 0; m < members.size(); m++)
+    files.push_back(members[m].file);
+  return files;
+}
+
+BBox3 PointCloudCollection::point_box() const {
+  BBox3 box;
+  for (size_t m = 0; m < members.size(); m++)
+    for (size_t b = 0; b < members[m].blocks.size(); b++) {
+      // Grow by the corners, as a box of one point counts as empty
+      box.grow(members[m].blocks[b].point_box.min());
+      box.grow(members[m].blocks[b].point_box.max());
+    }
+  return box;
+}
+
+int64 PointCloudCollection::num_points() const {
+  int64 num = 0;
+  for (size_t m = 0; m < members.size(); m++)
+    for (size_t b = 0; b < members[m].blocks.size(); b++)
+      num += members[m].blocks[b].num_points;
+  return num;
+}
+
+bool is_point_cloud_collection(std::string const& file) {
+  return boost::iends_with(file, ".pcc");
+}
+
+namespace {
+
+  // Find the bounding box, number of valid points, and error
+  // statistics of a block. The error image is empty if there are no
+  // error channels.
+  class PointCloudBlockTask: public vw::Task, private boost::noncopyable {
+    ImageViewRef<Vector3> m_cloud;
+    ImageViewRef<double>  m_error;
+    PointCloudBlock     & m_block;
+
+  public:
+    PointCloudBlockTask(ImageViewRef<Vector3> const& cloud, ImageViewRef<double> const& error,
+                        PointCloudBlock & block):
+      m_cloud(cloud), m_error(error), m_block(block) {}
+
+    virtual void operator()() {
+      ImageView<Vector3> points = crop(m_cloud, m_block.pixel_box);
+      ImageView<double> errors;
+      if (m_error.cols() > 0)
+        errors = crop(m_error, m_block.pixel_box);
+      for (int row = 0; row < points.rows(); row++) {
+        for (int col = 0; col < points.cols(); col++) {
+          Vector3 const& xyz = points(col, row);
+          if (xyz == Vector3() || xyz != xyz)
+            continue; // invalid and NaN check
+          m_block.add_point(xyz, (errors.cols() > 0) ? errors(col, row) : 0.0);
+        }
+      }
+      m_block.finish();
+    }
+  };
+
+} // end anonymous namespace
+
+void index_point_cloud(std::string const& file, int block_size,
+                       PointCloudMember & member) {
+
+  if (block_size <= 0)
+    vw_throw(ArgumentErr() << "The block size must be positive.\n");
+
+  if (read_point_cloud_index(file, member)) {
+    vw_out() << "Using the index: " << point_cloud_index_file(file) << "\n";
+    return;
+  }
+
+  ImageViewRef<Vector3> cloud = asp::read_asp_point_cloud<3>(file);
+  member.file         = file;
+  member.num_channels = vw::get_num_channels(file);
+  member.size         = Vector2i(cloud.cols(), cloud.rows());
+
+  // The norm of the error channels, if present
+  ImageViewRef<double> error;
+  if (member.num_channels == 4 || member.num_channels == 6)
+    error = asp::point_cloud_error_image(std::vector<std::string>(1, file));
+
+  std::vector<BBox2i> boxes = subdivide_bbox(BBox2i(0, 0, cloud.cols(), cloud.rows()),
+                                             block_size, block_size);
+  std::vector<PointCloudBlock> blocks(boxes.size());
+  vw::FifoWorkQueue queue(vw::vw_settings().default_num_threads());
+  for (size_t it = 0; it < boxes.size(); it++) {
+    blocks[it].pixel_box = boxes[it];
+    boost::shared_ptr<vw::Task> task(new PointCloudBlockTask(cloud, error, blocks[it]));
+    queue.add_task(task);
+  }
+  queue.join_all();
+
+  // Keep only the blocks with points
+  member.blocks.clear();
+  for (size_t it = 0; it < blocks.size(); it++) {
+    if (blocks[it].num_points > 0)
+      member.blocks.push_back(blocks[it]);
+  }
+}
+
+std::string point_cloud_index_file(std::string const& cloud_file) {
+  return fs::path(cloud_file).replace_extension(".pcc").string();
+}
+
+bool read_point_cloud_index(std::string const& cloud_file, PointCloudMember & member) {
+
+  std::string index_file = point_cloud_index_file(cloud_file);
+  if (is_point_cloud_collection(cloud_file) || !asp::is_latest_timestamp(index_file, cloud_file))
+    return false;
+
+  PointCloudCollection index;
+  try {
+    index.read(index_file);
+  } catch (std::exception const& e) {
+    vw_out(WarningMessage) << "Ignoring the point cloud index " << index_file
+                           << ". " << e.what();
+    return false;
+  }
+
+  ImageViewRef<Vector3> cloud = asp::read_asp_point_cloud<3>(cloud_file);
+  if (index.members.size() != 1 ||
+      index.members[0].size != Vector2i(cloud.cols(), cloud.rows()))
+    return false;
+
+  member = index.members[0];
+  member.file = cloud_file; // in case the files were moved
+  return true;
+}
+
+bool point_cloud_composite_blocks(std::vector<std::string> const& files, int spacing,
+                                  std::vector<BBox2i> & blocks) {
+
+  blocks.clear();
+  int composite_cols = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+
+    PointCloudMember member;
+    if (!read_point_cloud_index(files[i], member)) {
+      blocks.clear();
+      return false;
+    }
+
+    // Must be in sync with how form_point_cloud_composite() places
+    // the clouds side by side, transposing the wide ones.
+    bool transposed = (member.size.y() < member.size.x());
+    int cols = transposed ? member.size.y() : member.size.x();
+    int start = composite_cols;
+    if (i > 0)
+      start = spacing*(int)ceil(double(start)/spacing) + spacing;
+    composite_cols = start + cols;
+
+    for (size_t b = 0; b < member.blocks.size(); b++) {
+      BBox2i box = member.blocks[b].pixel_box;
+      if (transposed)
+        box = BBox2i(box.min().y(), box.min().x(), box.height(), box.width());
+      blocks.push_back(box + Vector2i(start, 0));
+    }
+  }
+
+  return true;
+}
+
+void PointCloudIndexer::add_block(PointCloudBlock const& block) {
+  Mutex::Lock lock(m_mutex);
+  // A block which is rasterized again replaces the earlier one
+  m_blocks[std::make_pair(block.pixel_box.min().x(), block.pixel_box.min().y())] = block;
+}
+
+void PointCloudIndexer::write(std::string const& cloud_file, int num_channels,
+                              Vector2i const& size) const {
+  Mutex::Lock lock(m_mutex);
+
+  PointCloudCollection index;
+  index.members.resize(1);
+  PointCloudMember & member = index.members[0];
+  member.file         = cloud_file;
+  member.num_channels = num_channels;
+  member.size         = size;
+  for (auto it = m_blocks.begin(); it != m_blocks.end(); it++) {
+    if (it->second.num_points > 0)
+      member.blocks.push_back(it->second);
+  }
+
+  std::string index_file = point_cloud_index_file(cloud_file);
+  vw_out() << "Writing point cloud index: " << index_file << "\n";
+  index.write(index_file);
+}
+
+std::vector<std::string> expand_point_cloud_collections(std::vector<std::string> const& files) {
+
+  std::vector<std::string> out;
+  for (size_t it = 0; it < files.size(); it++) {
+    if (!is_point_cloud_collection(files[it])) {
+      out.push_back(files[it]);
+      continue;
+    }
+    PointCloudCollection collection;
+    collection.read(files[it]);
+    std::vector<std::string> members = collection.files();
+    out.insert(out.end(), members.begin(), members.end());
+  }
+
+  return out;
+}
+
+BBox2 point_box_to_lonlat_box(BBox3 const& point_box,
+                              vw::cartography::Datum const& datum) {
+
+  BBox2 full(Vector2(-180.0, -90.0), Vector2(180.0, 90.0));
+  Vector3 lo = point_box.min(), hi = point_box.max();
+  if (lo.x() > hi.x() || lo.y() > hi.y() || lo.z() > hi.z())
+    return BBox2(); // no points
+
+  // The distance from the z axis ranges from the closest point of the
+  // box in the xy plane to its farthest corner.
+  double cx = std::max(lo.x(), std::min(0.0, hi.x()));
+  double cy = std::max(lo.y(), std::min(0.0, hi.y()));
+  double min_rho = sqrt(cx * cx + cy * cy), max_rho = 0.0;
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 2; j++) {
+      double x = (i == 0) ? lo.x() : hi.x(), y = (j == 0) ? lo.y() : hi.y();
+      max_rho = std::max(max_rho, sqrt(x * x + y * y));
+    }
+  }
+
+  // The latitude grows with z and, for positive z, shrinks with the
+  // distance from the axis, so it is extreme at these combinations.
+  double lat_lo = 90.0, lat_hi = -90.0;
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 2; j++) {
+      double rho = (i == 0) ? min_rho : max_rho, z = (j == 0) ? lo.z() : hi.z();
+      double lat = datum.cartesian_to_geodetic(Vector3(rho, 0, z))[1];
+      lat_lo = std::min(lat_lo, lat);
+      lat_hi = std::max(lat_hi, lat);
+    }
+  }
+
+  // If the box contains the z axis, or straddles the 180 degree
+  // meridian, do not constrain the longitude.
+  double lon_lo = -180.0, lon_hi = 180.0;
+  bool straddles = (lo.x() < 0 && lo.y() <= 0 && hi.y() >= 0);
+  if (min_rho > 0 && !straddles) {
+    lon_lo = 180.0; lon_hi = -180.0;
+    for (int i = 0; i < 2; i++) {
+      for (int j = 0; j < 2; j++) {
+        double x = (i == 0) ? lo.x() : hi.x(), y = (j == 0) ? lo.y() : hi.y();
+        double lon = atan2(y, x) * 180.0 / M_PI;
+        lon_lo = std::min(lon_lo, lon);
+        lon_hi = std::max(lon_hi, lon);
+      }
+    }
+  }
+
+  // Pad a little for numerical error
+  const double pad = 1e-8;
+  BBox2 lonlat(Vector2(lon_lo - pad, lat_lo - pad), Vector2(lon_hi + pad, lat_hi + pad));
+  lonlat.crop(full);
+  return lonlat;
+}
+
+} // end namespace asp
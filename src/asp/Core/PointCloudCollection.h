@@ -0,0 +1,213 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file PointCloudCollection.h
+///
+/// A point cloud collection is a small text file, with the .pcc
+/// extension, listing several ASP point clouds. The clouds are split
+/// into blocks, and for each block which has valid points the file
+/// stores its pixel extent, the number of valid points, and their 3D
+/// bounding box. This allows pc_merge to combine many clouds without
+/// writing them out again, and the tools reading the collection to
+/// skip the blocks they do not need.
+///
+/// A collection with a single cloud is also used as an index of that
+/// cloud. stereo_tri writes it next to the point cloud, as the cloud
+/// is being written, so later tools can find the extent of the cloud
+/// and skip its empty blocks without a pass over the data.
+
+#ifndef __ASP_CORE_POINT_CLOUD_COLLECTION_H__
+#define __ASP_CORE_POINT_CLOUD_COLLECTION_H__
+
+#include <vw/Math/BBox.h>
+#include <vw/Math/Vector.h>
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Thread.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/Manipulation.h>
+
+#include <boost/math/special_functions/fpclassify.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace vw {
+  namespace cartography {
+    class Datum;
+  }
+}
+
+namespace asp {
+
+  /// A block of a point cloud having valid points
+  struct PointCloudBlock {
+    vw::BBox2i pixel_box;  // the block extent in the cloud
+    vw::BBox3  point_box;  // the bounding box of the valid points, in ECEF
+    vw::int64  num_points; // the number of valid points
+    double     mean_error, max_error; // of the triangulation error, if known, else 0
+
+    PointCloudBlock(): num_points(0), mean_error(0.0), max_error(0.0) {}
+
+    /// Add the statistics of a point and its error
+    void add_point(vw::Vector3 const& xyz, double error);
+
+    /// Turn the accumulated sum of errors into their mean
+    void finish();
+  };
+
+  /// A point cloud in a collection, and its non-empty blocks
+  struct PointCloudMember {
+    std::string  file;
+    int          num_channels;
+    vw::Vector2i size;
+    std::vector<PointCloudBlock> blocks;
+  };
+
+  struct PointCloudCollection {
+    std::vector<PointCloudMember> members;
+
+    void write(std::string const& file) const;
+    void read (std::string const& file);
+
+    /// The files of the member clouds
+    std::vector<std::string> files() const;
+
+    /// The bounding box of all points, and their number
+    vw::BBox3 point_box() const;
+    vw::int64 num_points() const;
+  };
+
+  /// If this file is a point cloud collection, based on its extension
+  bool is_point_cloud_collection(std::string const& file);
+
+  /// Split an ASP point cloud into blocks of given size, and find the
+  /// non-empty ones, with their bounding boxes. The blocks are
+  /// processed in parallel. If the cloud has an up-to-date index, that
+  /// is used instead, with its own block size.
+  void index_point_cloud(std::string const& file, int block_size,
+                         PointCloudMember & member);
+
+  /// The index of a point cloud, such as run-PC.pcc for run-PC.tif
+  std::string point_cloud_index_file(std::string const& cloud_file);
+
+  /// Read the index of a point cloud. Return false if there is no
+  /// index, or if it is older than the cloud or does not fit it.
+  bool read_point_cloud_index(std::string const& cloud_file, PointCloudMember & member);
+
+  /// The blocks having points in the image made by
+  /// form_point_cloud_composite() from the given clouds with the given
+  /// spacing, found from the indices of the clouds. Return false if
+  /// some cloud has no index.
+  bool point_cloud_composite_blocks(std::vector<std::string> const& files, int spacing,
+                                    std::vector<vw::BBox2i> & blocks);
+
+  /// Collect the statistics of the blocks of a point cloud as it is
+  /// being written, and save them as the index of the cloud.
+  class PointCloudIndexer {
+  public:
+    void add_block(PointCloudBlock const& block);
+
+    /// Write the index, with the non-empty blocks seen so far
+    void write(std::string const& cloud_file, int num_channels,
+               vw::Vector2i const& size) const;
+
+  private:
+    mutable vw::Mutex m_mutex;
+    std::map<std::pair<int, int>, PointCloudBlock> m_blocks; // keyed by the block corner
+  };
+
+  /// Pass through a point cloud, with the x, y, z coordinates in the
+  /// first channels and the triangulation error in the rest. Each
+  /// rasterized tile becomes a block of the index.
+  template <class ImageT>
+  class PointCloudIndexView: public vw::ImageViewBase<PointCloudIndexView<ImageT>> {
+    ImageT              m_image;
+    PointCloudIndexer * m_indexer; // a pointer, as views are copied
+
+  public:
+    typedef typename ImageT::pixel_type pixel_type;
+    typedef pixel_type result_type;
+    typedef vw::ProceduralPixelAccessor<PointCloudIndexView> pixel_accessor;
+
+    PointCloudIndexView(ImageT const& image, PointCloudIndexer * indexer):
+      m_image(image), m_indexer(indexer) {}
+
+    inline vw::int32 cols  () const { return m_image.cols(); }
+    inline vw::int32 rows  () const { return m_image.rows(); }
+    inline vw::int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this, 0, 0); }
+
+    inline pixel_type operator()(double/*i*/, double/*j*/, vw::int32/*p*/ = 0) const {
+      vw::vw_throw(vw::NoImplErr()
+                   << "PointCloudIndexView::operator()(...) is not implemented");
+      return pixel_type();
+    }
+
+    typedef vw::CropView<vw::ImageView<pixel_type>> prerasterize_type;
+    inline prerasterize_type prerasterize(vw::BBox2i const& bbox) const {
+
+      vw::ImageView<pixel_type> tile = crop(m_image, bbox);
+
+      const int num_ch = vw::math::VectorSize<pixel_type>::value;
+      PointCloudBlock block;
+      block.pixel_box = bbox;
+      for (int row = 0; row < tile.rows(); row++) {
+        for (int col = 0; col < tile.cols(); col++) {
+          vw::Vector3 xyz = subvector(tile(col, row), 0, 3);
+          if (xyz == vw::Vector3() || boost::math::isnan(xyz[0]))
+            continue;
+          double error = 0.0;
+          if (num_ch > 3)
+            error = norm_2(subvector(tile(col, row), 3, num_ch - 3));
+          block.add_point(xyz, error);
+        }
+      }
+      block.finish();
+      m_indexer->add_block(block);
+
+      return prerasterize_type(tile, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+    }
+
+    template <class DestT>
+    inline void rasterize(DestT const& dest, vw::BBox2i const& bbox) const {
+      vw::rasterize(prerasterize(bbox), dest, bbox);
+    }
+  };
+
+  template <class ImageT>
+  PointCloudIndexView<ImageT> index_point_cloud_view(ImageT const& image,
+                                                     PointCloudIndexer * indexer) {
+    return PointCloudIndexView<ImageT>(image, indexer);
+  }
+
+  /// Replace each point cloud collection in the list with its member
+  /// clouds. Other files are kept as they are.
+  std::vector<std::string> expand_point_cloud_collections(std::vector<std::string> const& files);
+
+  /// A longitude-latitude box, in degrees, containing all points in
+  /// the given ECEF box. The longitude is in [-180, 180]. The box is
+  /// conservative, so it may be larger than needed.
+  vw::BBox2 point_box_to_lonlat_box(vw::BBox3 const& point_box,
+                                    vw::cartography::Datum const& datum);
+
+} // end namespace asp
+
+#endif // __ASP_CORE_POINT_CLOUD_COLLECTION_H__
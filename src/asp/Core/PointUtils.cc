@@ -30,6 +30,7 @@
 #include <asp/Core/Macros.h>
 #include <asp/Core/Common.h>
 #include <asp/Core/PointUtils.h>
+#include <asp/Core/PointCloudCollection.h>
 #include <vw/Cartography/Chipper.h>
 #include <vw/Core/Stopwatch.h>
 #include <boost/math/special_functions/fpclassify.hpp>
@@ -1217,6 +1218,8 @@ double asp::find_avg_lon(ImageViewRef<Vector3> const& point_image){
 /// Analyze a file name to determine the file type
 std::string asp::get_cloud_type(std::string const& file_name){
 
+  if (asp::is_point_cloud_collection(file_name))
+    return "PCC";
   if (asp::is_csv(file_name))
     return "CSV";
   if (asp::is_las(file_name))
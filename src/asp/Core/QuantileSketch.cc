@@ -0,0 +1,215 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Exception.h>
+#include <asp/Core/QuantileSketch.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace vw;
+
+namespace asp {
+
+QuantileSketch::QuantileSketch(int k): m_k(k), m_count(0), m_num_retained(0),
+                                       m_min(0.0), m_max(0.0), m_mean(0.0), m_m2(0.0),
+                                       m_num_compactions(0), m_max_size(0) {
+  if (k < 2)
+    vw_throw(ArgumentErr() << "The quantile sketch size must be at least 2.\n");
+  resize_levels(1);
+}
+
+// Lower levels hold fewer values, shrinking geometrically from the top
+void QuantileSketch::resize_levels(size_t num_levels) {
+  m_levels.resize(num_levels);
+  m_capacities.resize(num_levels);
+  m_max_size = 0;
+  for (size_t h = 0; h < num_levels; h++) {
+    int depth = int(num_levels) - int(h) - 1;
+    m_capacities[h] = std::max(int(ceil(m_k * pow(2.0/3.0, depth))), 2);
+    m_max_size += m_capacities[h];
+  }
+}
+
+void QuantileSketch::add(double val) {
+
+  if (m_count == 0) {
+    m_min = val;
+    m_max = val;
+  } else {
+    m_min = std::min(m_min, val);
+    m_max = std::max(m_max, val);
+  }
+
+  // Welford's update of the mean and squared deviations
+  m_count++;
+  double delta = val - m_mean;
+  m_mean += delta / m_count;
+  m_m2   += delta * (val - m_mean);
+
+  m_levels[0].push_back(val);
+  m_num_retained++;
+  if (m_num_retained > m_max_size)
+    compress();
+}
+
+void QuantileSketch::merge(QuantileSketch const& other) {
+
+  if (other.m_count == 0)
+    return;
+  if (m_count == 0) {
+    int k = m_k;
+    *this = other;
+    m_k = k;
+    resize_levels(m_levels.size());
+    compress();
+    return;
+  }
+
+  m_min = std::min(m_min, other.m_min);
+  m_max = std::max(m_max, other.m_max);
+  double n     = double(m_count) + double(other.m_count);
+  double delta = other.m_mean - m_mean;
+  m_mean += delta * other.m_count / n;
+  m_m2   += other.m_m2 + delta * delta * double(m_count) * double(other.m_count) / n;
+  m_count += other.m_count;
+
+  if (m_levels.size() < other.m_levels.size())
+    resize_levels(other.m_levels.size());
+  for (size_t h = 0; h < other.m_levels.size(); h++)
+    m_levels[h].insert(m_levels[h].end(), other.m_levels[h].begin(), other.m_levels[h].end());
+  m_num_retained += other.m_num_retained;
+
+  compress();
+}
+
+// Compact the lowest level over capacity until all values fit
+void QuantileSketch::compress() {
+  while (m_num_retained > m_max_size) {
+    size_t h = 0;
+    while (h < m_levels.size() && m_levels[h].size() < m_capacities[h])
+      h++;
+    if (h == m_levels.size())
+      return; // Cannot happen, as the sizes add up to more than the capacities
+    compact(h);
+  }
+}
+
+void QuantileSketch::compact(int level) {
+
+  if (level + 1 >= int(m_levels.size()))
+    resize_levels(level + 2);
+
+  std::vector<double> & vals = m_levels[level];
+  std::sort(vals.begin(), vals.end());
+
+  // With an odd number of values the smallest stays in place. Of the
+  // rest, keep alternately the ones at even and odd positions.
+  size_t start  = vals.size() % 2;
+  size_t offset = m_num_compactions % 2;
+  m_num_compactions++;
+
+  std::vector<double> & next = m_levels[level + 1];
+  for (size_t it = start + offset; it < vals.size(); it += 2)
+    next.push_back(vals[it]);
+
+  size_t num_moved = (vals.size() - start) / 2;
+  vals.resize(start);
+  m_num_retained -= num_moved;
+}
+
+double QuantileSketch::stddev() const {
+  if (m_count == 0)
+    return 0.0;
+  return sqrt(m_m2 / m_count);
+}
+
+size_t QuantileSketch::num_retained() const {
+  return m_num_retained;
+}
+
+void QuantileSketch::sorted_values(std::vector<double> & vals,
+                                   std::vector<double> & cum_weights) const {
+
+  std::vector<std::pair<double, double>> pairs;
+  pairs.reserve(m_num_retained);
+  double weight = 1.0;
+  for (size_t h = 0; h < m_levels.size(); h++) {
+    for (size_t it = 0; it < m_levels[h].size(); it++)
+      pairs.push_back(std::make_pair(m_levels[h][it], weight));
+    weight *= 2.0;
+  }
+  std::sort(pairs.begin(), pairs.end());
+
+  vals.resize(pairs.size());
+  cum_weights.resize(pairs.size());
+  double cum = 0.0;
+  for (size_t it = 0; it < pairs.size(); it++) {
+    cum += pairs[it].second;
+    vals[it]        = pairs[it].first;
+    cum_weights[it] = cum;
+  }
+}
+
+double QuantileSketch::value_at_rank(double rank) const {
+
+  if (m_count == 0)
+    return 0.0;
+
+  rank = std::max(0.0, std::min(rank, double(m_count) - 1.0));
+  std::vector<double> vals, cum_weights;
+  sorted_values(vals, cum_weights);
+
+  // The first value whose cumulative weight is more than the rank
+  size_t pos = std::upper_bound(cum_weights.begin(), cum_weights.end(), rank)
+    - cum_weights.begin();
+  pos = std::min(pos, vals.size() - 1);
+  return vals[pos];
+}
+
+double QuantileSketch::quantile(double p) const {
+  if (m_count == 0)
+    return 0.0;
+  p = std::max(0.0, std::min(1.0, p));
+  return value_at_rank(round((m_count - 1) * p));
+}
+
+double QuantileSketch::mean_of_smallest(double num) const {
+
+  if (num <= 0.0 || m_count == 0)
+    return 0.0;
+  if (num >= m_count)
+    return m_mean;
+
+  std::vector<double> vals, cum_weights;
+  sorted_values(vals, cum_weights);
+
+  double sum = 0.0, prev = 0.0;
+  for (size_t it = 0; it < vals.size(); it++) {
+    double weight = std::min(cum_weights[it], num) - prev;
+    sum += weight * vals[it];
+    prev += weight;
+    if (prev >= num)
+      break;
+  }
+
+  return sum / num;
+}
+
+} // end namespace asp
@@ -0,0 +1,98 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file QuantileSketch.h
+///
+/// Find percentiles of a stream of values in bounded memory.
+
+#ifndef __ASP_CORE_QUANTILE_SKETCH_H__
+#define __ASP_CORE_QUANTILE_SKETCH_H__
+
+#include <cstddef>
+#include <vector>
+
+namespace asp {
+
+  /// A KLL quantile sketch. The values are kept in levels, with the
+  /// values at level h standing for 2^h input values each. When the
+  /// sketch is full, a level is sorted and every other value in it
+  /// is moved to the level above. The memory use is about 3*k
+  /// values, and the rank error of a percentile is about 2/k of the
+  /// number of values. Until more than k values are added, all
+  /// percentiles are exact.
+  ///
+  /// The values left after a compaction alternate between the odd
+  /// and even ones, rather than being picked at random, so the
+  /// results are repeatable. Sketches built from parts of the data,
+  /// such as in different threads, can be merged. The count, min,
+  /// max, mean, and standard deviation are always exact.
+  class QuantileSketch {
+  public:
+    QuantileSketch(int k = 4096);
+
+    void add(double val);
+
+    /// Add the values of another sketch. Merging the sketches from
+    /// several threads in a fixed order gives repeatable results.
+    void merge(QuantileSketch const& other);
+
+    size_t size () const { return m_count; }
+    bool   empty() const { return m_count == 0; }
+    double min  () const { return m_min; }
+    double max  () const { return m_max; }
+    double mean () const { return m_mean; }
+
+    /// The population standard deviation
+    double stddev() const;
+
+    /// The value which would be at the given (0-based) position if
+    /// all values were sorted. The rank is clamped to [0, size() - 1].
+    double value_at_rank(double rank) const;
+
+    /// The value at position round((size() - 1) * p) in the sorted
+    /// values, with 0 <= p <= 1. Returns 0 if there are no values.
+    double quantile(double p) const;
+
+    /// The mean of the smallest num values
+    double mean_of_smallest(double num) const;
+
+    /// The number of values stored, for testing
+    size_t num_retained() const;
+
+  private:
+    int    m_k;
+    size_t m_count, m_num_retained;
+    double m_min, m_max, m_mean, m_m2; // m_m2 is the sum of squared deviations
+    unsigned int m_num_compactions;
+    std::vector<std::vector<double>> m_levels;
+    std::vector<size_t> m_capacities; // the number of values each level can hold
+    size_t m_max_size;                // the sum of the capacities
+
+    // Set the number of levels and update the capacities
+    void resize_levels(size_t num_levels);
+    void compress();
+    void compact(int level);
+
+    // The retained values, sorted, and the sum of their weights up to
+    // and including each one.
+    void sorted_values(std::vector<double> & vals, std::vector<double> & cum_weights) const;
+  };
+
+} // end namespace asp
+
+#endif // __ASP_CORE_QUANTILE_SKETCH_H__
@@ -0,0 +1,96 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Log.h>
+#include <asp/Core/SharedTileCache.h>
+#include <asp/Core/FileUtils.h>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <sstream>
+
+namespace fs = boost::filesystem;
+using namespace vw;
+
+namespace asp {
+
+std::string shared_tile_cache_prefix(std::string const& cache_dir,
+                                     std::string const& image_file,
+                                     int pixel_format, int channel_type) {
+
+  boost::system::error_code ec;
+  fs::create_directories(cache_dir, ec);
+  if (!fs::is_directory(cache_dir))
+    vw_throw(ArgumentErr() << "Could not create the shared tile cache directory: "
+             << cache_dir << ".\n");
+
+  std::ostringstream os;
+  os << file_cache_key(image_file) << "_" << pixel_format << "_" << channel_type;
+  return (fs::path(cache_dir) / os.str()).string();
+}
+
+std::string shared_tile_cache_file(std::string const& prefix, Vector2i const& corner) {
+  std::ostringstream os;
+  os << prefix << "_" << corner.x() << "_" << corner.y() << ".raw";
+  return os.str();
+}
+
+bool read_shared_tile(std::string const& cache_file, void * data, size_t num_bytes) {
+
+  boost::system::error_code ec;
+  boost::uintmax_t file_size = fs::file_size(cache_file, ec);
+  if (ec || file_size != num_bytes)
+    return false;
+
+  std::ifstream ifs(cache_file.c_str(), std::ios::binary);
+  if (!ifs.read(static_cast<char*>(data), num_bytes))
+    return false;
+
+  return true;
+}
+
+void write_shared_tile(std::string const& cache_file, const void * data, size_t num_bytes) {
+
+  // Leave a tenth of the space free for the processes using the cache
+  fs::path cache_dir = fs::path(cache_file).parent_path();
+  boost::system::error_code ec;
+  fs::space_info space = fs::space(cache_dir, ec);
+  if (ec || space.available < num_bytes + space.capacity / 10)
+    return;
+
+  // A unique name, as other threads and processes may be writing the
+  // same block at the same time.
+  fs::path tmp_file = cache_dir / fs::unique_path(fs::path(cache_file).filename().string()
+                                                  + ".tmp-%%%%-%%%%-%%%%");
+  std::ofstream ofs(tmp_file.string().c_str(), std::ios::binary);
+  ofs.write(static_cast<const char*>(data), num_bytes);
+  ofs.close();
+  if (!ofs) {
+    fs::remove(tmp_file, ec);
+    vw_out(DebugMessage, "asp") << "Could not write " << tmp_file.string() << ".\n";
+    return;
+  }
+
+  fs::rename(tmp_file, cache_file, ec);
+  if (ec)
+    fs::remove(tmp_file, ec);
+}
+
+} // end namespace asp
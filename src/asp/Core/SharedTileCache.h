@@ -0,0 +1,147 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file SharedTileCache.h
+///
+/// A cache of decoded image blocks shared by all processes on a
+/// machine. The blocks are stored as raw pixel data in a directory,
+/// which should be in memory, such as under /dev/shm. The first
+/// process needing a block decodes it from the image file and saves
+/// it, and the other processes read it back rather than decoding the
+/// image again. The cache files are named after the image path, its
+/// size and modification time, the pixel type, and the block, so a
+/// changed image is never read from stale cache files.
+
+#ifndef __ASP_CORE_SHARED_TILE_CACHE_H__
+#define __ASP_CORE_SHARED_TILE_CACHE_H__
+
+#include <vw/Core/Exception.h>
+#include <vw/Math/BBox.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelTypeInfo.h>
+#include <vw/FileIO/DiskImageView.h>
+
+#include <string>
+
+namespace asp {
+
+  /// The start of the names of the cache files for an image. Creates
+  /// the cache directory if needed.
+  std::string shared_tile_cache_prefix(std::string const& cache_dir,
+                                       std::string const& image_file,
+                                       int pixel_format, int channel_type);
+
+  /// The cache file for the block of an image starting at this corner
+  std::string shared_tile_cache_file(std::string const& prefix, vw::Vector2i const& corner);
+
+  /// Read a cached block into the given buffer. Return false if the
+  /// block is not in the cache.
+  bool read_shared_tile(std::string const& cache_file, void * data, size_t num_bytes);
+
+  /// Save a block to the cache. It is written to a temporary file
+  /// which is then renamed, so other processes never see a partially
+  /// written block. Nothing is saved if the cache directory is almost
+  /// full, or if writing fails, as the cache is only a speedup.
+  void write_shared_tile(std::string const& cache_file, const void * data, size_t num_bytes);
+
+  /// An image on disk whose pixels are read in blocks through the
+  /// shared cache.
+  template <class PixelT>
+  class SharedTileCacheView: public vw::ImageViewBase<SharedTileCacheView<PixelT>> {
+    vw::DiskImageView<PixelT> m_image;
+    std::string m_prefix;
+    int m_block_size;
+
+  public:
+    typedef PixelT pixel_type;
+    typedef PixelT result_type;
+    typedef vw::ProceduralPixelAccessor<SharedTileCacheView> pixel_accessor;
+
+    SharedTileCacheView(std::string const& image_file, std::string const& cache_dir,
+                        int block_size = 512):
+      m_image(image_file), m_block_size(block_size) {
+      m_prefix = shared_tile_cache_prefix(cache_dir, image_file,
+                                          vw::PixelFormatID<PixelT>::value,
+                                          vw::ChannelTypeID<typename vw::PixelChannelType
+                                          <PixelT>::type>::value);
+    }
+
+    inline vw::int32 cols  () const { return m_image.cols(); }
+    inline vw::int32 rows  () const { return m_image.rows(); }
+    inline vw::int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this, 0, 0); }
+
+    inline pixel_type operator()(double/*i*/, double/*j*/, vw::int32/*p*/ = 0) const {
+      vw::vw_throw(vw::NoImplErr()
+                   << "SharedTileCacheView::operator()(...) is not implemented");
+      return pixel_type();
+    }
+
+    typedef vw::CropView<vw::ImageView<pixel_type>> prerasterize_type;
+    inline prerasterize_type prerasterize(vw::BBox2i const& bbox) const {
+
+      vw::ImageView<pixel_type> tile(bbox.width(), bbox.height());
+
+      // Assemble the tile from the blocks of the grid overlapping it
+      int bx0 = bbox.min().x() / m_block_size, bx1 = (bbox.max().x() - 1) / m_block_size;
+      int by0 = bbox.min().y() / m_block_size, by1 = (bbox.max().y() - 1) / m_block_size;
+      for (int by = by0; by <= by1; by++) {
+        for (int bx = bx0; bx <= bx1; bx++) {
+          vw::BBox2i block(bx * m_block_size, by * m_block_size, m_block_size, m_block_size);
+          block.crop(vw::bounding_box(m_image));
+
+          vw::ImageView<pixel_type> block_data(block.width(), block.height());
+          size_t num_bytes = sizeof(pixel_type) * size_t(block.width()) * block.height();
+          std::string cache_file = shared_tile_cache_file(m_prefix, block.min());
+          if (!read_shared_tile(cache_file, block_data.data(), num_bytes)) {
+            block_data = crop(m_image, block);
+            write_shared_tile(cache_file, block_data.data(), num_bytes);
+          }
+
+          vw::BBox2i common = block;
+          common.crop(bbox);
+          crop(tile, common - bbox.min()) = crop(block_data, common - block.min());
+        }
+      }
+
+      return prerasterize_type(tile, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+    }
+
+    template <class DestT>
+    inline void rasterize(DestT const& dest, vw::BBox2i const& bbox) const {
+      vw::rasterize(prerasterize(bbox), dest, bbox);
+    }
+  };
+
+  /// Open an image on disk. If the cache directory is not empty, its
+  /// pixels are read through the shared cache.
+  template <class PixelT>
+  vw::ImageViewRef<PixelT> open_shared_cached_image(std::string const& image_file,
+                                                    std::string const& cache_dir) {
+    if (cache_dir.empty())
+      return vw::DiskImageView<PixelT>(image_file);
+    return SharedTileCacheView<PixelT>(image_file, cache_dir);
+  }
+
+} // end namespace asp
+
+#endif // __ASP_CORE_SHARED_TILE_CACHE_H__
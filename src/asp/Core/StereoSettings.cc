@@ -99,6 +99,10 @@ namespace asp {
     default_corr_timeout = 900; // in seconds
     
     nodata_value = g_nan_val;
+
+    // Image statistics are computed also by tools which do not parse
+    // stereo.default
+    stats_tile_fraction = 1.0;
   }
 
   // Define our options that are available
@@ -160,6 +164,12 @@ namespace asp {
        "Do not assume a reliable datum exists, such as for potato-shaped bodies.")
       ("skip-image-normalization", po::bool_switch(&global.skip_image_normalization)->default_value(false)->implicit_value(true),
        "Skip the step of normalizing the values of input images and removing nodata-pixels. Create instead symbolic links to original images. This is a speedup option which helps (and works mostly with) mapprojected input images with no alignment.")
+      ("virtual-aligned-images", po::bool_switch(&global.virtual_aligned_images)->default_value(false)->implicit_value(true),
+       "Do not write the normalized and aligned images L.tif and R.tif to disk. Instead, save a small file describing how to create them from the input images, and create the needed regions of them in later stereo steps. Works with the alignment methods affineepipolar, homography, and none.")
+      ("stats-tile-fraction", po::value(&global.stats_tile_fraction)->default_value(1.0),
+       "Compute the image statistics using only about this fraction of the image tiles, picked uniformly over the image. Must be positive and at most 1.")
+      ("shared-tile-cache-dir", po::value(&global.shared_tile_cache_dir)->default_value(""),
+       "Save the decoded blocks of the aligned images, masks, and disparities read by the stereo steps in this directory, and read them from there when needed again, including by other processes. It should be in memory and local to the machine, such as /dev/shm/asp_cache.")
       ("force-reuse-match-files", po::bool_switch(&global.force_reuse_match_files)->default_value(false)->implicit_value(true),
        "Force reusing the match files even if older than the images or cameras.")
       ("part-of-multiview-run", po::bool_switch(&global.part_of_multiview_run)->default_value(false)->implicit_value(true),
@@ -191,6 +201,8 @@ namespace asp {
        "Turn on atmospheric refraction correction for Optical Bar and non-ISIS linescan cameras. This option impairs the convergence of bundle adjustment.")
       ("dg-use-csm", po::bool_switch(&global.dg_use_csm)->default_value(false)->implicit_value(true),
        "Use the CSM model with DigitalGlobe linescan cameras (-t dg). No corrections are done for velocity aberration or atmospheric refraction.")
+      ("dg-interpolation-tables", po::bool_switch(&global.dg_interpolation_tables)->default_value(false)->implicit_value(true),
+       "With DigitalGlobe linescan cameras (-t dg), resample the camera positions, velocities, and orientations onto tables which are faster to evaluate, with the error checked to be negligible. Not used with --dg-use-csm.")
 
       // For bathymetry correction
       ("left-bathy-mask", po::value(&global.left_bathy_mask),
@@ -305,6 +317,8 @@ namespace asp {
   "Subpixel algorithm. [0 None, 1 Parabola, 2 Bayes EM, 3 Affine, 4 Phase Correlation 5 LK, 6 Bayes EM w/gamma, 7 SGM None 8 SGM Linear, 9 SGM Poly4, 10 SGM Cos, 11 SGM Parabola 12 SGM Blend]")
       ("subpix-from-blend",   po::bool_switch(&global.subpix_from_blend)->default_value(false)->implicit_value(true),
                               "For the input to subpixel, use the -B.tif file instead of the -D.tif file.")
+      ("blend-all-tiles",     po::bool_switch(&global.blend_all_tiles)->default_value(false)->implicit_value(true),
+                              "In stereo_blend, blend all tiles of a parallel_stereo run, reading each tile once, rather than only the current tile.")
       ("subpixel-kernel",     po::value(&global.subpixel_kernel)->default_value(Vector2i(35,35), "35 35"),
                               "Kernel size used for subpixel method.")
       ("disable-h-subpixel",  po::bool_switch(&global.disable_h_subpixel)->default_value(false)->implicit_value(true),
@@ -426,6 +440,12 @@ namespace asp {
        "Skip computing the piecewise adjustments for jitter, they should have been done by now.")
       ("use-least-squares",                 po::bool_switch(&global.use_least_squares)->default_value(false)->implicit_value(true),
        "Use rigorous least squares triangulation process. This is slow for ISIS processes.")      
+      ("ray-grid-spacing", po::value(&global.ray_grid_spacing)->default_value(0),
+       "If positive, for each triangulation tile sample the camera centers and ray directions on a grid with this spacing, in pixels, and interpolate them, instead of invoking the camera model for every pixel. Where the interpolation error exceeds the bounds set by --ray-grid-max-pixel-error and --ray-grid-max-center-error, the exact camera is used. Not applicable with bathymetry correction.")
+      ("ray-grid-max-pixel-error", po::value(&global.ray_grid_max_pixel_error)->default_value(0.01),
+       "When interpolating camera rays on a grid, the maximum allowed error in ray direction, measured in units of the angle between rays through adjacent pixels.")
+      ("ray-grid-max-center-error", po::value(&global.ray_grid_max_center_error)->default_value(0.01),
+       "When interpolating camera rays on a grid, the maximum allowed distance, in meters, between the interpolated camera center and the exact ray.")
       ;
   }
 
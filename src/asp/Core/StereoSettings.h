@@ -132,6 +132,9 @@ namespace asp {
     bool   skip_rough_homography;           ///< Use this if datum-based rough homography fails. 
     bool   no_datum;                        ///< Do not assume a reliable datum exists
     bool   skip_image_normalization;        ///< Skip the step of normalizing the values of input images and removing nodata-pixels. Create instead symbolic links to original images.
+    bool   virtual_aligned_images;          ///< Do not write L.tif and R.tif, create them on the fly when needed
+    double stats_tile_fraction;             ///< The fraction of image tiles to read when computing image statistics
+    std::string shared_tile_cache_dir;      ///< Share the decoded blocks of the intermediate images between processes via this directory
     bool   force_reuse_match_files;         ///< Force reusing the match files even if older than the images or cameras
     bool   part_of_multiview_run;           ///< If this run is part of a larger multiview run
     std::string datum;                      ///< The datum to use with RPC camera models
@@ -148,6 +151,7 @@ namespace asp {
     int disparity_range_expansion_percent; ///< Expand the estimated disparity range by this percentage before computing the stereo correlation with local alignment
 
     bool dg_use_csm; // Use the CSM camera model with Digital Globe images.
+    bool dg_interpolation_tables; // Faster position and pose interpolation for Digital Globe
     
     // Correlation options
     
@@ -203,6 +207,7 @@ namespace asp {
     // Subpixel options
 
     bool subpix_from_blend;           // Read from -B.tif instead of -D.tif
+    bool blend_all_tiles;             // Blend all parallel_stereo tiles in one process
     
     vw::uint16 subpixel_mode;         // 0 = none
                                       // 1 = parabola fitting
@@ -268,6 +273,9 @@ namespace asp {
     double min_triangulation_angle;           // min angle for valid triangulation
     double max_valid_triangulation_error;
     bool   use_least_squares;                 // Use a more rigorous triangulation
+    int    ray_grid_spacing;                  // Interpolate camera rays on a grid with this spacing
+    double ray_grid_max_pixel_error;          // Max ray direction error, in pixels, when interpolating
+    double ray_grid_max_center_error;         // Max camera center error, in meters, when interpolating
     bool   save_double_precision_point_cloud; // Save final point cloud in double precision rather than bringing the points closer to origin and saving as float (marginally more precision at 2x the storage).
     double point_cloud_rounding_error;        // How much to round the output point cloud values
     bool   compute_point_cloud_center_only;   // Only compute the center of triangulated point cloud and exit.
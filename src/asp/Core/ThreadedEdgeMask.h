@@ -18,19 +18,97 @@
 #include <vw/Core/System.h>
 #include <vw/Core/ThreadPool.h>
 #include <vw/Image/MaskViews.h>
-#include <boost/foreach.hpp>
+#include <vw/Core/Thread.h>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_array.hpp>
+
+#include <algorithm>
+#include <vector>
 
 #ifndef __ASP_CORE_THREADEDEDGEMASK_H__
 #define __ASP_CORE_THREADEDEDGEMASK_H__
 
 namespace asp {
 
-  /// Quick way to check which pixels are inside the valid input mask??
+  namespace edge_mask_private {
+
+    // The pixels of a row are compared with the mask value in chunks of
+    // this many, with no early exit inside a chunk, so the compiler can
+    // vectorize the comparisons.
+    const int CHUNK_SIZE = 16;
+
+    /// The index of the first pixel in the row not equal to the mask
+    /// value, or len if there is none.
+    template <class PixelT>
+    vw::int32 first_valid(const PixelT* row, vw::int32 len, PixelT const& mask_value) {
+      vw::int32 i = 0;
+      for (; i + CHUNK_SIZE <= len; i += CHUNK_SIZE) {
+        bool all_masked = true;
+        for (int k = 0; k < CHUNK_SIZE; k++)
+          all_masked &= (row[i + k] == mask_value);
+        if (!all_masked)
+          break;
+      }
+      for (; i < len; i++)
+        if (!(row[i] == mask_value))
+          return i;
+      return len;
+    }
+
+    /// The index of the last pixel in the row not equal to the mask
+    /// value, or -1 if there is none.
+    template <class PixelT>
+    vw::int32 last_valid(const PixelT* row, vw::int32 len, PixelT const& mask_value) {
+      vw::int32 i = len;
+      for (; i - CHUNK_SIZE >= 0; i -= CHUNK_SIZE) {
+        bool all_masked = true;
+        for (int k = 1; k <= CHUNK_SIZE; k++)
+          all_masked &= (row[i - k] == mask_value);
+        if (!all_masked)
+          break;
+      }
+      for (i = i - 1; i >= 0; i--)
+        if (!(row[i] == mask_value))
+          return i;
+      return -1;
+    }
+
+    /// What is known about the blocks of the image, shared by the tasks,
+    /// so a block found to have no valid pixels is not read again.
+    class BlockStates {
+    public:
+      enum State {UNKNOWN = 0, EMPTY = 1, NONEMPTY = 2};
+      BlockStates(int num_x, int num_y): m_num_x(num_x), m_states(num_x * num_y, UNKNOWN) {}
+      State get(int bx, int by) const {
+        vw::Mutex::Lock lock(m_mutex);
+        return State(m_states[by * m_num_x + bx]);
+      }
+      void set(int bx, int by, State state) {
+        vw::Mutex::Lock lock(m_mutex);
+        m_states[by * m_num_x + bx] = state;
+      }
+    private:
+      int m_num_x;
+      std::vector<vw::uint8> m_states;
+      mutable vw::Mutex m_mutex;
+    };
+
+  } // end namespace edge_mask_private
+
+  /// Mask the pixels outside of the region bounded by the outermost
+  /// valid pixels along each row and column. The image is processed in
+  /// bands of blocks, each band from both ends inwards, stopping as
+  /// soon as the outermost valid pixels of the band are found. Hence,
+  /// the blocks in the interior of the valid region are never read.
   template <class ViewT>
   class ThreadedEdgeMaskView : public vw::ImageViewBase<ThreadedEdgeMaskView<ViewT> > {
 
     ViewT m_view;
 
+    // For each row, the column before the first valid pixel, and the
+    // column after the last one. Similarly for each column. Rows and
+    // columns with no valid pixels have the left and top values past
+    // the image, and the right and bottom values at zero.
     typedef boost::shared_array<vw::int32> SharedArray;
     SharedArray m_left, m_right, m_top, m_bottom;
 
@@ -42,122 +120,139 @@ namespace asp {
         return false;
     }
 
-    // Task that checks individual blocks for edges
+    typedef typename ViewT::pixel_type raw_pixel_type;
+    typedef typename boost::remove_cv<typename boost::remove_reference<raw_pixel_type>::type>::type
+      value_type;
+
+    // Find the edges of a band of rows, or of columns, of blocks. The
+    // band has one block along one direction, and all blocks along the
+    // other one.
     class EdgeMaskTask : public vw::Task, private boost::noncopyable {
-      ViewT m_view;
-      typename ViewT::pixel_type m_mask_value;
-      vw::BBox2i m_bbox;   // Region of image we're working in
-      typedef std::vector<vw::int32> Array;
-      typedef boost::shared_array<vw::int32> SharedArray;
-      SharedArray g_left, g_right, g_top, g_bottom;
-      Array       m_left, m_right, m_top, m_bottom;
-      // This how much we increment after we test a pixel. Set to 1 if
-      // you wish to test every pixel.
-      const vw::int32 STEP_SIZE;
-    public:
-      EdgeMaskTask(ViewT const& view,
-                   typename ViewT::pixel_type mask_value,
-                   vw::int32 search_step,
-                   vw::BBox2i bbox, SharedArray left, SharedArray right,
-                   SharedArray top, SharedArray bottom ) :
-        m_view(view), m_mask_value(mask_value), m_bbox(bbox), 
-        g_left(left), g_right(right), g_top(top), g_bottom(bottom), 
-        m_left( m_bbox.height() ), m_right( m_bbox.height() ), 
-        m_top( m_bbox.width() ), m_bottom( m_bbox.width() ), STEP_SIZE(search_step) {
-
-        std::fill( m_left.begin  (), m_left.end  (), -1 );
-        std::fill( m_right.begin (), m_right.end (), -1 );
-        std::fill( m_top.begin   (), m_top.end   (), -1 );
-        std::fill( m_bottom.begin(), m_bottom.end(), -1 );
+      ViewT                      m_view;
+      value_type                 m_mask_value;
+      std::vector<vw::BBox2i>    m_blocks;   // the blocks of the band, in order
+      std::vector<vw::Vector2i>  m_indices;  // the position of each block in the grid
+      bool                       m_is_row_band;
+      edge_mask_private::BlockStates & m_states;
+      SharedArray                m_lo, m_hi; // left/right, or top/bottom
+
+      // The last block which was read, which may be needed again when
+      // scanning from the other end.
+      int                       m_cached_index;
+      vw::ImageView<value_type> m_cached_block;
+
+      // Read a block, unless it is known to have no valid pixels.
+      // Return false in that case.
+      bool read_block(int b) {
+        vw::Vector2i const& index = m_indices[b];
+        if (m_states.get(index.x(), index.y()) == edge_mask_private::BlockStates::EMPTY)
+          return false;
+        if (m_cached_index != b) {
+          m_cached_block = vw::crop(m_view, m_blocks[b]);
+          m_cached_index = b;
+        }
+        return true;
       }
 
-      void operator()() {
-        using namespace vw;
-
-        // Rasterizing local tile
-        ImageView<typename ViewT::pixel_type> copy( crop(m_view, m_bbox ) );
-
-        { // Detecting Edges
-          // Search left and right side
-          for ( int32 j = 0; j < copy.rows(); ++j ) { // Loop up through the rows in the local tile
-            int32 i = 0;
-            while ( i < copy.cols() && copy(i,j) == m_mask_value ) // Move from left to right in row by STEP_SIZE
-              i += STEP_SIZE;                                      //    until we hit an invalid pixel
-            if ( i > 0 ) i -= STEP_SIZE;                           // Walk back one step if we are not at col 0
-            while ( i < copy.cols() && copy(i,j) == m_mask_value ) // Now do the same thing but in steps of 1
-              ++i;
-            if ( i > 0 ) --i;
-            // Early exit condition if entire row was nodata
-            if ( i == copy.cols() -1 )
-              continue; // We're keeping left and right as -1
-            m_left[j] = i;                                         // Now we have the left-most valid column in the row
-
-            i = copy.cols() - 1;                                   // Do the same thing going right to left
-            while ( i >= 0 && copy(i,j) == m_mask_value )
-              i -= STEP_SIZE;
-            if ( i < copy.cols() - 1 )
-              i += STEP_SIZE;
-            while ( i >= 0 && copy(i,j) == m_mask_value )
-              --i;
-            if ( i < copy.cols() - 1 )
-              ++i;
-            m_right[j] = i;
-          }
-                                                                   // Now find the first valid rows from the bottom
-          for ( int32 i = 0; i < copy.cols(); ++i ) {
-            int32 j = 0;
-            while ( j < copy.rows() && copy(i,j) == m_mask_value )
-              j += STEP_SIZE;
-            if ( j > 0 )
-              j -= STEP_SIZE;
-            while ( j < copy.rows() && copy(i,j) == m_mask_value )
-              ++j;
-            if ( j > 0 )
-              --j;
-            // Early exit condition if entire column was nodata
-            if ( j == copy.rows() - 1 )
-              continue; // We're keeping top and bottom as -1
-            m_top[i] = j;
-
-            j = copy.rows()-1;                                     // And the first valid rows from the top
-            while ( j >= 0 && copy(i,j) == m_mask_value )
-              j -= STEP_SIZE;
-            if ( j < copy.rows()-1 )
-              j += STEP_SIZE;
-            while ( j >= 0 && copy(i,j) == m_mask_value )
-              --j;
-            if ( j < copy.rows()-1 )
-              ++j;
-            m_bottom[i] = j;
+      void mark_block(int b, bool found_valid) {
+        m_states.set(m_indices[b].x(), m_indices[b].y(),
+                     found_valid ? edge_mask_private::BlockStates::NONEMPTY
+                     : edge_mask_private::BlockStates::EMPTY);
+      }
+
+      // Find, for the rows of a row band, the first (or last) valid pixel
+      void scan_rows(bool from_start) {
+        using namespace edge_mask_private;
+        vw::BBox2i const& band = m_blocks[0];
+        int num_left = band.height(); // the rows not resolved yet
+        std::vector<bool> done(band.height(), false);
+        int num_blocks = m_blocks.size();
+        for (int k = 0; k < num_blocks && num_left > 0; k++) {
+          int b = from_start ? k : num_blocks - 1 - k;
+          if (!read_block(b))
+            continue;
+          vw::BBox2i const& box = m_blocks[b];
+          bool found_valid = false;
+          for (vw::int32 r = 0; r < box.height(); r++) {
+            const value_type* row = &m_cached_block(0, r);
+            vw::int32 i = from_start ? first_valid(row, box.width(), m_mask_value)
+                                     : last_valid (row, box.width(), m_mask_value);
+            if (i < 0 || i >= box.width())
+              continue;
+            found_valid = true;
+            if (done[r])
+              continue;
+            done[r] = true;
+            num_left--;
+            vw::int32 j = box.min().y() + r;
+            if (from_start)
+              m_lo[j] = box.min().x() + i - 1;
+            else
+              m_hi[j] = box.min().x() + i + 1;
           }
+          mark_block(b, found_valid);
         }
+      }
 
-        { // Merging result back into global perspective
-          int32 l = 0;
-          for ( int32 j = m_bbox.min()[1];                      // Loop through rows
-                j < m_bbox.max()[1]; j++ ) {
-            if ( m_left[l] == -1 ) {                            // Skip rows with no pixels
-              l++; continue;
+      // Find, for the columns of a column band, the first (or last)
+      // valid pixel. Rows are traversed rather than columns, to access
+      // the memory in order.
+      void scan_cols(bool from_start) {
+        using namespace edge_mask_private;
+        vw::BBox2i const& band = m_blocks[0];
+        int num_left = band.width(); // the columns not resolved yet
+        std::vector<bool> done(band.width(), false);
+        int num_blocks = m_blocks.size();
+        for (int k = 0; k < num_blocks && num_left > 0; k++) {
+          int b = from_start ? k : num_blocks - 1 - k;
+          if (!read_block(b))
+            continue;
+          vw::BBox2i const& box = m_blocks[b];
+          bool found_valid = false;
+          for (vw::int32 s = 0; s < box.height() && num_left > 0; s++) {
+            vw::int32 r = from_start ? s : box.height() - 1 - s;
+            const value_type* row = &m_cached_block(0, r);
+            vw::int32 i = first_valid(row, box.width(), m_mask_value);
+            if (i >= box.width())
+              continue; // all masked
+            found_valid = true;
+            vw::int32 j = box.min().y() + r;
+            for (; i < box.width(); i++) {
+              if (done[i] || row[i] == m_mask_value)
+                continue;
+              done[i] = true;
+              num_left--;
+              if (from_start)
+                m_lo[box.min().x() + i] = j - 1;
+              else
+                m_hi[box.min().x() + i] = j + 1;
             }
-            g_left[j] = std::min( m_left[l] + m_bbox.min()[0],  // Add in the bounding box column
-                                  g_left[j] );
-            g_right[j] = std::max( m_right[l] + m_bbox.min()[0],
-                                   g_right[j] );
-            l++;
           }
+          // If the scan stopped early the block has valid pixels, and
+          // otherwise found_valid tells if it does.
+          mark_block(b, found_valid);
+        }
+      }
 
-          l = 0;
-          for ( int32 i = m_bbox.min()[0];                       // Loop through columns
-                i < m_bbox.max()[0]; i++ ) {
-            if ( m_top[l] == -1 ) {                              // Skip columns with no pixels
-              l++; continue;
-            }
-            g_top[i] = std::min( m_top[l] + m_bbox.min()[1],     // Add in the bounding box row
-                                 g_top[i] );
-            g_bottom[i] = std::max( m_bottom[l] + m_bbox.min()[1],
-                                    g_bottom[i] );
-            l++;
-          }
+    public:
+      EdgeMaskTask(ViewT const& view, value_type const& mask_value,
+                   std::vector<vw::BBox2i> const& blocks,
+                   std::vector<vw::Vector2i> const& indices, bool is_row_band,
+                   edge_mask_private::BlockStates & states,
+                   SharedArray lo, SharedArray hi):
+        m_view(view), m_mask_value(mask_value), m_blocks(blocks), m_indices(indices),
+        m_is_row_band(is_row_band), m_states(states), m_lo(lo), m_hi(hi),
+        m_cached_index(-1) {}
+
+      void operator()() {
+        if (m_blocks.empty())
+          return;
+        if (m_is_row_band) {
+          scan_rows(true);
+          scan_rows(false);
+        } else {
+          scan_cols(true);
+          scan_cols(false);
         }
       }
     };
@@ -213,27 +308,36 @@ namespace asp {
       std::fill( m_top.get(),    m_top.get   ()+view.cols(), view.rows() );
       std::fill( m_bottom.get(), m_bottom.get()+view.cols(), 0           );
 
-      // Calculating edges in parallel
-      FifoWorkQueue queue( vw_settings().default_num_threads() );
-
-      std::vector<BBox2i> bboxes = subdivide_bbox( m_view, block_size, block_size );
-
-      // Figure out an ideal search step size. Smaller means we're
-      // more likely to catch small features. Bigger step size means
-      // will move a lot faster.
-      int32 search_step = norm_2(Vector2i(m_view.cols(),m_view.rows())) / 500;
-      if (search_step < 1 )
-        search_step = 1;
-      if ( search_step > 10 ) 
-        search_step = 10;
-      VW_OUT(DebugMessage, "threadededgemask") << "Setting search step to "
-                                               << search_step << std::endl;
+      // The grid of blocks
+      int num_x = (view.cols() + block_size - 1) / block_size;
+      int num_y = (view.rows() + block_size - 1) / block_size;
+      edge_mask_private::BlockStates states(num_x, num_y);
+      std::vector<std::vector<BBox2i>> row_bands(num_y), col_bands(num_x);
+      std::vector<std::vector<Vector2i>> row_indices(num_y), col_indices(num_x);
+      for (int by = 0; by < num_y; by++) {
+        for (int bx = 0; bx < num_x; bx++) {
+          BBox2i box(bx * block_size, by * block_size, block_size, block_size);
+          box.crop(bounding_box(m_view));
+          row_bands[by].push_back(box);
+          row_indices[by].push_back(Vector2i(bx, by));
+          col_bands[bx].push_back(box);
+          col_indices[bx].push_back(Vector2i(bx, by));
+        }
+      }
 
       // Find the outermost valid pixel coming in from each line/direction.
-      BOOST_FOREACH( BBox2i const& box, bboxes ) {
-        VW_OUT(DebugMessage, "threadededgemask") << "Created EdgeMaskTask for " << box << std::endl;
-        boost::shared_ptr<EdgeMaskTask> task(new EdgeMaskTask(m_view, mask_value, search_step, box, 
-                                                              m_left, m_right, m_top, m_bottom ) );
+      // The bands of rows and columns are processed in parallel.
+      FifoWorkQueue queue( vw_settings().default_num_threads() );
+      for (int by = 0; by < num_y; by++) {
+        boost::shared_ptr<EdgeMaskTask>
+          task(new EdgeMaskTask(m_view, mask_value, row_bands[by], row_indices[by],
+                                true, states, m_left, m_right));
+        queue.add_task(task);
+      }
+      for (int bx = 0; bx < num_x; bx++) {
+        boost::shared_ptr<EdgeMaskTask>
+          task(new EdgeMaskTask(m_view, mask_value, col_bands[bx], col_indices[bx],
+                                false, states, m_top, m_bottom));
         queue.add_task(task);
       }
       queue.join_all(); // Wait for all tasks to complete
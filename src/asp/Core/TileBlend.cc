@@ -0,0 +1,149 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <asp/Core/TileBlend.h>
+#include <vw/Image/Manipulation.h>
+
+using namespace vw;
+
+namespace asp {
+
+void init_blend(BBox2i const& roi, ImageView<BlendPixType> & output_image,
+                BlendWeightsType & output_weights) {
+
+  output_image.set_size(roi.width(), roi.height());
+  for (int col = 0; col < output_image.cols(); col++) {
+    for (int row = 0; row < output_image.rows(); row++) {
+      output_image(col, row) = BlendPixType();
+      output_image(col, row).invalidate();
+    }
+  }
+
+  output_weights.set_size(roi.width(), roi.height());
+  for (int col = 0; col < output_weights.cols(); col++) {
+    for (int row = 0; row < output_weights.rows(); row++) {
+      output_weights(col, row) = 0.0;
+    }
+  }
+}
+
+void accumulate_blend(ImageView<BlendPixType> const& image, BlendWeightsType const& weights,
+                      BBox2i const& padded_box, BBox2i const& roi,
+                      ImageView<BlendPixType> & output_image, BlendWeightsType & output_weights) {
+
+  BBox2i overlap = roi;
+  overlap.crop(padded_box);
+  for (int col = overlap.min().x(); col < overlap.max().x(); col++) {
+    for (int row = overlap.min().y(); row < overlap.max().y(); row++) {
+
+      // Convert the pixel to the coordinate systems of the padded tile and of the region
+      int in_col  = col - padded_box.min().x(), in_row  = row - padded_box.min().y();
+      int out_col = col - roi.min().x(),        out_row = row - roi.min().y();
+
+      if (!is_valid(image(in_col, in_row)) || weights(in_col, in_row) <= 0.0)
+        continue; // No useful info
+
+      output_image(out_col, out_row).validate();
+      output_image(out_col, out_row)   += weights(in_col, in_row) * image(in_col, in_row);
+      output_weights(out_col, out_row) += weights(in_col, in_row);
+    }
+  }
+}
+
+void normalize_blend(ImageView<BlendPixType> & output_image,
+                     BlendWeightsType const& output_weights) {
+  for (int col = 0; col < output_image.cols(); col++) {
+    for (int row = 0; row < output_image.rows(); row++) {
+
+      if (!is_valid(output_image(col, row)))
+        continue;
+
+      if (output_weights(col, row) <= 0) {
+        output_image(col, row).invalidate();
+        continue;
+      }
+
+      output_image(col, row) /= output_weights(col, row);
+    }
+  }
+}
+
+bool invalid_image(ImageView<BlendPixType> const& image) {
+  for (int col = 0; col < image.cols(); col++) {
+    for (int row = 0; row < image.rows(); row++) {
+      if (is_valid(image(col, row))) {
+        // Found a valid pixel
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+void build_blend_graph(std::vector<BlendTilePtr> & tiles,
+                       std::map<int, std::vector<int>> & rows) {
+
+  rows.clear();
+  for (size_t i = 0; i < tiles.size(); i++)
+    rows[tiles[i]->roi.min().y()].push_back(i);
+
+  // Only the rows of tiles overlapping a padded tile are searched
+  for (size_t i = 0; i < tiles.size(); i++) {
+    BlendTile & tile = *tiles[i];
+    for (auto row = rows.begin(); row != rows.end(); row++) {
+      BBox2i const& row_roi = tiles[row->second[0]]->roi;
+      if (row_roi.max().y() <= tile.padded_roi.min().y() ||
+          row_roi.min().y() >= tile.padded_roi.max().y())
+        continue;
+      for (size_t j = 0; j < row->second.size(); j++) {
+        BlendTile & target = *tiles[row->second[j]];
+        if (!tile.padded_roi.intersects(target.roi))
+          continue;
+        tile.targets.push_back(row->second[j]);
+        target.num_pending++;
+      }
+    }
+  }
+}
+
+void add_to_blends(std::vector<BlendTilePtr> & tiles, int index,
+                   ImageView<BlendPixType> const& image, BlendWeightsType const& weights) {
+
+  BlendTile & tile = *tiles[index];
+  for (size_t it = 0; it < tile.targets.size(); it++) {
+    BlendTile & target = *tiles[tile.targets[it]];
+    Mutex::Lock lock(target.mutex);
+    if (target.blend.cols() == 0)
+      init_blend(target.roi, target.blend, target.blend_weights);
+    if (tile.targets[it] == index)
+      target.has_valid = !invalid_image(crop(image, tile.roi - tile.padded_roi.min()));
+    accumulate_blend(image, weights, tile.padded_roi, target.roi,
+                     target.blend, target.blend_weights);
+    target.num_pending--;
+  }
+}
+
+void finish_blend(BlendTile & tile) {
+  if (tile.has_valid)
+    normalize_blend(tile.blend, tile.blend_weights);
+  else
+    init_blend(tile.roi, tile.blend, tile.blend_weights);
+}
+
+} // end namespace asp
@@ -0,0 +1,105 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file TileBlend.h
+///
+/// Blend the disparities of overlapping padded tiles, as produced by
+/// parallel_stereo, using their weights. Each tile is blended either
+/// by itself, from the padded tiles overlapping it, or together with
+/// all other tiles, when each padded tile is added to the blends of
+/// all tiles it overlaps.
+
+#ifndef __ASP_CORE_TILE_BLEND_H__
+#define __ASP_CORE_TILE_BLEND_H__
+
+#include <vw/Core/Thread.h>
+#include <vw/Math/BBox.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelMask.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace asp {
+
+  typedef vw::ImageView<double> BlendWeightsType;
+  typedef vw::PixelMask<vw::Vector2f> BlendPixType;
+
+  /// Start the blended image of a region as invalid and zero, and its
+  /// weights as zero. These will be used to accumulate the weighted
+  /// disparities.
+  void init_blend(vw::BBox2i const& roi, vw::ImageView<BlendPixType> & output_image,
+                  BlendWeightsType & output_weights);
+
+  /// Add the weighted pixels of a padded tile to the blended image of a
+  /// region. Padded tiles can overlap only partially with the region, so
+  /// only the overlap is visited.
+  void accumulate_blend(vw::ImageView<BlendPixType> const& image,
+                        BlendWeightsType const& weights,
+                        vw::BBox2i const& padded_box, vw::BBox2i const& roi,
+                        vw::ImageView<BlendPixType> & output_image,
+                        BlendWeightsType & output_weights);
+
+  /// Divide the accumulated disparities by the accumulated weights
+  void normalize_blend(vw::ImageView<BlendPixType> & output_image,
+                       BlendWeightsType const& output_weights);
+
+  /// See if a given image has only invalid pixels
+  bool invalid_image(vw::ImageView<BlendPixType> const& image);
+
+  /// A tile, when blending all tiles at once
+  struct BlendTile {
+    vw::BBox2i  roi, padded_roi;
+    std::string in_path, out_path;
+    std::vector<int> targets; // the tiles whose regions of interest overlap this padded tile
+    int         num_pending;  // the tiles yet to be added to the blend of this one
+    bool        has_valid;    // if this tile has valid pixels in its region of interest
+    bool        done;
+    vw::ImageView<BlendPixType> blend;
+    BlendWeightsType blend_weights;
+    vw::Mutex   mutex;
+    BlendTile(): num_pending(0), has_valid(false), done(false) {}
+  };
+
+  typedef boost::shared_ptr<BlendTile> BlendTilePtr;
+
+  /// Find the tiles whose regions of interest overlap each padded
+  /// tile, and the number of padded tiles overlapping each tile. Also
+  /// return the indices of the tiles in each row of tiles, keyed by
+  /// the starting row of the tiles.
+  void build_blend_graph(std::vector<BlendTilePtr> & tiles,
+                         std::map<int, std::vector<int>> & rows);
+
+  /// Add a padded tile, with the given pixels and weights, to the
+  /// blends of the tiles it overlaps. Can be called in parallel for
+  /// different tiles.
+  void add_to_blends(std::vector<BlendTilePtr> & tiles, int index,
+                     vw::ImageView<BlendPixType> const& image,
+                     BlendWeightsType const& weights);
+
+  /// Once all padded tiles overlapping a tile were added, divide its
+  /// blend by the weights. If the tile has no valid pixels in its
+  /// region of interest, its blend is made invalid.
+  void finish_blend(BlendTile & tile);
+
+} // end namespace asp
+
+#endif // __ASP_CORE_TILE_BLEND_H__
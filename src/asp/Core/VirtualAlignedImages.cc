@@ -0,0 +1,250 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Image/MaskViews.h>
+#include <vw/Image/Transform.h>
+#include <vw/Image/Algorithms.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/FileIO/DiskImageView.h>
+#include <vw/FileIO/DiskImageUtils.h>
+#include <vw/Cartography/GeoReference.h>
+#include <vw/Cartography/GeoReferenceUtils.h>
+
+#include <asp/Core/VirtualAlignedImages.h>
+#include <asp/Core/SharedTileCache.h>
+#include <asp/Core/StereoSettings.h>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+
+namespace fs = boost::filesystem;
+using namespace vw;
+
+namespace asp {
+
+VirtualAlignedImages::VirtualAlignedImages():
+  left_nodata(std::numeric_limits<float>::quiet_NaN()),
+  right_nodata(std::numeric_limits<float>::quiet_NaN()),
+  has_alignment(false), crop_right_to_left(false) {
+  left_align.set_identity();
+  right_align.set_identity();
+}
+
+void VirtualAlignedImages::write(std::string const& file) const {
+
+  std::ofstream ofs(file.c_str());
+  if (!ofs.good())
+    vw_throw(ArgumentErr() << "Cannot write: " << file << "\n");
+
+  // Use absolute paths so that the file can be used from any directory
+  ofs << std::setprecision(17);
+  ofs << "left_image "         << fs::absolute(left_image).string()  << "\n";
+  ofs << "right_image "        << fs::absolute(right_image).string() << "\n";
+  ofs << "left_nodata "        << left_nodata  << "\n";
+  ofs << "right_nodata "       << right_nodata << "\n";
+  ofs << "left_range "         << left_range[0]  << " " << left_range[1]  << "\n";
+  ofs << "right_range "        << right_range[0] << " " << right_range[1] << "\n";
+  ofs << "has_alignment "      << has_alignment << "\n";
+  ofs << "left_align";
+  for (int row = 0; row < 3; row++)
+    for (int col = 0; col < 3; col++)
+      ofs << " " << left_align(row, col);
+  ofs << "\n";
+  ofs << "right_align";
+  for (int row = 0; row < 3; row++)
+    for (int col = 0; col < 3; col++)
+      ofs << " " << right_align(row, col);
+  ofs << "\n";
+  ofs << "left_size "          << left_size[0]  << " " << left_size[1]  << "\n";
+  ofs << "right_size "         << right_size[0] << " " << right_size[1] << "\n";
+  ofs << "crop_right_to_left " << crop_right_to_left << "\n";
+  ofs.close();
+}
+
+void VirtualAlignedImages::read(std::string const& file) {
+
+  std::ifstream ifs(file.c_str());
+  if (!ifs.good())
+    vw_throw(ArgumentErr() << "Cannot read: " << file << "\n");
+
+  // The values are read as text first, as nan is not parsed by streams
+  std::string line;
+  int num_read = 0;
+  while (std::getline(ifs, line)) {
+    std::istringstream is(line);
+    std::string key;
+    if (!(is >> key))
+      continue;
+
+    bool good = true;
+    if (key == "left_image" || key == "right_image") {
+      std::string val;
+      std::getline(is >> std::ws, val);
+      if (key == "left_image") left_image = val; else right_image = val;
+      good = !val.empty();
+    } else if (key == "left_nodata" || key == "right_nodata") {
+      std::string val;
+      good = static_cast<bool>(is >> val);
+      float nodata = atof(val.c_str());
+      if (key == "left_nodata") left_nodata = nodata; else right_nodata = nodata;
+    } else if (key == "left_range") {
+      good = static_cast<bool>(is >> left_range[0] >> left_range[1]);
+    } else if (key == "right_range") {
+      good = static_cast<bool>(is >> right_range[0] >> right_range[1]);
+    } else if (key == "has_alignment") {
+      good = static_cast<bool>(is >> has_alignment);
+    } else if (key == "left_align" || key == "right_align") {
+      Matrix3x3 & align = (key == "left_align") ? left_align : right_align;
+      for (int row = 0; row < 3; row++)
+        for (int col = 0; col < 3; col++)
+          good = good && static_cast<bool>(is >> align(row, col));
+    } else if (key == "left_size") {
+      good = static_cast<bool>(is >> left_size[0] >> left_size[1]);
+    } else if (key == "right_size") {
+      good = static_cast<bool>(is >> right_size[0] >> right_size[1]);
+    } else if (key == "crop_right_to_left") {
+      good = static_cast<bool>(is >> crop_right_to_left);
+    } else {
+      continue; // Ignore unknown keys
+    }
+
+    if (!good)
+      vw_throw(ArgumentErr() << "Could not parse line: '" << line << "' in: " << file << "\n");
+    num_read++;
+  }
+
+  if (num_read != 13)
+    vw_throw(ArgumentErr() << "Incomplete file: " << file << "\n");
+}
+
+void VirtualAlignedImages::create_images(ImageViewRef<PixelGray<float>> & left,
+                                         ImageViewRef<PixelGray<float>> & right) const {
+
+  // This must be kept in sync with StereoSession::preprocessing_hook().
+  ImageViewRef<PixelMask<float>> Limg
+    = create_mask_less_or_equal(DiskImageView<float>(left_image),  left_nodata);
+  ImageViewRef<PixelMask<float>> Rimg
+    = create_mask_less_or_equal(DiskImageView<float>(right_image), right_nodata);
+
+  if (has_alignment) {
+    Limg = transform(Limg, HomographyTransform(left_align),
+                     left_size.x(), left_size.y());
+    Rimg = transform(Rimg, HomographyTransform(right_align),
+                     right_size.x(), right_size.y());
+  }
+
+  Limg = normalize(Limg, left_range[0],  left_range[1],  0.0, 1.0);
+  Rimg = normalize(Rimg, right_range[0], right_range[1], 0.0, 1.0);
+
+  if (crop_right_to_left) {
+    PixelMask<float> nodata_pix(0); nodata_pix.invalidate();
+    ValueEdgeExtension<PixelMask<float>> ext_nodata(nodata_pix);
+    Rimg = crop(edge_extend(Rimg, ext_nodata), bounding_box(Limg));
+  }
+
+  // Cache the computed tiles, as the same regions are usually
+  // requested repeatedly, such as by image pyramids in correlation.
+  int ts = vw_settings().default_tile_size();
+  left  = block_cache(pixel_cast<PixelGray<float>>(apply_mask(Limg, ALIGNED_IMAGE_NODATA)),
+                      Vector2i(ts, ts), 0);
+  right = block_cache(pixel_cast<PixelGray<float>>(apply_mask(Rimg, ALIGNED_IMAGE_NODATA)),
+                      Vector2i(ts, ts), 0);
+}
+
+std::string virtual_aligned_images_file(std::string const& out_prefix) {
+  return out_prefix + "-LR-virtual.txt";
+}
+
+bool has_virtual_aligned_images(std::string const& out_prefix) {
+  return fs::exists(virtual_aligned_images_file(out_prefix));
+}
+
+void open_aligned_images(std::string const& out_prefix,
+                         ImageViewRef<PixelGray<float>> & left_image,
+                         ImageViewRef<PixelGray<float>> & right_image) {
+
+  if (has_virtual_aligned_images(out_prefix)) {
+    VirtualAlignedImages images;
+    images.read(virtual_aligned_images_file(out_prefix));
+    images.create_images(left_image, right_image);
+    return;
+  }
+
+  std::string cache_dir = stereo_settings().shared_tile_cache_dir;
+  left_image  = open_shared_cached_image<PixelGray<float>>(out_prefix + "-L.tif", cache_dir);
+  right_image = open_shared_cached_image<PixelGray<float>>(out_prefix + "-R.tif", cache_dir);
+}
+
+bool read_aligned_image_size(std::string const& out_prefix, std::string const& side,
+                             Vector2i & size) {
+
+  if (has_virtual_aligned_images(out_prefix)) {
+    VirtualAlignedImages images;
+    images.read(virtual_aligned_images_file(out_prefix));
+    if (side == "L" || images.crop_right_to_left)
+      size = images.has_alignment ? images.left_size : file_image_size(images.left_image);
+    else
+      size = images.has_alignment ? images.right_size : file_image_size(images.right_image);
+    return true;
+  }
+
+  std::string image_file = out_prefix + "-" + side + ".tif";
+  if (!fs::exists(image_file))
+    return false;
+  size = file_image_size(image_file);
+  return true;
+}
+
+bool read_aligned_image_nodata(std::string const& out_prefix, std::string const& side,
+                               float & nodata) {
+
+  if (has_virtual_aligned_images(out_prefix)) {
+    nodata = ALIGNED_IMAGE_NODATA;
+    return true;
+  }
+
+  return vw::read_nodata_val(out_prefix + "-" + side + ".tif", nodata);
+}
+
+bool read_aligned_image_georef(std::string const& out_prefix, std::string const& side,
+                               vw::cartography::GeoReference & georef) {
+
+  if (has_virtual_aligned_images(out_prefix)) {
+    // If any alignment happens, the georef is not valid, and
+    // without alignment no cropping of the right image is done.
+    VirtualAlignedImages images;
+    images.read(virtual_aligned_images_file(out_prefix));
+    if (images.has_alignment)
+      return false;
+    if (side == "L")
+      return vw::cartography::read_georeference(georef, images.left_image);
+    return vw::cartography::read_georeference(georef, images.right_image);
+  }
+
+  return vw::cartography::read_georeference(georef, out_prefix + "-" + side + ".tif");
+}
+
+} // end namespace asp
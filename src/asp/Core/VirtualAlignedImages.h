@@ -0,0 +1,103 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file VirtualAlignedImages.h
+///
+/// Support for not writing the normalized and aligned images L.tif
+/// and R.tif in stereo_pprc. Instead, a small file is saved
+/// describing how to create these from the input images, and the
+/// regions of them needed by later stereo steps are created on demand.
+/// The functions here work the same way whether the aligned images
+/// were written to disk or not.
+
+#ifndef __ASP_CORE_VIRTUAL_ALIGNED_IMAGES_H__
+#define __ASP_CORE_VIRTUAL_ALIGNED_IMAGES_H__
+
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/PixelTypes.h>
+
+#include <string>
+
+namespace vw {
+  namespace cartography {
+    class GeoReference;
+  }
+}
+
+namespace asp {
+
+  /// The nodata value of the normalized aligned images. It must be
+  /// negative, as these images are scaled to around [0, 1].
+  const float ALIGNED_IMAGE_NODATA = -32768.0;
+
+  /// How to create L.tif and R.tif from the (possibly cropped) input
+  /// images. The inputs are masked with their nodata values, aligned
+  /// with the given homographies, and the pixel values in the given
+  /// ranges are mapped to [0, 1].
+  struct VirtualAlignedImages {
+    std::string   left_image, right_image;
+    float         left_nodata, right_nodata;
+    vw::Vector2   left_range, right_range;
+    bool          has_alignment;
+    vw::Matrix3x3 left_align, right_align;
+    vw::Vector2i  left_size, right_size;
+
+    /// If true, R.tif is cropped to the extent of L.tif
+    bool crop_right_to_left;
+
+    VirtualAlignedImages();
+
+    void write(std::string const& file) const;
+    void read (std::string const& file);
+
+    /// Create the images. Their pixels are computed when needed, and
+    /// the computed tiles are cached.
+    void create_images(vw::ImageViewRef<vw::PixelGray<float>> & left,
+                       vw::ImageViewRef<vw::PixelGray<float>> & right) const;
+  };
+
+  /// The file describing the aligned images, if they are not on disk
+  std::string virtual_aligned_images_file(std::string const& out_prefix);
+
+  /// If the aligned images are not on disk, but created on the fly
+  bool has_virtual_aligned_images(std::string const& out_prefix);
+
+  /// Open L.tif and R.tif, or create them on the fly if they were not
+  /// written to disk. Throws if neither can be done.
+  void open_aligned_images(std::string const& out_prefix,
+                           vw::ImageViewRef<vw::PixelGray<float>> & left_image,
+                           vw::ImageViewRef<vw::PixelGray<float>> & right_image);
+
+  /// Find the size of L.tif or R.tif, with side being "L" or "R".
+  /// Return false if these images were not created yet.
+  bool read_aligned_image_size(std::string const& out_prefix, std::string const& side,
+                               vw::Vector2i & size);
+
+  /// Read the nodata value of L.tif or R.tif. Return false if there is none.
+  bool read_aligned_image_nodata(std::string const& out_prefix, std::string const& side,
+                                 float & nodata);
+
+  /// Read the georeference of L.tif or R.tif. Return false if there is none.
+  bool read_aligned_image_georef(std::string const& out_prefix, std::string const& side,
+                                 vw::cartography::GeoReference & georef);
+
+} // end namespace asp
+
+#endif // __ASP_CORE_VIRTUAL_ALIGNED_IMAGES_H__
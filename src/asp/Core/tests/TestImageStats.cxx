@@ -0,0 +1,90 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+#include <asp/Core/ImageStats.h>
+#include <vw/FileIO/MatrixIO.h>
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace asp;
+
+TEST(ImageStats, tiles) {
+
+  Vector2i size(1000, 700);
+  std::vector<BBox2i> all_tiles = stats_tiles(size, 256, 1.0);
+  ASSERT_EQ(all_tiles.size(), 4u * 3u);
+  int area = 0;
+  for (size_t it = 0; it < all_tiles.size(); it++)
+    area += all_tiles[it].area();
+  EXPECT_EQ(area, size.x() * size.y());
+
+  // One tile in each group of 2 x 2 tiles, the same every time
+  std::vector<BBox2i> tiles1 = stats_tiles(size, 256, 0.25);
+  std::vector<BBox2i> tiles2 = stats_tiles(size, 256, 0.25);
+  ASSERT_EQ(tiles1.size(), 2u * 2u);
+  for (size_t it = 0; it < tiles1.size(); it++) {
+    EXPECT_EQ(tiles1[it], tiles2[it]);
+    EXPECT_TRUE(BBox2i(0, 0, size.x(), size.y()).contains(tiles1[it]));
+  }
+
+  EXPECT_EQ(stats_sample_rate(all_tiles, size.x() * size.y()), 1);
+  EXPECT_EQ(stats_sample_rate(all_tiles, size.x() * size.y() / 8.9), 3);
+}
+
+TEST(ImageStats, samples) {
+
+  // The values 0, ..., 99, with the invalid pixels skipped
+  ImageView<PixelMask<float>> img(10, 12);
+  for (int row = 0; row < img.rows(); row++) {
+    for (int col = 0; col < img.cols(); col++) {
+      img(col, row) = PixelMask<float>(row * img.cols() + col);
+      if (row >= 10)
+        img(col, row).invalidate();
+    }
+  }
+
+  std::vector<float> samples;
+  int rate = gather_stats_samples(img, 4, 1.0, img.cols() * img.rows(), samples);
+  EXPECT_EQ(rate, 1);
+  ASSERT_EQ(samples.size(), 100u);
+
+  Vector<float32,6> stats = stats_from_samples(samples);
+  EXPECT_NEAR(stats[0], 0.0,  1e-6);
+  EXPECT_NEAR(stats[1], 99.0, 1e-6);
+  EXPECT_NEAR(stats[2], 49.5, 1e-5);
+  EXPECT_NEAR(stats[3], sqrt((100.0 * 100.0 - 1.0) / 12.0), 1e-4);
+  EXPECT_NEAR(stats[4], 0.02 * 99.0, 1e-5);
+  EXPECT_NEAR(stats[5], 0.98 * 99.0, 1e-5);
+}
+
+TEST(ImageStats, cache) {
+
+  UnlinkName cache_file("image_stats_cache-stats.tif");
+  Vector<float32,6> stats(1, 2, 3, 4, 5, 6), read_stats;
+  write_cached_stats(cache_file, stats, 0.25);
+
+  ASSERT_TRUE(read_cached_stats(cache_file, 0.25, read_stats));
+  EXPECT_VECTOR_NEAR(stats, read_stats, 1e-12);
+
+  // The stats are not reused for a different fraction of the tiles
+  EXPECT_FALSE(read_cached_stats(cache_file, 1.0, read_stats));
+
+  // Nor if saved without the fraction
+  Vector<float32> old_stats = stats;
+  write_vector(cache_file, old_stats);
+  EXPECT_FALSE(read_cached_stats(cache_file, 1.0, read_stats));
+}
@@ -0,0 +1,90 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <test/Helpers.h>
+#include <vw/Image/ImageView.h>
+#include <asp/Core/MedianFilter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace vw;
+using namespace asp;
+
+TEST( MedianFilter, brute_force ) {
+
+  // Compare with sorting each window, with some pixels set to nodata
+  float nodata = -32768.0;
+  int cols = 37, rows = 23, kernel_size = 9, half = kernel_size/2;
+  ImageView<float> img(cols, rows);
+  for (int row = 0; row < rows; row++) {
+    for (int col = 0; col < cols; col++) {
+      if ((col * 7 + row * 3) % 11 == 0)
+        img(col, row) = nodata;
+      else
+        img(col, row) = sin(0.3 * col + 0.01 * row * row) * 100.0 + 0.001 * col;
+    }
+  }
+
+  ImageView<float> out;
+  fast_median_filter(img, nodata, kernel_size, true, out);
+  ASSERT_EQ(out.cols(), cols);
+  ASSERT_EQ(out.rows(), rows);
+
+  for (int row = 0; row < rows; row++) {
+    for (int col = 0; col < cols; col++) {
+
+      if (img(col, row) == nodata) {
+        EXPECT_EQ(out(col, row), nodata);
+        continue;
+      }
+
+      std::vector<float> vals;
+      for (int r = std::max(row - half, 0); r <= std::min(row + half, rows - 1); r++) {
+        for (int c = std::max(col - half, 0); c <= std::min(col + half, cols - 1); c++) {
+          if (img(c, r) != nodata)
+            vals.push_back(img(c, r));
+        }
+      }
+      std::sort(vals.begin(), vals.end());
+      int n = vals.size();
+      float median = (n % 2 == 1) ? vals[n/2] : (vals[n/2 - 1] + vals[n/2]) / 2.0f;
+      EXPECT_EQ(out(col, row), median);
+    }
+  }
+}
+
+TEST( MedianFilter, disparity ) {
+
+  ImageView<PixelMask<Vector2f>> disp(5, 5), out;
+  for (int row = 0; row < 5; row++)
+    for (int col = 0; col < 5; col++)
+      disp(col, row) = PixelMask<Vector2f>(Vector2f(col, -row));
+
+  // An outlier gets replaced, and an invalid pixel stays invalid. The
+  // invalid pixel is outside the window of the outlier, so the median
+  // there is of an odd number of values.
+  disp(2, 2) = PixelMask<Vector2f>(Vector2f(1000, 1000));
+  disp(0, 0).invalidate();
+  disparity_median_filter(disp, 3, out);
+
+  EXPECT_TRUE(is_valid(out(2, 2)));
+  EXPECT_VECTOR_NEAR(out(2, 2).child(), Vector2f(2, -2), 1e-6);
+  EXPECT_FALSE(is_valid(out(0, 0)));
+}
@@ -0,0 +1,145 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+#include <asp/Core/PointCloudCollection.h>
+#include <vw/Cartography/Datum.h>
+#include <vw/FileIO/DiskImageView.h>
+#include <vw/FileIO/DiskImageUtils.h>
+#include <vw/Image/ImageView.h>
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace asp;
+
+TEST(PointCloudCollection, index_and_read) {
+
+  // A cloud with points only in its upper-left corner
+  cartography::Datum datum("WGS84");
+  ImageView<Vector3> cloud(300, 200);
+  for (int row = 0; row < cloud.rows(); row++) {
+    for (int col = 0; col < cloud.cols(); col++) {
+      if (col < 50 && row < 40)
+        cloud(col, row) = datum.geodetic_to_cartesian(Vector3(10.0 + col * 1e-4,
+                                                              20.0 + row * 1e-4, 100.0));
+    }
+  }
+  UnlinkName cloud_name("pcc_cloud.tif"), pcc_name("pcc_test.pcc");
+  write_image(cloud_name, cloud);
+
+  PointCloudCollection collection;
+  collection.members.resize(2);
+  index_point_cloud(cloud_name, 128, collection.members[0]);
+  index_point_cloud(cloud_name, 128, collection.members[1]);
+
+  // Of the 3 x 2 blocks only the first one has points
+  ASSERT_EQ(collection.members[0].blocks.size(), 1u);
+  PointCloudBlock const& block = collection.members[0].blocks[0];
+  EXPECT_EQ(block.pixel_box, BBox2i(0, 0, 128, 128));
+  EXPECT_EQ(block.num_points, 50 * 40);
+  EXPECT_EQ(collection.num_points(), 2 * 50 * 40);
+
+  collection.write(pcc_name);
+  PointCloudCollection collection2;
+  collection2.read(pcc_name);
+  ASSERT_EQ(collection2.members.size(), 2u);
+  EXPECT_EQ(collection2.members[1].size, Vector2i(300, 200));
+  ASSERT_EQ(collection2.members[1].blocks.size(), 1u);
+  EXPECT_EQ(collection2.members[1].blocks[0].pixel_box, block.pixel_box);
+  EXPECT_VECTOR_NEAR(collection2.members[1].blocks[0].point_box.min(),
+                     block.point_box.min(), 1e-6);
+
+  std::vector<std::string> files;
+  files.push_back(pcc_name);
+  files.push_back("other.tif");
+  files = expand_point_cloud_collections(files);
+  ASSERT_EQ(files.size(), 3u);
+  EXPECT_EQ(files[2], "other.tif");
+  EXPECT_TRUE(is_point_cloud_collection(pcc_name));
+  EXPECT_FALSE(is_point_cloud_collection(cloud_name));
+
+  // The lon-lat box of the block contains all its points
+  BBox2 lonlat_box = point_box_to_lonlat_box(block.point_box, datum);
+  for (int row = 0; row < 40; row++) {
+    for (int col = 0; col < 50; col++) {
+      Vector3 llh = datum.cartesian_to_geodetic(cloud(col, row));
+      EXPECT_TRUE(lonlat_box.contains(subvector(llh, 0, 2)));
+    }
+  }
+  EXPECT_LT(lonlat_box.width(),  0.1);
+  EXPECT_LT(lonlat_box.height(), 0.1);
+}
+
+TEST(PointCloudCollection, lonlat_box) {
+
+  cartography::Datum datum("WGS84");
+
+  // A box around the 180 degree meridian spans all longitudes
+  BBox3 box;
+  box.grow(datum.geodetic_to_cartesian(Vector3(179.0, -5.0, 0.0)));
+  box.grow(datum.geodetic_to_cartesian(Vector3(-179.0, 5.0, 0.0)));
+  BBox2 lonlat_box = point_box_to_lonlat_box(box, datum);
+  EXPECT_NEAR(lonlat_box.min().x(), -180.0, 1e-6);
+  EXPECT_NEAR(lonlat_box.max().x(),  180.0, 1e-6);
+  EXPECT_LT(lonlat_box.min().y(), -5.0);
+  EXPECT_GT(lonlat_box.max().y(),  5.0);
+  EXPECT_LT(lonlat_box.height(), 10.5);
+}
+
+TEST(PointCloudCollection, index_view) {
+
+  // A cloud with an error channel and points only in its left half
+  ImageView<Vector4> cloud(200, 300);
+  for (int row = 0; row < cloud.rows(); row++) {
+    for (int col = 0; col < cloud.cols(); col++) {
+      if (col < 100)
+        cloud(col, row) = Vector4(1e6 + col, 2e6 + row, 3e6, col);
+    }
+  }
+  UnlinkName cloud_name("pc_index_cloud.tif"), index_name("pc_index_cloud.pcc");
+  write_image(cloud_name, cloud);
+
+  // Rasterize the view by blocks, as when writing it
+  PointCloudIndexer indexer;
+  PointCloudIndexView<ImageView<Vector4>> view = index_point_cloud_view(cloud, &indexer);
+  std::vector<BBox2i> boxes = subdivide_bbox(bounding_box(cloud), 128, 128);
+  for (size_t it = 0; it < boxes.size(); it++) {
+    ImageView<Vector4> tile = crop(view, boxes[it]);
+    for (int row = 0; row < tile.rows(); row++)
+      for (int col = 0; col < tile.cols(); col++)
+        EXPECT_EQ(tile(col, row), cloud(col + boxes[it].min().x(), row + boxes[it].min().y()));
+  }
+  indexer.write(cloud_name, 4, Vector2i(cloud.cols(), cloud.rows()));
+  EXPECT_EQ(point_cloud_index_file(cloud_name), index_name);
+
+  PointCloudMember member;
+  ASSERT_TRUE(read_point_cloud_index(cloud_name, member));
+  ASSERT_EQ(member.blocks.size(), 3u); // only the first column of blocks
+  EXPECT_EQ(member.blocks[0].num_points, 100 * 128);
+  EXPECT_NEAR(member.blocks[0].max_error,  99.0, 1e-12);
+  EXPECT_NEAR(member.blocks[0].mean_error, 49.5, 1e-12);
+  EXPECT_VECTOR_NEAR(member.blocks[0].point_box.min(), Vector3(1e6, 2e6, 3e6), 1e-6);
+
+  // Two such clouds side by side, with some spacing
+  std::vector<std::string> files(2, cloud_name);
+  std::vector<BBox2i> blocks;
+  ASSERT_TRUE(point_cloud_composite_blocks(files, 64, blocks));
+  ASSERT_EQ(blocks.size(), 6u);
+  EXPECT_EQ(blocks[3].min(), Vector2i(320, 0)); // 64 * ceil(200 / 64) + 64
+
+  files.push_back("no_such_cloud.tif");
+  EXPECT_FALSE(point_cloud_composite_blocks(files, 64, blocks));
+}
@@ -0,0 +1,75 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <asp/Core/QuantileSketch.h>
+#include <test/Helpers.h>
+
+#include <algorithm>
+
+using namespace vw;
+using namespace asp;
+
+TEST(QuantileSketch, exact) {
+
+  // With few values the percentiles are exact
+  QuantileSketch sketch(200);
+  std::vector<double> vals;
+  for (int it = 0; it < 200; it++) {
+    double val = (it * 37) % 200;
+    vals.push_back(val);
+    sketch.add(val);
+  }
+  std::sort(vals.begin(), vals.end());
+
+  EXPECT_EQ(sketch.size(), 200u);
+  EXPECT_EQ(sketch.min(), 0.0);
+  EXPECT_EQ(sketch.max(), 199.0);
+  EXPECT_NEAR(sketch.mean(), 99.5, 1e-10);
+  EXPECT_EQ(sketch.quantile(0.25), vals[round(199 * 0.25)]);
+  EXPECT_EQ(sketch.quantile(0.75), vals[round(199 * 0.75)]);
+  EXPECT_EQ(sketch.value_at_rank(100), 100.0);
+  EXPECT_NEAR(sketch.mean_of_smallest(10), 4.5, 1e-10);
+}
+
+TEST(QuantileSketch, approx_and_merge) {
+
+  int num = 1000000;
+  QuantileSketch all(1000), part1(1000), part2(1000);
+  for (int it = 0; it < num; it++) {
+    double val = (double((it * 7919LL) % num) + 0.5) / num; // a permutation of [0, 1]
+    all.add(val);
+    if (it % 3 == 0)
+      part1.add(val);
+    else
+      part2.add(val);
+  }
+  part1.merge(part2);
+
+  // Bounded memory, and small rank errors
+  EXPECT_LT(all.num_retained(),   4000u);
+  EXPECT_LT(part1.num_retained(), 4000u);
+  EXPECT_EQ(part1.size(), all.size());
+  EXPECT_NEAR(part1.mean(), all.mean(), 1e-10);
+  EXPECT_NEAR(part1.stddev(), all.stddev(), 1e-10);
+  for (int it = 1; it < 10; it++) {
+    double p = it / 10.0;
+    EXPECT_NEAR(all.quantile(p),   p, 0.005);
+    EXPECT_NEAR(part1.quantile(p), p, 0.005);
+  }
+  EXPECT_NEAR(all.mean_of_smallest(num/2), 0.25, 0.005);
+}
@@ -0,0 +1,103 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+// Check that parse_residual_file.py converts the binary residual files
+// written by bundle_adjust with --binary-residuals to the same text as
+// is written by default.
+
+#include <test/Helpers.h>
+#include <asp/Core/BundleAdjustUtils.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+using namespace vw;
+using namespace asp;
+
+// The converter, in the source tree
+std::string residual_converter() {
+  return std::string(TEST_SRCDIR) + "/../../Tools/parse_residual_file.py";
+}
+
+std::string read_text_file(std::string const& file) {
+  std::ifstream ifs(file.c_str());
+  std::stringstream buffer;
+  buffer << ifs.rdbuf();
+  return buffer.str();
+}
+
+// Run the converter and return the text it produced
+std::string convert_residual_file(std::string const& bin_file, std::string const& txt_file) {
+  std::string cmd = "python " + residual_converter() + " " + bin_file + " " + txt_file
+    + " > /dev/null";
+  EXPECT_EQ(0, system(cmd.c_str()));
+  return read_text_file(txt_file);
+}
+
+TEST(ResidualFiles, RawPixelsRoundTrip) {
+
+  UnlinkName bin_file("res_test-raw_pixels.bin"), txt_file("res_test-raw_pixels.txt");
+
+  std::vector<std::string> names;
+  names.push_back("left.tsai");
+  names.push_back("right camera.tsai");
+  names.push_back("empty.tsai");
+  std::vector<std::vector<double>> residuals(names.size());
+  for (int i = 0; i < 7; i++) {
+    residuals[0].push_back(0.1 * i - 1.0 / 3.0);
+    residuals[0].push_back(-2.0e-7 * i);
+  }
+  residuals[1].push_back(123456.789);
+  residuals[1].push_back(-1e-300);
+
+  std::string text;
+  {
+    std::ofstream bin(bin_file.c_str(), std::ios::binary);
+    for (size_t c = 0; c < names.size(); c++) {
+      size_t num_pixels = residuals[c].size() / 2;
+      text += raw_pixels_residual_text(names[c], residuals[c].data(), num_pixels);
+      write_raw_pixels_residual_binary(bin, names[c], residuals[c].data(), num_pixels);
+    }
+  }
+
+  EXPECT_EQ(text, convert_residual_file(bin_file, txt_file));
+}
+
+TEST(ResidualFiles, PointMapRoundTrip) {
+
+  UnlinkName bin_file("res_test-pointmap.bin"), txt_file("res_test-pointmap.csv");
+
+  std::string datum = "Geodeticdatum(name=WGS_1984; spheroid=WGS 84; "
+    "semi-major axis=6378137; semi-minor axis=6356752.3142451793; "
+    "meridian=Greenwich at 0; proj4=+proj=longlat +datum=WGS84 +no_defs)";
+
+  std::string text = residual_map_header_text(datum);
+  {
+    std::ofstream bin(bin_file.c_str(), std::ios::binary);
+    write_residual_map_header_binary(bin, datum);
+    for (int i = 0; i < 6; i++) {
+      Vector3 llh(-122.3 + 0.001 * i / 3.0, 37.4 - 1e-9 * i, 10.0 * i - 5.5);
+      double mean_residual = 0.5 + i / 7.0;
+      int num_observations = 2 + i, type = i % 3;
+      text += residual_map_point_text(llh, mean_residual, num_observations, type);
+      write_residual_map_point_binary(bin, llh, mean_residual, num_observations, type);
+    }
+  }
+
+  EXPECT_EQ(text, convert_residual_file(bin_file, txt_file));
+}
@@ -0,0 +1,62 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+#include <asp/Core/SharedTileCache.h>
+#include <vw/FileIO/DiskImageUtils.h>
+#include <vw/Image/ImageView.h>
+#include <test/Helpers.h>
+
+#include <boost/filesystem.hpp>
+
+namespace fs = boost::filesystem;
+using namespace vw;
+using namespace asp;
+
+TEST(SharedTileCache, read_through_cache) {
+
+  ImageView<float> image(300, 200);
+  for (int row = 0; row < image.rows(); row++)
+    for (int col = 0; col < image.cols(); col++)
+      image(col, row) = col + 1000.0 * row;
+
+  UnlinkName image_name("shared_cache_image.tif"), cache_dir("shared_cache_dir");
+  write_image(image_name, image);
+
+  // A tile spanning several blocks of the cache
+  BBox2i box(50, 20, 200, 150);
+  ImageView<float> tile = crop(SharedTileCacheView<float>(image_name, cache_dir, 128), box);
+  EXPECT_EQ(ImageView<float>(crop(image, box)), tile);
+
+  // The 3 x 2 blocks are now in the cache
+  int num_files = 0;
+  for (fs::directory_iterator it(cache_dir.c_str()); it != fs::directory_iterator(); it++)
+    num_files++;
+  EXPECT_EQ(num_files, 6);
+
+  // Another view of the same image reads the cached blocks and not
+  // the image, as shown by changing a cached block.
+  std::string prefix = shared_tile_cache_prefix(cache_dir, image_name,
+                                                PixelFormatID<float>::value,
+                                                ChannelTypeID<float>::value);
+  ImageView<float> block(128, 128);
+  fill(block, -1.0f);
+  write_shared_tile(shared_tile_cache_file(prefix, Vector2i(0, 0)), block.data(),
+                    sizeof(float) * 128 * 128);
+  ImageView<float> tile2 = crop(SharedTileCacheView<float>(image_name, cache_dir, 128), box);
+  EXPECT_EQ(tile2(0, 0), -1.0f);
+  EXPECT_EQ(tile2(100, 100), tile(100, 100));
+}
@@ -24,6 +24,7 @@
 #include <asp/Core/ThreadedEdgeMask.h>
 
 #include <algorithm>
+#include <cstdlib>
 #include <vector>
 
 using namespace vw;
@@ -54,3 +55,27 @@ TEST( ThreadedEdgeMask, active_area ) {
   output = threaded_edge_mask(input,0);
   EXPECT_EQ( input, output );
 }
+
+TEST( ThreadedEdgeMask, multiple_blocks ) {
+  // A diamond-shaped valid region spanning many small blocks, and
+  // touching the image edge on the left.
+  ImageView<uint8> input(100,70);
+  fill(input,0);
+  for ( int32 j = 0; j < input.rows(); j++ ) {
+    int32 half_width = 35 - std::abs(j - 35);
+    for ( int32 i = 0; i < input.cols(); i++ )
+      if ( std::abs(i - 30) <= half_width && i < 60 )
+        input(i,j) = 255;
+  }
+
+  ThreadedEdgeMaskView<ImageView<uint8> > mask = threaded_edge_mask(input,0,0,16);
+  EXPECT_EQ( BBox2i(0,0,60,70), mask.active_area() );
+
+  // With no buffer the region is convex, so nothing valid is masked
+  ImageView<uint8> output = apply_mask(mask);
+  EXPECT_EQ( input, output );
+  EXPECT_TRUE ( is_valid(mask(0,35))  );
+  EXPECT_FALSE( is_valid(mask(60,35)) );
+  EXPECT_TRUE ( is_valid(mask(30,0))  );
+  EXPECT_FALSE( is_valid(mask(29,0))  );
+}
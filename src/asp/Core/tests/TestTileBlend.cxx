@@ -0,0 +1,150 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <test/Helpers.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image/Manipulation.h>
+#include <asp/Core/TileBlend.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace vw;
+using namespace asp;
+
+namespace {
+
+// Add a padded tile to the blends, as stereo_blend does once it is read
+class AddToBlendsTask: public vw::Task {
+  std::vector<BlendTilePtr>                & m_tiles;
+  int                                        m_index;
+  std::vector<ImageView<BlendPixType>> const& m_images;
+  std::vector<BlendWeightsType>        const& m_weights;
+public:
+  AddToBlendsTask(std::vector<BlendTilePtr> & tiles, int index,
+                  std::vector<ImageView<BlendPixType>> const& images,
+                  std::vector<BlendWeightsType> const& weights):
+    m_tiles(tiles), m_index(index), m_images(images), m_weights(weights) {}
+  void operator()() {
+    add_to_blends(m_tiles, m_index, m_images[m_index], m_weights[m_index]);
+  }
+};
+
+} // end anonymous namespace
+
+TEST(TileBlend, AllTilesMatchPerTile) {
+
+  // A grid of tiles, with the last row and column of tiles smaller
+  BBox2i full_box(0, 0, 70, 45);
+  int tile_cols = 25, tile_rows = 15, pad = 6;
+  std::vector<BlendTilePtr> tiles;
+  for (int y = 0; y < full_box.height(); y += tile_rows) {
+    for (int x = 0; x < full_box.width(); x += tile_cols) {
+      BlendTilePtr tile(new BlendTile);
+      tile->roi = BBox2i(x, y, std::min(tile_cols, full_box.width() - x),
+                         std::min(tile_rows, full_box.height() - y));
+      tile->padded_roi = tile->roi;
+      tile->padded_roi.expand(pad);
+      tile->padded_roi.crop(full_box);
+      tiles.push_back(tile);
+    }
+  }
+  int num_tiles = tiles.size();
+  ASSERT_EQ(9, num_tiles);
+
+  // The padded tiles disagree on the overlaps, and have some invalid
+  // pixels. One tile has no valid pixels. The weights decrease towards
+  // the tile boundary.
+  int empty_tile = 5;
+  std::vector<ImageView<BlendPixType>> images(num_tiles);
+  std::vector<BlendWeightsType> weights(num_tiles);
+  for (int t = 0; t < num_tiles; t++) {
+    BBox2i const& box = tiles[t]->padded_roi;
+    images[t].set_size(box.width(), box.height());
+    weights[t].set_size(box.width(), box.height());
+    for (int col = 0; col < box.width(); col++) {
+      for (int row = 0; row < box.height(); row++) {
+        int gcol = col + box.min().x(), grow = row + box.min().y();
+        images[t](col, row) = BlendPixType(Vector2f(gcol + 0.1 * t, grow - 0.2 * t));
+        if (t == empty_tile || (gcol + grow) % 7 == 0)
+          images[t](col, row).invalidate();
+        weights[t](col, row) = std::min(std::min(col + 1, box.width()  - col),
+                                        std::min(row + 1, box.height() - row));
+      }
+    }
+  }
+
+  // Blend each tile by itself, from the padded tiles overlapping it,
+  // starting with the tile itself
+  std::vector<ImageView<BlendPixType>> per_tile(num_tiles);
+  for (int j = 0; j < num_tiles; j++) {
+    BlendTile const& tile = *tiles[j];
+    BlendWeightsType blend_weights;
+    init_blend(tile.roi, per_tile[j], blend_weights);
+    if (invalid_image(crop(images[j], tile.roi - tile.padded_roi.min())))
+      continue;
+    accumulate_blend(images[j], weights[j], tile.padded_roi, tile.roi,
+                     per_tile[j], blend_weights);
+    for (int i = 0; i < num_tiles; i++) {
+      if (i != j && tiles[i]->padded_roi.intersects(tile.roi))
+        accumulate_blend(images[i], weights[i], tiles[i]->padded_roi, tile.roi,
+                         per_tile[j], blend_weights);
+    }
+    normalize_blend(per_tile[j], blend_weights);
+  }
+
+  // Blend all tiles at once, a row of tiles at a time, in parallel
+  std::map<int, std::vector<int>> rows;
+  build_blend_graph(tiles, rows);
+  EXPECT_EQ(3u, rows.size());
+  for (auto row = rows.begin(); row != rows.end(); row++) {
+    FifoWorkQueue queue(4);
+    for (size_t j = 0; j < row->second.size(); j++) {
+      boost::shared_ptr<AddToBlendsTask>
+        task(new AddToBlendsTask(tiles, row->second[j], images, weights));
+      queue.add_task(task);
+    }
+    queue.join_all();
+  }
+
+  int num_valid = 0;
+  for (int j = 0; j < num_tiles; j++) {
+    BlendTile & tile = *tiles[j];
+    EXPECT_EQ(0, tile.num_pending);
+    finish_blend(tile);
+    ASSERT_EQ(per_tile[j].cols(), tile.blend.cols());
+    ASSERT_EQ(per_tile[j].rows(), tile.blend.rows());
+    for (int col = 0; col < tile.blend.cols(); col++) {
+      for (int row = 0; row < tile.blend.rows(); row++) {
+        BlendPixType const& a = per_tile[j](col, row);
+        BlendPixType const& b = tile.blend(col, row);
+        ASSERT_EQ(is_valid(a), is_valid(b));
+        if (!is_valid(a))
+          continue;
+        num_valid++;
+        EXPECT_NEAR(a.child()[0], b.child()[0], 1e-5);
+        EXPECT_NEAR(a.child()[1], b.child()[1], 1e-5);
+      }
+    }
+  }
+
+  // The empty tile stays invalid even where its neighbors are valid
+  EXPECT_TRUE(invalid_image(tiles[empty_tile]->blend));
+  EXPECT_GT(num_valid, 0);
+}
@@ -0,0 +1,88 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <test/Helpers.h>
+#include <asp/Core/VirtualAlignedImages.h>
+
+#include <boost/filesystem.hpp>
+
+#include <cmath>
+#include <fstream>
+
+using namespace vw;
+using namespace asp;
+namespace fs = boost::filesystem;
+
+TEST(VirtualAlignedImages, WriteRead) {
+
+  UnlinkName desc_file("virtual_test-LR-virtual.txt");
+  std::string out_prefix = desc_file.substr(0, desc_file.size() - 15);
+  EXPECT_EQ(std::string(desc_file), virtual_aligned_images_file(out_prefix));
+  EXPECT_FALSE(has_virtual_aligned_images(out_prefix));
+
+  VirtualAlignedImages in;
+  in.left_image    = "left.tif";
+  in.right_image   = "right.tif";
+  in.left_nodata   = -10.5;  // right_nodata stays NaN
+  in.left_range    = Vector2(1.25, 300.5);
+  in.right_range   = Vector2(-2.0, 1.0/3.0);
+  in.has_alignment = true;
+  for (int row = 0; row < 3; row++) {
+    for (int col = 0; col < 3; col++) {
+      in.left_align(row, col)  = row + 0.1 * col;
+      in.right_align(row, col) = 1.0 / (1.0 + row + 3 * col);
+    }
+  }
+  in.left_size          = Vector2i(1000, 2000);
+  in.right_size         = Vector2i(1001, 1999);
+  in.crop_right_to_left = true;
+  in.write(desc_file);
+  EXPECT_TRUE(has_virtual_aligned_images(out_prefix));
+
+  VirtualAlignedImages out;
+  out.read(desc_file);
+  EXPECT_EQ(fs::absolute(in.left_image).string(),  out.left_image);
+  EXPECT_EQ(fs::absolute(in.right_image).string(), out.right_image);
+  EXPECT_EQ(in.left_nodata, out.left_nodata);
+  EXPECT_TRUE(std::isnan(out.right_nodata));
+  EXPECT_VECTOR_NEAR(in.left_range,  out.left_range,  1e-15);
+  EXPECT_VECTOR_NEAR(in.right_range, out.right_range, 1e-15);
+  EXPECT_EQ(in.has_alignment, out.has_alignment);
+  for (int row = 0; row < 3; row++) {
+    for (int col = 0; col < 3; col++) {
+      EXPECT_NEAR(in.left_align(row, col),  out.left_align(row, col),  1e-15);
+      EXPECT_NEAR(in.right_align(row, col), out.right_align(row, col), 1e-15);
+    }
+  }
+  EXPECT_EQ(in.left_size,  out.left_size);
+  EXPECT_EQ(in.right_size, out.right_size);
+  EXPECT_EQ(in.crop_right_to_left, out.crop_right_to_left);
+}
+
+TEST(VirtualAlignedImages, IncompleteFile) {
+
+  UnlinkName desc_file("incomplete-LR-virtual.txt");
+  {
+    std::ofstream ofs(desc_file.c_str());
+    ofs << "left_image left.tif\n";
+    ofs << "right_image right.tif\n";
+  }
+
+  VirtualAlignedImages images;
+  EXPECT_THROW(images.read(desc_file), vw::ArgumentErr);
+}
@@ -52,17 +52,24 @@ ALSC::ALSC(Mat imgL, Mat imgR, CALSCParam paramALSC){
     nSystemMatrixRows = nRowPatch*nColPatch; //4 * nRadius * nRadius + 1 + 4 * nRadius;
     emA = Eigen::MatrixXf(nSystemMatrixRows,nParam);
     emB = Eigen::VectorXf(nSystemMatrixRows);
-
-    pfGx.resize(nRowPatch);
-    for (int i = 0; i < nRowPatch; i++) {
-        pfGx[i].resize(nColPatch);
-    }
-
-    pfGy.resize(nRowPatch);
-    for (int i = 0; i < nRowPatch; i++) {
-        pfGy[i].resize(nColPatch);
+    emAS = Eigen::MatrixXf(nParam,nParam);
+    emATB = Eigen::VectorXf(nParam);
+    emS = Eigen::VectorXf(nParam);
+    emErrors = Eigen::VectorXf(nSystemMatrixRows);
+    if (nParam == 7)
+        emA.col(6).setOnes(); // intensity offset
+
+    matGx = Eigen::MatrixXf::Zero(nRowPatch,nColPatch);
+    matGy = Eigen::MatrixXf::Zero(nRowPatch,nColPatch);
+
+    vecOffsetX = Eigen::VectorXf(nSystemMatrixRows);
+    vecOffsetY = Eigen::VectorXf(nSystemMatrixRows);
+    for (int x = 0; x < nColPatch; x++) {
+        for (int y = 0; y < nRowPatch; y++) {
+            vecOffsetX(x * nRowPatch + y) = x - nPatchRadius;
+            vecOffsetY(x * nRowPatch + y) = y - nPatchRadius;
+        }
     }
-
 }
 
 bool ALSC::isIntersecting(Rect rectA, Rect rectB){
@@ -144,50 +151,31 @@ bool ALSC::doMatching(Point2f ptStartL, Point2f ptStartR, CTiePt& tp, const floa
         getGradientX(matPatchR);
         getGradientY(matPatchR);
 
-        // make a system matrix A for LMS
-        int count = 0;
-        for (int y = 0; y < nRowPatch; y++) {
-
-            int yOffset = y - nPatchRadius;
-
-            for (int x = 0; x < nColPatch; x++) {
-
-                int xOffset = x - nPatchRadius;
-
-                float fVal = pfGx[y][x];
-                emA(count,0) = fVal;
-                emA(count,1) = fVal * xOffset;
-                emA(count,2) = fVal * yOffset;
-
-                fVal = pfGy[y][x];
-                emA(count,3) = fVal;
-                emA(count,4) = fVal * xOffset;
-                emA(count,5) = fVal * yOffset;
-
-                if (nParam == 7) {
-                    emA(count,6)  = 1;
-                }
-
-                emB(count) = matPatchL(y, x) - matPatchR(y, x);
-                count++;
-            }
-        }
+        // make a system matrix A for LMS, one column at a time, with
+        // a row per patch pixel. The intensity offset column is constant.
+        Eigen::Map<const Eigen::VectorXf> vecGx(matGx.data(), nSystemMatrixRows);
+        Eigen::Map<const Eigen::VectorXf> vecGy(matGy.data(), nSystemMatrixRows);
+        emA.col(0) = vecGx;
+        emA.col(1) = vecGx.cwiseProduct(vecOffsetX);
+        emA.col(2) = vecGx.cwiseProduct(vecOffsetY);
+        emA.col(3) = vecGy;
+        emA.col(4) = vecGy.cwiseProduct(vecOffsetX);
+        emA.col(5) = vecGy.cwiseProduct(vecOffsetY);
+        emB = Eigen::Map<const Eigen::VectorXf>(matPatchL.data(), nSystemMatrixRows)
+            - Eigen::Map<const Eigen::VectorXf>(matPatchR.data(), nSystemMatrixRows);
 
         // get LMS solution
-        Eigen::VectorXf emS(nParam);
-        Eigen::MatrixXf emAS(nParam,nParam);
-
         /* Don't explicitly calculate the inverse!  Use Cholesky decomposition instead. */
-        Eigen::MatrixXf emAT = emA.transpose();
-        emAS = (emAT*emA);
-        emS = emAS.llt().solve(emAT*emB);
+        emAS.noalias() = emA.transpose() * emA;
+        emATB.noalias() = emA.transpose() * emB;
+        emS = emAS.llt().solve(emATB);
 
         if (m_paramALSC.m_bIntOffset)
             fIntOffNew = emS(6);
 
         // error computation
-        Eigen::VectorXf emErrors(nSystemMatrixRows);
-        emErrors = (emA * emS) - emB;
+        emErrors.noalias() = emA * emS;
+        emErrors -= emB;
 
         // Compute the standard deviation of residual errors
         double dTotElelement = nSystemMatrixRows; //nRowPatch *nColPatch; //2 * nRadius + 1; //dTotElelement *= dTotElelement;
@@ -306,12 +294,11 @@ void ALSC::getGradientX(Eigen::Ref<Eigen::MatrixXf> matSrc) {
 
     int nW = matSrc.cols();
     int nH = matSrc.rows();
+    if (nW < 3 || nH < 3)
+        return;
 
-    for (int y = 1; y < nH - 1; y++) {
-        for (int x = 1; x < nW - 1; x++) {
-            pfGx.at(y).at(x) = matSrc(y, x+1) - matSrc(y, x);
-        }
-    }
+    matGx.block(1, 1, nH - 2, nW - 2)
+        = matSrc.block(1, 2, nH - 2, nW - 2) - matSrc.block(1, 1, nH - 2, nW - 2);
 
     return;
 }
@@ -320,12 +307,11 @@ void ALSC::getGradientY(Eigen::Ref<Eigen::MatrixXf> matSrc) {
 
     int nW = matSrc.cols();
     int nH = matSrc.rows();
+    if (nW < 3 || nH < 3)
+        return;
 
-    for (int y = 1; y < nH - 1; y++) {
-        for (int x = 1; x < nW - 1; x++) {
-            pfGy.at(y).at(x) = matSrc(y+1, x) - matSrc(y, x);
-        }
-    }
+    matGy.block(1, 1, nH - 2, nW - 2)
+        = matSrc.block(2, 1, nH - 2, nW - 2) - matSrc.block(1, 1, nH - 2, nW - 2);
 
     return;
 }
@@ -363,14 +349,16 @@ void ALSC::distortPatch(const Mat& matImg, const Point2f ptCentre, const float*
     /* Case when we're just cropping an image, don't waste time doing interpolation */
     if(pfAff[0] == 0 && pfAff[1] == 0 && pfAff[2] == 0 && pfAff[3] == 0){
         for (j = 0; j < nH; j++) {
+                dNewY = ptCentre.y + initY + j;
+                bool bRowOut = (dNewY < 0 || dNewY >= matImg.rows);
+                const unsigned char* pRow = bRowOut ? NULL : matImg.ptr<unsigned char>((int)dNewY);
                 for (i = 0; i < nW; i++) {
                     dNewX = ptCentre.x + initX + i;
-                    dNewY = ptCentre.y + initY + j;
 
-                    if(dNewX < 0 || dNewY < 0 || dNewX > matImg.cols || dNewY > matImg.rows)
+                    if(bRowOut || dNewX < 0 || dNewX >= matImg.cols)
                         matImgPatch(j,i) = 0.0;
                     else{
-                        matImgPatch(j,i) = matImg.at<unsigned char>(dNewY, dNewX);
+                        matImgPatch(j,i) = pRow[(int)dNewX];
                     }
                 }
         }
@@ -382,80 +370,59 @@ void ALSC::distortPatch(const Mat& matImg, const Point2f ptCentre, const float*
             pptUpdated[3] = Point2f(ptCentre.x + initX + nW-1, ptCentre.y + initY + nH-1);
         }
     }else{
-        /* Otherwise interpolate */
+        /* Otherwise interpolate. The affine transform is done inline, with
+           the terms depending only on the row computed once per row. */
         for (j = 0; j < nH; j++) {
+                double y = initY + j;
+                double dRowX = y * pfAff[1];
+                double dRowY = y * pfAff[3];
                 for (i = 0; i < nW; i++) {
-                    /* Perform the affine transform on the points */
-                    affineTransform(initX+i, initY+j, ptCentre, pfAff, &dNewX, &dNewY);
+                    double x = initX + i;
+                    dNewX = ptCentre.x + x + (x * pfAff[0] + dRowX);
+                    dNewY = ptCentre.y + y + (x * pfAff[2] + dRowY);
 
                     /* Interpolate from the image */
                     matImgPatch(j,i) = interpolate(dNewX, dNewY, matImg);
-
-                    /* Check if we're at one of the patch corners and store into the boundary array if needed */
-                    if(i == 0){
-                        if(j == 0){
-                            if (pptUpdated != NULL) pptUpdated[0] = Point2f(dNewX, dNewY);
-                        }else if(j == nH-1){
-                            if (pptUpdated != NULL) pptUpdated[1] = Point2f(dNewX, dNewY);
-                        }
-                    }else if(i == nW-1 && j == 0){
-                        if (pptUpdated != NULL) pptUpdated[3] = Point2f(dNewX, dNewY);
-                    }
                 }
             }
-            if (pptUpdated != NULL) pptUpdated[2] = Point2f(dNewX, dNewY);
+
+        /* Store the patch corners */
+        if (pptUpdated != NULL){
+            affineTransform(initX, initY, ptCentre, pfAff, &dNewX, &dNewY);
+            pptUpdated[0] = Point2f(dNewX, dNewY);
+            affineTransform(initX, initY+nH-1, ptCentre, pfAff, &dNewX, &dNewY);
+            pptUpdated[1] = Point2f(dNewX, dNewY);
+            affineTransform(initX+nW-1, initY+nH-1, ptCentre, pfAff, &dNewX, &dNewY);
+            pptUpdated[2] = Point2f(dNewX, dNewY);
+            affineTransform(initX+nW-1, initY, ptCentre, pfAff, &dNewX, &dNewY);
+            pptUpdated[3] = Point2f(dNewX, dNewY);
+        }
     }
 
     return;
 }
 
 float ALSC::interpolate(double dNewX, double dNewY, const Mat &matImg){
-    int x1, x2, y2, y1;
-    float val1, val2, val3, val4;
-    float fPixelVal = 0.0;
-    double x,y;
 
-    val1 = val2 = val3 = val4 = 0.0;
-
-    x1 = (int) floor(dNewX);
-    x2 = (int) ceil(dNewX);
-    y2 = (int) ceil(dNewY);
-    y1 = (int) floor(dNewY);
+    int x1 = (int) floor(dNewX);
+    int y1 = (int) floor(dNewY);
+    double dx = dNewX - x1;
+    double dy = dNewY - y1;
+    int x2 = (dx > 0) ? x1 + 1 : x1; // same as ceil()
+    int y2 = (dy > 0) ? y1 + 1 : y1;
 
     if(x1 < 0 || y1 < 0 || x2 >= matImg.cols || y2 >= matImg.rows)
         return 0.0;
 
-    if (x1 == x2 && y1 == y2){ // when dNewX and dNewY are both integer -> happy case no interpolation is required
-        fPixelVal = matImg.at<unsigned char>(y1, x1);
-    }
-    else if (x1 == x2 && y1 != y2){ // dNewX is integer but dNewY is not. 1D interpolation is required (not bidirectional interpolation)
-        val1 = matImg.at<unsigned char>(y1, x1);
-        val2 = matImg.at<unsigned char>(y2, x1);
-
-        fPixelVal = (val2 - val1) * (dNewY - y1) + val1;
-    }
-    else if (x1 != x2 && y1 == y2){
-        val1 = matImg.at<unsigned char>(y1, x1);
-        val2 = matImg.at<unsigned char>(y1, x2);
+    // Bilinear interpolation. When dNewX or dNewY is an integer, the
+    // weights of the second column or row are zero, so this also
+    // covers 1D interpolation and no interpolation.
+    const unsigned char* pRow1 = matImg.ptr<unsigned char>(y1);
+    const unsigned char* pRow2 = matImg.ptr<unsigned char>(y2);
+    double dTop    = pRow1[x1] + dx * (pRow1[x2] - pRow1[x1]);
+    double dBottom = pRow2[x1] + dx * (pRow2[x2] - pRow2[x1]);
 
-        fPixelVal = (val2 - val1) * (dNewX - x1) + val1;
-    }
-    else{ // bidirectional interpolation
-            x = dNewX;
-            y = dNewY;
-
-            val1 = matImg.at<unsigned char>(y1, x1);
-            val2 = matImg.at<unsigned char>(y1, x2);
-            val3 = matImg.at<unsigned char>(y2, x1);
-            val4 = matImg.at<unsigned char>(y2, x2);
-
-            fPixelVal = (val1 * (x2 - x) * (y2 - y)
-                         + val2 * (x - x1) * (y2 - y)
-                         + val3 * (x2 - x) * (y - y1)
-                         + val4 * (x - x1) * (y - y1));
-    }
-
-    return fPixelVal;
+    return dTop + dy * (dBottom - dTop);
 }
 
 float ALSCU16::interpolate(double dNewX, double dNewY, const Mat &matImg){
@@ -74,16 +74,27 @@ private:
     int nColPatch;
     int nSystemMatrixRows;
 
-    std::vector<std::vector<float> > pfGx;
-    std::vector<std::vector<float> > pfGy;
+    // Patch gradients. Their borders stay zero.
+    Eigen::MatrixXf matGx;
+    Eigen::MatrixXf matGy;
 
     Eigen::MatrixXf matPatchL;
     Eigen::MatrixXf matPatchR;
 
+    // Pixel offsets from the patch centre, in the (column-major) order
+    // of the patch pixels, which is also the order of the rows of emA
+    Eigen::VectorXf vecOffsetX;
+    Eigen::VectorXf vecOffsetY;
+
     Eigen::Matrix2f matC;
 
+    // The normal equations, allocated once
     Eigen::MatrixXf emA;
     Eigen::VectorXf emB;
+    Eigen::MatrixXf emAS;
+    Eigen::VectorXf emATB;
+    Eigen::VectorXf emS;
+    Eigen::VectorXf emErrors;
 
     int nParam;
 
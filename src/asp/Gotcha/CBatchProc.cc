@@ -483,6 +483,11 @@ void CBatchProc::refinement(std::vector<CTiePt> const& vecTPs,
   paramDense.m_paramGotcha.m_nMinTile = m_imgL.cols + m_imgL.rows;
   paramDense.m_paramGotcha.m_nNeiType = (int)tl["nNeiType"];
 
+  // This is optional, older parameter files do not have it
+  FileNode pp = fs["processParam"];
+  if (!pp.empty() && !pp["nThreads"].empty())
+    paramDense.m_paramGotcha.m_nNumThreads = (int)pp["nThreads"];
+
   paramDense.m_paramGotcha.m_paramALSC.m_bIntOffset = (int)tl["bIntOffset"];
   paramDense.m_paramGotcha.m_paramALSC.m_bWeighting = (int)tl["bWeight"];
   paramDense.m_paramGotcha.m_paramALSC.m_fAffThr = (float)tl["fAff"];
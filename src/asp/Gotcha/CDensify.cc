@@ -18,6 +18,11 @@
 #include <asp/Gotcha/CDensify.h>
 #include <asp/Gotcha/ALSC.h>
 
+#include <vw/Core/ThreadPool.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <cmath>
@@ -494,13 +499,14 @@ bool CDensify::saveResult(cv::Mat & output_dispX, cv::Mat & output_dispY){
     return bRes;
 }
 
-void CDensify::getNeighbour(const CTiePt tp, vector<CTiePt>& vecNeiTp, const int nNeiType, const Mat& matSim){
+void CDensify::getNeighbour(const CTiePt tp, vector<CTiePt>& vecNeiTp, const int nNeiType, const Mat& matSim,
+                            const Point ptSimOrigin){
     //
     Point2f ptLeft = tp.m_ptL;
     Point2f ptRight = tp.m_ptR;
 
     if (nNeiType == CGOTCHAParam::NEI_DIFF){
-        getDisffusedNei(vecNeiTp, tp, matSim);
+        getDisffusedNei(vecNeiTp, tp, matSim, ptSimOrigin);
     }
     /*if(nNeiType == CGOTCHAParam::NEI_X || nNeiType == CGOTCHAParam::NEI_Y || nNeiType == CGOTCHAParam::NEI_4 || nNeiType == CGOTCHAParam::NEI_8)*/
     else {
@@ -543,14 +549,15 @@ void CDensify::getNeighbour(const CTiePt tp, vector<CTiePt>& vecNeiTp, const int
     }
 }
 
-void CDensify::getDisffusedNei(vector<CTiePt>& vecNeiTp, const CTiePt tp, const Mat& matSim){
+void CDensify::getDisffusedNei(vector<CTiePt>& vecNeiTp, const CTiePt tp, const Mat& matSim,
+                               const Point ptSimOrigin){
     // estimate the growth
     // make a diffusion map
     int nSzDiff = m_paramDense.m_paramGotcha.m_paramALSC.m_nPatch;//12
     double pdDiffMap[nSzDiff*2+1][nSzDiff*2+1];
-    int nW = m_imgL.cols;//m_imgL.getMaxX()+1;//m_imgL.getWidth();
-    int nH = m_imgL.rows;//m_imgL.getMaxY()+1;//m_imgL.getHeight();
-    Rect rectRegion(0,0,nW, nH);
+    // The similarity map covers only the part of the image around the current strip
+    Rect rectRegion(ptSimOrigin.x, ptSimOrigin.y, matSim.cols, matSim.rows);
+    rectRegion &= Rect(0, 0, m_imgL.cols, m_imgL.rows);
 
     Point2f ptLeft = tp.m_ptL;
     Point2f ptRight = tp.m_ptR;
@@ -560,9 +567,9 @@ void CDensify::getDisffusedNei(vector<CTiePt>& vecNeiTp, const CTiePt tp, const
             int nX = (int)floor(ptLeft.x+i);
             int nY = (int)floor(ptLeft.y+j);
             if (rectRegion.contains(Point(nX, nY)) &&
-                matSim.at<float>(nY, nX) > 0){
+                matSim.at<float>(nY - ptSimOrigin.y, nX - ptSimOrigin.x) > 0){
                 // assume sim value has been already normalised
-                val = 1.f - matSim.at<float>(nY, nX);// /m_paramDense.m_paramGotcha.m_paramALSC.m_fEigThr;
+                val = 1.f - matSim.at<float>(nY - ptSimOrigin.y, nX - ptSimOrigin.x);// /m_paramDense.m_paramGotcha.m_paramALSC.m_fEigThr;
             }
             pdDiffMap[j+nSzDiff][i+nSzDiff] = val;
         }
@@ -671,7 +678,7 @@ void CDensify::removeOutsideImage(vector<CTiePt>& vecNeiTp, const Rect_<float> r
 
 }
 
-void CDensify::removePtInLUT(vector<CTiePt>& vecNeiTp, const vector<bool>& pLUT, const int nWidth){
+void CDensify::removePtInLUT(vector<CTiePt>& vecNeiTp, const vector<unsigned char>& pLUT, const int nWidth){
     vector<CTiePt>::iterator iter;
 
     for (iter = vecNeiTp.begin(); iter < vecNeiTp.end(); ){        
@@ -734,6 +741,52 @@ void CDensify::breakIntoSubRect(Rect_<float> rectParent, vector< Rect_<float> >&
 }
 
 
+void CDensify::makeStrips(const Rect_<float> rectTile, int nMinHeight,
+                          vector< Rect_<float> >& vecRectStrips){
+
+    // Strips must be tall enough so that most of the growing happens
+    // inside them. Their number depends only on the tile, so the result
+    // does not change with the number of threads.
+    int nStrips = std::max(1, (int)(rectTile.height / std::max(nMinHeight, 1)));
+
+    float fTop = rectTile.y;
+    for (int i = 0; i < nStrips; i++){
+        float fBottom = rectTile.y + rectTile.height;
+        if (i + 1 < nStrips)
+            fBottom = floor(rectTile.y + rectTile.height * (i + 1) / nStrips);
+        vecRectStrips.push_back(Rect_<float>(rectTile.x, fTop, rectTile.width, fBottom - fTop));
+        fTop = fBottom;
+    }
+}
+
+// Grow the matches in one strip of a tile
+class DensifyStripTask: public vw::Task {
+    CDensify& m_densify;
+    const Mat& m_matImgL;
+    const Mat& m_matImgR;
+    const vector<CTiePt>& m_vectpSeeds;
+    const CGOTCHAParam& m_paramGotcha;
+    Rect_<float> m_rectStrip;
+    Mat& m_matSim;
+    Point m_ptSimOrigin;
+    vector<unsigned char>& m_pLUT;
+    vector<CTiePt>& m_vectpAdded;
+
+public:
+    DensifyStripTask(CDensify& densify, const Mat& matImgL, const Mat& matImgR,
+                     const vector<CTiePt>& vectpSeeds, const CGOTCHAParam& paramGotcha,
+                     Rect_<float> rectStrip, Mat& matSim, Point ptSimOrigin,
+                     vector<unsigned char>& pLUT, vector<CTiePt>& vectpAdded):
+        m_densify(densify), m_matImgL(matImgL), m_matImgR(matImgR), m_vectpSeeds(vectpSeeds),
+        m_paramGotcha(paramGotcha), m_rectStrip(rectStrip), m_matSim(matSim),
+        m_ptSimOrigin(ptSimOrigin), m_pLUT(pLUT), m_vectpAdded(vectpAdded){}
+
+    virtual void operator()(){
+        m_densify.doTileGotcha(m_matImgL, m_matImgR, m_vectpSeeds, m_paramGotcha, m_vectpAdded,
+                               m_rectStrip, m_matSim, m_ptSimOrigin, m_pLUT);
+    }
+};
+
 bool CDensify::doGotcha(const Mat& matImgL, const Mat& matImgR, vector<CTiePt>& vectpSeeds,
                         const CGOTCHAParam& paramGotcha, vector<CTiePt>& vectpAdded){
 
@@ -750,14 +803,9 @@ bool CDensify::doGotcha(const Mat& matImgL, const Mat& matImgR, vector<CTiePt>&
     Size szImgL(matImgL.cols, matImgL.rows);
     // cout << "CASP-GO INFO: initialising pixel LUT" << endl;
 
-    // IMARS bool pLUT[szImgL.area()]; // if true it indicates the pixel has already processed
-    vector<bool> pLUT; //IMARS
-
-    // initialise
-    for (int i = 0; i< szImgL.area(); i++){
-        bool bpLUT = false; //IMARS
-        pLUT.push_back(bpLUT); //IMARS
-    } //IMARS
+    // If nonzero it indicates the pixel has already been processed. Not using
+    // vector<bool>, as the strips below modify this concurrently.
+    vector<unsigned char> pLUT(szImgL.area(), 0); //IMARS
 
     vector< Rect_<float> > vecRectTiles;
     vecRectTiles.push_back(Rect(0., 0., matImgL.cols, matImgL.rows));
@@ -781,21 +829,16 @@ bool CDensify::doGotcha(const Mat& matImgL, const Mat& matImgR, vector<CTiePt>&
         matSimMap.at<float>(nY, nX) = vectpSeeds.at(i).m_fSimVal;
 
         int nIdx = nY*szImgL.width + nX;
-        pLUT[nIdx] = true;
-
-        //cout << "DEBUG: pLUT change successfully to " << pLUT[nIdx] << endl;
+        pLUT[nIdx] = 1;
     }
 
     // cout << "CASP-GO INFO: apply mask to remove area that no densification is required." << endl;
     // apply mask, remove area where no densification is required
-    //std::cout << "Reading mask: " << paramGotcha.m_strMask << std::endl;
-    //Mat Mask = imread(paramGotcha.m_strMask, CV_LOAD_IMAGE_ANYDEPTH);
     for (int i=0; i<m_Mask.rows; i++){
         for (int j=0; j<m_Mask.cols; j++){
             if (m_Mask.at<uchar>(i,j)==0){
                 int nIdx = i*m_Mask.cols + j;
-                pLUT[nIdx] = true;
-                //cout << "DEBUG: pLUT change successfully to " << pLUT[nIdx] << endl;
+                pLUT[nIdx] = 1;
             }
         }
     }
@@ -804,14 +847,90 @@ bool CDensify::doGotcha(const Mat& matImgL, const Mat& matImgR, vector<CTiePt>&
     vectpAdded.clear();
     //cout << "CASP-GO INFO: Desifying disparity... ..." << endl;
 
-    for (int i = 0 ; i < (int)vecRectTiles.size(); i++){
-          vector<CTiePt> vecRes;
-          bRes = bRes && doTileGotcha(matImgL, matImgR, vectpSeeds, paramGotcha, vecRes, vecRectTiles.at(i), matSimMap, pLUT);
-          // collect result
-          vectpAdded.insert(vectpAdded.end(), vecRes.begin(), vecRes.end());
+    // Split the tiles into horizontal strips and grow them concurrently.
+    // Each strip gets its own copy of the similarity map in the strip
+    // and a halo around it, as the diffused neighbours look that far.
+    // The halo has only the seeds, not what the adjacent strips grow,
+    // so the result does not depend on the order the strips are processed.
+    int nHalo = std::max(paramGotcha.m_paramALSC.m_nPatch, 1);
+    vector< Rect_<float> > vecRectStrips;
+    vector<int> vecTileIndex; // the tile each strip is in
+    for (int i = 0; i < (int)vecRectTiles.size(); i++){
+        makeStrips(vecRectTiles.at(i), 4*nHalo, vecRectStrips);
+        vecTileIndex.resize(vecRectStrips.size(), i);
+    }
+
+    int nStrips = vecRectStrips.size();
+    vector<Mat> vecSimStrips(nStrips);
+    vector<Point> vecSimOrigins(nStrips);
+    vector< vector<CTiePt> > vecStripRes(nStrips);
+    vector< boost::shared_ptr<DensifyStripTask> > vecTasks(nStrips);
+    Rect rectImg(0, 0, matImgL.cols, matImgL.rows);
+    for (int i = 0; i < nStrips; i++){
+        Rect_<float> rectStrip = vecRectStrips.at(i);
+        Rect rectSim((int)floor(rectStrip.x) - nHalo, (int)floor(rectStrip.y) - nHalo,
+                     (int)ceil(rectStrip.width) + 2*nHalo + 1, (int)ceil(rectStrip.height) + 2*nHalo + 1);
+        rectSim &= rectImg;
+        vecSimStrips[i] = matSimMap(rectSim).clone();
+        vecSimOrigins[i] = rectSim.tl();
+        vecTasks[i] = boost::shared_ptr<DensifyStripTask>
+            (new DensifyStripTask(*this, matImgL, matImgR, vectpSeeds, paramGotcha, rectStrip,
+                                  vecSimStrips[i], vecSimOrigins[i], pLUT, vecStripRes[i]));
+    }
+
+    int nThreads = std::max(1, std::min(paramGotcha.m_nNumThreads, nStrips));
+    if (nThreads == 1){
+        for (int i = 0; i < nStrips; i++)
+            (*vecTasks[i])();
+    }
+    else {
+        vw::FifoWorkQueue queue(nThreads);
+        for (int i = 0; i < nStrips; i++)
+            queue.add_task(vecTasks[i]);
+        queue.join_all();
+    }
+
+    // Collect the results in strip order, and put back the grown
+    // similarity values in the strips
+    for (int i = 0; i < nStrips; i++){
+        vectpAdded.insert(vectpAdded.end(), vecStripRes[i].begin(), vecStripRes[i].end());
+        int nRow0 = std::max((int)ceil(vecRectStrips[i].y), 0);
+        int nRow1 = std::min((int)ceil(vecRectStrips[i].y + vecRectStrips[i].height), matImgL.rows);
+        for (int nRow = nRow0; nRow < nRow1; nRow++){
+            int nSimRow = nRow - vecSimOrigins[i].y;
+            for (int nCol = 0; nCol < vecSimStrips[i].cols; nCol++){
+                int nX = nCol + vecSimOrigins[i].x;
+                if (vecRectStrips[i].contains(Point2f(nX, nRow)))
+                    matSimMap.at<float>(nRow, nX) = vecSimStrips[i].at<float>(nSimRow, nCol);
+            }
+        }
+    }
 
-          // debug
-          //cout << "Tile " << i << " has been processed: " << vecRes.size() << " points are added" << endl;
+    // Let the regions reachable only across a strip boundary be grown
+    // from the points found near that boundary. This is done serially
+    // and in a fixed order, so it is deterministic as well.
+    for (int t = 0; t < (int)vecRectTiles.size(); t++){
+        vector<CTiePt> vecBoundarySeeds;
+        for (int i = 0; i < nStrips; i++){
+            if (vecTileIndex[i] != t)
+                continue;
+            const Rect_<float>& rectStrip = vecRectStrips[i];
+            bool bHasAbove = (i > 0 && vecTileIndex[i-1] == t);
+            bool bHasBelow = (i + 1 < nStrips && vecTileIndex[i+1] == t);
+            for (size_t j = 0; j < vecStripRes[i].size(); j++){
+                float fY = vecStripRes[i][j].m_ptL.y;
+                if ((bHasAbove && fY < rectStrip.y + nHalo) ||
+                    (bHasBelow && fY >= rectStrip.y + rectStrip.height - nHalo))
+                    vecBoundarySeeds.push_back(vecStripRes[i][j]);
+            }
+        }
+        if (vecBoundarySeeds.empty())
+            continue;
+
+        vector<CTiePt> vecRes;
+        bRes = bRes && doTileGotcha(matImgL, matImgR, vecBoundarySeeds, paramGotcha, vecRes,
+                                    vecRectTiles.at(t), matSimMap, Point(0, 0), pLUT);
+        vectpAdded.insert(vectpAdded.end(), vecRes.begin(), vecRes.end());
     }
 
     return bRes;
@@ -821,7 +940,8 @@ bool CDensify::doGotcha(const Mat& matImgL, const Mat& matImgR, vector<CTiePt>&
 bool CDensify::doTileGotcha(const Mat& matImgL, const Mat& matImgR, const
                             vector<CTiePt>& vectpSeeds,
                             const CGOTCHAParam& paramGotcha, vector<CTiePt>& vectpAdded,
-                            const Rect_<float> rectTileL, Mat& matSimMap, vector<bool>& pLUT){
+                            const Rect_<float> rectTileL, Mat& matSimMap, const Point ptSimOrigin,
+                            vector<unsigned char>& pLUT){
 
     vector<CTiePt> vectpSeedTPs; //= vectpSeeds;                // need this hard copy for sorting
 
@@ -838,39 +958,18 @@ bool CDensify::doTileGotcha(const Mat& matImgL, const Mat& matImgR, const
         }
 
     }
-    //std::cout << "Reading mask: " << paramGotcha.m_strMask << std::endl;
-    //Mat Mask = imread(paramGotcha.m_strMask, CV_LOAD_IMAGE_ANYDEPTH);
-    Mat imgL = matImgL;
-    Mat imgR = matImgR;
-    imgL.convertTo(imgL, CV_8UC1);
-    imgR.convertTo(imgR, CV_8UC1);
-
-    unsigned int nGapSize = 0;
-    for (int i=0; i<m_Mask.rows; i++){
-        for (int j=0; j< m_Mask.cols; j++){
-          if (m_Mask.at<uchar>(i,j)==1 &&
-              imgL.at<uchar>(i,j)!=0 &&imgR.at<uchar>(i,j)!=0)
-                nGapSize+=1;
-        }
-    }
 
     //sort(vectpSeedTPs.begin(), vectpSeedTPs.end(), compareTP); // sorted in ascending order
     /////////////////////////////////////////////////////////////////////
     // stereo region growing
-    //int nCount = 0; // for debug
-#if 0
-      // Hide the verbose messages
-      cout << "[--------------------]  0% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-#endif
-      
-    while (vectpSeedTPs.size() > 0) {
+    // The seeds are processed in the order they were added. Advance
+    // an index rather than erasing from the front, which is slow.
+    for (size_t nNext = 0; nNext < vectpSeedTPs.size(); nNext++) {
         // get a point from seed
-        CTiePt tp = vectpSeedTPs.at(0);
+        CTiePt tp = vectpSeedTPs[nNext];
 
-//        mvectpAdded.push_back(tp);
-        vectpSeedTPs.erase(vectpSeedTPs.begin());
         vector<CTiePt> vecNeiTp;        
-        getNeighbour(tp, vecNeiTp, paramGotcha.m_nNeiType, matSimMap);
+        getNeighbour(tp, vecNeiTp, paramGotcha.m_nNeiType, matSimMap, ptSimOrigin);
         removeOutsideImage(vecNeiTp, rectTileL, rectImgR);
         removePtInLUT(vecNeiTp, pLUT, matImgL.cols);
 
@@ -891,7 +990,6 @@ bool CDensify::doTileGotcha(const Mat& matImgL, const Mat& matImgR, const
             int nLen = pvecRefTPtemp->size();
             if( nLen > 0){
                 // append survived neighbours to the seed point list and the seed LUT
-                // vector<CRefinedTP>::iterator iterNei;
                 for (int i = 0 ; i < nLen; i++){
                     CTiePt tpNei = pvecRefTPtemp->at(i);
 
@@ -899,8 +997,8 @@ bool CDensify::doTileGotcha(const Mat& matImgL, const Mat& matImgR, const
                     int nYnei = (int)floor(tpNei.m_ptL.y);
                     int nIdxNei = nYnei*szImgL.width + nXnei;
 
-                    matSimMap.at<float>(nYnei,nXnei) = tpNei.m_fSimVal;                    
-                    pLUT[nIdxNei] = true;
+                    matSimMap.at<float>(nYnei - ptSimOrigin.y, nXnei - ptSimOrigin.x) = tpNei.m_fSimVal;
+                    pLUT[nIdxNei] = 1;
 
                     vectpSeedTPs.push_back(tpNei);
                     vectpAdded.push_back(tpNei);
@@ -909,55 +1007,7 @@ bool CDensify::doTileGotcha(const Mat& matImgL, const Mat& matImgR, const
                 //sort(vectpSeedTPs.begin(), vectpSeedTPs.end(), compareTP);
             } 
         }
-#if 0
-        // Hide the verbose messages
-        if (vectpAdded.size()>0){
-        if (vectpAdded.size() >= (nGapSize)/20 && vectpAdded.size() < 2*(nGapSize)/20)
-            cout << "[*-------------------]  5% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 2*(nGapSize)/20 && vectpAdded.size() < 3*(nGapSize)/20)
-            cout << "[**------------------] 10% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 3*(nGapSize)/20 && vectpAdded.size() < 4*(nGapSize)/20)
-            cout << "[***-----------------] 15% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 4*(nGapSize)/20 && vectpAdded.size() < 5*(nGapSize)/20)
-            cout << "[****----------------] 20% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 5*(nGapSize)/20 && vectpAdded.size() < 6*(nGapSize)/20)
-            cout << "[*****---------------] 25% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 6*(nGapSize)/20 && vectpAdded.size() < 7*(nGapSize)/20)
-            cout << "[******--------------] 30% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 7*(nGapSize)/20 && vectpAdded.size() < 8*(nGapSize)/20)
-            cout << "[*******-------------] 35% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 8*(nGapSize)/20 && vectpAdded.size() < 9*(nGapSize)/20)
-            cout << "[********------------] 40% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 9*(nGapSize)/20 && vectpAdded.size() < 10*(nGapSize)/20)
-            cout << "[*********-----------] 45% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 10*(nGapSize)/20 && vectpAdded.size() < 11*(nGapSize)/20)
-            cout << "[**********----------] 50% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 11*(nGapSize)/20 && vectpAdded.size() < 12*(nGapSize)/20)
-            cout << "[***********---------] 55% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 12*(nGapSize)/20 && vectpAdded.size() < 13*(nGapSize)/20)
-            cout << "[************--------] 60% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 13*(nGapSize)/20 && vectpAdded.size() < 14*(nGapSize)/20)
-            cout << "[*************-------] 65% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 14*(nGapSize)/20 && vectpAdded.size() < 15*(nGapSize)/20)
-            cout << "[**************------] 70% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 15*(nGapSize)/20 && vectpAdded.size() < 16*(nGapSize)/20)
-            cout << "[***************-----] 75% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 16*(nGapSize)/20 && vectpAdded.size() < 17*(nGapSize)/20)
-            cout << "[****************----] 80% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 17*(nGapSize)/20 && vectpAdded.size() < 18*(nGapSize)/20)
-            cout << "[*****************---] 85% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 18*(nGapSize)/20 && vectpAdded.size() < 19*(nGapSize)/20)
-            cout << "[******************--] 90% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() >= 19*(nGapSize)/20 && vectpAdded.size() < 20*(nGapSize)/20)
-            cout << "[*******************-] 95% OF THE GAP AREA HAS BEEN DENSIFIED\r" << std::flush;
-        else if (vectpAdded.size() == nGapSize)
-          cout << "[********************]100% OF THE GAP AREA HAS BEEN DENSIFIED";
-        }
-#endif
     }
-#if 0
-    cout << endl;
-#endif
     
     return true;
 }
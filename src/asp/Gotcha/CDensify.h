@@ -35,7 +35,10 @@
 
 namespace gotcha {
 
+class DensifyStripTask;
+
 class CDensify: public CProcBlock {
+  friend class DensifyStripTask;
 public:
   CDensify();
   CDensify(CDensifyParam paramDense, std::vector<CTiePt> const& vecTPs,
@@ -60,15 +63,22 @@ private:
     std::vector<CTiePt> getIntToFloatSeed(std::vector<CTiePt>& vecTPSrc); // get integer Seed point pairs from a float seed point pair
     bool doGotcha(const cv::Mat& matImgL, const cv::Mat& matImgR, std::vector<CTiePt>& vectpSeeds,
                   const CGOTCHAParam& paramGotcha, std::vector<CTiePt>& vectpAdded);
+    // The similarity map may cover only a part of the image, starting at ptSimOrigin.
+    // The pixel LUT covers the whole image.
     bool doTileGotcha(const cv::Mat& matImgL, const cv::Mat& matImgR, const std::vector<CTiePt>& vectpSeeds,
                       const CGOTCHAParam& paramGotcha, std::vector<CTiePt>& mvectpAdded,
-                      const cv::Rect_<float> rectTileL, cv::Mat& matSimMap, std::vector<bool>& pLUT); //IMARS
-    void removePtInLUT(std::vector<CTiePt>& vecNeiTp, const std::vector<bool>& pLUT, const int nWidth); //IMARS
+                      const cv::Rect_<float> rectTileL, cv::Mat& matSimMap, const cv::Point ptSimOrigin,
+                      std::vector<unsigned char>& pLUT); //IMARS
+    void removePtInLUT(std::vector<CTiePt>& vecNeiTp, const std::vector<unsigned char>& pLUT, const int nWidth); //IMARS
     void removeOutsideImage(std::vector<CTiePt>& vecNeiTp, const cv::Rect_<float> rectTileL, const cv::Rect_<float> rectImgR);
-    void getNeighbour(const CTiePt tp, std::vector<CTiePt>& vecNeiTp, const int nNeiType, const cv::Mat& matSim);
-    void getDisffusedNei(std::vector<CTiePt>& vecNeiTp, const CTiePt tp, const cv::Mat& matSim);
+    void getNeighbour(const CTiePt tp, std::vector<CTiePt>& vecNeiTp, const int nNeiType, const cv::Mat& matSim,
+                      const cv::Point ptSimOrigin);
+    void getDisffusedNei(std::vector<CTiePt>& vecNeiTp, const CTiePt tp, const cv::Mat& matSim,
+                         const cv::Point ptSimOrigin);
     void breakIntoSubRect(cv::Rect_<float> rectParent, std::vector< cv::Rect_<float> >& vecRes);
     void makeTiles(std::vector< cv::Rect_<float> >& vecRectTiles, int nMin);
+    void makeStrips(const cv::Rect_<float> rectTile, int nMinHeight,
+                    std::vector< cv::Rect_<float> >& vecRectStrips);
     bool isHavingTP(std::vector<CTiePt>& vecNeiTp, CTiePt tp); // used in diffused neighbour
     bool doPGotcha(int nNeiType);
     int getTotPyramidLev(int nszPatch);
@@ -26,7 +26,7 @@ namespace gotcha {
 class CGOTCHAParam {
 
 public:
-    CGOTCHAParam():m_nNeiType(NEI_4),m_fDiffCoef(0.05),m_fDiffThr(0.1),m_nDiffIter(5), m_bNeedInitALSC(true){ m_nMinTile = 1000000000;}
+    CGOTCHAParam():m_nNeiType(NEI_4),m_fDiffCoef(0.05),m_fDiffThr(0.1),m_nDiffIter(5), m_nNumThreads(1), m_bNeedInitALSC(true){ m_nMinTile = 1000000000;}
 
     std::string getNeiType(){if (m_nNeiType == NEI_X) return "NEI_X";
                         else if (m_nNeiType == NEI_Y) return "NEI_Y";
@@ -41,6 +41,11 @@ public:
     float m_fDiffThr;
     int m_nDiffIter;
 
+    // Each tile is split into horizontal strips of a fixed height,
+    // which are grown concurrently using this many threads. The result
+    // does not depend on the number of threads.
+    int m_nNumThreads;
+
     //std::string m_strMask;
 
     CALSCParam m_paramALSC;
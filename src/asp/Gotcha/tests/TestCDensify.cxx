@@ -0,0 +1,91 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <test/Helpers.h>
+#include <asp/Gotcha/CDensify.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace gotcha;
+
+namespace {
+
+// A textured 8-bit image, shifted to the right by the given amount
+cv::Mat make_image(int cols, int rows, double shift) {
+  cv::Mat image(rows, cols, CV_8UC1);
+  for (int row = 0; row < rows; row++) {
+    for (int col = 0; col < cols; col++) {
+      double x = col - shift;
+      double val = 128.0 + 60.0 * sin(0.35 * x) * cos(0.3 * row)
+        + 40.0 * sin(0.13 * x + 0.21 * row);
+      image.at<unsigned char>(row, col)
+        = (unsigned char)std::max(0.0, std::min(255.0, round(val)));
+    }
+  }
+  return image;
+}
+
+} // end anonymous namespace
+
+TEST(CDensify, ThreadCount) {
+
+  // The tile is tall enough to be split into several strips
+  int cols = 100, rows = 160, shift = 3;
+  cv::Mat imgL = make_image(cols, rows, 0);
+  cv::Mat imgR = make_image(cols, rows, shift);
+  cv::Mat dispX = cv::Mat::zeros(rows, cols, CV_32FC1);
+  cv::Mat dispY = cv::Mat::zeros(rows, cols, CV_32FC1);
+  cv::Mat mask  = cv::Mat::ones(rows, cols, CV_8UC1) * 255;
+
+  // Sparse seeds with the correct disparity
+  std::vector<CTiePt> seeds;
+  for (int row = 10; row < rows - 10; row += 30) {
+    for (int col = 10; col < cols - 10; col += 30) {
+      CTiePt tp;
+      tp.m_ptL = cv::Point2f(col, row);
+      tp.m_ptR = cv::Point2f(col + shift, row);
+      seeds.push_back(tp);
+    }
+  }
+
+  CDensifyParam param;
+  param.m_paramGotcha.m_nNeiType = CGOTCHAParam::NEI_8;
+  param.m_paramGotcha.m_paramALSC.m_nPatch = 5;
+  param.m_paramGotcha.m_paramALSC.m_nMaxIter = 8;
+
+  // The strips do not depend on the number of threads, so the
+  // result must be the same
+  cv::Mat outX1, outY1;
+  param.m_paramGotcha.m_nNumThreads = 1;
+  CDensify densify1(param, seeds, imgL, imgR, dispX, dispY, mask);
+  ASSERT_EQ(CDensifyParam::NO_ERR, densify1.performDensitification(outX1, outY1));
+  EXPECT_GT(cv::countNonZero(outX1), 0);
+
+  int num_threads[] = {2, 4};
+  for (int it = 0; it < 2; it++) {
+    cv::Mat outX, outY;
+    param.m_paramGotcha.m_nNumThreads = num_threads[it];
+    CDensify densify(param, seeds, imgL, imgR, dispX, dispY, mask);
+    ASSERT_EQ(CDensifyParam::NO_ERR, densify.performDensitification(outX, outY));
+    EXPECT_EQ(densify1.getNumTotTps(), densify.getNumTotTps());
+    EXPECT_EQ(0.0, cv::norm(outX1, outX, cv::NORM_INF));
+    EXPECT_EQ(0.0, cv::norm(outY1, outY, cv::NORM_INF));
+  }
+}
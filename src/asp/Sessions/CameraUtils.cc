@@ -22,14 +22,21 @@
 #include <asp/Sessions/CameraUtils.h>
 #include <asp/Sessions/StereoSessionFactory.h>
 #include <asp/Camera/CsmModel.h>
+#include <asp/Core/FileUtils.h>
+#include <asp/Core/StereoSettings.h>
 
 #include <vw/Core/Exception.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Camera/PinholeModel.h>
 #include <vw/Camera/CameraUtilities.h>
 #include <vw/InterestPoint/InterestData.h>
 
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
 #include <string>
 #include <iostream>
+#include <typeinfo>
 
 typedef boost::shared_ptr<asp::StereoSession> SessionPtr;
 
@@ -37,12 +44,177 @@ using namespace vw;
 
 namespace asp {
 
+// The file in the camera cache directory for a camera file. The name
+// depends on the camera file contents, so an edited camera is not
+// matched with a stale cached model.
+std::string camera_cache_file(std::string const& cache_dir,
+                              std::string const& camera_file) {
+  return (boost::filesystem::path(cache_dir)
+          / (asp::file_cache_key(camera_file) + ".json")).string();
+}
+
+// Save the state of a CSM model to the cache. It is written to a temporary
+// file which is then renamed, so other processes never read a partially
+// written state. Failures are not fatal, as the cache is only a speedup.
+void save_cached_camera(std::string const& cache_file, asp::CsmModel const& cam) {
+  namespace fs = boost::filesystem;
+  boost::system::error_code ec;
+  fs::path tmp_file = fs::path(cache_file).parent_path()
+    / fs::unique_path(fs::path(cache_file).filename().string() + ".tmp-%%%%-%%%%-%%%%");
+  try {
+    cam.saveState(tmp_file.string());
+  } catch (std::exception const& e) {
+    fs::remove(tmp_file, ec);
+    vw_out(DebugMessage, "asp") << "Could not cache the camera: " << e.what() << "\n";
+    return;
+  }
+  fs::rename(tmp_file, cache_file, ec);
+  if (ec)
+    fs::remove(tmp_file, ec);
+}
+
+// If cameras can be cached. Only unadjusted CSM cameras are cached, as
+// they are stored as they are loaded.
+bool use_camera_cache(std::string const& camera_cache_dir, std::string const& camera_file,
+                      std::string const& stereo_session) {
+  return (!camera_cache_dir.empty() && !camera_file.empty() && stereo_session == "csm" &&
+          stereo_settings().bundle_adjust_prefix.empty());
+}
+
+// Read a camera from the cache. Return a null pointer if it was not
+// cached before or cannot be read.
+boost::shared_ptr<vw::camera::CameraModel>
+load_cached_camera(std::string const& camera_cache_dir, std::string const& camera_file) {
+
+  boost::shared_ptr<vw::camera::CameraModel> cam;
+  std::string cache_file = camera_cache_file(camera_cache_dir, camera_file);
+  if (!boost::filesystem::exists(cache_file))
+    return cam;
+
+  try {
+    cam.reset(new asp::CsmModel(cache_file));
+  } catch (std::exception const& e) {
+    vw_out(WarningMessage) << "Could not read the cached camera " << cache_file
+                           << ". Parsing " << camera_file << " instead.\n";
+    cam.reset();
+  }
+  return cam;
+}
+
+// Create the session with which to load a camera. This also refines
+// the stereo session name. For mapprojected images, creating a session
+// temporarily changes the bundle adjust prefix in the global stereo
+// settings, so sessions must not be created in parallel with each
+// other or with loading cameras.
+SessionPtr camera_session(std::string const& image_file, std::string const& camera_file,
+                          std::string const& out_prefix, vw::GdalWriteOptions const& opt,
+                          std::string & stereo_session) {
+  // The same camera is double-loaded into the same session instance.
+  // TODO: One day replace this with a simpler camera model loader class.
+  return SessionPtr(asp::StereoSessionFactory::create(stereo_session, opt,
+                                                      image_file, image_file,
+                                                      camera_file, camera_file,
+                                                      out_prefix));
+}
+
+// Load a camera with a session created before. This can be called in
+// parallel if the session supports multi-threading. If a camera cache
+// directory is given, plain CSM models are added to it.
+boost::shared_ptr<vw::camera::CameraModel>
+load_session_camera(SessionPtr session,
+                    std::string const& image_file, std::string const& camera_file,
+                    std::string const& camera_cache_dir) {
+
+  boost::shared_ptr<vw::camera::CameraModel> cam
+    = session->camera_model(image_file, camera_file);
+
+  // Only plain CSM models are cached, in their own state format, which
+  // CsmModel reads back without parsing the camera file. Models of
+  // classes derived from CsmModel, such as for Pleiades, have more state
+  // than what is saved. The DG and SPOT models hold interpolators built
+  // from the XML files which cannot be saved, so these are not cached.
+  if (use_camera_cache(camera_cache_dir, camera_file, session->name()) &&
+      cam.get() != NULL && typeid(*cam) == typeid(asp::CsmModel)) {
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(camera_cache_dir, ec);
+    if (!boost::filesystem::is_directory(camera_cache_dir))
+      vw_throw(ArgumentErr() << "Could not create the camera cache directory: "
+               << camera_cache_dir << ".\n");
+    save_cached_camera(camera_cache_file(camera_cache_dir, camera_file),
+                       *dynamic_cast<asp::CsmModel*>(cam.get()));
+  }
+
+  return cam;
+}
+
+// Load one camera model. If a camera cache directory is given, plain
+// CSM models are read from it if cached before, else they are
+// parsed and added to it.
+boost::shared_ptr<vw::camera::CameraModel>
+load_camera(std::string const& image_file, std::string const& camera_file,
+            std::string const& out_prefix, vw::GdalWriteOptions const& opt,
+            std::string const& camera_cache_dir,
+            // Outputs
+            std::string & stereo_session, bool & supports_multi_threading) {
+
+  vw_out(DebugMessage,"asp") << "Loading: " << image_file << ' ' << camera_file << "\n";
+
+  if (use_camera_cache(camera_cache_dir, camera_file, stereo_session)) {
+    boost::shared_ptr<vw::camera::CameraModel> cam
+      = load_cached_camera(camera_cache_dir, camera_file);
+    if (cam.get() != NULL) {
+      supports_multi_threading = true;
+      return cam;
+    }
+  }
+
+  SessionPtr session = camera_session(image_file, camera_file, out_prefix, opt,
+                                      stereo_session);
+  supports_multi_threading = session->supports_multi_threading();
+  return load_session_camera(session, image_file, camera_file, camera_cache_dir);
+}
+
+// Load a range of the cameras, in a thread. The cameras without a
+// session are read from the cache. If that fails, they are left null.
+class LoadCamerasTask: public vw::Task, private boost::noncopyable {
+  std::vector<std::string> const& m_image_files;
+  std::vector<std::string> const& m_camera_files;
+  std::vector<SessionPtr> const& m_sessions;
+  std::string m_camera_cache_dir;
+  size_t m_beg, m_end;
+  std::vector<boost::shared_ptr<vw::camera::CameraModel>> & m_camera_models;
+
+public:
+  LoadCamerasTask(std::vector<std::string> const& image_files,
+                  std::vector<std::string> const& camera_files,
+                  std::vector<SessionPtr> const& sessions,
+                  std::string const& camera_cache_dir,
+                  size_t beg, size_t end,
+                  std::vector<boost::shared_ptr<vw::camera::CameraModel>> & camera_models):
+    m_image_files(image_files), m_camera_files(camera_files), m_sessions(sessions),
+    m_camera_cache_dir(camera_cache_dir), m_beg(beg), m_end(end),
+    m_camera_models(camera_models) {}
+
+  void operator()() {
+    for (size_t i = m_beg; i < m_end; i++) {
+      vw_out(DebugMessage,"asp") << "Loading: " << m_image_files[i] << ' '
+                                 << m_camera_files[i] << "\n";
+      if (m_sessions[i].get() == NULL)
+        m_camera_models[i] = load_cached_camera(m_camera_cache_dir, m_camera_files[i]);
+      else
+        m_camera_models[i] = load_session_camera(m_sessions[i], m_image_files[i],
+                                                 m_camera_files[i], m_camera_cache_dir);
+    }
+  }
+};
+
 // Load cameras from given image and camera files
 void load_cameras(std::vector<std::string> const& image_files,
                   std::vector<std::string> const& camera_files,
                   std::string const& out_prefix, 
                   vw::GdalWriteOptions const& opt,
                   bool approximate_pinhole_intrinsics,
+                  std::string const& camera_cache_dir,
                   // Outputs
                   std::string & stereo_session, // may change
                   bool & single_threaded_cameras,
@@ -54,30 +226,73 @@ void load_cameras(std::vector<std::string> const& image_files,
   
   if (image_files.size() != camera_files.size()) 
     vw_throw(ArgumentErr() << "Expecting as many images as cameras.\n");  
+
+  camera_models.resize(image_files.size());
+  if (image_files.empty())
+    return;
+
+  // The first camera is loaded by itself, as that determines the
+  // session, and if the cameras can be loaded in parallel.
+  bool supports_multi_threading = true;
+  camera_models[0] = load_camera(image_files[0], camera_files[0], out_prefix, opt,
+                                 camera_cache_dir, stereo_session, supports_multi_threading);
   
-  for (size_t i = 0; i < image_files.size(); i++) {
-    vw_out(DebugMessage,"asp") << "Loading: " << image_files [i] << ' '
-                               << camera_files[i] << "\n";
-    
-    // The same camera is double-loaded into the same session instance.
-    // TODO: One day replace this with a simpler camera model loader class.
-    // But note that this call also refines the stereo session name.
-    SessionPtr session
-      (asp::StereoSessionFactory::create(stereo_session, opt,
-                                         image_files [i], image_files [i],
-                                         camera_files[i], camera_files[i],
-                                         out_prefix));
-    
-    camera_models.push_back(session->camera_model(image_files [i],
-                                                  camera_files[i]));
-    
-    // This is necessary to avoid a crash with ISIS cameras which is single-threaded
-    if (!session->supports_multi_threading())
-      single_threaded_cameras = true;
+  // This is necessary to avoid a crash with ISIS cameras which is single-threaded
+  single_threaded_cameras = !supports_multi_threading;
+
+  if (single_threaded_cameras || opt.num_threads <= 1) {
+    for (size_t i = 1; i < image_files.size(); i++) {
+      camera_models[i] = load_camera(image_files[i], camera_files[i], out_prefix, opt,
+                                     camera_cache_dir, stereo_session,
+                                     supports_multi_threading);
+      if (!supports_multi_threading)
+        single_threaded_cameras = true;
+    }
+  } else {
+    // Parsing the camera files dominates, so load them in parallel, a
+    // few per task to keep the overhead small. The sessions are created
+    // before that, one at a time, as creating them may change the
+    // global stereo settings. Cached cameras need no session.
+    size_t num_cams = image_files.size();
+    std::vector<SessionPtr> sessions(num_cams);
+    for (size_t i = 1; i < num_cams; i++) {
+      if (use_camera_cache(camera_cache_dir, camera_files[i], stereo_session) &&
+          boost::filesystem::exists(camera_cache_file(camera_cache_dir, camera_files[i])))
+        continue;
+      std::string session_name = stereo_session;
+      sessions[i] = camera_session(image_files[i], camera_files[i], out_prefix, opt,
+                                   session_name);
+    }
     
+    size_t cams_per_task = std::max(size_t(1),
+                                    (num_cams - 1) / (4 * size_t(opt.num_threads)));
+    vw::FifoWorkQueue queue(opt.num_threads);
+    for (size_t beg = 1; beg < num_cams; beg += cams_per_task) {
+      size_t end = std::min(num_cams, beg + cams_per_task);
+      boost::shared_ptr<vw::Task>
+        task(new LoadCamerasTask(image_files, camera_files, sessions, camera_cache_dir,
+                                 beg, end, camera_models));
+      queue.add_task(task);
+    }
+    queue.join_all();
+
+    // Parse the cameras whose cached copy could not be read. That
+    // replaces the cached copy.
+    for (size_t i = 1; i < num_cams; i++) {
+      if (camera_models[i].get() != NULL)
+        continue;
+      std::string session_name = stereo_session;
+      SessionPtr session = camera_session(image_files[i], camera_files[i], out_prefix, opt,
+                                          session_name);
+      camera_models[i] = load_session_camera(session, image_files[i], camera_files[i],
+                                             camera_cache_dir);
+    }
+  }
+
+  for (size_t i = 0; i < camera_models.size(); i++) {
     if (approximate_pinhole_intrinsics) {
       boost::shared_ptr<vw::camera::PinholeModel> pinhole_ptr = 
-        boost::dynamic_pointer_cast<vw::camera::PinholeModel>(camera_models.back());
+        boost::dynamic_pointer_cast<vw::camera::PinholeModel>(camera_models[i]);
       // Replace lens distortion with fast approximation
       vw::camera::update_pinhole_for_fast_point2pixel<vw::camera::TsaiLensDistortion>
         (*(pinhole_ptr.get()), file_image_size(image_files[i]));
@@ -95,7 +310,7 @@ void load_cameras(std::vector<std::string> const& image_files,
       // 1e-8. CSM can give junk results if this is too low.
       //csm_cam->setDesiredPrecision(asp::DEFAULT_CSM_DESIRED_PRECISISON); 
     }
-  } // End loop through images loading all the camera models
+  } // End loop through the camera models
   
   return;
 }
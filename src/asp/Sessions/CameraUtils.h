@@ -39,12 +39,16 @@ namespace vw {
 
 namespace asp {
 
-// Load cameras from given image and camera files
+// Load cameras from given image and camera files. If the cameras
+// support it, they are loaded in parallel, using opt.num_threads. If
+// the camera cache directory is not empty, CSM models are saved there
+// as state files and read back in later runs rather than parsed again.
 void load_cameras(std::vector<std::string> const& image_files,
                   std::vector<std::string> const& camera_files,
                   std::string const& out_prefix, 
                   vw::GdalWriteOptions const& opt,
                   bool approximate_pinhole_intrinsics,
+                  std::string const& camera_cache_dir,
                   // Outputs
                   std::string & stereo_session, // may change
                   bool & single_threaded_cameras,
@@ -32,6 +32,7 @@
 
 #include <asp/Sessions/StereoSession.h>
 #include <asp/Core/BundleAdjustUtils.h>
+#include <asp/Core/VirtualAlignedImages.h>
 #include <asp/Camera/AdjustedLinescanDGModel.h>
 #include <asp/Camera/RPCModel.h>
 #include <asp/Sessions/StereoSessionASTER.h>
@@ -236,6 +237,20 @@ void StereoSession::preprocessing_hook(bool adjust_left_image_size,
                                        std::string      & left_output_file,
                                        std::string      & right_output_file) {
 
+  // See if the aligned images can be created on the fly in later
+  // steps rather than written to disk.
+  std::string alignment_method = stereo_settings().alignment_method;
+  bool virtual_images = stereo_settings().virtual_aligned_images;
+  if (virtual_images &&
+      ((alignment_method != "affineepipolar" && alignment_method != "homography" &&
+        alignment_method != "none") ||
+       this->do_bathymetry() || stereo_settings().seed_mode == 3)) {
+    vw_out(WarningMessage) << "Cannot use --virtual-aligned-images with alignment method "
+                           << alignment_method << ", bathymetry, or --corr-seed-mode 3. "
+                           << "Will write the aligned images to disk.\n";
+    virtual_images = false;
+  }
+
   std::string left_cropped_file, right_cropped_file;
   vw::GdalWriteOptions options;
   float left_nodata_value, right_nodata_value;
@@ -248,7 +263,8 @@ void StereoSession::preprocessing_hook(bool adjust_left_image_size,
                                              left_cropped_file, right_cropped_file,
                                              left_nodata_value, right_nodata_value,
                                              has_left_georef,   has_right_georef,
-                                             left_georef,       right_georef);
+                                             left_georef,       right_georef,
+                                             virtual_images);
 
   if (exit_early)
     return;
@@ -356,9 +372,34 @@ void StereoSession::preprocessing_hook(bool adjust_left_image_size,
     write_vector(right_stats_file, right_stats2);
   }
   
+  if (virtual_images) {
+    // Save how to create the aligned images instead of writing them.
+    // This must be kept in sync with the logic above.
+    asp::VirtualAlignedImages images;
+    images.left_image   = left_cropped_file;
+    images.right_image  = right_cropped_file;
+    images.left_nodata  = left_nodata_value;
+    images.right_nodata = right_nodata_value;
+    asp::normalization_ranges(stereo_settings().force_use_entire_range,
+                              stereo_settings().individually_normalize,
+                              use_percentile_stretch, do_not_exceed_min_max,
+                              left_stats, right_stats,
+                              images.left_range, images.right_range);
+    images.has_alignment = (alignment_method != "none");
+    images.left_align    = align_left_matrix;
+    images.right_align   = align_right_matrix;
+    images.left_size     = left_size;
+    images.right_size    = right_size;
+    images.crop_right_to_left = (alignment_method != "none");
+    std::string virtual_file = asp::virtual_aligned_images_file(this->m_out_prefix);
+    vw_out() << "\t--> Writing: " << virtual_file << ".\n";
+    images.write(virtual_file);
+    return;
+  }
+
   // The output no-data value must be < 0 as we scale the images to [0, 1].
   bool has_nodata = true;
-  float output_nodata = -32768.0;
+  float output_nodata = asp::ALIGNED_IMAGE_NODATA;
   vw_out() << "\t--> Writing pre-aligned images.\n";
   vw_out() << "\t--> Writing: " << left_output_file << ".\n";
   block_write_gdal_image(left_output_file, apply_mask(Limg, output_nodata),
@@ -450,7 +491,8 @@ shared_preprocessing_hook(vw::GdalWriteOptions & options,
                           bool                              & has_left_georef,
                           bool                              & has_right_georef,
                           vw::cartography::GeoReference     & left_georef,
-                          vw::cartography::GeoReference     & right_georef){
+                          vw::cartography::GeoReference     & right_georef,
+                          bool                                virtual_images){
 
   // Retrieve nodata values and let the handles go out of scope right away.
   // For this to work the ISIS type must be registered with the
@@ -501,8 +543,18 @@ shared_preprocessing_hook(vw::GdalWriteOptions & options,
   check_files.push_back(right_input_file);
   check_files.push_back(m_left_camera_file);
   check_files.push_back(m_right_camera_file);
-  bool rebuild = (!is_latest_timestamp(left_output_file, check_files) ||
-                  !is_latest_timestamp(right_output_file, check_files));
+  std::string virtual_file = asp::virtual_aligned_images_file(this->m_out_prefix);
+  bool rebuild = false;
+  if (virtual_images) {
+    rebuild = !is_latest_timestamp(virtual_file, check_files);
+  } else {
+    // A file describing aligned images from a previous run would take
+    // precedence over the images to be written now.
+    if (boost::filesystem::exists(virtual_file))
+      boost::filesystem::remove(virtual_file);
+    rebuild = (!is_latest_timestamp(left_output_file, check_files) ||
+               !is_latest_timestamp(right_output_file, check_files));
+  }
 
   if (do_bathy) {
     rebuild = (rebuild ||
@@ -513,8 +565,8 @@ shared_preprocessing_hook(vw::GdalWriteOptions & options,
   if (!rebuild && !crop_left && !crop_right) {
     try {
       vw_log().console_log().rule_set().add_rule(-1, "fileio");
-      DiskImageView<PixelGray<float32> > out_left (left_output_file );
-      DiskImageView<PixelGray<float32> > out_right(right_output_file);
+      ImageViewRef<PixelGray<float32>> out_left, out_right;
+      asp::open_aligned_images(this->m_out_prefix, out_left, out_right);
 
       if (do_bathy) {
         DiskImageView<float> left_bathy_mask (left_aligned_bathy_mask());
@@ -30,6 +30,7 @@
 
 #include <boost/shared_ptr.hpp>
 #include <asp/Core/ImageNormalization.h>
+#include <asp/Core/ImageStats.h>
 #include <asp/Core/Common.h>
 #include <asp/Core/FileUtils.h>
 #include <asp/Core/StereoSettings.h>
@@ -228,7 +229,9 @@ namespace asp {
 
     // Factor out here all functionality shared among the preprocessing hooks
     // for various sessions. Return 'true' if we encounter cached images
-    // and don't need to go through the motions again.
+    // and don't need to go through the motions again. If virtual_images
+    // is true, the aligned images will not be written to disk, and instead
+    // a file describing them will be saved (see VirtualAlignedImages.h).
     bool shared_preprocessing_hook(vw::GdalWriteOptions & options,
                                    std::string const                 & left_input_file,
                                    std::string const                 & right_input_file,
@@ -241,7 +244,8 @@ namespace asp {
                                    bool                              & has_left_georef,
                                    bool                              & has_right_georef,
                                    vw::cartography::GeoReference     & left_georef,
-                                   vw::cartography::GeoReference     & right_georef);
+                                   vw::cartography::GeoReference     & right_georef,
+                                   bool                                virtual_images);
 
     // These are all the currently supported transformation types
     tx_type tx_identity        () const; // Not left or right specific
@@ -334,47 +338,37 @@ Vector6f StereoSession::gather_stats(vw::ImageViewBase<ViewT> const& view_base,
     }
   }
   
-  // Check if this stats file was computed after any image modifications.
+  // Check if this stats file was computed after any image
+  // modifications, and from the same fraction of the image tiles.
+  double tile_fraction = stereo_settings().stats_tile_fraction;
+  bool have_cache = false;
   if ((use_cache && asp::is_latest_timestamp(cache_path, image_path)) ||
-      (stereo_settings().force_reuse_match_files && fs::exists(cache_path))) {
-    vw_out(InfoMessage) << "\t--> Reading statistics from file " + cache_path << std::endl;
-    Vector<float32> stats;
-    read_vector(stats, cache_path); // Just fetch the stats from the file on disk.
-    result = stats;
+      (stereo_settings().force_reuse_match_files && fs::exists(cache_path)))
+    have_cache = asp::read_cached_stats(cache_path, tile_fraction, result);
 
+  if (have_cache) {
+    vw_out(InfoMessage) << "\t--> Read statistics from file " + cache_path << std::endl;
   } else { // Compute the results
 
-    // Compute statistics at a reduced resolution
-    const float TARGET_NUM_PIXELS = 1000000;
-    float num_pixels = float(image.cols())*float(image.rows());
-    int   stat_scale = int(ceil(sqrt(num_pixels / TARGET_NUM_PIXELS)));
-
+    // Compute statistics at a reduced resolution, reading the image
+    // tiles in parallel. Optionally use only a fraction of the tiles.
+    const double TARGET_NUM_SAMPLES = 1000000;
+    const int    STATS_TILE_SIZE    = 1024;
+    if (tile_fraction < 1.0)
+      vw_out(InfoMessage) << "Using about " << 100.0 * tile_fraction
+                          << "% of the image tiles.\n";
+
+    std::vector<float> samples;
+    int stat_scale = asp::gather_stats_samples(image, STATS_TILE_SIZE, tile_fraction,
+                                               TARGET_NUM_SAMPLES, samples);
     vw_out(InfoMessage) << "Using downsample scale: " << stat_scale << std::endl;
 
-    ChannelAccumulator<vw::math::CDFAccumulator<float> > accumulator;
-    for_each_pixel( subsample( edge_extend(image, ConstantEdgeExtension()),
-                              stat_scale ),
-                    accumulator );
-
-    // Compute the CDF in parallel.
-    // -> Turned off because it makes the unit tests non-deterministic.
-    //Vector2i block_size(256,256);
-    //int buffer_size = 100000; // TODO: If this gets too large the CDFAccumulator class fails!
-    //vw::math::CDFAccumulator<float> accumulator(buffer_size);
-    //block_cdf_computation(image, accumulator, stat_scale, block_size);
-
-    result[0] = accumulator.quantile(0); // Min
-    result[1] = accumulator.quantile(1); // Max
-    result[2] = accumulator.approximate_mean();
-    result[3] = accumulator.approximate_stddev();
-    result[4] = accumulator.quantile(0.02); // Percentile values
-    result[5] = accumulator.quantile(0.98);
+    result = asp::stats_from_samples(samples);
 
     // Cache the results to disk
     if (use_cache) {
       vw_out() << "\t    Writing stats file: " << cache_path << std::endl;
-      Vector<float32> stats = result;  // cast
-      write_vector(cache_path, stats);
+      asp::write_cached_stats(cache_path, result, tile_fraction);
     }
 
   } // Done computing the results
@@ -358,7 +358,8 @@ void StereoSessionIsis::preprocessing_hook(bool adjust_left_image_size,
                                              left_cropped_file, right_cropped_file,
                                              left_nodata_value, right_nodata_value,
                                              has_left_georef,   has_right_georef,
-                                             left_georef,       right_georef);
+                                             left_georef,       right_georef,
+                                             false); // virtual_images
 
   if (exit_early)
     return;
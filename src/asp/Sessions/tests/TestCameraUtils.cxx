@@ -0,0 +1,116 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <asp/Sessions/CameraUtils.h>
+#include <asp/Camera/CsmModel.h>
+#include <asp/Camera/LinescanDGModel.h>
+#include <test/Helpers.h>
+#include <vw/Core/StringUtils.h>
+
+#include <xercesc/util/PlatformUtils.hpp>
+#include <boost/filesystem.hpp>
+
+using namespace vw;
+using namespace asp;
+using namespace xercesc;
+namespace fs = boost::filesystem;
+
+TEST(CameraUtils, ParallelLoadKeepsOrder) {
+  XMLPlatformUtils::Initialize();
+
+  std::vector<std::string> camera_files, image_files;
+  for (int it = 0; it < 9; it++) {
+    camera_files.push_back("dg_example" + vw::num_to_str(1 + it % 3) + ".xml");
+    image_files.push_back("");
+  }
+
+  // Load the cameras one at a time, and then in parallel
+  vw::GdalWriteOptions opt;
+  std::vector<vw::CamPtr> serial_cams, parallel_cams;
+  bool single_threaded_cameras = false;
+  bool approximate_pinhole_intrinsics = false;
+  std::string camera_cache_dir = "";
+  std::string stereo_session = "dg";
+  opt.num_threads = 1;
+  load_cameras(image_files, camera_files, "run/run", opt, approximate_pinhole_intrinsics,
+               camera_cache_dir, stereo_session, single_threaded_cameras, serial_cams);
+  stereo_session = "dg";
+  opt.num_threads = 4;
+  load_cameras(image_files, camera_files, "run/run", opt, approximate_pinhole_intrinsics,
+               camera_cache_dir, stereo_session, single_threaded_cameras, parallel_cams);
+  EXPECT_EQ("dg", stereo_session);
+  EXPECT_FALSE(single_threaded_cameras);
+
+  ASSERT_EQ(camera_files.size(), serial_cams.size());
+  ASSERT_EQ(camera_files.size(), parallel_cams.size());
+  Vector2 pix(1000, 2000);
+  for (size_t it = 0; it < camera_files.size(); it++) {
+    ASSERT_TRUE(parallel_cams[it].get() != NULL);
+    EXPECT_VECTOR_NEAR(serial_cams[it]->camera_center(pix),
+                       parallel_cams[it]->camera_center(pix), 1e-8);
+    EXPECT_VECTOR_NEAR(serial_cams[it]->pixel_to_vector(pix),
+                       parallel_cams[it]->pixel_to_vector(pix), 1e-12);
+  }
+
+  // Different files give different cameras, so the order is checked
+  EXPECT_GT(norm_2(parallel_cams[0]->camera_center(pix) -
+                   parallel_cams[1]->camera_center(pix)), 1.0);
+
+  XMLPlatformUtils::Terminate();
+}
+
+TEST(CameraUtils, CameraCacheHit) {
+  XMLPlatformUtils::Initialize();
+
+  // Make CSM state files from DG cameras
+  UnlinkName cam_file1("cache_test_cam1.json"), cam_file2("cache_test_cam2.json");
+  UnlinkName cache_dir("cache_test_dir");
+  vw::CamPtr dg_cam1 = load_dg_camera_model_from_xml("dg_example1.xml");
+  vw::CamPtr dg_cam2 = load_dg_camera_model_from_xml("dg_example2.xml");
+  boost::shared_ptr<CsmModel> csm_cam1 = dynamic_cast<DGCameraModel*>(dg_cam1.get())->m_csm_model;
+  boost::shared_ptr<CsmModel> csm_cam2 = dynamic_cast<DGCameraModel*>(dg_cam2.get())->m_csm_model;
+  csm_cam1->saveState(cam_file1);
+  csm_cam2->saveState(cam_file2);
+
+  std::vector<std::string> camera_files(1, cam_file1), image_files(1, "");
+  vw::GdalWriteOptions opt;
+  std::vector<vw::CamPtr> cams;
+  bool single_threaded_cameras = false;
+  std::string stereo_session = "csm";
+  load_cameras(image_files, camera_files, "run/run", opt, false, cache_dir,
+               stereo_session, single_threaded_cameras, cams);
+  ASSERT_EQ(1u, cams.size());
+
+  // The camera was added to the cache
+  std::vector<fs::path> cached_files;
+  for (fs::directory_iterator it(cache_dir.c_str()); it != fs::directory_iterator(); it++)
+    cached_files.push_back(it->path());
+  ASSERT_EQ(1u, cached_files.size());
+
+  // Replace the cached camera. It must be what is loaded next time
+  // rather than the camera file.
+  fs::copy_file(cam_file2.c_str(), cached_files[0], fs::copy_option::overwrite_if_exists);
+  load_cameras(image_files, camera_files, "run/run", opt, false, cache_dir,
+               stereo_session, single_threaded_cameras, cams);
+  ASSERT_EQ(1u, cams.size());
+  Vector2 pix(1000, 2000);
+  EXPECT_VECTOR_NEAR(csm_cam2->camera_center(pix), cams[0]->camera_center(pix), 1e-3);
+  EXPECT_GT(norm_2(csm_cam1->camera_center(pix) - cams[0]->camera_center(pix)), 1.0);
+  
+  XMLPlatformUtils::Terminate();
+}
@@ -22,6 +22,7 @@
 // BundleAdjustUtils.cc.
 #include <vw/Camera/CameraUtilities.h>
 #include <vw/Core/CmdUtils.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/FileIO/MatrixIO.h>
 #include <asp/Core/Macros.h>
 #include <asp/Sessions/StereoSession.h>
@@ -32,6 +33,7 @@
 #include <asp/Core/IpMatchingAlgs.h> // Lightweight header for ip matching
 #include <asp/Tools/bundle_adjust.h>
 #include <asp/Camera/CsmModel.h>
+#include <asp/Camera/BundleAdjustPartition.h>
 #include <asp/Core/OutlierProcessing.h>
 #include <asp/Core/DataLoader.h>
 
@@ -39,6 +41,10 @@
 
 #include <xercesc/util/PlatformUtils.hpp>
 
+#include <algorithm>
+#include <functional>
+#include <limits>
+
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
 
@@ -213,12 +219,26 @@ private:
   asp::BAParams const& m_param_storage;
 };
 
+/// The options for evaluating the residuals
+ceres::Problem::EvaluateOptions residual_eval_options(Options const& opt,
+                                                      bool apply_loss_function) {
+  ceres::Problem::EvaluateOptions eval_options;
+  eval_options.apply_loss_function = apply_loss_function;
+  if (opt.single_threaded_cameras)
+    eval_options.num_threads = 1; // ISIS must be single threaded!
+  else
+    eval_options.num_threads = opt.num_threads;
+  return eval_options;
+}
+
 /// Add error source for projecting a 3D point into the camera.
 void add_reprojection_residual_block(Vector2 const& observation, Vector2 const& pixel_sigma,
                                      int point_index, int camera_index, 
                                      asp::BAParams & param_storage,
                                      Options const& opt,
-                                     ceres::Problem & problem){
+                                     ceres::Problem & problem,
+                                     std::vector<AdjustedModelCheck> & model_checks,
+                                     std::vector<CameraSurrogate> * surrogates){
 
   ceres::LossFunction* loss_function;
   loss_function = get_loss_function(opt);
@@ -230,10 +250,18 @@ void add_reprojection_residual_block(Vector2 const& observation, Vector2 const&
 
   if (opt.camera_type == BaCameraType_Other) {
     // The generic camera case
-    boost::shared_ptr<CeresBundleModelBase> wrapper(new AdjustedCameraBundleModel(camera_model));
-      ceres::CostFunction* cost_function =
-        BaReprojectionError::Create(observation, pixel_sigma, wrapper);
-      problem.AddResidualBlock(cost_function, loss_function, point, camera);
+    ceres::CostFunction* cost_function =
+      BaAdjustedReprojectionError::Create(observation, pixel_sigma, camera_model,
+                                          model_checks[camera_index], opt.camera_surrogate);
+    problem.AddResidualBlock(cost_function, loss_function, point, camera);
+
+    // Keep the cost functions which can use a linearized camera
+    CameraSurrogate surrogate;
+    surrogate.cost_function = dynamic_cast<BaAdjustedReprojectionError*>(cost_function);
+    surrogate.point  = point;
+    surrogate.camera = camera;
+    if (surrogates != NULL && surrogate.cost_function != NULL)
+      surrogates->push_back(surrogate);
 
   } else { // Pinhole and optical bar
 
@@ -374,64 +402,121 @@ void add_disparity_residual_block(Vector3 const& reference_xyz,
 //----------------------------------------------------------------
 // Residuals functions
 
-/// Compute the residuals
-void compute_residuals(bool apply_loss_function,
-                       Options const& opt,
-                       asp::BAParams const& param_storage,
-                       std::vector<size_t> const& cam_residual_counts,
-                       size_t num_gcp_or_dem_residuals,
-                       size_t num_tri_residuals,
-                       std::vector<vw::Vector3> const& reference_vec,
-                       ceres::Problem & problem,
-                       // Output
-                       std::vector<double> & residuals) {
-  // TODO: Associate residuals with cameras!
-  // Generate some additional diagnostic info
-  double cost = 0.0;
-  ceres::Problem::EvaluateOptions eval_options;
-  eval_options.apply_loss_function = apply_loss_function;
-  if (opt.single_threaded_cameras)
-    eval_options.num_threads = 1; // ISIS must be single threaded!
-  else
-    eval_options.num_threads = opt.num_threads;
+/// The residual blocks of the problem, in the order they were added.
+/// Verify that our book-keeping is correct.
+void get_residual_blocks(Options const& opt,
+                         asp::BAParams const& param_storage,
+                         std::vector<size_t> const& cam_residual_counts,
+                         size_t num_gcp_or_dem_residuals,
+                         size_t num_tri_residuals,
+                         std::vector<vw::Vector3> const& reference_vec,
+                         ceres::Problem & problem,
+                         // Output
+                         std::vector<ceres::ResidualBlockId> & residual_blocks) {
 
-  problem.Evaluate(eval_options, &cost, &residuals, 0, 0);
-  const size_t num_residuals = residuals.size();
-  
-  // Verify our book-keeping is correct
-  size_t num_expected_residuals
-    = (num_gcp_or_dem_residuals + num_tri_residuals) * param_storage.params_per_point();
-  size_t total_num_cam_params   = param_storage.num_cameras()*param_storage.params_per_camera();
+  problem.GetResidualBlocks(&residual_blocks);
+
+  // Each camera constraint is one block per camera
+  size_t num_expected_blocks = num_gcp_or_dem_residuals + num_tri_residuals;
   for (size_t i=0; i<param_storage.num_cameras(); i++)
-    num_expected_residuals += cam_residual_counts[i]*PIXEL_SIZE;
+    num_expected_blocks += cam_residual_counts[i];
   if (opt.camera_weight > 0)
-    num_expected_residuals += total_num_cam_params;
+    num_expected_blocks += param_storage.num_cameras();
   if (opt.rotation_weight > 0 || opt.translation_weight > 0)
-    num_expected_residuals += total_num_cam_params;
-  num_expected_residuals += reference_vec.size() * PIXEL_SIZE;
-  
-  if (num_expected_residuals != num_residuals)
-    vw_throw( LogicErr() << "Expected " << num_expected_residuals
-                         << " residuals but instead got " << num_residuals);
+    num_expected_blocks += param_storage.num_cameras();
+  num_expected_blocks += reference_vec.size();
+
+  if (num_expected_blocks != residual_blocks.size())
+    vw_throw( LogicErr() << "Expected " << num_expected_blocks
+                         << " residual blocks but instead got " << residual_blocks.size());
 }
 
-/// Compute residual map by averaging all the reprojection error at a given point
-void compute_mean_residuals_at_xyz(CRNJ & crn,
-                                  std::vector<double> const& residuals,
-                                  asp::BAParams const& param_storage,
-                                  // outputs
-                                  std::vector<double> & mean_residuals,
-                                  std::vector<int>  & num_point_observations) {
+/// Evaluate the residual blocks in the given range. Only their
+/// parameter blocks are passed to Ceres, so the memory this takes is
+/// proportional to the size of the range. The total time of evaluating
+/// all ranges still grows with the number of residuals. The residual
+/// and parameter block lists of the given options are overwritten, so
+/// when called once per range with the same options their storage is
+/// allocated once and reused.
+void evaluate_residual_blocks(ceres::Problem & problem,
+                              ceres::Problem::EvaluateOptions & eval_options,
+                              std::vector<ceres::ResidualBlockId> const& residual_blocks,
+                              size_t begin, size_t end,
+                              // Output
+                              std::vector<double> & residuals) {
+
+  // The parameter blocks of the range, without repetitions
+  std::vector<double*> & param_blocks = eval_options.parameter_blocks;
+  param_blocks.clear();
+  std::vector<double*> block_params;
+  for (size_t it = begin; it < end; it++) {
+    problem.GetParameterBlocksForResidualBlock(residual_blocks[it], &block_params);
+    param_blocks.insert(param_blocks.end(), block_params.begin(), block_params.end());
+  }
+  std::sort(param_blocks.begin(), param_blocks.end());
+  param_blocks.erase(std::unique(param_blocks.begin(), param_blocks.end()),
+                     param_blocks.end());
 
-  mean_residuals.resize(param_storage.num_points());
-  num_point_observations.resize(param_storage.num_points());
+  eval_options.residual_blocks.assign(residual_blocks.begin() + begin,
+                                      residual_blocks.begin() + end);
+
+  residuals.clear();
+  double cost = 0.0;
+  if (begin < end)
+    problem.Evaluate(eval_options, &cost, &residuals, NULL, NULL);
+}
+
+/// Evaluate the pixel reprojection residuals a group of cameras at a
+/// time, rather than all at once, to save memory. For each group, call
+/// the given function with the index of the first camera, the number of
+/// cameras, and their residuals. The reprojection residuals are at the
+/// beginning of the problem in the same order they were originally
+/// added to Ceres, by camera.
+void for_each_camera_group(Options const& opt, bool apply_loss_function,
+                           std::vector<size_t> const& cam_residual_counts,
+                           std::vector<ceres::ResidualBlockId> const& residual_blocks,
+                           ceres::Problem & problem,
+                           std::function<void(size_t, size_t,
+                                              std::vector<double> const&)> func) {
+
+  // This many observations at a time, but always whole cameras
+  const size_t max_group_size = 1000000;
+  
+  ceres::Problem::EvaluateOptions eval_options
+    = residual_eval_options(opt, apply_loss_function);
   
-  // Observation residuals are stored at the beginning of the residual vector in the 
-  //  same order they were originally added to Ceres.
+  std::vector<double> residuals;
+  size_t num_cameras = cam_residual_counts.size();
+  size_t block_index = 0;
+  for (size_t beg_cam = 0; beg_cam < num_cameras; ) {
+    size_t end_cam = beg_cam, group_size = 0;
+    while (end_cam < num_cameras &&
+           (end_cam == beg_cam || group_size + cam_residual_counts[end_cam] <= max_group_size)) {
+      group_size += cam_residual_counts[end_cam];
+      end_cam++;
+    }
+    
+    evaluate_residual_blocks(problem, eval_options, residual_blocks,
+                             block_index, block_index + group_size, residuals);
+    func(beg_cam, end_cam - beg_cam, residuals);
+    
+    block_index += group_size;
+    beg_cam = end_cam;
+  }
+}
+
+/// Add the reprojection errors of the given cameras to the sum of
+/// errors at each point, and count them.
+void accumulate_residuals_at_xyz(CRNJ & crn, size_t beg_cam, size_t num_cams,
+                                 std::vector<double> const& residuals,
+                                 asp::BAParams const& param_storage,
+                                 // outputs
+                                 std::vector<double> & mean_residuals,
+                                 std::vector<int>  & num_point_observations) {
   
   size_t residual_index = 0;
   // Double loop through cameras and crn entries will give us the correct order
-  for ( size_t icam = 0; icam < param_storage.num_cameras(); icam++ ) {
+  for (size_t icam = beg_cam; icam < beg_cam + num_cams; icam++) {
     typedef CameraNode<JFeature>::const_iterator crn_iter;
     for (crn_iter fiter = crn[icam].begin(); fiter != crn[icam].end(); fiter++){
 
@@ -455,7 +540,15 @@ void compute_mean_residuals_at_xyz(CRNJ & crn,
     }
   } // End double loop through all the observations
 
-  // Do the averaging
+  if (residual_index != residuals.size())
+    vw_throw( LogicErr() << "Have " << residuals.size() << " residuals, but iterated through "
+              << residual_index);
+}
+
+/// Turn the sums of errors at each point into their means
+void average_residuals_at_xyz(asp::BAParams const& param_storage,
+                              std::vector<double> & mean_residuals,
+                              std::vector<int>  & num_point_observations) {
   for (size_t i = 0; i < param_storage.num_points(); i++) {
     if (param_storage.get_point_outlier(i)) {
       // Skip outliers. But initialize to something.
@@ -465,10 +558,89 @@ void compute_mean_residuals_at_xyz(CRNJ & crn,
     }
     mean_residuals[i] /= static_cast<double>(num_point_observations[i]);
   }
+}
+
+/// Compute residual map by averaging all the reprojection error at a given point
+void compute_mean_residuals_at_xyz(CRNJ & crn,
+                                   Options const& opt,
+                                   asp::BAParams const& param_storage,
+                                   std::vector<size_t> const& cam_residual_counts,
+                                   std::vector<ceres::ResidualBlockId> const& residual_blocks,
+                                   ceres::Problem & problem,
+                                   // outputs
+                                   std::vector<double> & mean_residuals,
+                                   std::vector<int>  & num_point_observations) {
+
+  mean_residuals.assign(param_storage.num_points(), 0.0);
+  num_point_observations.assign(param_storage.num_points(), 0);
+
+  // This is the reprojection error, without the loss function
+  bool apply_loss_function = false;
+  for_each_camera_group(opt, apply_loss_function, cam_residual_counts, residual_blocks, problem,
+                        [&](size_t beg_cam, size_t num_cams, std::vector<double> const& residuals) {
+                          accumulate_residuals_at_xyz(crn, beg_cam, num_cams, residuals,
+                                                      param_storage, mean_residuals,
+                                                      num_point_observations);
+                        });
+  
+  average_residuals_at_xyz(param_storage, mean_residuals, num_point_observations);
   
 } // End function compute_mean_residuals_at_xyz
 
-/// Write out a .csv file recording the residual error at each location on the ground
+/// The text for one camera in the raw pixels file and the stats file.
+/// With binary residuals, the raw pixels text is not created.
+class FormatCameraResidualsTask: public vw::Task {
+  std::string m_name;
+  double const* m_residuals;
+  size_t m_num_residuals;
+  bool m_format_raw_pixels;
+  std::string & m_raw_pixels_text, & m_stats_text;
+public:
+  FormatCameraResidualsTask(std::string const& name, double const* residuals,
+                            size_t num_residuals, bool format_raw_pixels,
+                            std::string & raw_pixels_text, std::string & stats_text):
+    m_name(name), m_residuals(residuals), m_num_residuals(num_residuals),
+    m_format_raw_pixels(format_raw_pixels),
+    m_raw_pixels_text(raw_pixels_text), m_stats_text(stats_text) {}
+
+  virtual void operator()() {
+    std::ostringstream stats;
+    stats.precision(18);
+
+    if (m_format_raw_pixels)
+      m_raw_pixels_text = asp::raw_pixels_residual_text(m_name, m_residuals, m_num_residuals);
+
+    // All residuals are for inliers, as we do not even add a residual
+    // for an outlier
+    
+    double mean_residual = 0; // Take average of all pixel coord errors
+    std::vector<double> residual_norms;
+    for (size_t i = 0; i < m_num_residuals; i++) {
+      double ex = m_residuals[PIXEL_SIZE*i];
+      double ey = m_residuals[PIXEL_SIZE*i + 1];
+      double residual_norm = std::sqrt(ex * ex + ey * ey);
+      mean_residual += residual_norm;
+      residual_norms.push_back(residual_norm);
+    }
+    // Write line for the summary file
+    mean_residual /= static_cast<double>(m_num_residuals);
+    double median_residual = std::numeric_limits<double>::quiet_NaN();
+    if (residual_norms.size() > 0) {
+      std::sort(residual_norms.begin(), residual_norms.end());
+      median_residual = residual_norms[residual_norms.size()/2];
+    }
+    
+    stats << m_name                 << ", "
+          << mean_residual          << ", "
+          << median_residual        << ", "
+          << m_num_residuals        << std::endl;
+
+    m_stats_text = stats.str();
+  }
+};
+
+/// Write out a .csv file recording the residual error at each location
+/// on the ground. With --binary-residuals, write a .bin file instead.
 void write_residual_map(std::string const& output_prefix,
                         // Mean residual of each point
                         std::vector<double> const& mean_residuals,
@@ -478,7 +650,7 @@ void write_residual_map(std::string const& output_prefix,
                         ControlNetwork const& cnet,
                         Options const& opt) {
 
-  std::string output_path = output_prefix + ".csv";
+  std::string output_path = output_prefix + (opt.binary_residuals ? ".bin" : ".csv");
 
   if (opt.datum.name() == asp::UNSPECIFIED_DATUM) {
     vw_out(WarningMessage) << "No datum specified, can't write file: " << output_path << ". "
@@ -497,13 +669,17 @@ void write_residual_map(std::string const& output_prefix,
   // Open the output file and write the header
   vw_out() << "Writing: " << output_path << std::endl;
   std::ofstream file;
-  file.open(output_path.c_str());
-  file.precision(18); // TODO(oalexan1): Replace here by 17
-  file << "# lon, lat, height_above_datum, mean_residual, num_observations\n";
-
-  // stereo_gui counts on being able to parse the datum from this file, so
-  // do not modify the line below.
-  file << "# " << opt.datum << std::endl;
+  std::ostringstream datum;
+  datum << opt.datum;
+  if (opt.binary_residuals) {
+    file.open(output_path.c_str(), std::ios::binary);
+    asp::write_residual_map_header_binary(file, datum.str());
+  } else {
+    // stereo_gui counts on being able to parse the datum from this
+    // file, so do not modify the header.
+    file.open(output_path.c_str());
+    file << asp::residual_map_header_text(datum.str());
+  }
   
   // Now write all the points to the file
   for (size_t i = 0; i < param_storage.num_points(); i++) {
@@ -511,20 +687,24 @@ void write_residual_map(std::string const& output_prefix,
     if (param_storage.get_point_outlier(i))
       continue; // skip outliers
     
-      // The final GCC coordinate of this point
-      const double * point = param_storage.get_point_ptr(i);
-      Vector3 xyz(point[0], point[1], point[2]);
+    // The final GCC coordinate of this point
+    const double * point = param_storage.get_point_ptr(i);
+    Vector3 xyz(point[0], point[1], point[2]);
 
-      Vector3 llh = opt.datum.cartesian_to_geodetic(xyz);
+    Vector3 llh = opt.datum.cartesian_to_geodetic(xyz);
 
-      std::string comment = "";
-      if (cnet[i].type() == ControlPoint::GroundControlPoint)
-        comment = " # GCP";
-      else if (cnet[i].type() == ControlPoint::PointFromDem)
-        comment = " # from DEM";
-      
-      file << llh[0] <<", "<< llh[1] <<", "<< llh[2] <<", "<< mean_residuals[i] <<", "
-           << num_point_observations[i] << comment << std::endl;
+    int type = 0;
+    if (cnet[i].type() == ControlPoint::GroundControlPoint)
+      type = 1;
+    else if (cnet[i].type() == ControlPoint::PointFromDem)
+      type = 2;
+
+    if (opt.binary_residuals)
+      asp::write_residual_map_point_binary(file, llh, mean_residuals[i],
+                                           num_point_observations[i], type);
+    else
+      file << asp::residual_map_point_text(llh, mean_residuals[i],
+                                           num_point_observations[i], type);
   }
   file.close();
 
@@ -543,17 +723,14 @@ void write_residual_logs(std::string const& residual_prefix, bool apply_loss_fun
                          ControlNetwork const& cnet, CRNJ & crn, 
                          ceres::Problem &problem) {
   
-  std::vector<double> residuals;
-  compute_residuals(apply_loss_function, opt, param_storage,
-                    cam_residual_counts, num_gcp_or_dem_residuals, num_tri_residuals,
-                    reference_vec, problem,
-                    // Output
-                    residuals);
-    
-  const size_t num_residuals = residuals.size();
+  std::vector<ceres::ResidualBlockId> residual_blocks;
+  get_residual_blocks(opt, param_storage, cam_residual_counts,
+                      num_gcp_or_dem_residuals, num_tri_residuals, reference_vec,
+                      problem, residual_blocks);
 
   const std::string residual_path               = residual_prefix + "_stats.txt";
-  const std::string residual_raw_pixels_path    = residual_prefix + "_raw_pixels.txt";
+  const std::string residual_raw_pixels_path    = residual_prefix
+    + (opt.binary_residuals ? "_raw_pixels.bin" : "_raw_pixels.txt");
   const std::string residual_raw_gcp_path       = residual_prefix + "_raw_gcp.txt";
   const std::string residual_raw_cams_path      = residual_prefix + "_raw_cameras.txt";
   const std::string residual_reference_xyz_path = residual_prefix + "_reference_terrain.txt";
@@ -568,7 +745,12 @@ void write_residual_logs(std::string const& residual_prefix, bool apply_loss_fun
   
   residual_file.open(residual_path.c_str());
   residual_file.precision(18); // TODO(oalexan1): Replace here with 17
-  residual_file_raw_pixels.open(residual_raw_pixels_path.c_str());
+  // With --binary-residuals, each camera has its name, the number of
+  // pixels, then the column and row residual for each pixel as doubles
+  if (opt.binary_residuals)
+    residual_file_raw_pixels.open(residual_raw_pixels_path.c_str(), std::ios::binary);
+  else
+    residual_file_raw_pixels.open(residual_raw_pixels_path.c_str());
   residual_file_raw_pixels.precision(18); // TODO(oalexan1): Replace here with 17
   residual_file_raw_cams.open(residual_raw_cams_path.c_str());
   residual_file_raw_cams.precision(18); // TODO(oalexan1): Replace here with 17
@@ -579,49 +761,60 @@ void write_residual_logs(std::string const& residual_prefix, bool apply_loss_fun
     residual_file_reference_xyz.precision(18); // TODO(oalexan1): Replace here with 17
   }
   
-  size_t index = 0;
-  // For each camera, average together all the point observation residuals
+  // For each camera, average together all the point observation
+  // residuals. Also accumulate them at each point, for the residual map.
+  // The text for each camera is formatted in parallel, then written
+  // in order.
+  std::vector<double> mean_residuals(param_storage.num_points(), 0.0);
+  std::vector<int> num_point_observations(param_storage.num_points(), 0);
   residual_file << "Mean and median norm of residual error and point count for cameras:\n";
-  for (size_t c = 0; c < param_storage.num_cameras(); c++) {
-    size_t num_this_cam_residuals = cam_residual_counts[c];
-    
-    // Write header for the raw file
-    std::string name = opt.camera_files[c];
-    if (name == "")
-      name = opt.image_files[c];
+  for_each_camera_group(opt, apply_loss_function, cam_residual_counts, residual_blocks, problem,
+                        [&](size_t beg_cam, size_t num_cams, std::vector<double> const& residuals) {
     
-    residual_file_raw_pixels << name << ", " << num_this_cam_residuals << std::endl;
-
-    // All residuals are for inliers, as we do not even add a residual
-    // for an outlier
-    
-    double mean_residual = 0; // Take average of all pixel coord errors
-    std::vector<double> residual_norms;
-    for (size_t i = 0; i < num_this_cam_residuals; i++) {
-      double ex = residuals[index];
-      ++index;
-      double ey = residuals[index];
-      ++index;
-      double residual_norm = std::sqrt(ex * ex + ey * ey);
-      mean_residual += residual_norm;
-      residual_norms.push_back(residual_norm);
-      residual_file_raw_pixels << ex << ", " << ey << std::endl; // Write ex, ey on raw file
-    }
-    // Write line for the summary file
-    mean_residual /= static_cast<double>(num_this_cam_residuals);
-    double median_residual = std::numeric_limits<double>::quiet_NaN();
-    if (residual_norms.size() > 0) {
-      std::sort(residual_norms.begin(), residual_norms.end());
-      median_residual = residual_norms[residual_norms.size()/2];
+    std::vector<std::string> raw_pixels_text(num_cams), stats_text(num_cams);
+    FifoWorkQueue queue(std::max(opt.num_threads, 1));
+    size_t index = 0;
+    for (size_t c = beg_cam; c < beg_cam + num_cams; c++) {
+      std::string name = opt.camera_files[c];
+      if (name == "")
+        name = opt.image_files[c];
+      boost::shared_ptr<FormatCameraResidualsTask> task
+        (new FormatCameraResidualsTask(name, residuals.data() + index, cam_residual_counts[c],
+                                       !opt.binary_residuals,
+                                       raw_pixels_text[c - beg_cam], stats_text[c - beg_cam]));
+      queue.add_task(task);
+      if (opt.binary_residuals)
+        asp::write_raw_pixels_residual_binary(residual_file_raw_pixels, name,
+                                              residuals.data() + index,
+                                              cam_residual_counts[c]);
+      index += PIXEL_SIZE * cam_residual_counts[c];
     }
+    queue.join_all();
     
-    residual_file << name                   << ", "
-                  << mean_residual          << ", "
-                  << median_residual        << ", "
-                  << num_this_cam_residuals << std::endl;
-  }
+    for (size_t c = 0; c < num_cams; c++) {
+      residual_file_raw_pixels << raw_pixels_text[c];
+      residual_file            << stats_text[c];
+    }
+
+    accumulate_residuals_at_xyz(crn, beg_cam, num_cams, residuals, param_storage,
+                                mean_residuals, num_point_observations);
+  });
   
   residual_file_raw_pixels.close();
+
+  // The other residuals, except for the triangulation constraints,
+  // which are not saved
+  size_t num_reproj_blocks = 0;
+  for (size_t c = 0; c < param_storage.num_cameras(); c++)
+    num_reproj_blocks += cam_residual_counts[c];
+  std::vector<double> residuals;
+  ceres::Problem::EvaluateOptions eval_options
+    = residual_eval_options(opt, apply_loss_function);
+  evaluate_residual_blocks(problem, eval_options,
+                           residual_blocks, num_reproj_blocks,
+                           residual_blocks.size() - num_tri_residuals, residuals);
+  const size_t num_residuals = residuals.size();
+  size_t index = 0;
   
   // List the GCP residuals
   if (num_gcp_or_dem_residuals > 0) {
@@ -696,19 +889,13 @@ void write_residual_logs(std::string const& residual_prefix, bool apply_loss_fun
     residual_file_reference_xyz.close();
   }
 
-  // Keep track of number of triangulation constraint residuals but don't save those
-  index += asp::BAParams::PARAMS_PER_POINT * num_tri_residuals;
-  
   if (index != num_residuals)
     vw_throw( LogicErr() << "Have " << num_residuals << " residuals, but iterated through "
               << index);
 
   // Generate the location based file
   std::string map_prefix = residual_prefix + "_pointmap";
-  std::vector<double> mean_residuals;
-  std::vector<int> num_point_observations;
-  compute_mean_residuals_at_xyz(crn,  residuals,  param_storage,
-                                mean_residuals, num_point_observations);
+  average_residuals_at_xyz(param_storage, mean_residuals, num_point_observations);
 
   write_residual_map(map_prefix, mean_residuals, num_point_observations,
                      param_storage, cnet, opt);
@@ -738,20 +925,16 @@ int add_to_outliers(ControlNetwork & cnet,
   const size_t num_points  = param_storage.num_points();
   const size_t num_cameras = param_storage.num_cameras();
   
-  // Compute the reprojection error. Hence we should not add the contribution
-  // of the loss function.
-  bool apply_loss_function = false;
-  std::vector<double> residuals;
-  compute_residuals(apply_loss_function,  
-                    opt, param_storage,  cam_residual_counts,  
-                    num_gcp_or_dem_residuals, num_tri_residuals, reference_vec, problem,
-                    // output
-                    residuals);
-
-  // Compute the mean residual at each xyz, and how many times that residual is seen
+  // Compute the mean reprojection error at each xyz, and how many
+  // times that residual is seen
+  std::vector<ceres::ResidualBlockId> residual_blocks;
+  get_residual_blocks(opt, param_storage, cam_residual_counts,
+                      num_gcp_or_dem_residuals, num_tri_residuals, reference_vec,
+                      problem, residual_blocks);
   std::vector<double> mean_residuals;
   std::vector<int   > num_point_observations;
-  compute_mean_residuals_at_xyz(crn,  residuals,  param_storage,
+  compute_mean_residuals_at_xyz(crn, opt, param_storage, cam_residual_counts, residual_blocks,
+                                problem,
                                 // outputs
                                 mean_residuals, num_point_observations);
 
@@ -1077,6 +1260,8 @@ int do_ba_ceres_one_pass(Options             & opt,
   
   // Add the various cost functions the solver will optimize over.
   std::vector<size_t> cam_residual_counts(num_cameras);
+  std::vector<CameraSurrogate> surrogates;
+  std::vector<AdjustedModelCheck> model_checks(num_cameras);
   typedef CameraNode<JFeature>::iterator crn_iter;
   for (int icam = 0; icam < num_cameras; icam++) { // Camera loop
     cam_residual_counts[icam] = 0;
@@ -1149,7 +1334,8 @@ int do_ba_ceres_one_pass(Options             & opt,
 
       // Call function to add the appropriate Ceres residual block.
       add_reprojection_residual_block(observation, pixel_sigma, ipt, icam,
-                                      param_storage, opt, problem);
+                                      param_storage, opt, problem, model_checks,
+                                      &surrogates);
       cam_residual_counts[icam] += 1; // Track the number of residual blocks for each camera
       
     } // end iterating over points
@@ -1454,8 +1640,27 @@ int do_ba_ceres_one_pass(Options             & opt,
 
   vw_out() << "Starting the Ceres optimizer." << std::endl;
   ceres::Solver::Summary summary;
-  ceres::Solve(options, &problem, &summary);
-  final_cost = summary.final_cost;
+  if (opt.num_partitions > 1) {
+    int num_threads = opt.num_threads;
+    if (opt.single_threaded_cameras)
+      num_threads = 1;
+    bool apply_loss_function = true;
+    asp::solve_partitioned(options, residual_eval_options(opt, apply_loss_function),
+                           opt.num_partitions, opt.num_partition_rounds, num_threads,
+                           param_storage, problem, summary, final_cost);
+  } else if (!opt.camera_surrogate || surrogates.empty()) {
+    ceres::Solve(options, &problem, &summary);
+    final_cost = summary.final_cost;
+  } else {
+    int num_threads = opt.num_threads;
+    if (opt.single_threaded_cameras)
+      num_threads = 1;
+    bool apply_loss_function = true;
+    solve_with_camera_surrogates(options, residual_eval_options(opt, apply_loss_function),
+                                 opt.max_surrogate_refits, opt.surrogate_tolerance,
+                                 num_threads, surrogates, param_storage, problem,
+                                 summary, final_cost);
+  }
   vw_out() << summary.FullReport() << "\n";
   if (summary.termination_type == ceres::NO_CONVERGENCE){
     // Print a clarifying message, so the user does not think that the algorithm failed.
@@ -1684,9 +1889,15 @@ void do_ba_ceres(Options & opt, std::vector<Vector3> const& estimated_camera_gcc
     
     // Must update the number of points after the control network is recomputed
     num_points = cnet.size();
-    param_storage.get_point_vector().resize(num_points*asp::BAParams::PARAMS_PER_POINT);
+    param_storage.resize_points(num_points);
   }
 
+  // Store the points seen by the same camera next to each other in
+  // memory, for faster access when building the Schur complement.
+  std::vector<int> point_order;
+  asp::camera_major_point_order(cnet, point_order);
+  param_storage.reorder_points(point_order);
+
   // Fill in the point vector with the starting values.
   for (int ipt = 0; ipt < num_points; ipt++)
     param_storage.set_point(ipt, cnet[ipt].position());
@@ -2028,6 +2239,20 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
      "How many interest points to detect in each image (default: automatic determination). It is overridden by --ip-per-tile if provided.")
     ("num-passes",           po::value(&opt.num_ba_passes)->default_value(2),
      "How many passes of bundle adjustment to do, with given number of iterations in each pass. For more than one pass, outliers will be removed between passes using --remove-outliers-params, and re-optimization will take place. Residual files and a copy of the match files with the outliers removed (*-clean.match) will be written to disk.")
+    ("num-partitions", po::value(&opt.num_partitions)->default_value(0),
+     "If more than 1, split the cameras into this many partitions, based on the triangulated points they see. Solve each partition on its own, in parallel, then solve for the cameras and points shared among partitions, and repeat. This is meant for many thousands of cameras. Does not work with --solve-intrinsics and ignores --camera-surrogate. Parameter bounds are respected.")
+    ("num-partition-rounds", po::value(&opt.num_partition_rounds)->default_value(3),
+     "With --num-partitions, solve the partitions and then the shared cameras and points at most this many times in each pass.")
+    ("binary-residuals", po::bool_switch(&opt.binary_residuals)->default_value(false)->implicit_value(true),
+     "Write the per-pixel residuals and the residuals at the triangulated points to binary files ending in raw_pixels.bin and pointmap.bin, rather than to text files, which is faster and takes less space for large problems. Convert them to text with parse_residual_file.py.")
+    ("camera-surrogate", po::bool_switch(&opt.camera_surrogate)->default_value(false)->implicit_value(true),
+     "In each pass, run the solver with each camera linearized about the current triangulated points and adjustments, which is much faster for expensive cameras, such as ISIS, CSM, or DG. The cameras are linearized again and the solver is run again until the cost with the exact cameras stops decreasing. Does not apply to pinhole and optical bar cameras.")
+    ("max-surrogate-refits", po::value(&opt.max_surrogate_refits)->default_value(5),
+     "With --camera-surrogate, linearize the cameras and run the solver at most this many times in each pass.")
+    ("surrogate-tolerance", po::value(&opt.surrogate_tolerance)->default_value(1e-3),
+     "With --camera-surrogate, stop linearizing the cameras again when the cost with the exact cameras decreases by less than this fraction.")
+    ("camera-cache-dir", po::value(&opt.camera_cache_dir)->default_value(""),
+     "Save the parsed CSM camera models in this directory, and read them from there in later runs rather than parsing the camera files again. Cached models are matched to the camera files by path, size, and modification time. Only CSM cameras are cached. DG, SPOT, Pleiades, and ISIS cameras are not, as their models have no saved form.")
     ("num-random-passes",           po::value(&opt.num_random_passes)->default_value(0),
      "After performing the normal bundle adjustment passes, do this many more passes using the same matches but adding random offsets to the initial parameter values with the goal of avoiding local minima that the optimizer may be getting stuck in.")
     ("remove-outliers-params", 
@@ -2096,6 +2321,8 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
      "The index of this parallel bundle adjustment process.")
     ("stop-after-statistics",    po::bool_switch(&opt.stop_after_stats)->default_value(false)->implicit_value(true),
      "Quit after computing image statistics.")
+    ("stats-tile-fraction",    po::value(&opt.stats_tile_fraction)->default_value(1.0),
+     "Compute the image statistics using only about this fraction of the image tiles, picked uniformly over the image. Must be positive and at most 1.")
     ("stop-after-matching",    po::bool_switch(&opt.stop_after_matching)->default_value(false)->implicit_value(true),
      "Quit after writing all match files.")
     ("force-reuse-match-files", po::bool_switch(&opt.force_reuse_match_files)->default_value(false)->implicit_value(true),
@@ -2326,6 +2553,9 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
   if (opt.approximate_pinhole_intrinsics && opt.solve_intrinsics)
     vw_throw( ArgumentErr() << "Cannot approximate intrinsics while solving for them.\n");
 
+  if (opt.num_partitions > 1 && opt.solve_intrinsics)
+    vw_throw( ArgumentErr() << "Cannot use --num-partitions with --solve-intrinsics.\n");
+
   if (opt.camera_type != BaCameraType_Other &&
       opt.camera_type != BaCameraType_Pinhole &&
       opt.input_prefix != "")
@@ -2861,7 +3091,7 @@ int main(int argc, char* argv[]) {
     handle_arguments(argc, argv, opt);
 
     asp::load_cameras(opt.image_files, opt.camera_files, opt.out_prefix, opt,  
-                      opt.approximate_pinhole_intrinsics,  
+                      opt.approximate_pinhole_intrinsics, opt.camera_cache_dir,
                       // Outputs
                       opt.stereo_session,  // may change
                       opt.single_threaded_cameras,  
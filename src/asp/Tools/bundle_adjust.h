@@ -66,13 +66,16 @@ struct Options: public asp::BaBaseOptions {
     transform_cameras_with_shared_gcp, transform_cameras_using_gcp,
     fix_gcp_xyz, solve_intrinsics,
     ip_normalize_tiles, ip_debug_images, stop_after_stats, stop_after_matching,
-    skip_matching, match_first_to_last, apply_initial_transform_only, save_vwip;
+    skip_matching, match_first_to_last, apply_initial_transform_only, save_vwip,
+    camera_surrogate, binary_residuals;
   BACameraType camera_type;
   std::string datum_str, camera_position_file, initial_transform_file,
     csv_format_str, csv_proj4_str, reference_terrain, disparity_list,
     proj_str;
   double semi_major, semi_minor, position_filter_dist;
-  int    num_ba_passes, max_num_reference_points;
+  int    num_ba_passes, max_num_reference_points, max_surrogate_refits,
+    num_partitions, num_partition_rounds;
+  double surrogate_tolerance;
   std::string remove_outliers_params_str;
   std::vector<double> intrinsics_limits;
   boost::shared_ptr<vw::ba::ControlNetwork> cnet;
@@ -81,7 +84,7 @@ struct Options: public asp::BaBaseOptions {
   int    ip_detect_method, num_scales;
   double epipolar_threshold; // Max distance from epipolar line to search for IP matches.
   double ip_inlier_factor, ip_uniqueness_thresh, nodata_value, max_disp_error,
-    reference_terrain_weight, auto_overlap_buffer;
+    reference_terrain_weight, auto_overlap_buffer, stats_tile_fraction;
   bool   skip_rough_homography, enable_rough_homography, disable_tri_filtering,
     enable_tri_filtering, no_datum, individually_normalize, use_llh_error,
     force_reuse_match_files, save_cnet_as_csv,
@@ -101,10 +104,13 @@ struct Options: public asp::BaBaseOptions {
   // over-written later.
   Options(): ip_per_tile(0), ip_per_image(0), 
              forced_triangulation_distance(-1), overlap_exponent(0), 
-              save_intermediate_cameras(false),
+              save_intermediate_cameras(false), camera_surrogate(false),
+             binary_residuals(false),
              fix_gcp_xyz(false), solve_intrinsics(false), camera_type(BaCameraType_Other),
              semi_major(0), semi_minor(0), position_filter_dist(-1),
              num_ba_passes(2), max_num_reference_points(-1),
+             max_surrogate_refits(5), num_partitions(0), num_partition_rounds(3),
+             surrogate_tolerance(1e-3),
              datum(vw::cartography::Datum(asp::UNSPECIFIED_DATUM, "User Specified Spheroid",
                                           "Reference Meridian", 1, 1, 0)),
              ip_detect_method(0), num_scales(-1), skip_rough_homography(false),
@@ -140,6 +146,7 @@ struct Options: public asp::BaBaseOptions {
     
     asp::stereo_settings().individually_normalize     = individually_normalize;
     asp::stereo_settings().force_reuse_match_files    = force_reuse_match_files;
+    asp::stereo_settings().stats_tile_fraction        = stats_tile_fraction;
     asp::stereo_settings().min_triangulation_angle    = min_triangulation_angle;
     asp::stereo_settings().ip_triangulation_max_error = ip_triangulation_max_error;
     asp::stereo_settings().ip_num_ransac_iterations   = ip_num_ransac_iterations;
@@ -26,7 +26,12 @@
 #include <vw/Camera/CameraUtilities.h>
 #include <asp/Core/Macros.h>
 #include <asp/Core/StereoSettings.h>
+#include <asp/Camera/BundleAdjustCamera.h>
+#include <asp/Camera/BundleAdjustPartition.h>
 #include <vw/Camera/OpticalBarModel.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <sstream>
 
 
 // Turn off warnings from eigen
@@ -44,6 +49,8 @@
 
 #include <ceres/ceres.h>
 #include <ceres/loss_function.h>
+#include <ceres/jet.h>
+#include <ceres/rotation.h>
 
 #if defined(__GNUC__) || defined(__GNUG__)
 #if LOCAL_GCC_VERSION >= 40600
@@ -102,8 +109,9 @@ public:
   }
 
   /// Read in all of the parameters and generate an output pixel observation.
+  /// - The parameter blocks are in the order of get_block_sizes().
   /// - Throws if the point does not project in to the camera.
-  virtual vw::Vector2 evaluate(std::vector<double const*> const param_blocks) const = 0;
+  virtual vw::Vector2 evaluate(double const* const* param_blocks) const = 0;
   
 }; // End class CeresBundleModelBase
 
@@ -126,7 +134,7 @@ public:
   virtual int num_parameter_blocks() const {return 2;}
 
   /// Read in all of the parameters and compute the residuals.
-  virtual vw::Vector2 evaluate(std::vector<double const*> const param_blocks) const {
+  virtual vw::Vector2 evaluate(double const* const* param_blocks) const {
 
     double const* raw_point = param_blocks[0];
     double const* raw_pose  = param_blocks[1];
@@ -194,7 +202,7 @@ public:
   }
 
   /// Read in all of the parameters and compute the residuals.
-  virtual vw::Vector2 evaluate(std::vector<double const*> const param_blocks) const {
+  virtual vw::Vector2 evaluate(double const* const* param_blocks) const {
 
     double const* raw_point  = param_blocks[0];
     double const* raw_pose   = param_blocks[1];
@@ -282,7 +290,7 @@ public:
   }
 
   /// Read in all of the parameters and compute the residuals.
-  virtual vw::Vector2 evaluate(std::vector<double const*> const param_blocks) const {
+  virtual vw::Vector2 evaluate(double const* const* param_blocks) const {
 
     double const* raw_point  = param_blocks[0];
     double const* raw_pose   = param_blocks[1];
@@ -365,14 +373,8 @@ struct BaReprojectionError {
     //std::cout << "For observation " << m_observation << std::endl;
 
     try {
-      // Unpack the parameter blocks
-      std::vector<double const*> param_blocks(m_num_param_blocks);
-      for (size_t i=0; i<m_num_param_blocks; ++i) {
-        param_blocks[i] = parameters[i];
-      }
-
       // Use the camera model wrapper to handle all of the parameter blocks.
-      Vector2 prediction = m_camera_wrapper->evaluate(param_blocks);
+      Vector2 prediction = m_camera_wrapper->evaluate(parameters);
 
       //std::cout << "Got prediction " << prediction << std::endl;
 
@@ -434,6 +436,339 @@ private:
 
 }; // End class BaReprojectionError
 
+/// If BaAdjustedReprojectionError can be used for a camera. This is
+/// found once per camera, with the first observation in it.
+struct AdjustedModelCheck {
+  bool    done, agrees;
+  Vector3 rotation_center;
+  AdjustedModelCheck(): done(false), agrees(false) {}
+};
+
+/// The reprojection error for a camera with only a rotation and
+/// translation adjustment, with analytic derivatives. The adjusted
+/// camera projects a point X as the underlying camera projects
+/// R^{-1}(X - c - t) + c, with t the translation, R the rotation, and
+/// c the rotation center, as in vw::camera::AdjustedCameraModel. The derivatives
+/// of this map are exact, and only the underlying camera projection is
+/// differentiated numerically, which takes 6 projections rather than
+/// the 18 needed to differentiate numerically in the point and
+/// adjustment. No memory is allocated per evaluation.
+class BaAdjustedReprojectionError: public ceres::SizedCostFunction<2, 3, 6> {
+public:
+  BaAdjustedReprojectionError(Vector2 const& observation, Vector2 const& pixel_sigma,
+                              boost::shared_ptr<vw::camera::CameraModel> camera,
+                              Vector3 const& rotation_center, bool camera_surrogate):
+    m_observation(observation), m_pixel_sigma(pixel_sigma),
+    m_camera(camera), m_rotation_center(rotation_center),
+    m_camera_surrogate(camera_surrogate), m_have_surrogate(false) {}
+
+  /// The point in the coordinates of the underlying camera, and
+  /// optionally its derivatives in the rotation and the point (the
+  /// derivatives in the translation are the negatives of the latter).
+  void adjusted_point(double const* point, double const* adjustment, Vector3 & adj_point,
+                      double d_rotation[3][3], double d_point[3][3]) const {
+    typedef ceres::Jet<double, 6> JetT;
+    JetT neg_angle_axis[3], offset[3], rotated[3];
+    for (int i = 0; i < 3; i++) {
+      neg_angle_axis[i] = -JetT(adjustment[3 + i], i);
+      offset[i] = JetT(point[i] - m_rotation_center[i] - adjustment[i], 3 + i);
+    }
+    ceres::AngleAxisRotatePoint(neg_angle_axis, offset, rotated);
+    for (int i = 0; i < 3; i++) {
+      adj_point[i] = rotated[i].a + m_rotation_center[i];
+      for (int j = 0; j < 3; j++) {
+        d_rotation[i][j] = rotated[i].v[j];
+        d_point   [i][j] = rotated[i].v[3 + j];
+      }
+    }
+  }
+
+  /// Project a point with the underlying camera, and find the
+  /// derivative of the projection with central differences and the
+  /// same step as Ceres uses. Return false if the projection failed.
+  bool project(Vector3 const& adj_point, Vector2 & pixel, double d_pixel[2][3]) const {
+    try {
+      pixel = m_camera->point_to_pixel(adj_point);
+    } catch(...) {
+      return false;
+    }
+    
+    for (int k = 0; k < 3; k++) {
+      double step = std::max(std::abs(adj_point[k]), 1.0) * 1e-6;
+      Vector3 plus = adj_point, minus = adj_point;
+      plus[k]  += step;
+      minus[k] -= step;
+      Vector2 diff;
+      try {
+        diff = (m_camera->point_to_pixel(plus) - m_camera->point_to_pixel(minus))/(2.0*step);
+      } catch(...) {
+        diff = Vector2();
+      }
+      for (int r = 0; r < 2; r++)
+        d_pixel[r][k] = diff[r];
+    }
+    return true;
+  }
+
+  /// Replace the camera with its linearization about the current
+  /// point and adjustment, if this was created with camera_surrogate
+  /// set. Call this again when the parameters change much.
+  void fit_surrogate(double const* point, double const* adjustment) {
+    if (!m_camera_surrogate)
+      return;
+    double d_rotation[3][3], d_point[3][3];
+    adjusted_point(point, adjustment, m_surrogate_point, d_rotation, d_point);
+    m_have_surrogate = project(m_surrogate_point, m_surrogate_pixel, m_surrogate_jacobian);
+  }
+
+  /// Go back to using the exact camera
+  void clear_surrogate() { m_have_surrogate = false; }
+
+  virtual bool Evaluate(double const* const* parameters, double* residuals,
+                        double** jacobians) const {
+
+    double d_rotation[3][3], d_point[3][3];
+    Vector3 adj_point;
+    adjusted_point(parameters[0], parameters[1], adj_point, d_rotation, d_point);
+
+    Vector2 pixel;
+    double d_pixel[2][3];
+    bool success = true;
+    if (m_have_surrogate) {
+      Vector3 diff = adj_point - m_surrogate_point;
+      for (int r = 0; r < 2; r++) {
+        pixel[r] = m_surrogate_pixel[r];
+        for (int k = 0; k < 3; k++) {
+          pixel[r] += m_surrogate_jacobian[r][k] * diff[k];
+          d_pixel[r][k] = m_surrogate_jacobian[r][k];
+        }
+      }
+    } else if (jacobians != NULL) {
+      success = project(adj_point, pixel, d_pixel);
+    } else {
+      try {
+        pixel = m_camera->point_to_pixel(adj_point);
+      } catch(...) {
+        success = false;
+      }
+    }
+
+    // We must not allow one bad point to ruin the optimization
+    if (!success) {
+      pixel = vw::Vector2(g_big_pixel_value, g_big_pixel_value);
+      for (int r = 0; r < 2; r++)
+        for (int k = 0; k < 3; k++)
+          d_pixel[r][k] = 0.0;
+    }
+    for (int r = 0; r < 2; r++)
+      residuals[r] = (pixel[r] - m_observation[r])/m_pixel_sigma[r];
+
+    if (jacobians == NULL)
+      return true;
+
+    // The chain rule. The blocks are the point, then the translation and rotation.
+    for (int r = 0; r < 2; r++) {
+      for (int j = 0; j < 3; j++) {
+        double dp = 0.0, dr = 0.0;
+        for (int k = 0; k < 3; k++) {
+          dp += d_pixel[r][k] * d_point   [k][j];
+          dr += d_pixel[r][k] * d_rotation[k][j];
+        }
+        dp /= m_pixel_sigma[r];
+        dr /= m_pixel_sigma[r];
+        if (jacobians[0] != NULL)
+          jacobians[0][3*r + j] = dp;
+        if (jacobians[1] != NULL) {
+          jacobians[1][6*r + j]     = -dp;
+          jacobians[1][6*r + 3 + j] = dr;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  /// Check if the analytic form of the adjustment agrees with
+  /// vw::camera::AdjustedCameraModel for this camera, by projecting a
+  /// point along the ray through the observation with a nontrivial
+  /// adjustment. Set the center of rotation for which that happens.
+  static bool check_adjusted_model(Vector2 const& observation,
+                                   boost::shared_ptr<vw::camera::CameraModel> camera,
+                                   Vector3 & rotation_center) {
+    try {
+      Vector3 ctr = camera->camera_center(observation);
+      Vector3 point = ctr + 0.1 * norm_2(ctr) * camera->pixel_to_vector(observation);
+      double adjustment[6] = {1.0, -2.0, 3.0, 1e-5, -2e-5, 3e-5};
+      CameraAdjustment correction(adjustment);
+      vw::camera::AdjustedCameraModel adj_cam(camera, correction.position(),
+                                              correction.pose());
+      Vector2 exact_pix = adj_cam.point_to_pixel(point);
+
+      // Try rotating about the camera center, then about the origin
+      Vector3 centers[2] = {camera->camera_center(Vector2()), Vector3()};
+      for (int it = 0; it < 2; it++) {
+        BaAdjustedReprojectionError cost(observation, Vector2(1, 1), camera, centers[it],
+                                         false);
+        double d_rotation[3][3], d_point[3][3];
+        Vector3 adj_point;
+        cost.adjusted_point(&point[0], adjustment, adj_point, d_rotation, d_point);
+        if (norm_2(camera->point_to_pixel(adj_point) - exact_pix) < 1e-3) {
+          rotation_center = centers[it];
+          return true;
+        }
+      }
+    } catch(...) {}
+    
+    return false;
+  }
+
+  // Factory to hide the construction of the CostFunction object from
+  // the client code. If the analytic adjustment cannot be used for this
+  // camera, use numerical differentiation. The check for that is done
+  // only the first time a given check object is passed in. If
+  // camera_surrogate is set, the camera can be linearized.
+  static ceres::CostFunction* Create(Vector2 const& observation,
+                                     Vector2 const& pixel_sigma,
+                                     boost::shared_ptr<vw::camera::CameraModel> camera,
+                                     AdjustedModelCheck & check, bool camera_surrogate) {
+    if (!check.done) {
+      check.agrees = check_adjusted_model(observation, camera, check.rotation_center);
+      check.done   = true;
+    }
+    if (check.agrees)
+      return new BaAdjustedReprojectionError(observation, pixel_sigma, camera,
+                                             check.rotation_center, camera_surrogate);
+
+    boost::shared_ptr<CeresBundleModelBase> wrapper(new AdjustedCameraBundleModel(camera));
+    return BaReprojectionError::Create(observation, pixel_sigma, wrapper);
+  }
+  
+private:
+  
+  Vector2 m_observation;
+  Vector2 m_pixel_sigma;
+  boost::shared_ptr<vw::camera::CameraModel> m_camera;
+  Vector3 m_rotation_center;
+
+  // The linearized camera
+  bool    m_camera_surrogate, m_have_surrogate;
+  Vector3 m_surrogate_point;
+  Vector2 m_surrogate_pixel;
+  double  m_surrogate_jacobian[2][3];
+}; // End class BaAdjustedReprojectionError
+
+/// A reprojection error which can use a linearized camera, and its parameters
+struct CameraSurrogate {
+  BaAdjustedReprojectionError * cost_function; // owned by the Ceres problem
+  double * point;
+  double * camera;
+};
+
+/// Linearize the cameras for a range of reprojection errors about
+/// the current parameters.
+class FitSurrogatesTask: public vw::Task {
+  std::vector<CameraSurrogate> & m_surrogates;
+  size_t m_begin, m_end;
+public:
+  FitSurrogatesTask(std::vector<CameraSurrogate> & surrogates, size_t begin, size_t end):
+    m_surrogates(surrogates), m_begin(begin), m_end(end) {}
+  
+  virtual void operator()() {
+    for (size_t it = m_begin; it < m_end; it++)
+      m_surrogates[it].cost_function->fit_surrogate(m_surrogates[it].point,
+                                                    m_surrogates[it].camera);
+  }
+};
+
+void fit_camera_surrogates(int num_threads, std::vector<CameraSurrogate> & surrogates) {
+  
+  if (num_threads <= 0)
+    num_threads = 1;
+
+  const size_t chunk = 1000;
+  FifoWorkQueue queue(num_threads);
+  for (size_t begin = 0; begin < surrogates.size(); begin += chunk) {
+    size_t end = std::min(begin + chunk, surrogates.size());
+    boost::shared_ptr<FitSurrogatesTask> task(new FitSurrogatesTask(surrogates, begin, end));
+    queue.add_task(task);
+  }
+  queue.join_all();
+}
+
+void clear_camera_surrogates(std::vector<CameraSurrogate> & surrogates) {
+  for (size_t it = 0; it < surrogates.size(); it++)
+    surrogates[it].cost_function->clear_surrogate();
+}
+
+/// Solve the problem with the cameras linearized about the current
+/// parameters, then linearize them again about the solution, and so
+/// on, at most max_refits times. The cost with the exact cameras is
+/// checked after each solve. Stop when it decreases by less than the
+/// given fraction. If it increased, undo the last solve and finish
+/// with the exact cameras, so the result is never worse than without
+/// surrogates. The summary covers all solves.
+void solve_with_camera_surrogates(ceres::Solver::Options const& options,
+                                  ceres::Problem::EvaluateOptions const& eval_options,
+                                  int max_refits, double tolerance, int num_threads,
+                                  std::vector<CameraSurrogate> & surrogates,
+                                  asp::BAParams & param_storage,
+                                  ceres::Problem & problem,
+                                  ceres::Solver::Summary & summary,
+                                  double & final_cost) {
+
+  double cost = asp::problem_cost(eval_options, problem);
+  double initial_cost = cost;
+  asp::BAParams prev_params(param_storage);
+  int num_solves = 0;
+  bool used_exact_cameras = false;
+  for (int refit = 0; refit < max_refits; refit++) {
+
+    fit_camera_surrogates(num_threads, surrogates);
+    ceres::Solver::Summary solve_summary;
+    ceres::Solve(options, &problem, &solve_summary);
+    clear_camera_surrogates(surrogates);
+    if (num_solves == 0) {
+      summary = solve_summary;
+    } else {
+      asp::accumulate_summary(solve_summary, summary);
+      summary.total_time_in_seconds += solve_summary.total_time_in_seconds;
+    }
+    num_solves++;
+    
+    double exact_cost = asp::problem_cost(eval_options, problem);
+    vw_out() << "Cost with linearized cameras: " << solve_summary.final_cost
+             << ", with exact cameras: " << exact_cost << ".\n";
+    if (exact_cost > cost) {
+      vw_out() << "The exact cost increased. Undoing the last solver run "
+               << "and solving with the exact cameras.\n";
+      param_storage.copy_points (prev_params);
+      param_storage.copy_cameras(prev_params);
+      ceres::Solve(options, &problem, &solve_summary);
+      asp::accumulate_summary(solve_summary, summary);
+      summary.total_time_in_seconds += solve_summary.total_time_in_seconds;
+      cost = solve_summary.final_cost;
+      used_exact_cameras = true;
+      break;
+    }
+
+    bool small_change = (cost - exact_cost <= tolerance * cost);
+    cost = exact_cost;
+    if (small_change)
+      break;
+    
+    prev_params.copy_points (param_storage);
+    prev_params.copy_cameras(param_storage);
+  }
+
+  final_cost = cost;
+  summary.initial_cost = initial_cost;
+  summary.final_cost   = cost;
+  std::ostringstream os;
+  os << "Solved " << num_solves << " time(s) with linearized cameras"
+     << (used_exact_cameras ? ", then with the exact cameras." : ".");
+  summary.message = os.str();
+}
+
 /// A ceres cost function. Here we float two pinhole camera's
 /// intrinsic and extrinsic parameters. We take as input a reference
 /// xyz point and a disparity from left to right image. The
@@ -467,8 +802,8 @@ struct BaDispXyzError {
       unpack_residual_pointers(parameters, left_param_blocks, right_param_blocks);
 
       // Get pixel projection in both cameras.
-      Vector2 left_prediction  = m_left_camera_wrapper->evaluate (left_param_blocks );
-      Vector2 right_prediction = m_right_camera_wrapper->evaluate(right_param_blocks);
+      Vector2 left_prediction  = m_left_camera_wrapper->evaluate (&left_param_blocks [0]);
+      Vector2 right_prediction = m_right_camera_wrapper->evaluate(&right_param_blocks[0]);
 
       // See how consistent that is with the observed disparity.
       bool good_ans = true;
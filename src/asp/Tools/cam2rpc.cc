@@ -32,6 +32,7 @@
 #include <asp/Core/FileUtils.h>
 #include <asp/Camera/RPCModelGen.h>
 #include <asp/Core/PointUtils.h>
+#include <vw/Core/ThreadPool.h>
 
 #include <limits>
 #include <cstring>
@@ -51,7 +52,7 @@ using namespace vw::cartography;
 struct Options : public vw::GdalWriteOptions {
   double penalty_weight;
   string image_file, camera_file, output_rpc, stereo_session, bundle_adjust_prefix,
-    datum_str, dem_file, target_srs_string;
+    datum_str, dem_file, target_srs_string, batch_list;
   bool no_crop, skip_computing_rpc, save_tif, has_output_nodata;
   BBox2 lon_lat_range;
   BBox2i image_crop_box;
@@ -102,7 +103,9 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
     ("skip-computing-rpc", po::bool_switch(&opt.skip_computing_rpc)->default_value(false),
      "Skip computing the RPC model.")
     ("gsd",     po::value(&opt.gsd)->default_value(-1),
-     "Expected resolution on the ground, in meters. This is needed for SETSM.");
+     "Expected resolution on the ground, in meters. This is needed for SETSM.")
+    ("batch-list", po::value(&opt.batch_list)->default_value(""),
+     "Create RPC models for many cameras in one run. Each line of this file has an input image, camera, and output RPC file. The positional arguments are then not used.");
 
   general_options.add( vw::GdalWriteOptionsDescription(opt) );
 
@@ -125,12 +128,9 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
                             positional, positional_desc, usage,
                             allow_unregistered, unregistered);
 
-  if ( opt.image_file.empty() )
+  if ( opt.image_file.empty() && opt.batch_list.empty() )
     vw_throw( ArgumentErr() << "Missing input image.\n" << usage << general_options );
 
-  if (boost::iends_with(opt.image_file, ".cub") && opt.stereo_session == "" )
-    opt.stereo_session = "isis";
-
   // Need this to be able to load adjusted camera models. That will happen
   // in the stereo session.
   asp::stereo_settings().bundle_adjust_prefix = opt.bundle_adjust_prefix;
@@ -187,398 +187,556 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
   }
 }
 
-int main( int argc, char *argv[] ) {
-
-  Options opt;
-  try {
+// Project a range of ground points into the camera. Each point is
+// replaced by its round trip through ECEF. This is a bugfix for the
+// 360 deg offset problem.
+class ProjectPointsTask: public vw::Task, private boost::noncopyable {
+  CameraModel const* m_cam;
+  Datum const& m_datum;
+  size_t m_beg, m_end;
+  std::vector<Vector3> & m_llh;
+  std::vector<Vector2> & m_pixels;
+  std::vector<char>    & m_valid; // not vector<bool>, as it is written to in parallel
+  vw::Mutex & m_mutex;
+  vw::ProgressCallback const& m_progress;
+  double m_inc_amount;
+
+public:
+  ProjectPointsTask(CameraModel const* cam, Datum const& datum, size_t beg, size_t end,
+                    std::vector<Vector3> & llh, std::vector<Vector2> & pixels,
+                    std::vector<char> & valid, vw::Mutex & mutex,
+                    vw::ProgressCallback const& progress, double inc_amount):
+    m_cam(cam), m_datum(datum), m_beg(beg), m_end(end), m_llh(llh), m_pixels(pixels),
+    m_valid(valid), m_mutex(mutex), m_progress(progress), m_inc_amount(inc_amount) {}
+
+  void operator()() {
+    for (size_t i = m_beg; i < m_end; i++) {
+      Vector3 xyz = m_datum.geodetic_to_cartesian(m_llh[i]);
+      m_llh[i] = m_datum.cartesian_to_geodetic(xyz);
+      m_valid[i] = 0;
+      try {
+        // the point_to_pixel function can be capricious
+        m_pixels[i] = m_cam->point_to_pixel(xyz);
+        m_valid[i] = 1;
+      }catch(...){
+      }
+    }
 
-    handle_arguments(argc, argv, opt);
+    vw::Mutex::Lock lock(m_mutex);
+    m_progress.report_incremental_progress(m_inc_amount);
+  }
+};
 
-    typedef boost::scoped_ptr<asp::StereoSession> SessionPtr;
-    SessionPtr session(asp::StereoSessionFactory::create
-                       (opt.stereo_session, // may change inside
-                        opt,
-                        opt.image_file, opt.image_file,
-                        opt.camera_file, opt.camera_file,
-                        opt.output_rpc,
-                        opt.dem_file,
-                        false) ); // Do not allow promotion from normal to map projected session
-
-    // If the session was passed in or guessed isis or rpc, adjust for the fact
-    // that the isis .cub file also has camera info.
-    if ( opt.output_rpc.empty() &&
-         ((session->name() == "isis"         ||
-           session->name() == "isismapisis") ||
-          session->name()  == "rpc") ){
-      // The user did not provide an output file. Then the camera
-      // information is contained within the image file and what is in
-      // the camera file is actually the output file.
-      opt.output_rpc  = opt.camera_file;
-      opt.camera_file = opt.image_file;
-    }
+// Project ground points into the camera with the given number of
+// threads. The points which fail to project are flagged as invalid.
+void project_points(CameraModel const* cam, Datum const& datum, int num_threads,
+                    bool report_progress,
+                    std::vector<Vector3> & llh,
+                    std::vector<Vector2> & pixels,
+                    std::vector<char>    & valid) {
+
+  size_t num_pts = llh.size();
+  pixels.resize(num_pts);
+  valid.resize(num_pts);
+
+  vw::Mutex mutex;
+  vw::TerminalProgressCallback tpc("asp", "\t--> ");
+  vw::ProgressCallback const& progress
+    = report_progress ? tpc : vw::ProgressCallback::dummy_instance();
+  progress.report_progress(0);
+
+  const size_t PTS_PER_TASK = 1000;
+  double inc_amount = double(PTS_PER_TASK) / std::max(num_pts, size_t(1));
+  vw::FifoWorkQueue queue(std::max(num_threads, 1));
+  for (size_t beg = 0; beg < num_pts; beg += PTS_PER_TASK) {
+    size_t end = std::min(num_pts, beg + PTS_PER_TASK);
+    boost::shared_ptr<vw::Task>
+      task(new ProjectPointsTask(cam, datum, beg, end, llh, pixels, valid,
+                                 mutex, progress, inc_amount));
+    queue.add_task(task);
+  }
+  queue.join_all();
+  progress.report_finished();
+}
 
-    if ( opt.camera_file.empty() )
-      vw_throw( ArgumentErr() << "Missing input camera.\n" );
+// Load the camera to approximate. Set whether it can be used from
+// several threads. Sessions are created here, one at a time, as that
+// is not thread-safe.
+boost::shared_ptr<CameraModel> load_camera(Options & opt, bool & multithreaded) {
 
-    if ( opt.output_rpc.empty() )
-      vw_throw( ArgumentErr() << "Missing output RPC file.\n" );
+  if (boost::iends_with(opt.image_file, ".cub") && opt.stereo_session == "" )
+    opt.stereo_session = "isis";
 
-    // Create the output directory
-    vw::create_out_dir(opt.output_rpc);
+  typedef boost::scoped_ptr<asp::StereoSession> SessionPtr;
+  SessionPtr session(asp::StereoSessionFactory::create
+                     (opt.stereo_session, // may change inside
+                      opt,
+                      opt.image_file, opt.image_file,
+                      opt.camera_file, opt.camera_file,
+                      opt.output_rpc,
+                      opt.dem_file,
+                      false) ); // Do not allow promotion from normal to map projected session
+
+  // If the session was passed in or guessed isis or rpc, adjust for the fact
+  // that the isis .cub file also has camera info.
+  if ( opt.output_rpc.empty() &&
+       ((session->name() == "isis"         ||
+         session->name() == "isismapisis") ||
+        session->name()  == "rpc") ){
+    // The user did not provide an output file. Then the camera
+    // information is contained within the image file and what is in
+    // the camera file is actually the output file.
+    opt.output_rpc  = opt.camera_file;
+    opt.camera_file = opt.image_file;
+  }
 
-    boost::shared_ptr<CameraModel> cam = session->camera_model(opt.image_file, opt.camera_file);
+  if ( opt.camera_file.empty() )
+    vw_throw( ArgumentErr() << "Missing input camera.\n" );
 
-    // Get the input nodata value from the image file, unless the
-    // user overwrites it.
-    float val = std::numeric_limits<float>::quiet_NaN();
-    bool has_input_nodata = vw::read_nodata_val(opt.image_file, val);
-    if (has_input_nodata && boost::math::isnan(opt.input_nodata_value)) {
-      opt.input_nodata_value = val;
-    }
-    if (!boost::math::isnan(opt.input_nodata_value)) 
-      vw_out() << "Using input nodata value: " << opt.input_nodata_value << "\n";
-    else
-      has_input_nodata = false;
-
-    // If the output nodata value was not specified, use the input one
-    if (boost::math::isnan(opt.output_nodata_value)) 
-      opt.output_nodata_value = opt.input_nodata_value;
-
-    if (!boost::math::isnan(opt.output_nodata_value)) {
-      opt.has_output_nodata = true;
-      vw_out() << "Using output nodata value: " << opt.output_nodata_value << "\n";
-    }else{
-      opt.has_output_nodata = false;
-    }
+  if ( opt.output_rpc.empty() )
+    vw_throw( ArgumentErr() << "Missing output RPC file.\n" );
 
-    DiskImageView<float> disk_view(opt.image_file);
+  // Create the output directory
+  vw::create_out_dir(opt.output_rpc);
 
-    // The bounding box
-    BBox2 image_box = bounding_box(disk_view);
-    if (!opt.image_crop_box.empty()) 
-      image_box.crop(opt.image_crop_box);
+  multithreaded = session->supports_multi_threading();
+  return session->camera_model(opt.image_file, opt.camera_file);
+}
 
-    // TODO: Merge this code with what is in sfs.cc!
-    // Generate point pairs
-    std::vector<Vector3> all_llh;
-    std::vector<Vector2> all_pixels;
+// Collect the ground points, as longitude, latitude, and height, from
+// the lon-lat-height box or from the DEM. With a DEM, its datum is
+// used. These do not depend on the camera.
+void sample_ground(Options & opt, std::vector<Vector3> & ground_llh) {
 
-    vw_out() << "Projecting pixels into the camera to generate the RPC model.\n";
-    vw::TerminalProgressCallback tpc("asp", "\t--> ");
-    double inc_amount = 1.0 / double(opt.num_samples);
+  // TODO: Merge this code with what is in sfs.cc!
+  ground_llh.clear();
+  if (opt.dem_file.empty()) {
 
+    vw_out() << "Using datum: " << opt.datum << std::endl;
+
+    BBox2   & ll = opt.lon_lat_range; // shortcut
+    Vector2 & H  = opt.height_range;
+    double delta_lon = (ll.max()[0] - ll.min()[0])/double(opt.num_samples);
+    double delta_lat = (ll.max()[1] - ll.min()[1])/double(opt.num_samples);
+    double delta_ht  = (H[1] - H[0])/double(opt.num_samples);
+    for (double lon = ll.min()[0]; lon <= ll.max()[0]; lon += delta_lon) {
+      for (double lat = ll.min()[1]; lat <= ll.max()[1]; lat += delta_lat) {
+        for (double ht = H[0]; ht <= H[1]; ht += delta_ht) {
+          ground_llh.push_back(Vector3(lon, lat, ht));
+        }
+      }
+    }
 
-    // Mask the input image
-    ImageViewRef< PixelMask<float> > input_img
-      = create_mask_less_or_equal(disk_view, opt.input_nodata_value);
+  }else{
+    vw_out() << "Sampling the surface of the DEM: " << opt.dem_file  << std::endl;
 
-    if (opt.dem_file.empty()) {
+    float dem_nodata_val = -std::numeric_limits<float>::max(); 
+    vw::read_nodata_val(opt.dem_file, dem_nodata_val);
+    ImageView< PixelMask<double> > dem = create_mask
+      (channel_cast<double>(DiskImageView<float>(opt.dem_file)), dem_nodata_val);
 
-      vw_out() << "Using datum: " << opt.datum << std::endl;
+    GeoReference dem_geo;
+    if (!read_georeference(dem_geo, opt.dem_file))
+      vw_throw( ArgumentErr() << "Missing georef.\n");
 
-      BBox2   & ll = opt.lon_lat_range; // shortcut
-      Vector2 & H  = opt.height_range;
-      double delta_lon = (ll.max()[0] - ll.min()[0])/double(opt.num_samples);
-      double delta_lat = (ll.max()[1] - ll.min()[1])/double(opt.num_samples);
-      double delta_ht  = (H[1] - H[0])/double(opt.num_samples);
-      tpc.report_progress(0);
-      for (double lon = ll.min()[0]; lon <= ll.max()[0]; lon += delta_lon) {
-        for (double lat = ll.min()[1]; lat <= ll.max()[1]; lat += delta_lat) {
-          for (double ht = H[0]; ht <= H[1]; ht += delta_ht) {
+    // Get the datum from the DEM
+    opt.datum = dem_geo.datum();
+    
+    // If the DEM is too big, we need to skip points. About
+    // 40,000 points should be good enough to determine 78 RPC
+    // coefficients.
+    double delta_col = std::max(1.0, dem.cols()/double(opt.num_samples));
+    double delta_row = std::max(1.0, dem.rows()/double(opt.num_samples));
+    for (double dcol = 0; dcol < dem.cols(); dcol += delta_col) {
+      for (double drow = 0; drow < dem.rows(); drow += delta_row) {
+        int col = dcol, row = drow; // cast to int
+
+        if (!is_valid(dem(col, row))) continue;
+
+        Vector2 pix(col, row);
+        Vector2 lonlat = dem_geo.pixel_to_lonlat(pix);
+
+        // Lon lat height
+        ground_llh.push_back(Vector3(lonlat[0], lonlat[1], dem(col, row).child()));
+      }
+    }
+  }
+}
 
-            Vector3 llh(lon, lat, ht);
-            Vector3 xyz = opt.datum.geodetic_to_cartesian(llh);
+// Create the RPC model for one camera from the ground samples. The
+// camera is projected into with the given number of threads.
+void camera_to_rpc(Options & opt, boost::shared_ptr<CameraModel> cam,
+                   std::vector<Vector3> const& ground_samples,
+                   int num_threads, bool report_progress) {
+
+  // Get the input nodata value from the image file, unless the
+  // user overwrites it.
+  float val = std::numeric_limits<float>::quiet_NaN();
+  bool has_input_nodata = vw::read_nodata_val(opt.image_file, val);
+  if (has_input_nodata && boost::math::isnan(opt.input_nodata_value)) {
+    opt.input_nodata_value = val;
+  }
+  if (!boost::math::isnan(opt.input_nodata_value)) 
+    vw_out() << "Using input nodata value: " << opt.input_nodata_value << "\n";
+  else
+    has_input_nodata = false;
+
+  // If the output nodata value was not specified, use the input one
+  if (boost::math::isnan(opt.output_nodata_value)) 
+    opt.output_nodata_value = opt.input_nodata_value;
+
+  if (!boost::math::isnan(opt.output_nodata_value)) {
+    opt.has_output_nodata = true;
+    vw_out() << "Using output nodata value: " << opt.output_nodata_value << "\n";
+  }else{
+    opt.has_output_nodata = false;
+  }
 
-            // Go back to llh. This is a bugfix for the 360 deg offset problem.
-            llh = opt.datum.cartesian_to_geodetic(xyz);
+  DiskImageView<float> disk_view(opt.image_file);
+
+  // The bounding box
+  BBox2 image_box = bounding_box(disk_view);
+  if (!opt.image_crop_box.empty()) 
+    image_box.crop(opt.image_crop_box);
+
+  // Generate point pairs by projecting the ground points into the
+  // camera. This replaces each point with its round trip through
+  // ECEF, so work on a copy.
+  std::vector<Vector3> all_llh;
+  std::vector<Vector2> all_pixels;
+  std::vector<Vector3> ground_llh = ground_samples;
+
+  // Mask the input image
+  ImageViewRef< PixelMask<float> > input_img
+    = create_mask_less_or_equal(disk_view, opt.input_nodata_value);
+
+  vw_out() << "Projecting pixels into the camera to generate the RPC model.\n";
+  std::vector<Vector2> ground_pixels;
+  std::vector<char> valid;
+  project_points(cam.get(), opt.datum, num_threads, report_progress,
+                 ground_llh, ground_pixels, valid);
+
+  // Keep the points projecting into the image, in the order they were
+  // generated. With a DEM, the image must also be valid there.
+  for (size_t i = 0; i < ground_llh.size(); i++) {
+    if (!valid[i] || !image_box.contains(ground_pixels[i]))
+      continue;
+    if (!opt.dem_file.empty() &&
+        !is_valid(input_img(ground_pixels[i][0], ground_pixels[i][1])))
+      continue;
+    all_llh.push_back(ground_llh[i]);
+    all_pixels.push_back(ground_pixels[i]);
+  }
 
-            Vector2 cam_pix = cam->point_to_pixel(xyz);
-            if (image_box.contains(cam_pix)) {
-              all_llh.push_back(llh);
-              all_pixels.push_back(cam_pix);
-            }
+  // The pixel box
+  BBox2 pixel_box;
+  for (size_t i = 0; i < all_pixels.size(); i++) 
+    pixel_box.grow(all_pixels[i]);
 
-          }
-        }
-        tpc.report_incremental_progress(inc_amount);
-      }
+  // Find the range of lon-lat-heights
+  BBox3 llh_box;
+  for (size_t i = 0; i < all_llh.size(); i++) 
+    llh_box.grow(all_llh[i]);
 
-    }else{
-      vw_out() << "Sampling the surface of the DEM: " << opt.dem_file  << std::endl;
-
-      float dem_nodata_val = -std::numeric_limits<float>::max(); 
-      vw::read_nodata_val(opt.dem_file, dem_nodata_val);
-      ImageView< PixelMask<double> > dem = create_mask
-        (channel_cast<double>(DiskImageView<float>(opt.dem_file)), dem_nodata_val);
-
-      GeoReference dem_geo;
-      if (!read_georeference(dem_geo, opt.dem_file))
-        vw_throw( ArgumentErr() << "Missing georef.\n");
-
-      // Get the datum from the DEM
-      opt.datum = dem_geo.datum();
-      
-      // If the DEM is too big, we need to skip points. About
-      // 40,000 points should be good enough to determine 78 RPC
-      // coefficients.
-      double delta_col = std::max(1.0, dem.cols()/double(opt.num_samples));
-      double delta_row = std::max(1.0, dem.rows()/double(opt.num_samples));
-      tpc.report_progress(0);
-      for (double dcol = 0; dcol < dem.cols(); dcol += delta_col) {
-        for (double drow = 0; drow < dem.rows(); drow += delta_row) {
-          int col = dcol, row = drow; // cast to int
-
-          if (!is_valid(dem(col, row))) continue;
-
-          Vector2 pix(col, row);
-          Vector2 lonlat = dem_geo.pixel_to_lonlat(pix);
-
-          // Lon lat height
-          Vector3 llh;
-          llh[0] = lonlat[0]; llh[1] = lonlat[1]; llh[2] = dem(col, row).child();
-          Vector3 xyz = opt.datum.geodetic_to_cartesian(llh);
-
-          // Go back to llh. This is a bugfix for the 360 deg offset problem.
-          llh = opt.datum.cartesian_to_geodetic(xyz);
-
-          Vector2 cam_pix;
-          try {
-            // the point_to_pixel function can be capricious
-            cam_pix = cam->point_to_pixel(xyz);
-          }catch(...){
-            continue;
-          }
-
-          if (image_box.contains(cam_pix) && is_valid(input_img(cam_pix[0], cam_pix[1]))) {
-            all_llh.push_back(llh);
-            all_pixels.push_back(cam_pix);
-          }
+  // If cropping, adjust the pixels
+  BBox2 crop_box;
+  if (!opt.no_crop) {
+    // Cast to int so that we can crop properly
+    pixel_box.min() = floor(pixel_box.min());
+    pixel_box.max() = ceil(pixel_box.max());
+    pixel_box.crop(image_box);
 
-        }
-        tpc.report_incremental_progress(inc_amount);
-      }
-    }
-    tpc.report_finished();
+    crop_box = pixel_box; // save it before we modify pixel_box
 
-    // The pixel box
-    BBox2 pixel_box;
+    // Shift all pixels by the crop corner, including the pixel box itself
     for (size_t i = 0; i < all_pixels.size(); i++) 
-      pixel_box.grow(all_pixels[i]);
-
-    // Find the range of lon-lat-heights
-    BBox3 llh_box;
-    for (size_t i = 0; i < all_llh.size(); i++) 
-      llh_box.grow(all_llh[i]);
-
-    // If cropping, adjust the pixels
-    BBox2 crop_box;
-    if (!opt.no_crop) {
-      // Cast to int so that we can crop properly
-      pixel_box.min() = floor(pixel_box.min());
-      pixel_box.max() = ceil(pixel_box.max());
-      pixel_box.crop(image_box);
-
-      crop_box = pixel_box; // save it before we modify pixel_box
-
-      // Shift all pixels by the crop corner, including the pixel box itself
-      for (size_t i = 0; i < all_pixels.size(); i++) 
-        all_pixels[i] -= pixel_box.min();
-
-      // Need to first save the corner before subtracting it, otherwise get wrong result
-      Vector2 shift = pixel_box.min(); 
-      pixel_box -= shift;
-    }
+      all_pixels[i] -= pixel_box.min();
+
+    // Need to first save the corner before subtracting it, otherwise get wrong result
+    Vector2 shift = pixel_box.min(); 
+    pixel_box -= shift;
+  }
+
+  // We need this line for other tools
+  vw_out() << "crop_box "
+           << crop_box.min().x() << ' ' << crop_box.min().y() << ' '
+           << crop_box.max().x() << ' ' << crop_box.max().y() << std::endl;
+
+  if (opt.save_tif) {
+
+    ImageViewRef< PixelMask<float> > output_img = input_img;
+    if (!opt.no_crop) 
+      output_img = crop(input_img, crop_box);
+
+    std::string out_img_file = fs::path(opt.output_rpc).replace_extension("tif").string();
+    vw_out() << "Writing: " << out_img_file << std::endl;
+
+    GeoReference img_geo;
+    bool has_img_geo = false;
+    vw::cartography::block_write_gdal_image(out_img_file,
+                                            apply_mask(output_img, opt.output_nodata_value),
+                                            has_img_geo, img_geo,
+                                            opt.has_output_nodata,
+                                            opt.output_nodata_value,
+                                            opt,
+                                            TerminalProgressCallback("asp", "\t-->: "));
+  }
+
+  if (opt.skip_computing_rpc) 
+    return;
+
+  vw_out() << "Lon-lat-height box for the RPC approx: " << llh_box   << std::endl;
+  vw_out() << "Camera pixel box for the RPC approx:   " << pixel_box << std::endl;
+
+  // Find the RPC coefficients
+  Vector3 llh_scale, llh_offset;
+  Vector2 pixel_scale, pixel_offset;
+  asp::RPCModel::CoeffVec line_num, line_den, samp_num, samp_den;
+  vw_out() << "Generating the RPC approximation using " << all_llh.size() << " point pairs.\n";
+  asp::fit_rpc_to_points(// Inputs
+                         opt.penalty_weight, all_llh, all_pixels, llh_box, pixel_box,
+                         // Outputs
+                         llh_scale, llh_offset, pixel_scale, pixel_offset,
+                         line_num, line_den, samp_num, samp_den);
+
+  // TODO: Integrate this with aster2asp existing functionality!
+  // Have a generic function for saving WV RPC files. 
+  std::string lineoffset   = vw::num_to_str(pixel_offset.y());
+  std::string sampoffset   = vw::num_to_str(pixel_offset.x());
+  std::string latoffset    = vw::num_to_str(llh_offset.y());
+  std::string longoffset   = vw::num_to_str(llh_offset.x());
+  std::string heightoffset = vw::num_to_str(llh_offset.z());
+
+  std::string linescale   = vw::num_to_str(pixel_scale.y());
+  std::string sampscale   = vw::num_to_str(pixel_scale.x());
+  std::string latscale    = vw::num_to_str(llh_scale.y());
+  std::string longscale   = vw::num_to_str(llh_scale.x());
+  std::string heightscale = vw::num_to_str(llh_scale.z());
+
+  std::string linenumcoef = vw::vec_to_str(line_num);
+  std::string linedencoef = vw::vec_to_str(line_den);
+  std::string sampnumcoef = vw::vec_to_str(samp_num);
+  std::string sampdencoef = vw::vec_to_str(samp_den);
+
+  std::string gsd_str = vw::num_to_str(opt.gsd);
+
+  vw::cartography::GeoReference datum_georef;
+  datum_georef.set_datum(opt.datum);
+  std::string datum_wkt = datum_georef.get_wkt();
+  
+  vw_out() << "Writing: " << opt.output_rpc << std::endl;
+  std::ofstream ofs(opt.output_rpc.c_str());
+  ofs.precision(18);
+
+  // Header
+  ofs << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n";
+  ofs << "<isd>\n";
+
+  // Image params
+  int image_cols = disk_view.cols();
+  int image_rows = disk_view.rows();
+  ofs << "   <IMD>\n";
+  ofs << "        <NUMROWS>" << image_rows << "</NUMROWS>\n";
+  ofs << "        <NUMCOLUMNS>" << image_cols << "</NUMCOLUMNS>\n";
+  ofs << "                <BAND_P>\n";
+  ofs << "                    <ULLON>" << llh_box.min()[0] << "</ULLON>\n";
+  ofs << "                    <ULLAT>" << llh_box.max()[1] << "</ULLAT>\n";
+  ofs << "                    <ULHAE>" << llh_box.min()[2] << "</ULHAE>\n";
+
+  ofs << "                    <URLON>" << llh_box.max()[0] << "</URLON>\n";
+  ofs << "                    <URLAT>" << llh_box.max()[1] << "</URLAT>\n";
+  ofs << "                    <URHAE>" << llh_box.max()[2] << "</URHAE>\n";
+
+  ofs << "                    <LRLON>" << llh_box.max()[0] << "</LRLON>\n";
+  ofs << "                    <LRLAT>" << llh_box.min()[1] << "</LRLAT>\n";
+  ofs << "                    <LRHAE>" << llh_box.min()[2] << "</LRHAE>\n";
+
+  ofs << "                    <LLLON>" << llh_box.min()[0] << "</LLLON>\n";
+  ofs << "                    <LLLAT>" << llh_box.min()[1] << "</LLLAT>\n";
+  ofs << "                    <LLHAE>" << llh_box.max()[2] << "</LLHAE>\n";
+
+  ofs << "        </BAND_P>\n";
+  ofs << "        <IMAGE>\n";
+  ofs << "            <SATID>cam2rpc</SATID>\n";
+  ofs << "            <MODE>FullSwath</MODE>\n";
+  ofs << "            <SCANDIRECTION>Forward</SCANDIRECTION>\n";
+  ofs << "            <CATID>0</CATID>\n";
+  ofs << "            <TLCTIME>2010-06-21T21:32:55.534775Z</TLCTIME>\n";
+  ofs << "            <NUMTLC>2</NUMTLC>\n";   
+  ofs << "            <TLCLISTList>\n";                                        
+  ofs << "               <TLCLIST>0.0 0.000000000000000e+00</TLCLIST>\n";     
+  ofs << "               <TLCLIST>27572.0 1.378600000000000e+00</TLCLIST>\n"; 
+  ofs << "            </TLCLISTList>\n";                                       
+  ofs << "            <FIRSTLINETIME>2010-06-21T21:32:55.534775Z</FIRSTLINETIME>\n";
+  ofs << "            <AVGLINERATE>20000.0</AVGLINERATE>\n";                        
+  ofs << "            <EXPOSUREDURATION>0.0016</EXPOSUREDURATION>\n";               
+  ofs << "            <MINCOLLECTEDROWGSD>"   << gsd_str << "</MINCOLLECTEDROWGSD>\n";            
+  ofs << "            <MAXCOLLECTEDROWGSD>"   << gsd_str << "</MAXCOLLECTEDROWGSD>\n";            
+  ofs << "            <MEANCOLLECTEDROWGSD>"  << gsd_str << "</MEANCOLLECTEDROWGSD>\n";          
+  ofs << "            <MINCOLLECTEDCOLGSD>"   << gsd_str << "</MINCOLLECTEDCOLGSD>\n";            
+  ofs << "            <MAXCOLLECTEDCOLGSD>"   << gsd_str << "</MAXCOLLECTEDCOLGSD>\n";            
+  ofs << "            <MEANCOLLECTEDCOLGSD>"  << gsd_str << "</MEANCOLLECTEDCOLGSD>\n";          
+  ofs << "            <MEANCOLLECTEDGSD>"     << gsd_str << "</MEANCOLLECTEDGSD>\n";                 
+  ofs << "            <MEANPRODUCTGSD>"       << gsd_str << "</MEANPRODUCTGSD>\n";                       
+  ofs << "        </IMAGE>\n";
+  ofs << "   </IMD>\n";
+
+  // RPC
+  ofs << "    <RPB>\n";
+  ofs << "        <SATID>cam2rpc</SATID>\n";
+  ofs << "        <BANDID>P</BANDID>\n";
+  ofs << "        <SPECID>RPC00B</SPECID>\n";
+  ofs << "        <IMAGE>\n";
+  ofs << "	        <ERRBIAS>1.006000000000000e+01</ERRBIAS>\n"; // why?
+  ofs << "	        <ERRRAND>1.100000000000000e-01</ERRRAND>\n"; // why?
+  ofs << "            <CAM2RPC_DATUM>"   << datum_wkt << "</CAM2RPC_DATUM>\n";
+  ofs << "            <LINEOFFSET>"      << lineoffset   << "</LINEOFFSET>\n";
+  ofs << "            <SAMPOFFSET>"      << sampoffset   << "</SAMPOFFSET>\n";
+  ofs << "            <LATOFFSET>"       << latoffset    << "</LATOFFSET>\n";
+  ofs << "            <LONGOFFSET>"      << longoffset   << "</LONGOFFSET>\n";
+  ofs << "            <HEIGHTOFFSET>"    << heightoffset << "</HEIGHTOFFSET>\n";
+  ofs << "            <LINESCALE>"       << linescale    << "</LINESCALE>\n";
+  ofs << "            <SAMPSCALE>"       << sampscale    << "</SAMPSCALE>\n";
+  ofs << "            <LATSCALE>"        << latscale     << "</LATSCALE>\n";
+  ofs << "            <LONGSCALE>"       << longscale    << "</LONGSCALE>\n";
+  ofs << "            <HEIGHTSCALE>"     << heightscale  << "</HEIGHTSCALE>\n";
+  ofs << "            <LINENUMCOEFList>\n";
+  ofs << "                <LINENUMCOEF>" << linenumcoef  << "</LINENUMCOEF>\n";
+  ofs << "            </LINENUMCOEFList>\n";
+  ofs << "            <LINEDENCOEFList>\n";
+  ofs << "                <LINEDENCOEF>" << linedencoef  << "</LINEDENCOEF>\n";
+  ofs << "            </LINEDENCOEFList>\n";
+  ofs << "            <SAMPNUMCOEFList>\n";
+  ofs << "                <SAMPNUMCOEF>" << sampnumcoef  << "</SAMPNUMCOEF>\n";
+  ofs << "            </SAMPNUMCOEFList>\n";
+  ofs << "            <SAMPDENCOEFList>\n";
+  ofs << "                <SAMPDENCOEF>" << sampdencoef  << "</SAMPDENCOEF>\n";
+  ofs << "            </SAMPDENCOEFList>\n";
+  ofs << "        </IMAGE>\n";
+  ofs << "    </RPB>\n";
+
+  // Footer
+  ofs << "</isd>\n";
+  ofs.close();
+}
 
-    // We need this line for other tools
-    vw_out() << "crop_box "
-             << crop_box.min().x() << ' ' << crop_box.min().y() << ' '
-             << crop_box.max().x() << ' ' << crop_box.max().y() << std::endl;
-
-    if (opt.save_tif) {
-
-      ImageViewRef< PixelMask<float> > output_img = input_img;
-      if (!opt.no_crop) 
-        output_img = crop(input_img, crop_box);
-
-      std::string out_img_file = fs::path(opt.output_rpc).replace_extension("tif").string();
-      vw_out() << "Writing: " << out_img_file << std::endl;
-
-      GeoReference img_geo;
-      bool has_img_geo = false;
-      vw::cartography::block_write_gdal_image(out_img_file,
-                                              apply_mask(output_img, opt.output_nodata_value),
-                                              has_img_geo, img_geo,
-                                              opt.has_output_nodata,
-                                              opt.output_nodata_value,
-                                              opt,
-                                              TerminalProgressCallback("asp", "\t-->: "));
+// Create the RPC model for one camera of the batch list, with one
+// thread, as many of these run at the same time. Record the error
+// message if this fails.
+class CameraToRpcTask: public vw::Task, private boost::noncopyable {
+  Options & m_opt;
+  boost::shared_ptr<CameraModel> m_cam;
+  std::vector<Vector3> const& m_ground_llh;
+  std::string & m_error;
+public:
+  CameraToRpcTask(Options & opt, boost::shared_ptr<CameraModel> cam,
+                  std::vector<Vector3> const& ground_llh, std::string & error):
+    m_opt(opt), m_cam(cam), m_ground_llh(ground_llh), m_error(error) {}
+
+  void operator()() {
+    try {
+      camera_to_rpc(m_opt, m_cam, m_ground_llh, 1, false);
+    } catch (const std::exception& e) {
+      m_error = e.what();
     }
+  }
+};
 
-    if (opt.skip_computing_rpc) 
-      return 0;
+int main( int argc, char *argv[] ) {
 
-    Vector3 llh_scale  = (llh_box.max() - llh_box.min())/2.0; // half range
-    Vector3 llh_offset = (llh_box.max() + llh_box.min())/2.0; // center point
+  Options opt;
+  try {
 
-    Vector2 pixel_scale  = (pixel_box.max() - pixel_box.min())/2.0; // half range 
-    Vector2 pixel_offset = (pixel_box.max() + pixel_box.min())/2.0; // center point
+    handle_arguments(argc, argv, opt);
 
-    vw_out() << "Lon-lat-height box for the RPC approx: " << llh_box   << std::endl;
-    vw_out() << "Camera pixel box for the RPC approx:   " << pixel_box << std::endl;
+    if (opt.batch_list.empty()) {
+      bool multithreaded = false;
+      boost::shared_ptr<CameraModel> cam = load_camera(opt, multithreaded);
+      std::vector<Vector3> ground_llh;
+      sample_ground(opt, ground_llh);
+      int num_threads = multithreaded ? vw::vw_settings().default_num_threads() : 1;
+      camera_to_rpc(opt, cam, ground_llh, num_threads, true);
+      return 0;
+    }
 
-    Vector<double> normalized_llh;
-    Vector<double> normalized_pixels;
-    int num_total_pts = all_llh.size();
-    normalized_llh.set_size(asp::RPCModel::GEODETIC_COORD_SIZE*num_total_pts);
-    normalized_pixels.set_size(asp::RPCModel::IMAGE_COORD_SIZE*num_total_pts
-                               + asp::RpcSolveLMA::NUM_PENALTY_TERMS);
-    for (size_t i = 0; i < normalized_pixels.size(); i++) {
-      // Important: The extra penalty terms are all set to zero here.
-      normalized_pixels[i] = 0.0; 
+    // Each line of the batch list has an image, camera, and output RPC file
+    std::vector<std::string> entries;
+    asp::read_list(opt.batch_list, entries);
+    if (entries.size() % 3 != 0)
+      vw_throw( ArgumentErr() << "Expecting in " << opt.batch_list
+                << " an image, camera, and output RPC file on each line.\n" );
+
+    // The ground points are the same for all cameras
+    std::vector<Vector3> ground_llh;
+    sample_ground(opt, ground_llh);
+
+    // Load the cameras one at a time. A failure with one camera should
+    // not stop the others.
+    int num_cams = entries.size() / 3;
+    std::vector<Options> cam_opts(num_cams, opt);
+    std::vector<boost::shared_ptr<CameraModel>> cams(num_cams);
+    std::vector<std::string> errors(num_cams);
+    bool all_multithreaded = true;
+    for (int it = 0; it < num_cams; it++) {
+      cam_opts[it].image_file  = entries[3 * it + 0];
+      cam_opts[it].camera_file = entries[3 * it + 1];
+      cam_opts[it].output_rpc  = entries[3 * it + 2];
+      vw_out() << "Loading camera " << it + 1 << " of " << num_cams << ": "
+               << cam_opts[it].camera_file << std::endl;
+      try {
+        bool multithreaded = false;
+        cams[it] = load_camera(cam_opts[it], multithreaded);
+        all_multithreaded = all_multithreaded && multithreaded;
+      } catch (const std::exception& e) {
+        errors[it] = e.what();
+      }
     }
 
-    // Form the arrays of normalized pixels and normalized llh
-    for (int pt = 0; pt < num_total_pts; pt++) {
-      // Normalize the pixel to -1 <> 1 range
-      Vector3 llh_n   = elem_quot(all_llh[pt]    - llh_offset,   llh_scale);
-      Vector2 pixel_n = elem_quot(all_pixels[pt] - pixel_offset, pixel_scale);
-      subvector(normalized_llh, asp::RPCModel::GEODETIC_COORD_SIZE*pt,
-                asp::RPCModel::GEODETIC_COORD_SIZE) = llh_n;
-      subvector(normalized_pixels, asp::RPCModel::IMAGE_COORD_SIZE*pt,
-                asp::RPCModel::IMAGE_COORD_SIZE   ) = pixel_n;
+    // Fit the cameras in parallel, each with one thread. That is
+    // faster than projecting into one camera at a time with many
+    // threads, as fitting the RPC model is serial. Do the cameras one
+    // at a time if they cannot be used from several threads, or if
+    // images are saved, as that uses its own threads.
+    int num_threads = vw::vw_settings().default_num_threads();
+    if (all_multithreaded && !opt.save_tif && num_threads > 1) {
+      vw_out() << "Fitting the RPC models for " << num_cams << " cameras with "
+               << num_threads << " threads.\n";
+      vw::FifoWorkQueue queue(num_threads);
+      for (int it = 0; it < num_cams; it++) {
+        if (cams[it].get() == NULL)
+          continue;
+        boost::shared_ptr<vw::Task>
+          task(new CameraToRpcTask(cam_opts[it], cams[it], ground_llh, errors[it]));
+        queue.add_task(task);
+      }
+      queue.join_all();
+    } else {
+      for (int it = 0; it < num_cams; it++) {
+        if (cams[it].get() == NULL)
+          continue;
+        vw_out() << "Camera " << it + 1 << " of " << num_cams << ": "
+                 << cam_opts[it].camera_file << std::endl;
+        try {
+          camera_to_rpc(cam_opts[it], cams[it], ground_llh,
+                        all_multithreaded ? num_threads : 1, true);
+        } catch (const std::exception& e) {
+          errors[it] = e.what();
+        }
+      }
     }
 
-    // Find the RPC coefficients
-    asp::RPCModel::CoeffVec line_num, line_den, samp_num, samp_den;
-    std::string output_prefix = "";
-    vw_out() << "Generating the RPC approximation using " << num_total_pts << " point pairs.\n";
-    asp::gen_rpc(// Inputs
-                 opt.penalty_weight, output_prefix,
-                 normalized_llh, normalized_pixels,
-                 llh_scale, llh_offset, pixel_scale, pixel_offset,
-                 // Outputs
-                 line_num, line_den, samp_num, samp_den);
-
-    // TODO: Integrate this with aster2asp existing functionality!
-    // Have a generic function for saving WV RPC files. 
-    std::string lineoffset   = vw::num_to_str(pixel_offset.y());
-    std::string sampoffset   = vw::num_to_str(pixel_offset.x());
-    std::string latoffset    = vw::num_to_str(llh_offset.y());
-    std::string longoffset   = vw::num_to_str(llh_offset.x());
-    std::string heightoffset = vw::num_to_str(llh_offset.z());
-
-    std::string linescale   = vw::num_to_str(pixel_scale.y());
-    std::string sampscale   = vw::num_to_str(pixel_scale.x());
-    std::string latscale    = vw::num_to_str(llh_scale.y());
-    std::string longscale   = vw::num_to_str(llh_scale.x());
-    std::string heightscale = vw::num_to_str(llh_scale.z());
-
-    std::string linenumcoef = vw::vec_to_str(line_num);
-    std::string linedencoef = vw::vec_to_str(line_den);
-    std::string sampnumcoef = vw::vec_to_str(samp_num);
-    std::string sampdencoef = vw::vec_to_str(samp_den);
-
-    std::string gsd_str = vw::num_to_str(opt.gsd);
-
-    vw::cartography::GeoReference datum_georef;
-    datum_georef.set_datum(opt.datum);
-    std::string datum_wkt = datum_georef.get_wkt();
-    
-    vw_out() << "Writing: " << opt.output_rpc << std::endl;
-    std::ofstream ofs(opt.output_rpc.c_str());
-    ofs.precision(18);
-
-    // Header
-    ofs << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n";
-    ofs << "<isd>\n";
-
-    // Image params
-    int image_cols = disk_view.cols();
-    int image_rows = disk_view.rows();
-    ofs << "   <IMD>\n";
-    ofs << "        <NUMROWS>" << image_rows << "</NUMROWS>\n";
-    ofs << "        <NUMCOLUMNS>" << image_cols << "</NUMCOLUMNS>\n";
-    ofs << "                <BAND_P>\n";
-    ofs << "                    <ULLON>" << llh_box.min()[0] << "</ULLON>\n";
-    ofs << "                    <ULLAT>" << llh_box.max()[1] << "</ULLAT>\n";
-    ofs << "                    <ULHAE>" << llh_box.min()[2] << "</ULHAE>\n";
-
-    ofs << "                    <URLON>" << llh_box.max()[0] << "</URLON>\n";
-    ofs << "                    <URLAT>" << llh_box.max()[1] << "</URLAT>\n";
-    ofs << "                    <URHAE>" << llh_box.max()[2] << "</URHAE>\n";
-
-    ofs << "                    <LRLON>" << llh_box.max()[0] << "</LRLON>\n";
-    ofs << "                    <LRLAT>" << llh_box.min()[1] << "</LRLAT>\n";
-    ofs << "                    <LRHAE>" << llh_box.min()[2] << "</LRHAE>\n";
-
-    ofs << "                    <LLLON>" << llh_box.min()[0] << "</LLLON>\n";
-    ofs << "                    <LLLAT>" << llh_box.min()[1] << "</LLLAT>\n";
-    ofs << "                    <LLHAE>" << llh_box.max()[2] << "</LLHAE>\n";
-
-    ofs << "        </BAND_P>\n";
-    ofs << "        <IMAGE>\n";
-    ofs << "            <SATID>cam2rpc</SATID>\n";
-    ofs << "            <MODE>FullSwath</MODE>\n";
-    ofs << "            <SCANDIRECTION>Forward</SCANDIRECTION>\n";
-    ofs << "            <CATID>0</CATID>\n";
-    ofs << "            <TLCTIME>2010-06-21T21:32:55.534775Z</TLCTIME>\n";
-    ofs << "            <NUMTLC>2</NUMTLC>\n";   
-    ofs << "            <TLCLISTList>\n";                                        
-    ofs << "               <TLCLIST>0.0 0.000000000000000e+00</TLCLIST>\n";     
-    ofs << "               <TLCLIST>27572.0 1.378600000000000e+00</TLCLIST>\n"; 
-    ofs << "            </TLCLISTList>\n";                                       
-    ofs << "            <FIRSTLINETIME>2010-06-21T21:32:55.534775Z</FIRSTLINETIME>\n";
-    ofs << "            <AVGLINERATE>20000.0</AVGLINERATE>\n";                        
-    ofs << "            <EXPOSUREDURATION>0.0016</EXPOSUREDURATION>\n";               
-    ofs << "            <MINCOLLECTEDROWGSD>"   << gsd_str << "</MINCOLLECTEDROWGSD>\n";            
-    ofs << "            <MAXCOLLECTEDROWGSD>"   << gsd_str << "</MAXCOLLECTEDROWGSD>\n";            
-    ofs << "            <MEANCOLLECTEDROWGSD>"  << gsd_str << "</MEANCOLLECTEDROWGSD>\n";          
-    ofs << "            <MINCOLLECTEDCOLGSD>"   << gsd_str << "</MINCOLLECTEDCOLGSD>\n";            
-    ofs << "            <MAXCOLLECTEDCOLGSD>"   << gsd_str << "</MAXCOLLECTEDCOLGSD>\n";            
-    ofs << "            <MEANCOLLECTEDCOLGSD>"  << gsd_str << "</MEANCOLLECTEDCOLGSD>\n";          
-    ofs << "            <MEANCOLLECTEDGSD>"     << gsd_str << "</MEANCOLLECTEDGSD>\n";                 
-    ofs << "            <MEANPRODUCTGSD>"       << gsd_str << "</MEANPRODUCTGSD>\n";                       
-    ofs << "        </IMAGE>\n";
-    ofs << "   </IMD>\n";
-
-    // RPC
-    ofs << "    <RPB>\n";
-    ofs << "        <SATID>cam2rpc</SATID>\n";
-    ofs << "        <BANDID>P</BANDID>\n";
-    ofs << "        <SPECID>RPC00B</SPECID>\n";
-    ofs << "        <IMAGE>\n";
-    ofs << "	        <ERRBIAS>1.006000000000000e+01</ERRBIAS>\n"; // why?
-    ofs << "	        <ERRRAND>1.100000000000000e-01</ERRRAND>\n"; // why?
-    ofs << "            <CAM2RPC_DATUM>"   << datum_wkt << "</CAM2RPC_DATUM>\n";
-    ofs << "            <LINEOFFSET>"      << lineoffset   << "</LINEOFFSET>\n";
-    ofs << "            <SAMPOFFSET>"      << sampoffset   << "</SAMPOFFSET>\n";
-    ofs << "            <LATOFFSET>"       << latoffset    << "</LATOFFSET>\n";
-    ofs << "            <LONGOFFSET>"      << longoffset   << "</LONGOFFSET>\n";
-    ofs << "            <HEIGHTOFFSET>"    << heightoffset << "</HEIGHTOFFSET>\n";
-    ofs << "            <LINESCALE>"       << linescale    << "</LINESCALE>\n";
-    ofs << "            <SAMPSCALE>"       << sampscale    << "</SAMPSCALE>\n";
-    ofs << "            <LATSCALE>"        << latscale     << "</LATSCALE>\n";
-    ofs << "            <LONGSCALE>"       << longscale    << "</LONGSCALE>\n";
-    ofs << "            <HEIGHTSCALE>"     << heightscale  << "</HEIGHTSCALE>\n";
-    ofs << "            <LINENUMCOEFList>\n";
-    ofs << "                <LINENUMCOEF>" << linenumcoef  << "</LINENUMCOEF>\n";
-    ofs << "            </LINENUMCOEFList>\n";
-    ofs << "            <LINEDENCOEFList>\n";
-    ofs << "                <LINEDENCOEF>" << linedencoef  << "</LINEDENCOEF>\n";
-    ofs << "            </LINEDENCOEFList>\n";
-    ofs << "            <SAMPNUMCOEFList>\n";
-    ofs << "                <SAMPNUMCOEF>" << sampnumcoef  << "</SAMPNUMCOEF>\n";
-    ofs << "            </SAMPNUMCOEFList>\n";
-    ofs << "            <SAMPDENCOEFList>\n";
-    ofs << "                <SAMPDENCOEF>" << sampdencoef  << "</SAMPDENCOEF>\n";
-    ofs << "            </SAMPDENCOEFList>\n";
-    ofs << "        </IMAGE>\n";
-    ofs << "    </RPB>\n";
-
-    // Footer
-    ofs << "</isd>\n";
-    ofs.close();
+    int num_failed = 0;
+    for (int it = 0; it < num_cams; it++) {
+      if (errors[it].empty())
+        continue;
+      vw_out(WarningMessage) << "Failed to create the RPC model for "
+                             << cam_opts[it].camera_file << ": " << errors[it] << "\n";
+      num_failed++;
+    }
 
+    if (num_failed > 0)
+      vw_throw( ArgumentErr() << "Failed to create " << num_failed << " out of "
+                << num_cams << " RPC models.\n" );
 
   } ASP_STANDARD_CATCHES;
 
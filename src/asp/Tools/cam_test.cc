@@ -25,6 +25,9 @@
 // using the cam1 camera and back-projecting the resulting points into
 // the cam2 camera, then doing this in reverse.
 
+// With --benchmark, instead measure how many times per second each
+// camera function can be called, for a range of thread counts.
+
 #include <asp/Core/Macros.h>
 #include <asp/Core/Common.h>
 #include <asp/Core/StereoSettings.h>
@@ -33,6 +36,7 @@
 #include <asp/Camera/RPCModel.h>
 #include <vw/Core/Stopwatch.h>
 #include <asp/Camera/CsmModel.h>
+#include <asp/Camera/CameraBenchmark.h>
 #include <asp/IsisIO/IsisCameraModel.h>
 
 // Temporary header
@@ -50,8 +54,12 @@ struct Options : vw::GdalWriteOptions {
   int sample_rate; // use one out of these many pixels
   double subpixel_offset, height_above_datum;
   bool enable_correct_velocity_aberration, enable_correct_atmospheric_refraction,
-    print_per_pixel_results, dg_use_csm, dg_vs_csm, test_covariance_computation;
+    print_per_pixel_results, dg_use_csm, dg_vs_csm, test_covariance_computation,
+    benchmark;
   vw::Vector2 single_pixel;
+  std::string benchmark_threads_str, benchmark_json;
+  std::vector<int> benchmark_threads;
+  double benchmark_seconds;
   
   Options() {}
 };
@@ -89,6 +97,14 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
      "Compare projecting into the camera without and with using the CSM model for Digital Globe.")
     ("test-covariance-computation", po::bool_switch(&opt.test_covariance_computation)->default_value(false)->implicit_value(true),
      "Test computing the covariances (see --compute-point-cloud-covariances). This is an undocumented developer option.")
+    ("benchmark", po::bool_switch(&opt.benchmark)->default_value(false)->implicit_value(true),
+     "Measure how many times per second the camera center, pixel-to-vector, and point-to-pixel functions can be called for each camera, instead of comparing the cameras. Then --cam2 is optional.")
+    ("benchmark-threads", po::value(&opt.benchmark_threads_str)->default_value("1 2 4 8"),
+     "The thread counts to use with --benchmark, in quotes.")
+    ("benchmark-seconds", po::value(&opt.benchmark_seconds)->default_value(2.0),
+     "The approximate duration of each --benchmark measurement, in seconds.")
+    ("benchmark-json", po::value(&opt.benchmark_json)->default_value(""),
+     "Save the --benchmark results to this JSON file.")
     ;  
   general_options.add(vw::GdalWriteOptionsDescription(opt));
   
@@ -105,9 +121,24 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
                             positional, positional_desc, usage,
                             allow_unregistered, unregistered);
 
-  if (opt.image_file == "" || opt.cam1_file == "" || opt.cam2_file == "")
+  if (opt.image_file == "" || opt.cam1_file == "" ||
+      (opt.cam2_file == "" && !opt.benchmark))
     vw_throw(ArgumentErr() << "Not all inputs were specified.\n" << usage << general_options);
 
+  if (opt.benchmark) {
+    std::istringstream is(opt.benchmark_threads_str);
+    int num_threads = 0;
+    while (is >> num_threads) {
+      if (num_threads <= 0)
+        vw_throw(ArgumentErr() << "The benchmark thread counts must be positive.\n");
+      opt.benchmark_threads.push_back(num_threads);
+    }
+    if (opt.benchmark_threads.empty())
+      vw_throw(ArgumentErr() << "No benchmark thread counts were specified.\n");
+    if (opt.benchmark_seconds <= 0.0)
+      vw_throw(ArgumentErr() << "The benchmark duration must be positive.\n");
+  }
+
   if (opt.sample_rate <= 0)
     vw_throw(ArgumentErr() << "The sample rate must be positive.\n" << usage << general_options);
 
@@ -167,18 +198,22 @@ int main(int argc, char *argv[]) {
                                                            use_sphere_for_non_earth);
     vw_out() << "Datum: " << datum << std::endl;
     
-    // Load cam2
+    // Load cam2. It is optional when benchmarking.
     std::string default_session2 = opt.session2; // save it before it changes
-    SessionPtr cam2_session(asp::StereoSessionFactory::create
-                           (opt.session2, // may change
-                            opt,
-                            opt.image_file, opt.image_file,
-                            opt.cam2_file, opt.cam2_file,
-                            out_prefix));
-    boost::shared_ptr<vw::camera::CameraModel> cam2_model
-      = cam2_session->camera_model(opt.image_file, opt.cam2_file);
-
-    if (opt.session1 == opt.session2 && (default_session1 == "" || default_session2 == "")) 
+    SessionPtr cam2_session;
+    boost::shared_ptr<vw::camera::CameraModel> cam2_model;
+    if (opt.cam2_file != "") {
+      cam2_session.reset(asp::StereoSessionFactory::create
+                         (opt.session2, // may change
+                          opt,
+                          opt.image_file, opt.image_file,
+                          opt.cam2_file, opt.cam2_file,
+                          out_prefix));
+      cam2_model = cam2_session->camera_model(opt.image_file, opt.cam2_file);
+    }
+
+    if (!opt.benchmark && opt.session1 == opt.session2 &&
+        (default_session1 == "" || default_session2 == ""))
       vw_throw(ArgumentErr() << "The session names for both cameras "
                << "were guessed as: '" << opt.session1 << "'. It is suggested that they be "
                << "explicitly specified using --session1 and --session2.\n");
@@ -226,6 +261,39 @@ int main(int argc, char *argv[]) {
     }
 
     vw_out() << "Image dimensions: " << image_cols << ' ' << image_rows << std::endl;
+
+    if (opt.benchmark) {
+      // Sample the image sparsely, as the same samples are reused for
+      // all timings.
+      const int NUM_BENCHMARK_SAMPLES = 1000;
+      std::vector<asp::CameraBenchmarkResult> results;
+      std::vector<std::string> names;
+      std::vector<boost::shared_ptr<vw::camera::CameraModel>> models;
+      names.push_back(opt.session1);
+      models.push_back(cam1_model);
+      if (cam2_model) {
+        names.push_back(opt.session2);
+        models.push_back(cam2_model);
+      }
+      for (size_t it = 0; it < models.size(); it++) {
+        std::vector<Vector2> pixels;
+        std::vector<Vector3> points;
+        asp::camera_benchmark_samples(models[it].get(), Vector2i(image_cols, image_rows),
+                                      datum, opt.height_above_datum,
+                                      NUM_BENCHMARK_SAMPLES, pixels, points);
+        vw_out() << "Benchmarking " << names[it] << " with " << pixels.size()
+                 << " samples.\n";
+        asp::benchmark_camera(names[it], models[it], pixels, points,
+                              opt.benchmark_threads, opt.benchmark_seconds, results);
+      }
+
+      asp::print_camera_benchmark(results);
+      if (opt.benchmark_json != "") {
+        vw_out() << "Writing: " << opt.benchmark_json << "\n";
+        asp::write_camera_benchmark_json(opt.benchmark_json, results);
+      }
+      return 0;
+    }
     
     bool single_pix = !std::isnan(opt.single_pixel[0]) && !std::isnan(opt.single_pixel[1]);
 
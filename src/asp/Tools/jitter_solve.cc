@@ -34,12 +34,14 @@
 #include <vw/BundleAdjustment/ControlNetwork.h>
 #include <vw/BundleAdjustment/ControlNetworkLoader.h>
 #include <vw/Core/Stopwatch.h>
+#include <vw/Core/Thread.h>
 #include <vw/Cartography/CameraBBox.h>
 
 #include <asp/Sessions/StereoSessionFactory.h>
 #include <asp/Sessions/CameraUtils.h>
 #include <asp/Camera/CsmModel.h>
 #include <asp/Camera/BundleAdjustCamera.h>
+#include <asp/Camera/LinescanModelPool.h>
 #include <asp/Core/Macros.h>
 #include <asp/Core/StereoSettings.h>
 #include <asp/Core/BundleAdjustUtils.h>
@@ -68,32 +70,49 @@ const int PIXEL_SIZE      = 2;
 
 const double g_big_pixel_value = 1000.0;  // don't make this too big
 
+// Refresh the model copies used by the residuals each time Ceres
+// updates the model parameters, with update_state_every_iteration.
+class RefreshModelPoolsCallback: public ceres::IterationCallback {
+public:
+  RefreshModelPoolsCallback(std::vector<boost::shared_ptr<LsModelPool>> const& model_pools):
+    m_model_pools(model_pools) {}
+
+  virtual ceres::CallbackReturnType operator()(const ceres::IterationSummary& summary) {
+    for (size_t it = 0; it < m_model_pools.size(); it++)
+      m_model_pools[it]->refresh();
+    return ceres::SOLVER_CONTINUE;
+  }
+
+private:
+  std::vector<boost::shared_ptr<LsModelPool>> const& m_model_pools;
+};
+
 // An error function minimizing the error of projecting an xyz point
 // into a given camera pixel. The variables of optimization are a
 // portion of the position and quaternion variables affected by this.
   
 struct pixelReprojectionError {
   pixelReprojectionError(vw::Vector2 const& observation, double weight,
-                         UsgsAstroLsSensorModel* ls_model,
+                         boost::shared_ptr<LsModelPool> model_pool,
                          int begQuatIndex, int endQuatIndex, int begPosIndex, int endPosIndex):
-    m_observation(observation), m_weight(weight),
+    m_observation(observation), m_weight(weight), m_model_pool(model_pool),
     m_begQuatIndex(begQuatIndex), m_endQuatIndex(endQuatIndex),
-    m_begPosIndex(begPosIndex),   m_endPosIndex(endPosIndex),
-    m_ls_model(ls_model){}
+    m_begPosIndex(begPosIndex),   m_endPosIndex(endPosIndex) {}
 
   // Call to work with ceres::DynamicCostFunction.
   bool operator()(double const * const * parameters, double * residuals) const {
 
+    // Borrow a copy of the model, in which we will update the
+    // quaternion and position values that are being modified now.
+    LsModelPool::Entry entry = m_model_pool->acquire();
+    UsgsAstroLsSensorModel * cam = entry.model.get();
+    
     try {
-      // Make a copy of the model, as we will update quaternion and position values
-      // that are being modified now. This may be expensive.
-      UsgsAstroLsSensorModel cam = *m_ls_model;
-
       // Update the relevant quaternions in the local copy
       int shift = 0;
       for (int qi = m_begQuatIndex; qi < m_endQuatIndex; qi++) {
         for (int coord = 0; coord < NUM_QUAT_PARAMS; coord++) {
-          cam.m_quaternions[NUM_QUAT_PARAMS * qi + coord]
+          cam->m_quaternions[NUM_QUAT_PARAMS * qi + coord]
             = parameters[qi + shift - m_begQuatIndex][coord];
         }
       }
@@ -103,7 +122,7 @@ struct pixelReprojectionError {
       shift += (m_endQuatIndex - m_begQuatIndex);
       for (int pi = m_begPosIndex; pi < m_endPosIndex; pi++) {
         for (int coord = 0; coord < NUM_XYZ_PARAMS; coord++) {
-          cam.m_positions[NUM_XYZ_PARAMS * pi + coord]
+          cam->m_positions[NUM_XYZ_PARAMS * pi + coord]
             = parameters[pi + shift - m_begPosIndex][coord];
         }
       }
@@ -119,7 +138,7 @@ struct pixelReprojectionError {
       // anything lower than 1e-8, as the linescan model will then
       // return junk.
       double desired_precision = asp::DEFAULT_CSM_DESIRED_PRECISISON;
-      csm::ImageCoord imagePt = cam.groundToImage(P, desired_precision);
+      csm::ImageCoord imagePt = cam->groundToImage(P, desired_precision);
 
       // Convert to what ASP expects
       vw::Vector2 pix;
@@ -131,21 +150,23 @@ struct pixelReprojectionError {
     } catch (std::exception const& e) {
       residuals[0] = g_big_pixel_value;
       residuals[1] = g_big_pixel_value;
-      return true; // accept the solution anyway
     }
-    return true;
+
+    m_model_pool->release(entry, m_begQuatIndex, m_endQuatIndex,
+                          m_begPosIndex, m_endPosIndex);
+    return true; // accept the solution anyway
   }
 
   // Factory to hide the construction of the CostFunction object from the client code.
   static ceres::CostFunction* Create(vw::Vector2 const& observation, double weight,
-                                     UsgsAstroLsSensorModel* ls_model,
+                                     boost::shared_ptr<LsModelPool> model_pool,
                                      int begQuatIndex, int endQuatIndex,
                                      int begPosIndex, int endPosIndex){
 
     // TODO(oalexan1): Try using here the analytical cost function
     ceres::DynamicNumericDiffCostFunction<pixelReprojectionError>* cost_function =
       new ceres::DynamicNumericDiffCostFunction<pixelReprojectionError>
-      (new pixelReprojectionError(observation, weight, ls_model,
+      (new pixelReprojectionError(observation, weight, model_pool,
                                   begQuatIndex, endQuatIndex,
                                   begPosIndex, endPosIndex));
 
@@ -167,7 +188,7 @@ struct pixelReprojectionError {
 private:
   Vector2 m_observation; // The pixel observation for this camera/point pair
   double m_weight;
-  UsgsAstroLsSensorModel* m_ls_model;
+  boost::shared_ptr<LsModelPool> m_model_pool;
   int m_begQuatIndex, m_endQuatIndex;
   int m_begPosIndex, m_endPosIndex;
 }; // End class pixelReprojectionError
@@ -410,7 +431,9 @@ void handle_arguments(int argc, char *argv[], Options& opt) {
     ("quat-norm-weight", po::value(&opt.quat_norm_weight)->default_value(1.0),
      "How much weight to give to the constraint that the norm of each quaternion must be 1.")
     ("ip-side-filter-percent",  po::value(&opt.ip_edge_buffer_percent)->default_value(-1.0),
-     "Remove matched IPs this percentage from the image left/right sides.");
+     "Remove matched IPs this percentage from the image left/right sides.")
+    ("camera-cache-dir", po::value(&opt.camera_cache_dir)->default_value(""),
+     "Save the parsed CSM camera models in this directory, and read them from there in later runs rather than parsing the camera files again. Cached models are matched to the camera files by path, size, and modification time. Only CSM cameras are cached. DG, SPOT, Pleiades, and ISIS cameras are not, as their models have no saved form.");
   
     general_options.add(vw::GdalWriteOptionsDescription(opt));
 
@@ -1089,9 +1112,15 @@ void addReprojectionErrors
  std::vector<std::vector<int>>                        const & isAnchor_vec,
  std::vector<UsgsAstroLsSensorModel*>                 const & ls_models,
  // Outputs
+ std::vector<boost::shared_ptr<LsModelPool>>                & model_pools,
  std::vector<double>                                        & weight_per_residual, // append
  ceres::Problem                                             & problem) {
 
+  // The copies of each model used when evaluating the residuals
+  model_pools.resize(ls_models.size());
+  for (size_t icam = 0; icam < ls_models.size(); icam++)
+    model_pools[icam].reset(new LsModelPool(ls_models[icam]));
+  
   // Do here two passes, first for non-anchor points and then for anchor ones.
   // This way it is easier to do the bookkeeping when saving the residuals.
   // Note: The same motions as here are repeated in save_residuals().
@@ -1155,7 +1184,7 @@ void addReprojectionErrors
           vw_throw(ArgumentErr() << "Book-keeping error for pixel: " << observation << ".\n"); 
 
         ceres::CostFunction* pixel_cost_function =
-          pixelReprojectionError::Create(observation, weight, ls_models[icam],
+          pixelReprojectionError::Create(observation, weight, model_pools[icam],
                                          begQuatIndex, endQuatIndex,
                                          begPosIndex, endPosIndex);
         ceres::LossFunction* pixel_loss_function = new ceres::CauchyLoss(opt.robust_threshold);
@@ -1345,7 +1374,7 @@ void run_jitter_solve(int argc, char* argv[]) {
 
   bool approximate_pinhole_intrinsics = false;
   asp::load_cameras(opt.image_files, opt.camera_files, opt.out_prefix, opt,  
-                    approximate_pinhole_intrinsics,  
+                    approximate_pinhole_intrinsics, opt.camera_cache_dir,
                     // Outputs
                     opt.stereo_session,  // may change
                     opt.single_threaded_cameras,  
@@ -1584,10 +1613,11 @@ void run_jitter_solve(int argc, char* argv[]) {
   ceres::Problem problem;
   
   // Add reprojection errors
+  std::vector<boost::shared_ptr<LsModelPool>> model_pools;
   addReprojectionErrors(opt, crn, pixel_vec, xyz_vec, xyz_vec_ptr, weight_vec,
                         isAnchor_vec, ls_models,
                         // Outputs
-                        weight_per_residual, problem);
+                        model_pools, weight_per_residual, problem);
  
   // Add the DEM constraint. We check earlier that only one
   // of the two options below can be set at a time.
@@ -1643,11 +1673,20 @@ void run_jitter_solve(int argc, char* argv[]) {
   options.linear_solver_type  = ceres::ITERATIVE_SCHUR;
   options.preconditioner_type = ceres::SCHUR_JACOBI;
   options.use_explicit_schur_complement = false; // Only matters with ITERATIVE_SCHUR
+
+  // The model copies used by the residuals must be refreshed when the
+  // model parameters change. Without update_state_every_iteration that
+  // happens only at the end of the solve.
+  RefreshModelPoolsCallback refresh_callback(model_pools);
+  if (options.update_state_every_iteration)
+    options.callbacks.push_back(&refresh_callback);
   
   // Solve the problem
   vw_out() << "Starting the Ceres optimizer." << std::endl;
   ceres::Solver::Summary summary;
   ceres::Solve(options, &problem, &summary);
+  for (size_t icam = 0; icam < model_pools.size(); icam++)
+    model_pools[icam]->refresh();
   vw_out() << summary.FullReport() << "\n";
   if (summary.termination_type == ceres::NO_CONVERGENCE) 
     vw_out() << "Found a valid solution, but did not reach the actual minimum.\n";
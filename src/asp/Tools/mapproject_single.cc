@@ -47,7 +47,8 @@ struct Options : vw::GdalWriteOptions {
   // Input
   std::string dem_file, image_file, camera_file, output_file, stereo_session,
     bundle_adjust_prefix;
-  bool isQuery, noGeoHeaderInfo, nearest_neighbor, parseOptions, dg_use_csm;
+  bool isQuery, noGeoHeaderInfo, nearest_neighbor, parseOptions, dg_use_csm,
+    dg_interpolation_tables;
   bool multithreaded_model; // This is set based on the session type.
   bool enable_correct_velocity_aberration, enable_correct_atmospheric_refraction;
   
@@ -102,6 +103,8 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
      "Turn on atmospheric refraction correction for Optical Bar and non-ISIS linescan cameras. This option impairs the convergence of bundle adjustment.")
     ("dg-use-csm", po::bool_switch(&opt.dg_use_csm)->default_value(false)->implicit_value(true),
      "Use the CSM model with DigitalGlobe linescan cameras (-t dg). No corrections are done for velocity aberration or atmospheric refraction.")
+    ("dg-interpolation-tables", po::bool_switch(&opt.dg_interpolation_tables)->default_value(false)->implicit_value(true),
+     "With DigitalGlobe linescan cameras (-t dg), resample the camera positions, velocities, and orientations onto tables which are faster to evaluate, with the error checked to be negligible. Not used with --dg-use-csm.")
     ("parse-options", po::bool_switch(&opt.parseOptions)->default_value(false),
      "Parse the options and print the results. Used by the mapproject script.")
     ;
@@ -161,6 +164,7 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     = opt.enable_correct_atmospheric_refraction;
   
   asp::stereo_settings().dg_use_csm = opt.dg_use_csm;
+  asp::stereo_settings().dg_interpolation_tables = opt.dg_interpolation_tables;
   
   if (fs::path(opt.dem_file).extension() != "") {
     // A path to a real DEM file was provided, load it!
@@ -0,0 +1,88 @@
+#!/usr/bin/env python
+# __BEGIN_LICENSE__
+#  Copyright (c) 2009-2013, United States Government as represented by the
+#  Administrator of the National Aeronautics and Space Administration. All
+#  rights reserved.
+#
+#  The NGT platform is licensed under the Apache License, Version 2.0 (the
+#  "License"); you may not use this file except in compliance with the
+#  License. You may obtain a copy of the License at
+#  http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+# __END_LICENSE__
+
+# Convert the binary residual files written by bundle_adjust with the
+# option --binary-residuals to the text files it writes by default.
+
+import argparse, os, struct, sys
+
+def read_string(f):
+    """
+    Read a string preceded by its length as a 64-bit integer. Return None
+    at the end of the file.
+    """
+    buf = f.read(8)
+    if len(buf) < 8:
+        return None
+    length, = struct.unpack('=Q', buf)
+    return f.read(length).decode('utf-8')
+
+def convert_raw_pixels(infile, out):
+    """
+    For each camera, the name, the number of pixels, and the column and
+    row residual for each pixel.
+    """
+    with open(infile, 'rb') as f:
+        while True:
+            name = read_string(f)
+            if name is None:
+                break
+            num, = struct.unpack('=Q', f.read(8))
+            vals = struct.unpack('=%dd' % (2 * num), f.read(16 * num))
+            out.write('%s, %d\n' % (name, num))
+            for i in range(num):
+                out.write('%.18g, %.18g\n' % (vals[2 * i], vals[2 * i + 1]))
+
+def convert_pointmap(infile, out):
+    """
+    The datum, then for each point the longitude, latitude, height,
+    mean residual, number of observations, and point type.
+    """
+    comments = {0: '', 1: ' # GCP', 2: ' # from DEM'}
+    record = struct.Struct('=ddddiB')
+    with open(infile, 'rb') as f:
+        datum = read_string(f)
+        out.write('# lon, lat, height_above_datum, mean_residual, num_observations\n')
+        out.write('# %s\n' % datum)
+        while True:
+            buf = f.read(record.size)
+            if len(buf) < record.size:
+                break
+            lon, lat, height, residual, num_obs, point_type = record.unpack(buf)
+            out.write('%.18g, %.18g, %.18g, %.18g, %d%s\n' %
+                      (lon, lat, height, residual, num_obs, comments[point_type]))
+
+if __name__ == '__main__':
+
+    parser = argparse.ArgumentParser(description='Convert a binary residual file written by bundle_adjust with --binary-residuals, ending in raw_pixels.bin or pointmap.bin, to the text format it writes by default.')
+    parser.add_argument('infile', type=str, help='Path to the input file.')
+    parser.add_argument('outfile', type=str, help='Path to the output file.')
+    args = parser.parse_args()
+
+    if args.infile.endswith('raw_pixels.bin'):
+        convert = convert_raw_pixels
+    elif args.infile.endswith('pointmap.bin'):
+        convert = convert_pointmap
+    else:
+        print("Expecting a file ending in raw_pixels.bin or pointmap.bin.")
+        sys.exit(1)
+
+    print("Reading: " + args.infile)
+    print("Writing: " + args.outfile)
+    with open(args.outfile, 'w') as out:
+        convert(args.infile, out)
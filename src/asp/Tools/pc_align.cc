@@ -68,6 +68,7 @@
 #include <asp/Core/Common.h>
 #include <asp/Core/Macros.h>
 #include <asp/Core/PointUtils.h>
+#include <asp/Core/QuantileSketch.h>
 #include <asp/Core/InterestPointMatching.h>
 #include <asp/Tools/pc_align_utils.h>
 
@@ -308,35 +309,31 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
               << "--initial-transform-ransac-params.\n");
 }
 
-/// Compute output statistics for pc_align
+/// Compute output statistics for pc_align. The errors are put in a
+/// quantile sketch rather than copied and sorted, as there can be
+/// very many of them.
 void calc_stats(string label, PointMatcher<RealT>::Matrix const& dists){
 
   VW_ASSERT(dists.rows() == 1,
             LogicErr() << "Expecting only one row.");
 
-  vector<double> errs(dists.cols()*dists.rows());
-  int count = 0;
-  for (int col = 0; col < dists.cols(); col++){
-    //for (int row = 0; row < dists.rows(); row++){
-    errs[count] = dists(0, col);
-    count++;
-    //}
-  }
-  sort(errs.begin(), errs.end());
+  asp::QuantileSketch errs;
+  for (int col = 0; col < dists.cols(); col++)
+    errs.add(dists(0, col));
 
   int len = errs.size();
   vw_out() << "Number of errors: " << len << endl;
   if (len == 0)
     return;
 
-  double p16 = errs[std::min(len-1, (int)round(len*0.16))];
-  double p50 = errs[std::min(len-1, (int)round(len*0.50))];
-  double p84 = errs[std::min(len-1, (int)round(len*0.84))];
+  double p16 = errs.value_at_rank(std::min(len-1, (int)round(len*0.16)));
+  double p50 = errs.value_at_rank(std::min(len-1, (int)round(len*0.50)));
+  double p84 = errs.value_at_rank(std::min(len-1, (int)round(len*0.84)));
   vw_out() << label << ": error percentile of smallest errors (meters):"
            << " 16%: " << p16 << ", 50%: " << p50 << ", 84%: " << p84 << endl;
 
-  double a25 = calc_mean(errs,   len/4), a50  = calc_mean(errs, len/2);
-  double a75 = calc_mean(errs, 3*len/4), a100 = calc_mean(errs, len);
+  double a25 = errs.mean_of_smallest(len/4),   a50  = errs.mean_of_smallest(len/2);
+  double a75 = errs.mean_of_smallest(3*len/4), a100 = errs.mean_of_smallest(len);
   vw_out() << label << ": mean of smallest errors (meters):"
            << " 25%: "  << a25 << ", 50%: "  << a50
            << ", 75%: " << a75 << ", 100%: " << a100 << endl;
@@ -58,6 +58,7 @@
 #include <asp/Core/Macros.h>
 #include <asp/Core/PointUtils.h>
 #include <asp/Core/EigenUtils.h>
+#include <asp/Core/PointCloudCollection.h>
 
 // Turn off warnings about things we can't control
 #pragma GCC diagnostic push
@@ -132,9 +133,6 @@ void calc_extended_lonlat_bbox(vw::cartography::GeoReference const& geo,
                                vw::BBox2 & out_box, 
                                vw::BBox2 & trans_out_box);
   
-/// Compute the mean value of an std::vector out to a length
-double calc_mean(std::vector<double> const& errs, int len);
-
 /// Compute the standard deviation of an std::vector out to a length
 double calc_stddev(std::vector<double> const& errs, double mean);
 
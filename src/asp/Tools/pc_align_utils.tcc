@@ -201,6 +201,9 @@ void load_cloud(std::string const& file_name,
   else if (file_type == "PC")
     load_pc(file_name, num_points_to_load, lonlat_box, calc_shift, shift,
 	    geo, verbose, data);
+  else if (file_type == "PCC")
+    load_pc_collection(file_name, num_points_to_load, lonlat_box, calc_shift, shift,
+                       geo, verbose, data);
   else if (file_type == "LAS")
     load_las(file_name, num_points_to_load, lonlat_box, calc_shift, shift,
 	     geo, verbose, data);
@@ -385,15 +388,6 @@ void adjust_lonlat_bbox(std::string const& file_name, vw::BBox2 & box){
   box += Vector2(lon_offset, 0);
 }
 
-double calc_mean(std::vector<double> const& errs, int len){
-  double mean = 0.0;
-  for (int i = 0; i < len; i++){
-    mean += errs[i];
-  }
-  if (len == 0) return 0;
-  return mean/len;
-}
-
 double calc_stddev(std::vector<double> const& errs, double mean){
   double stddev = 0.0;
   int len = errs.size();
@@ -530,6 +524,35 @@ void save_trans_point_cloud(vw::GdalWriteOptions const& opt,
   std::string file_type = get_cloud_type(input_file);
 
   std::string output_file;
+  if (file_type == "PCC") {
+    // Transform each cloud in the collection, and list the results in
+    // a new collection. The transformed block boxes are found from the
+    // box corners, so they are still conservative.
+    asp::PointCloudCollection collection;
+    collection.read(input_file);
+    for (size_t m = 0; m < collection.members.size(); m++) {
+      asp::PointCloudMember & member = collection.members[m];
+      std::string member_prefix = out_prefix + "-" + vw::num_to_str(m);
+      save_trans_point_cloud(opt, member.file, member_prefix, geo, csv_conv, T);
+      member.file = member_prefix + ".tif";
+      for (size_t b = 0; b < member.blocks.size(); b++) {
+        vw::BBox3 & box = member.blocks[b].point_box;
+        vw::BBox3 trans_box;
+        for (int c = 0; c < 8; c++) {
+          vw::Vector3 corner((c & 1) ? box.max().x() : box.min().x(),
+                             (c & 2) ? box.max().y() : box.min().y(),
+                             (c & 4) ? box.max().z() : box.min().z());
+          trans_box.grow(apply_transform(T, corner));
+        }
+        box = trans_box;
+      }
+    }
+    output_file = out_prefix + ".pcc";
+    vw::vw_out() << "Writing: " << output_file << std::endl;
+    collection.write(output_file);
+    return;
+  }
+
   if (file_type == "CSV")
     output_file = out_prefix + ".csv";
   else if (file_type == "LAS")
@@ -798,10 +821,15 @@ void read_georef(std::vector<std::string> const& clouds,
   // Either one, or both or neither of the pc files may have a georef.
   std::string pc_file = "";
   for (size_t it = 0; it < clouds.size(); it++) {
-    if ( asp::get_cloud_type(clouds[it]) == "PC" ){
+    std::string cloud_type = asp::get_cloud_type(clouds[it]);
+    if (cloud_type == "PC" || cloud_type == "PCC"){
+      // For a collection, use the georef of its first cloud
+      std::string file = clouds[it];
+      if (cloud_type == "PCC")
+        file = asp::expand_point_cloud_collections(std::vector<std::string>(1, file))[0];
       vw::cartography::GeoReference local_geo;
-      if (vw::cartography::read_georeference(local_geo, clouds[it])){
-        pc_file = clouds[it];
+      if (vw::cartography::read_georeference(local_geo, file)){
+        pc_file = file;
         geo = local_geo;
         vw::vw_out() << "Detected datum from " << pc_file << ":\n" << geo.datum() << std::endl;
         is_good = true;
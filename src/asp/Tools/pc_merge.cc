@@ -19,12 +19,15 @@
 /// \file pc_merge.cc
 ///
 /// A simple tool to merge multiple point cloud files into a single file. The clouds
-/// can have 1 channel (plain raster images) or 3 to 6 channels.
+/// can have 1 channel (plain raster images) or 3 to 6 channels. If the output
+/// file has the .pcc extension, write instead a point cloud collection, which
+/// lists the input clouds and their non-empty blocks.
 
 #include <asp/Core/Macros.h>
 #include <asp/Core/Common.h>
 #include <asp/Core/PointUtils.h>
 #include <asp/Core/OrthoRasterizer.h>
+#include <asp/Core/PointCloudCollection.h>
 
 #include <vw/Core/Stopwatch.h>
 #include <vw/Mosaic/ImageComposite.h>
@@ -80,7 +83,9 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
   if (vm.count("input-files") == 0)
     vw_throw( ArgumentErr() << "Missing input point clouds.\n"
                             << usage << general_options );
-  opt.pointcloud_files = vm["input-files"].as< std::vector<std::string> >();
+  // Collections in the input are replaced with their member clouds
+  opt.pointcloud_files
+    = asp::expand_point_cloud_collections(vm["input-files"].as< std::vector<std::string> >());
 
   if (opt.out_file == "")
     vw_throw( ArgumentErr() << "The output file must be specified!\n"
@@ -195,6 +200,25 @@ do_work(Vector3 const& shift, Options const& opt) {
       opt, TerminalProgressCallback("asp", "\t--> Merging: "));
 }
 
+// Index the input clouds and list them in a collection file. No
+// point is copied, so this is fast and takes little space.
+void write_collection(Options const& opt) {
+
+  // Use a multiple of the point2dem block size, so a block of the
+  // collection is either fully read or fully skipped.
+  const int block_size = 8 * ASP_MAX_SUBBLOCK_SIZE;
+
+  asp::PointCloudCollection collection;
+  collection.members.resize(opt.pointcloud_files.size());
+  for (size_t i = 0; i < opt.pointcloud_files.size(); i++) {
+    vw_out() << "Indexing: " << opt.pointcloud_files[i] << "\n";
+    asp::index_point_cloud(opt.pointcloud_files[i], block_size, collection.members[i]);
+  }
+
+  vw_out() << "Writing point cloud collection: " << opt.out_file << "\n";
+  collection.write(opt.out_file);
+}
+
 //-----------------------------------------------------------------------------------
 
 int main( int argc, char *argv[] ) {
@@ -206,6 +230,13 @@ int main( int argc, char *argv[] ) {
     // Determine the number of channels
     int num_channels = check_num_channels(opt.pointcloud_files);
 
+    if (asp::is_point_cloud_collection(opt.out_file)) {
+      if (num_channels < 3)
+        vw_throw(ArgumentErr() << "Only point clouds can be merged into a collection.\n");
+      write_collection(opt);
+      return 0;
+    }
+
     // Determine the output shift (if any)
     Vector3 shift = determine_output_shift(opt.pointcloud_files, opt);
 
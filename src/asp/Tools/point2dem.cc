@@ -20,6 +20,7 @@
 ///
 
 #include <asp/Core/PointUtils.h>
+#include <asp/Core/PointCloudCollection.h>
 #include <asp/Core/OrthoRasterizer.h>
 #include <asp/Core/Macros.h>
 #include <asp/Core/Common.h>
@@ -105,7 +106,7 @@ struct Options : vw::GdalWriteOptions {
     has_las_or_csv_or_pcd(false), max_output_size(9999999, 9999999){}
 };
 
-void parse_input_clouds_textures(std::vector<std::string> const& files,
+void parse_input_clouds_textures(std::vector<std::string> const& in_files,
                                  std::string const& usage,
                                  po::options_description const& general_options,
                                  Options& opt) {
@@ -115,26 +116,31 @@ void parse_input_clouds_textures(std::vector<std::string> const& files,
   // must be one for each point cloud, and each cloud must have the
   // same dimensions as its texture file.
 
-  int num = files.size();
+  int num = in_files.size();
   if (num == 0)
     vw_throw(ArgumentErr() << "Missing input point clouds.\n"
                             << usage << general_options);
 
   // Ensure there were no unrecognized options
   for (int i = 0; i < num; i++){
-    if (!files[i].empty() && files[i][0] == '-'){
-      vw_throw(ArgumentErr() << "Unrecognized option: " << files[i] << ".\n"
+    if (!in_files[i].empty() && in_files[i][0] == '-'){
+      vw_throw(ArgumentErr() << "Unrecognized option: " << in_files[i] << ".\n"
                               << usage << general_options);
     }
   }
 
   // Ensure that files exist
   for (int i = 0; i < num; i++){
-    if (!fs::exists(files[i])){
-      vw_throw(ArgumentErr() << "File does not exist: " << files[i] << ".\n");
+    if (!fs::exists(in_files[i])){
+      vw_throw(ArgumentErr() << "File does not exist: " << in_files[i] << ".\n");
     }
   }
 
+  // Replace point cloud collections with their member clouds. The
+  // tiles of the DEM are later made only from the clouds they overlap.
+  std::vector<std::string> files = asp::expand_point_cloud_collections(in_files);
+  num = files.size();
+
   if (opt.do_ortho){
     if (num <= 1)
       vw_throw(ArgumentErr() << "Missing input texture files.\n"
@@ -1081,7 +1087,8 @@ void do_software_rasterization_multi_spacing(const ImageViewRef<Vector3>& proj_p
                                              cartography::GeoReference& georef,
                                              ImageViewRef<double> const& error_image,
                                              double estim_max_error,
-                                             vw::BBox3 const& estim_proj_box) {
+                                             vw::BBox3 const& estim_proj_box,
+                                             std::vector<BBox2i> const& valid_blocks) {
 
   asp::OutlierRemovalMethod outlier_removal_method = asp::NO_OUTLIER_REMOVAL_METHOD;
   if (opt.remove_outliers_with_pct)
@@ -1108,7 +1115,8 @@ void do_software_rasterization_multi_spacing(const ImageViewRef<Vector3>& proj_p
                opt.median_filter_params, opt.erode_len, opt.has_las_or_csv_or_pcd,
                opt.filter, opt.default_grid_size_multiplier,
                &num_invalid_pixels, &count_mutex,
-               TerminalProgressCallback("asp","QuadTree: "));
+               TerminalProgressCallback("asp","QuadTree: "),
+               valid_blocks);
 
   sw1.stop();
   vw_out(DebugMessage,"asp") << "Quad time: " << sw1.elapsed_seconds() << std::endl;
@@ -1211,6 +1219,13 @@ int main(int argc, char *argv[]) {
     ImageViewRef<Vector3> point_image
       = asp::form_point_cloud_composite<Vector3>(opt.pointcloud_files,
                                                  ASP_MAX_SUBBLOCK_SIZE);
+
+    // If all clouds have an index, as written by stereo_tri, find the
+    // blocks having points, so the rest can be skipped.
+    std::vector<BBox2i> valid_blocks;
+    if (asp::point_cloud_composite_blocks(opt.pointcloud_files, ASP_MAX_SUBBLOCK_SIZE,
+                                          valid_blocks))
+      vw_out() << "Using the point cloud indices to skip empty blocks.\n";
     
     // Apply an (optional) rotation to the 3D points before building the mesh.
     if (opt.phi_rot != 0 || opt.omega_rot != 0 || opt.kappa_rot != 0) {
@@ -1290,7 +1305,7 @@ int main(int argc, char *argv[]) {
 
     // Create the DEM
     do_software_rasterization_multi_spacing(proj_points, opt, output_georef, error_image,
-                                            estim_max_error, estim_proj_box);
+                                            estim_max_error, estim_proj_box, valid_blocks);
     
     // Wipe the temporary files
     for (int i = 0; i < (int)tmp_tifs.size(); i++)
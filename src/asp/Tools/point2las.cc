@@ -33,63 +33,56 @@
 #include <asp/Core/Macros.h>
 #include <asp/Core/Common.h>
 #include <asp/Core/PointUtils.h>
+#include <asp/Core/PointCloudCollection.h>
+#include <asp/Core/QuantileSketch.h>
 
 #include <vw/Cartography/PointImageManipulation.h>
 #include <vw/Core/Stopwatch.h>
-#include <vw/Math/Statistics.h>
 
 using namespace vw;
 namespace po = boost::program_options;
 
 // A class to collect some positive errors, and return the error at
-// given percentile multiplied by given factor.
+// given percentile multiplied by given factor. The errors are kept in
+// a quantile sketch, so the memory use does not grow with their number.
 class PercentileErrorAccum : public ReturnFixedType<void> {
   typedef double accum_type;
-  std::vector<accum_type> m_vals;
+  asp::QuantileSketch m_sketch;
 public:
   typedef accum_type value_type;
   
-  PercentileErrorAccum() { m_vals.clear(); }
+  PercentileErrorAccum() {}
   
   void operator()( accum_type const& value ) {
     // Don't add zero errors, those most likely came from invalid points
     if (value > 0)
-      m_vals.push_back(value);
+      m_sketch.add(value);
   }
   
-  int size(){
-    return m_vals.size();
+  size_t size(){
+    return m_sketch.size();
   }
   
   value_type value(Vector2 const& outlier_removal_params, bool use_tukey_outlier_removal){
 
     // Care here with empty sets
-    if (m_vals.empty()) {
+    if (m_sketch.empty()) {
       vw_out() << "Found no positive triangulation errors in the sample.\n";
       return 0.0;
     }
     
-    std::sort(m_vals.begin(), m_vals.end());
+    vw_out() << "Collected a sample of " << m_sketch.size()
+             << " positive triangulation errors.\n";
 
-    int len = m_vals.size();
-
-    vw_out() << "Collected a sample of " << len << " positive triangulation errors.\n";
-
-    double mean = vw::math::mean(m_vals);
-    
     vw_out() << "For this sample: "
-             << "min = "     << m_vals.front()
-             << ", mean = "  << mean
-             << ", stdev = " << vw::math::standard_deviation(m_vals, mean)
-             << ", max = " << m_vals.back() << "." << std::endl;
-
-    int i25 = round((len - 1) * 0.25);
-    int i50 = round((len - 1) * 0.50);
-    int i75 = round((len - 1) * 0.75);
-
-    double Q1 = m_vals[i25];
-    double Q2 = m_vals[i50];
-    double Q3 = m_vals[i75];
+             << "min = "     << m_sketch.min()
+             << ", mean = "  << m_sketch.mean()
+             << ", stdev = " << m_sketch.stddev()
+             << ", max = "   << m_sketch.max() << "." << std::endl;
+
+    double Q1 = m_sketch.quantile(0.25);
+    double Q2 = m_sketch.quantile(0.50);
+    double Q3 = m_sketch.quantile(0.75);
     vw_out() << "Error percentiles: " 
              << "Q1 (25%): " << Q1 << ", "
              << "Q2 (50%): " << Q2 << ", "
@@ -103,12 +96,11 @@ public:
     
     double pct    = outlier_removal_params[0]/100.0; // e.g., 0.75
     double factor = outlier_removal_params[1];
-    int k         = (int)round((len - 1) * pct);
     
     vw_out() << "Using as outlier cutoff the " << outlier_removal_params[0] << " percentile times "
              << factor << "." << std::endl;
     
-    return m_vals[k] * factor;
+    return m_sketch.quantile(pct) * factor;
   }
 
 };
@@ -117,6 +109,7 @@ struct Options : vw::GdalWriteOptions {
   // Input
   std::string reference_spheroid, datum;
   std::string pointcloud_file;
+  std::vector<std::string> pointcloud_files; // the member clouds, for a collection
   std::string target_srs_string;
   bool        compressed, use_tukey_outlier_removal;
   Vector2     outlier_removal_params;
@@ -179,6 +172,9 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     opt.out_prefix =
       vw::prefix_from_filename( opt.pointcloud_file );
 
+  opt.pointcloud_files
+    = asp::expand_point_cloud_collections(std::vector<std::string>(1, opt.pointcloud_file));
+
   // reference_spheroid and datum are aliases.
   boost::to_lower(opt.reference_spheroid);
   boost::to_lower(opt.datum);
@@ -207,9 +203,7 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
 
 void find_error_image_and_do_stats(Options& opt, ImageViewRef<double> & error_image) {
       
-  std::vector<std::string> pointcloud_files;
-  pointcloud_files.push_back(opt.pointcloud_file);
-  error_image = asp::point_cloud_error_image(pointcloud_files);
+  error_image = asp::point_cloud_error_image(opt.pointcloud_files);
   
   if (error_image.rows() == 0 || error_image.cols() == 0) {
     vw_out() << "The point cloud files must have an equal number of channels which "
@@ -261,6 +255,32 @@ int main( int argc, char *argv[] ) {
   try {
     handle_arguments(argc, argv, opt);
 
+    // The pixel boxes to read in each cloud. For a collection, or a
+    // cloud with an index, these are its non-empty blocks, and the rest
+    // is skipped. Then the bounding box of the points is known as well.
+    std::vector<std::vector<BBox2i>> cloud_boxes(opt.pointcloud_files.size());
+    asp::PointCloudCollection collection;
+    bool have_blocks = false;
+    if (asp::is_point_cloud_collection(opt.pointcloud_file)) {
+      collection.read(opt.pointcloud_file);
+      have_blocks = true;
+    } else {
+      collection.members.resize(1);
+      have_blocks = asp::read_point_cloud_index(opt.pointcloud_file, collection.members[0]);
+      if (have_blocks)
+        vw_out() << "Using the index: "
+                 << asp::point_cloud_index_file(opt.pointcloud_file) << "\n";
+    }
+    if (have_blocks) {
+      for (size_t m = 0; m < collection.members.size(); m++) {
+        for (size_t b = 0; b < collection.members[m].blocks.size(); b++)
+          cloud_boxes[m].push_back(collection.members[m].blocks[b].pixel_box);
+      }
+    } else {
+      ImageViewRef<Vector3> cloud = asp::read_asp_point_cloud<3>(opt.pointcloud_file);
+      cloud_boxes[0].push_back(bounding_box(cloud));
+    }
+
     ImageViewRef<double> error_image;
     if (opt.outlier_removal_params[0] < 100.0 || opt.max_valid_triangulation_error > 0.0)
       find_error_image_and_do_stats(opt, error_image);
@@ -272,7 +292,7 @@ int main( int argc, char *argv[] ) {
     bool have_user_datum = asp::read_user_datum(0, 0, opt.datum, datum);
 
     cartography::GeoReference georef;
-    bool have_input_georef = vw::cartography::read_georeference(georef, opt.pointcloud_file);
+    bool have_input_georef = vw::cartography::read_georeference(georef, opt.pointcloud_files[0]);
     if (have_input_georef && opt.target_srs_string.empty()) {
       opt.target_srs_string = georef.overall_proj4_str();
     }
@@ -296,14 +316,45 @@ int main( int argc, char *argv[] ) {
     }
 
     // Save the las file with given georeference, if present
-    ImageViewRef<Vector3> point_image = asp::read_asp_point_cloud<3>(opt.pointcloud_file);
+    double avg_lon = 0.0;
     if (is_geodetic) {
-      point_image = cartesian_to_geodetic(point_image, datum);
-      double avg_lon = asp::find_avg_lon(point_image); // see if to use [-180, 180] or [0, 360]
-      point_image = geodetic_to_point(asp::recenter_longitude(point_image, avg_lon), georef);
+      // See if to use [-180, 180] or [0, 360]
+      ImageViewRef<Vector3> all_points
+        = asp::form_point_cloud_composite<Vector3>(opt.pointcloud_files, ASP_MAX_SUBBLOCK_SIZE);
+      avg_lon = asp::find_avg_lon(cartesian_to_geodetic(all_points, datum));
+    }
+    std::vector<ImageViewRef<Vector3>> point_images(opt.pointcloud_files.size());
+    for (size_t m = 0; m < opt.pointcloud_files.size(); m++) {
+      point_images[m] = asp::read_asp_point_cloud<3>(opt.pointcloud_files[m]);
+      if (is_geodetic)
+        point_images[m]
+          = geodetic_to_point(asp::recenter_longitude(cartesian_to_geodetic(point_images[m],
+                                                                             datum),
+                                                      avg_lon), georef);
     }
 
-    BBox3 cloud_bbox = asp::pointcloud_bbox(point_image, is_geodetic);
+    BBox3 cloud_bbox;
+    if (have_blocks && !is_geodetic) {
+      // The points are not transformed, so the known box can be used
+      cloud_bbox = collection.point_box();
+    } else if (!have_blocks) {
+      cloud_bbox = asp::pointcloud_bbox(point_images[0], is_geodetic);
+    } else {
+      vw_out() << "Computing the point cloud bounding box.\n";
+      for (size_t m = 0; m < point_images.size(); m++) {
+        for (size_t b = 0; b < cloud_boxes[m].size(); b++) {
+          ImageView<Vector3> points = crop(point_images[m], cloud_boxes[m][b]);
+          for (int row = 0; row < points.rows(); row++) {
+            for (int col = 0; col < points.cols(); col++) {
+              Vector3 const& pt = points(col, row);
+              if ( (!is_geodetic && pt != vw::Vector3()) ||
+                   (is_geodetic  && !boost::math::isnan(pt.z())) )
+                cloud_bbox.grow(pt);
+            }
+          }
+        }
+      }
+    }
 
     // The las format stores the values as 32 bit integers. So, for a
     // given point, we store round((point-offset)/scale), as well as
@@ -342,50 +393,71 @@ int main( int argc, char *argv[] ) {
     TerminalProgressCallback tpc("asp", "\t--> ");
     long long int num_total_points = 0;
     long long int num_kept_points = 0;
-    
-    for (int row = 0; row < point_image.rows(); row++){
-      tpc.report_fractional_progress(row, point_image.rows());
-      for (int col = 0; col < point_image.cols(); col++){
-
-        Vector3 point = point_image(col, row);
-
-        // Skip no-data points
-        bool is_good = ( (!is_geodetic && point != vw::Vector3()) ||
-                         (is_geodetic  && !boost::math::isnan(point.z())) );
-        if (!is_good) continue;
 
-        num_total_points++;
+    double total_area = 0.0, done_area = 0.0;
+    for (size_t m = 0; m < cloud_boxes.size(); m++)
+      for (size_t b = 0; b < cloud_boxes[m].size(); b++)
+        total_area += cloud_boxes[m][b].area();
+
+    for (size_t m = 0; m < point_images.size(); m++) {
+
+      // The errors of this cloud. They are found only if needed for
+      // outlier removal, and then the stats were done already.
+      ImageViewRef<double> cloud_error_image;
+      if (error_image.rows() > 0 && error_image.cols() > 0)
+        cloud_error_image
+          = asp::point_cloud_error_image(std::vector<std::string>(1, opt.pointcloud_files[m]));
+
+      for (size_t b = 0; b < cloud_boxes[m].size(); b++) {
+        BBox2i const& box = cloud_boxes[m][b];
+        done_area += box.area();
+        for (int row = box.min().y(); row < box.max().y(); row++){
+          tpc.report_fractional_progress(done_area - box.area()
+                                         + double(row - box.min().y()) * box.width(),
+                                         std::max(total_area, 1.0));
+          for (int col = box.min().x(); col < box.max().x(); col++){
+
+            Vector3 point = point_images[m](col, row);
+
+            // Skip no-data points
+            bool is_good = ( (!is_geodetic && point != vw::Vector3()) ||
+                             (is_geodetic  && !boost::math::isnan(point.z())) );
+            if (!is_good) continue;
+
+            num_total_points++;
         
-        if (opt.max_valid_triangulation_error > 0.0 &&
-            error_image(col, row) > opt.max_valid_triangulation_error) 
-          continue;
+            if (opt.max_valid_triangulation_error > 0.0 &&
+                cloud_error_image(col, row) > opt.max_valid_triangulation_error) 
+              continue;
 
-        num_kept_points++;
+            num_kept_points++;
 #if 0
-        // For comparison later with las2txt.
-        std::cout.precision(16);
-        std::cout << "\npoint " << point[0] << ' ' << point[1] << ' '
-                  << point[2] << std::endl;
+            // For comparison later with las2txt.
+            std::cout.precision(16);
+            std::cout << "\npoint " << point[0] << ' ' << point[1] << ' '
+                      << point[2] << std::endl;
 #endif
 
-        liblas::Point las_point(&header);
-        las_point.SetCoordinates(point[0], point[1], point[2]);
-
-        if (opt.triangulation_error_factor > 0.0) {
-          // Scale the triangulation error, clamp it, and save it as
-          // uint16.  The LAS 1.2 format has no fields (apart from the
-          // taken already x, y, and z) with 32-bit values, so uint16
-          // is all one can do.
-          double scaled_error = opt.triangulation_error_factor * error_image(col, row);
-          scaled_error = round(scaled_error);
-          scaled_error = std::max(scaled_error, 0.0); // should not be necessary
-          scaled_error = std::min(scaled_error, double(std::numeric_limits<std::uint16_t>::max()));
-          las_point.SetIntensity(std::uint16_t(scaled_error));
-        }
+            liblas::Point las_point(&header);
+            las_point.SetCoordinates(point[0], point[1], point[2]);
+
+            if (opt.triangulation_error_factor > 0.0) {
+              // Scale the triangulation error, clamp it, and save it as
+              // uint16.  The LAS 1.2 format has no fields (apart from the
+              // taken already x, y, and z) with 32-bit values, so uint16
+              // is all one can do.
+              double scaled_error = opt.triangulation_error_factor * cloud_error_image(col, row);
+              scaled_error = round(scaled_error);
+              scaled_error = std::max(scaled_error, 0.0); // should not be necessary
+              scaled_error = std::min(scaled_error, double(std::numeric_limits<std::uint16_t>::max()));
+              las_point.SetIntensity(std::uint16_t(scaled_error));
+            }
           
-        writer.WritePoint(las_point);
-      }
-    }
+            writer.WritePoint(las_point);
+          }
+        }
+      } // end loop through blocks
+    } // end loop through clouds
     tpc.report_finished();
 
     vw_out () << "Saved: " << num_kept_points << " points." << std::endl;
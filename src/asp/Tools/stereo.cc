@@ -28,6 +28,7 @@
 #include <asp/Tools/stereo.h>
 #include <asp/Camera/RPCModel.h>
 #include <asp/Core/Bathymetry.h>
+#include <asp/Core/VirtualAlignedImages.h>
 #include <asp/Sessions/StereoSessionFactory.h>
 
 // Can't do much about warnings in boost except to hide them
@@ -54,9 +55,9 @@ namespace asp {
     if (b == BBox2i(0, 0, 0, 0)){
 
       // No box was provided. Use the full box.
-      if ( fs::exists(opt.out_prefix+"-L.tif") ){
-        DiskImageView<PixelGray<float> > L_img(opt.out_prefix+"-L.tif");
-        b = bounding_box(L_img);
+      Vector2i L_size;
+      if (asp::read_aligned_image_size(opt.out_prefix, "L", L_size)){
+        b = BBox2i(0, 0, L_size.x(), L_size.y());
       }else{
         b = full_box; // To not have an empty box
       }
@@ -72,11 +73,10 @@ namespace asp {
         b = HomographyTransform(align_left_matrix).forward_bbox(b);
       }
 
-      if ( fs::exists(opt.out_prefix+"-L.tif") ){
-        // Intersect with L.tif which is the transformed and processed left image
-        DiskImageView<PixelGray<float> > L_img(opt.out_prefix+"-L.tif");
-        b.crop(bounding_box(L_img));
-      }
+      // Intersect with L.tif which is the transformed and processed left image
+      Vector2i L_size;
+      if (asp::read_aligned_image_size(opt.out_prefix, "L", L_size))
+        b.crop(BBox2i(0, 0, L_size.x(), L_size.y()));
 
     }
 
@@ -462,10 +462,9 @@ namespace asp {
         stereo_settings().trans_crop_win = transformed_crop_win(opt);
 
       // Intersect with L.tif which is the transformed and processed left image.
-      if ( fs::exists(opt.out_prefix+"-L.tif") ){
-        DiskImageView<PixelGray<float> > L_img(opt.out_prefix+"-L.tif");
-        stereo_settings().trans_crop_win.crop(bounding_box(L_img));
-      }
+      Vector2i L_size;
+      if (asp::read_aligned_image_size(opt.out_prefix, "L", L_size))
+        stereo_settings().trans_crop_win.crop(BBox2i(0, 0, L_size.x(), L_size.y()));
     }else{ 
       // If left_image_crop_win is specified, as can be see in
       // StereoSession::preprocessing_hook(), we actually
@@ -475,10 +474,9 @@ namespace asp {
       // we set it to the entire cropped image.
       if (stereo_settings().trans_crop_win == BBox2i(0, 0, 0, 0)) {
         stereo_settings().trans_crop_win = bounding_box(left_image);
-        if ( fs::exists(opt.out_prefix+"-L.tif") ){
-          DiskImageView<PixelGray<float> > L_img(opt.out_prefix+"-L.tif");
-          stereo_settings().trans_crop_win = bounding_box(L_img);
-        }
+        Vector2i L_size;
+        if (asp::read_aligned_image_size(opt.out_prefix, "L", L_size))
+          stereo_settings().trans_crop_win = BBox2i(0, 0, L_size.x(), L_size.y());
       }
     } // End crop checking case
 
@@ -39,15 +39,21 @@
 
 #include <vw/Stereo/DisparityMap.h>
 #include <asp/Tools/stereo.h>
+#include <asp/Core/VirtualAlignedImages.h>
+#include <asp/Core/TileBlend.h>
+#include <vw/Core/ThreadPool.h>
 #include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <map>
 
 using namespace vw;
 using namespace vw::stereo;
 using namespace asp;
 using namespace std;
 
-typedef ImageView<double> WeightsType;
-typedef PixelMask<Vector2f> MaskedPixType;
+typedef BlendWeightsType WeightsType;
+typedef BlendPixType MaskedPixType;
 
 // Every tile has 8 neighbors
 const int NUM_NEIGHBORS = 8;
@@ -84,8 +90,9 @@ BBox2i bbox_from_folder(std::string const& s, std::string const& in_file) {
   return BBox2i(x, y, width, height);
 }
 
-// Load an image and form its weights
-bool load_image_and_weights(std::string const& file_path,
+// Load an image and form its weights. The image must fit in the given
+// box, which is the padded tile it is supposed to be.
+bool load_image_and_weights(std::string const& file_path, BBox2i const& padded_box,
                             ImageView<MaskedPixType> & image, WeightsType & weights,
                             int & num_channels, bool & has_nodata, float& nodata_value) {
 
@@ -106,6 +113,10 @@ bool load_image_and_weights(std::string const& file_path,
   // with local epipolar alignment, when the resulting disparity has
   // float pixels even when ASP_BM is used.
   boost::shared_ptr<DiskImageResource> rsrc(DiskImageResourcePtr(file_path));
+  if (rsrc->cols() != padded_box.width() || rsrc->rows() != padded_box.height())
+    vw_throw(ArgumentErr() << "stereo_blend: File: " << file_path
+             << " is expected to fit in box: " << padded_box);
+
   ChannelTypeEnum disp_data_type = rsrc->channel_type();
   if (disp_data_type != VW_CHANNEL_FLOAT32)
     vw_throw(ArgumentErr() << "Error: stereo_blend should only be called with float images.");
@@ -183,23 +194,36 @@ struct BlendOptions {
   }
 };
 
-// Check if the dimensions of a tile agree with the box it is supposed to fit in
-void check_size(BBox2i const& bbox, std::string const& image_file) {
-  Vector2i image_size = file_image_size(image_file);
+// This must be sync-ed up with parallel_stereo. Read the list of
+// dirs that parallel_stereo made.
+void read_folder_list(std::string const& out_prefix, std::vector<std::string> & folder_list) {
+  folder_list.clear();
+  std::string dir;
+  std::string dirList = out_prefix + "-dirList.txt";
+  std::ifstream ifs(dirList.c_str());
+  while (ifs >> dir){
+    folder_list.push_back(dir);
+  }
+  ifs.close();
+  if (folder_list.empty()) 
+    vw_throw(ArgumentErr() << "Something is corrupted. Found an empty file: "
+             << dirList << ".\n");
+}
 
-  bool is_good = (bbox.width() == image_size.x() && bbox.height() == image_size.y());
-  if (!is_good) 
-    vw_throw(ArgumentErr() << "stereo_blend: File: " << image_file
-             << " is expected to fit in box: " << bbox);
+// The box of the full image, and the padding of the tiles
+void read_full_box_and_padding(ASPGlobalOptions const& opt, BlendOptions & blend_opt) {
+  Vector2i full_image_size;
+  if (!asp::read_aligned_image_size(opt.out_prefix, "L", full_image_size))
+    vw_throw(ArgumentErr() << "stereo_blend: Cannot find the size of the left aligned image "
+             << "for prefix: " << opt.out_prefix << "\n");
+  blend_opt.full_box = BBox2i(0, 0, full_image_size.x(), full_image_size.y());
+  blend_opt.pad_size = stereo_settings().sgm_collar_size;
 }
 
 void fill_blend_options(ASPGlobalOptions const& opt, std::string const& in_file,
                         BlendOptions & blend_opt) {
 
-  std::string left_image = opt.out_prefix + "-L.tif";
-  Vector2i full_image_size = file_image_size(left_image);
-  blend_opt.full_box = BBox2i(0, 0, full_image_size.x(), full_image_size.y());
-  blend_opt.pad_size = stereo_settings().sgm_collar_size;
+  read_full_box_and_padding(opt, blend_opt);
   
   blend_opt.main_path = opt.out_prefix + "-" + in_file;
 
@@ -210,19 +234,8 @@ void fill_blend_options(ASPGlobalOptions const& opt, std::string const& in_file,
   // What if it is path1/path2/path3. 
   parallel_stereo_folder = parallel_stereo_folder.parent_path().parent_path();
 
-  // This must be sync-ed up with parallel_stereo. Read the list of
-  // dirs that parallel_stereo made.
   std::vector<std::string> folder_list;
-  std::string dir;
-  std::string dirList = opt.out_prefix + "-dirList.txt";
-  std::ifstream ifs(dirList.c_str());
-  while (ifs >> dir){
-    folder_list.push_back(dir);
-  }
-  ifs.close();
-  if (folder_list.empty()) 
-    vw_throw(ArgumentErr() << "Something is corrupted. Found an empty file: "
-             << dirList << ".\n");
+  read_folder_list(opt.out_prefix, folder_list);
   
   // Get the main tile bbox from the subfolder name
   boost::filesystem::path mpath(blend_opt.main_path);
@@ -230,7 +243,6 @@ void fill_blend_options(ASPGlobalOptions const& opt, std::string const& in_file,
 
   blend_opt.main_roi    = bbox_from_folder(mbb, in_file);
   blend_opt.padded_main = blend_opt.add_padding(blend_opt.main_roi);
-  check_size(blend_opt.padded_main, blend_opt.main_path);
   
   BBox2i main_bbox = blend_opt.main_roi;
 
@@ -302,23 +314,8 @@ void fill_blend_options(ASPGlobalOptions const& opt, std::string const& in_file,
       continue; // no neighbor in that direction
 
     blend_opt.padded_neib[i] = blend_opt.add_padding(blend_opt.neib_roi[i]);
-    check_size(blend_opt.padded_neib[i], blend_opt.neib_path[i]);
-  }
-
-}
-
-// See if a given image has only invalid pixels
-bool invalid_image(ImageView<MaskedPixType> const& image) {
-  for (int col = 0; col < image.cols(); col++) {
-    for (int row = 0; row < image.rows(); row++) {
-      if (is_valid(image(col, row))) {
-        // Found a valid pixel
-        return false;
-      }
-    }
   }
 
-  return true;
 }
 
 /// Blend the borders of the main tile using the neighboring
@@ -336,23 +333,9 @@ ImageView<MaskedPixType> tile_blend(ASPGlobalOptions const& opt,
   has_nodata = false;
   nodata_value = -32768.0;
 
-  // Start the output image as invalid and zero. It will be used to
-  // accumulate the weighted disparities.
-  ImageView<MaskedPixType> output_image(blend_opt.main_roi.width(), blend_opt.main_roi.height()); 
-  for (int col = 0; col < output_image.cols(); col++) {
-    for (int row = 0; row < output_image.rows(); row++) {
-      output_image(col, row) = MaskedPixType(); 
-      output_image(col, row).invalidate();
-    }
-  }
-  
-  // Accumulate here the weights
-  WeightsType output_weights(blend_opt.main_roi.width(), blend_opt.main_roi.height());
-  for (int col = 0; col < output_weights.cols(); col++) {
-    for (int row = 0; row < output_weights.rows(); row++) {
-      output_weights(col, row) = 0.0; 
-    }
-  }
+  ImageView<MaskedPixType> output_image;
+  WeightsType output_weights;
+  init_blend(blend_opt.main_roi, output_image, output_weights);
 
   // Add the contribution from the main tile and neighboring tiles. Note
   // that i = -1 corresponds to the main tile.
@@ -368,7 +351,8 @@ ImageView<MaskedPixType> tile_blend(ASPGlobalOptions const& opt,
       int curr_num_channels = 1;
       bool curr_has_nodata = false;
       float curr_nodata_value = -32768.0;
-      bool ans = load_image_and_weights(blend_opt.main_path, image, weights,
+      bool ans = load_image_and_weights(blend_opt.main_path, blend_opt.padded_main,
+                                        image, weights,
                                         curr_num_channels, curr_has_nodata, curr_nodata_value);
       if (!ans) 
         vw_throw(ArgumentErr() << "stereo_blend: main tile is missing.");
@@ -390,7 +374,8 @@ ImageView<MaskedPixType> tile_blend(ASPGlobalOptions const& opt,
       int curr_num_channels = 1;
       bool curr_has_nodata = false;
       float curr_nodata_value = -32768.0;
-      bool ans = load_image_and_weights(blend_opt.neib_path[i], image, weights,
+      bool ans = load_image_and_weights(blend_opt.neib_path[i], blend_opt.padded_neib[i],
+                                        image, weights,
                                         curr_num_channels, curr_has_nodata, curr_nodata_value);
       if (!ans)
         continue; // Nothing to blend
@@ -405,69 +390,20 @@ ImageView<MaskedPixType> tile_blend(ASPGlobalOptions const& opt,
     }
 
     // Do the blending, either with the main or neighboring tiles
-    for (int col = 0; col < output_image.cols(); col++) {
-      for (int row = 0; row < output_image.rows(); row++) {
-
-        // Convert the given pixel to the coordinate system of the full image
-        Vector2 pix = Vector2(col, row) + blend_opt.main_roi.min();
-
-        // Convert the pixel to the coordinate system of the current padded tile
-        pix = pix - padded_box.min();
-
-        // Padded tiles can overlap only partially with the central region of the main
-        // tile. If not in the overlap region, skip the work.
-        if (!vw::bounding_box(image).contains(pix)) 
-          continue;
-
-        if (!is_valid(image(pix[0], pix[1])) || weights(pix[0], pix[1]) <= 0.0) 
-          continue; // No useful info
-
-        output_image(col, row).validate();
-        output_image(col, row)   += weights(pix[0], pix[1]) * image(pix[0], pix[1]);
-        output_weights(col, row) += weights(pix[0], pix[1]);
-      }
-    }
+    accumulate_blend(image, weights, padded_box, blend_opt.main_roi,
+                     output_image, output_weights);
   }
   
-  // Normalize
-  for (int col = 0; col < output_image.cols(); col++) {
-    for (int row = 0; row < output_image.rows(); row++) {
-      
-      if (!is_valid(output_image(col, row)))
-        continue;
-      
-      if (output_weights(col, row) <= 0) {
-        output_image(col, row).invalidate();
-        continue;
-      }
-      
-      output_image(col, row) /= output_weights(col, row);
-    }
-  }
+  normalize_blend(output_image, output_weights);
   
   return output_image;
 }
 
-void stereo_blending(ASPGlobalOptions const& opt, std::string const& in_file,
-                     std::string const& out_file) {
-
-  BlendOptions blend_opt;
-  fill_blend_options(opt, in_file, blend_opt);
-
-  // Since this tool is only for follow-up processing of SGM results
-  // in parallel_stereo, it can be safely assumed that the input
-  // images are small enough to load entirely into memory.
-
-  cartography::GeoReference left_georef;
-  std::string left_image = opt.out_prefix + "-L.tif";
-  bool   has_left_georef = read_georeference(left_georef, left_image);
-  int num_channels       = 1;
-  bool has_nodata        = false;
-  float nodata           = -32768.0;
-
-  ImageView<MaskedPixType> blended_disp = tile_blend(opt, blend_opt,
-                                                     // These will change
-                                                     num_channels, has_nodata, nodata);
+// Write a blended tile, either as a disparity or as a single-channel image
+void write_blended_tile(ASPGlobalOptions const& opt, std::string const& full_out_file,
+                        ImageView<MaskedPixType> const& blended_disp,
+                        int num_channels, bool has_nodata, float nodata,
+                        bool has_left_georef, cartography::GeoReference const& left_georef) {
 
   // Sanity check
   if (num_channels == 1 && !has_nodata) {
@@ -475,7 +411,6 @@ void stereo_blending(ASPGlobalOptions const& opt, std::string const& in_file,
              << "expecting to have a no-data value in order to keep track of invalid pixels.");
   }
 
-  std::string full_out_file = opt.out_prefix + "-" + out_file;
   vw_out() << "Writing: " << full_out_file << "\n";
   if (num_channels == 3) {
     // Write the blended disparity
@@ -501,6 +436,127 @@ void stereo_blending(ASPGlobalOptions const& opt, std::string const& in_file,
   }
 }
 
+void stereo_blending(ASPGlobalOptions const& opt, std::string const& in_file,
+                     std::string const& out_file) {
+
+  BlendOptions blend_opt;
+  fill_blend_options(opt, in_file, blend_opt);
+
+  // Since this tool is only for follow-up processing of SGM results
+  // in parallel_stereo, it can be safely assumed that the input
+  // images are small enough to load entirely into memory.
+
+  cartography::GeoReference left_georef;
+  bool   has_left_georef = asp::read_aligned_image_georef(opt.out_prefix, "L", left_georef);
+  int num_channels       = 1;
+  bool has_nodata        = false;
+  float nodata           = -32768.0;
+
+  ImageView<MaskedPixType> blended_disp = tile_blend(opt, blend_opt,
+                                                     // These will change
+                                                     num_channels, has_nodata, nodata);
+
+  write_blended_tile(opt, opt.out_prefix + "-" + out_file, blended_disp,
+                     num_channels, has_nodata, nodata, has_left_georef, left_georef);
+}
+
+// The properties of the tiles on disk, assumed to be the same for all
+struct BlendTileInfo {
+  int   num_channels;
+  bool  has_nodata;
+  float nodata;
+  vw::Mutex mutex;
+  BlendTileInfo(): num_channels(1), has_nodata(false), nodata(-32768.0) {}
+};
+
+// Read a tile and add it to the blends of the tiles it overlaps
+class BlendTileTask: public vw::Task, private boost::noncopyable {
+  std::vector<BlendTilePtr> & m_tiles;
+  int                         m_index;
+  BlendTileInfo             & m_info;
+public:
+  BlendTileTask(std::vector<BlendTilePtr> & tiles, int index, BlendTileInfo & info):
+    m_tiles(tiles), m_index(index), m_info(info) {}
+  
+  void operator()() {
+    BlendTile & tile = *m_tiles[m_index];
+    ImageView<MaskedPixType> image;
+    WeightsType weights;
+    int num_channels = 1;
+    bool has_nodata = false;
+    float nodata = -32768.0;
+    load_image_and_weights(tile.in_path, tile.padded_roi, image, weights,
+                           num_channels, has_nodata, nodata);
+    {
+      vw::Mutex::Lock lock(m_info.mutex);
+      m_info.num_channels = num_channels;
+      m_info.has_nodata   = has_nodata;
+      m_info.nodata       = nodata;
+    }
+
+    add_to_blends(m_tiles, m_index, image, weights);
+  }
+};
+
+/// Blend all tiles of a parallel_stereo run in this process. Each
+/// tile is read once, and added to the blends of the tiles whose
+/// regions of interest it overlaps. The tiles are processed one row
+/// of tiles at a time, in parallel, and a tile is saved and its blend
+/// freed as soon as all tiles overlapping it were added, so only a
+/// few rows of tiles are in memory at any time.
+void blend_all_tiles(ASPGlobalOptions const& opt, std::string const& in_file,
+                     std::string const& out_file) {
+
+  BlendOptions blend_opt;
+  read_full_box_and_padding(opt, blend_opt);
+  std::vector<std::string> folder_list;
+  read_folder_list(opt.out_prefix, folder_list);
+  
+  // The tiles, and the indices of the tiles in each row of tiles
+  std::vector<BlendTilePtr> tiles;
+  std::map<int, std::vector<int>> rows;
+  for (size_t i = 0; i < folder_list.size(); i++) {
+    BlendTilePtr tile(new BlendTile);
+    std::string bbox_string = extract_process_folder_bbox_string(folder_list[i], in_file);
+    tile->roi        = bbox_from_folder(folder_list[i], in_file);
+    tile->padded_roi = blend_opt.add_padding(tile->roi);
+    tile->in_path    = folder_list[i] + "/" + bbox_string + "-" + in_file;
+    tile->out_path   = folder_list[i] + "/" + bbox_string + "-" + out_file;
+    tiles.push_back(tile);
+  }
+  build_blend_graph(tiles, rows);
+
+  cartography::GeoReference left_georef;
+  bool has_left_georef = asp::read_aligned_image_georef(opt.out_prefix, "L", left_georef);
+  BlendTileInfo info;
+  
+  for (auto row = rows.begin(); row != rows.end(); row++) {
+    
+    FifoWorkQueue queue(vw_settings().default_num_threads());
+    for (size_t j = 0; j < row->second.size(); j++) {
+      boost::shared_ptr<BlendTileTask> task(new BlendTileTask(tiles, row->second[j], info));
+      queue.add_task(task);
+    }
+    queue.join_all();
+
+    // Save the tiles to which nothing will be added anymore
+    for (size_t i = 0; i < tiles.size(); i++) {
+      BlendTile & tile = *tiles[i];
+      if (tile.done || tile.num_pending > 0)
+        continue;
+
+      // If there are no valid pixels in the tile without its padding,
+      // save an invalid blended tile.
+      finish_blend(tile);
+      write_blended_tile(opt, tile.out_path, tile.blend, info.num_channels,
+                         info.has_nodata, info.nodata, has_left_georef, left_georef);
+      tile.blend         = ImageView<MaskedPixType>();
+      tile.blend_weights = WeightsType();
+      tile.done = true;
+    }
+  }
+}
+
 int main(int argc, char* argv[]) {
 
   try {
@@ -530,13 +586,19 @@ int main(int argc, char* argv[]) {
       // No further subpixel refinement, skip to the -RD output.
       out_file = "RD.tif";
     }
-    stereo_blending(opt, in_file, out_file);
+    if (stereo_settings().blend_all_tiles)
+      blend_all_tiles(opt, in_file, out_file);
+    else
+      stereo_blending(opt, in_file, out_file);
 
     // See if to also blend L-R disp differences
     if (stereo_settings().save_lr_disp_diff) {
       in_file  = "L-R-disp-diff.tif";
       out_file = "L-R-disp-diff-blend.tif";
-      stereo_blending(opt, in_file, out_file);
+      if (stereo_settings().blend_all_tiles)
+        blend_all_tiles(opt, in_file, out_file);
+      else
+        stereo_blending(opt, in_file, out_file);
     }
     
     vw_out() << "\n[ " << current_posix_time_string() << " ] : BLENDING FINISHED\n";
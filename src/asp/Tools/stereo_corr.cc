@@ -30,6 +30,8 @@
 #include <asp/Core/InterestPointMatching.h>
 #include <asp/Core/IpMatchingAlgs.h>         // Lightweight header
 #include <asp/Core/LocalAlignment.h>
+#include <asp/Core/VirtualAlignedImages.h>
+#include <asp/Core/SharedTileCache.h>
 #include <asp/Sessions/StereoSession.h>
 #include <asp/Tools/stereo.h>
 
@@ -322,9 +324,9 @@ void load_or_compute_ip(std::string const & left_unalgined_image,
 
   vw_out() << "No IP file found, computing IP now.\n";
   
-  // Load the images
-  boost::shared_ptr<DiskImageResource> left_rsrc (DiskImageResourcePtr(left_aligned_image_file)),
-    right_rsrc(DiskImageResourcePtr(right_aligned_image_file));
+  // Load the images. These may be created on the fly.
+  ImageViewRef<PixelGray<float>> left_aligned_image, right_aligned_image;
+  asp::open_aligned_images(out_prefix, left_aligned_image, right_aligned_image);
 
   std::string left_ip_filename  = ip::ip_filename(out_prefix, left_aligned_image_file);
   std::string right_ip_filename = ip::ip_filename(out_prefix, right_aligned_image_file);
@@ -333,12 +335,12 @@ void load_or_compute_ip(std::string const & left_unalgined_image,
   // the normalized left and right sub-images were created.
   float left_nodata_value  = std::numeric_limits<float>::quiet_NaN();
   float right_nodata_value = std::numeric_limits<float>::quiet_NaN();
-  if (left_rsrc->has_nodata_read ()) left_nodata_value  = left_rsrc->nodata_read ();
-  if (right_rsrc->has_nodata_read()) right_nodata_value = right_rsrc->nodata_read();
+  asp::read_aligned_image_nodata(out_prefix, "L", left_nodata_value);
+  asp::read_aligned_image_nodata(out_prefix, "R", right_nodata_value);
   
   // These images can be big, so use ImageViewRef
-  ImageViewRef<float> left_image  = DiskImageView<float>(left_rsrc);
-  ImageViewRef<float> right_image = DiskImageView<float>(right_rsrc);
+  ImageViewRef<float> left_image  = pixel_cast<float>(left_aligned_image);
+  ImageViewRef<float> right_image = pixel_cast<float>(right_aligned_image);
 
   // No interest point operations have been performed before
   vw_out() << "\t    * Detecting interest points.\n";
@@ -894,18 +896,14 @@ void stereo_correlation_2D(ASPGlobalOptions& opt) {
 
   // Load up for the actual native resolution processing
 
-  std::string left_image_file = opt.out_prefix + "-L.tif";
-  std::string right_image_file = opt.out_prefix + "-R.tif";
+  // Load the normalized images. These may be created on the fly.
+  ImageViewRef<PixelGray<float>> left_disk_image, right_disk_image;
+  asp::open_aligned_images(opt.out_prefix, left_disk_image, right_disk_image);
   
-  boost::shared_ptr<DiskImageResource>
-    left_rsrc (vw::DiskImageResourcePtr(left_image_file)),
-    right_rsrc(vw::DiskImageResourcePtr(right_image_file));
-
-  // Load the normalized images.
-  DiskImageView<PixelGray<float>> left_disk_image(left_rsrc), right_disk_image(right_rsrc);
-  
-  DiskImageView<vw::uint8> Lmask(opt.out_prefix + "-lMask.tif"),
-    Rmask(opt.out_prefix + "-rMask.tif");
+  std::string cache_dir = stereo_settings().shared_tile_cache_dir;
+  ImageViewRef<vw::uint8>
+    Lmask = asp::open_shared_cached_image<vw::uint8>(opt.out_prefix + "-lMask.tif", cache_dir),
+    Rmask = asp::open_shared_cached_image<vw::uint8>(opt.out_prefix + "-rMask.tif", cache_dir);
   ImageViewRef<PixelMask<Vector2f> > sub_disp;
   
   if (stereo_settings().seed_mode > 0) {
@@ -1008,7 +1006,7 @@ void stereo_correlation_2D(ASPGlobalOptions& opt) {
   }
   
   cartography::GeoReference left_georef;
-  bool   has_left_georef = read_georeference(left_georef,  opt.out_prefix + "-L.tif");
+  bool   has_left_georef = asp::read_aligned_image_georef(opt.out_prefix, "L", left_georef);
   bool   has_nodata      = false;
   double nodata          = -32768.0;
 
@@ -28,6 +28,8 @@
 #include <vw/Image/InpaintView.h>
 
 #include <asp/Core/ThreadedEdgeMask.h>
+#include <asp/Core/MedianFilter.h>
+#include <asp/Core/VirtualAlignedImages.h>
 #include <asp/Sessions/StereoSession.h>
 #include <asp/Gotcha/CBatchProc.h>
 
@@ -104,7 +106,7 @@ public:
 
 
     ImageView<pixel_type > disp_tile_median;
-    vw::stereo::disparity_median_filter(input_disp_tile, disp_tile_median, m_median_filter_size);
+    asp::disparity_median_filter(input_disp_tile, m_median_filter_size, disp_tile_median);
     
     ImageView<pixel_type > disp_tile_filtered;
     vw::stereo::texture_preserving_disparity_filter(disp_tile_median, disp_tile_filtered, texture_image, 
@@ -253,7 +255,7 @@ void write_good_pixel_and_filtered(ImageViewBase<ImageT> const& inputview,
 
   // Determine if we can attach geo information to the output image
   cartography::GeoReference left_georef;
-  bool has_left_georef = read_georeference(left_georef,  opt.out_prefix + "-L.tif");
+  bool has_left_georef = asp::read_aligned_image_georef(opt.out_prefix, "L", left_georef);
   bool has_nodata = false;
   double nodata = -32768.0;
 
@@ -366,7 +368,8 @@ void stereo_filtering(ASPGlobalOptions& opt) {
       mask_buffer = max( stereo_settings().subpixel_kernel );
 
 
-    DiskImageView<PixelGray<float> > left_disk_image (opt.out_prefix+"-L.tif");
+    ImageViewRef<PixelGray<float>> left_disk_image, right_disk_image;
+    asp::open_aligned_images(opt.out_prefix, left_disk_image, right_disk_image);
 
     vw_out() << "\t--> Cleaning up disparity map prior to filtering processes ("
              << stereo_settings().rm_cleanup_passes << " pass).\n";
@@ -478,20 +481,19 @@ void gotcha_disparity_refinement(ASPGlobalOptions& opt) {
     = opt.session->pre_pointcloud_hook(disp_file_nogotcha);
 
   // TODO(oalexan1): How about no-data pixels in the left and right images?
-  std::string L_file = opt.out_prefix + "-L.tif";
-  std::string R_file = opt.out_prefix + "-R.tif";
-  DiskImageView<float> left_image (L_file);
-  DiskImageView<float> right_image(R_file);
+  ImageViewRef<PixelGray<float>> left_image, right_image;
+  asp::open_aligned_images(opt.out_prefix, left_image, right_image);
   
   // Determine if we can attach geo information to the output disparity
   cartography::GeoReference left_georef;
-  bool has_left_georef = read_georeference(left_georef, L_file);
+  bool has_left_georef = asp::read_aligned_image_georef(opt.out_prefix, "L", left_georef);
   bool has_nodata = false;
   double nodata = -32768.0;
   vw_out() << "Writing Gotcha-refined disparity: " << disp_file << endl;
   block_write_gdal_image(disp_file,
                          gotcha::gotcha_refine(filtered_disparity,  
-                                               left_image, right_image,
+                                               select_channel(left_image, 0),
+                                               select_channel(right_image, 0),
                                                padding, stereo_settings().casp_go_param_file),
                          has_left_georef, left_georef,
                          has_nodata, nodata, opt,
@@ -25,6 +25,7 @@
 #include <vw/Cartography/GeoReferenceUtils.h>
 #include <vw/Stereo/CorrelationView.h>
 #include <asp/Sessions/StereoSession.h>
+#include <asp/Core/VirtualAlignedImages.h>
 #include <asp/Sessions/StereoSessionFactory.h>
 #include <xercesc/util/PlatformUtils.hpp>
 
@@ -138,9 +139,8 @@ int main(int argc, char* argv[]) {
     string trans_right_image = opt.out_prefix+"-R.tif";
     vw_out() << "trans_left_image,"  << trans_left_image  << endl;
     vw_out() << "trans_right_image," << trans_right_image << endl;
-    Vector2 trans_left_image_size;
-    if ( fs::exists(trans_left_image) )
-      trans_left_image_size = file_image_size(trans_left_image);
+    Vector2i trans_left_image_size;
+    asp::read_aligned_image_size(opt.out_prefix, "L", trans_left_image_size);
     vw_out() << "trans_left_image_size," << trans_left_image_size.x() << "," << trans_left_image_size.y() << endl;
 
     cartography::GeoReference georef = opt.session->get_georef();
@@ -203,22 +203,23 @@ int main(int argc, char* argv[]) {
     vw_out() << "save_lr_disp_diff," << stereo_settings().save_lr_disp_diff << std::endl;
 
     vw_out() << "correlator_mode," << stereo_settings().correlator_mode << endl;
+
+    vw_out() << "shared_tile_cache_dir," << stereo_settings().shared_tile_cache_dir << endl;
     
     // This block of code should be in its own executable but I am
     // reluctant to create one just for it. This functionality will be
     // invoked after low-res disparity is computed, whether done in
     // C++ or in Python. It will attach a georeference to this disparity.
-    std::string left_image_file = opt.out_prefix + "-L.tif";
+    Vector2i left_image_size;
     if (stereo_settings().attach_georeference_to_lowres_disparity &&
-        fs::exists(left_image_file)) {
+        asp::read_aligned_image_size(opt.out_prefix, "L", left_image_size)) {
 
       cartography::GeoReference left_georef, left_sub_georef;
-      bool   has_left_georef = read_georeference(left_georef, left_image_file);
+      bool   has_left_georef = asp::read_aligned_image_georef(opt.out_prefix, "L", left_georef);
       bool   has_nodata      = false;
       double output_nodata   = -32768.0;
       if (has_left_georef) {
 
-        DiskImageView<float> left_image(left_image_file);
         for (int i = 0; i < 2; i++) {
           std::string d_sub_file = opt.out_prefix + "-D_sub.tif";
           if (i == 1) d_sub_file = opt.out_prefix + "-D_sub_spread.tif";
@@ -234,8 +235,8 @@ int main(int argc, char* argv[]) {
           ImageView<PixelMask<Vector2f> > d_sub;
           read_image(d_sub, d_sub_file);
           // Account for scale.
-          double left_scale = 0.5*( double(d_sub.cols())/left_image.cols() +
-                                    double(d_sub.rows())/left_image.rows());
+          double left_scale = 0.5*( double(d_sub.cols())/left_image_size.x() +
+                                    double(d_sub.rows())/left_image_size.y());
           left_sub_georef = resample(left_georef, left_scale);
           vw::cartography::block_write_gdal_image(d_sub_file, d_sub,
                                       has_left_georef, left_sub_georef,
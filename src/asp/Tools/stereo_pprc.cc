@@ -31,6 +31,7 @@
 #include <vw/Math/Functors.h>
 #include <asp/Tools/stereo.h>
 #include <asp/Core/ThreadedEdgeMask.h>
+#include <asp/Core/VirtualAlignedImages.h>
 #include <asp/Sessions/StereoSession.h>
 #include <asp/Sessions/StereoSessionFactory.h>
 #include <xercesc/util/PlatformUtils.hpp>
@@ -93,6 +94,12 @@ void create_sym_links(std::string const& left_input_file,
 
   vw_out(WarningMessage) << "Skipping image normalization.\n";
 
+  // A file describing aligned images from a previous run would take
+  // precedence over the links to be made now.
+  std::string virtual_file = asp::virtual_aligned_images_file(out_prefix);
+  if (fs::exists(virtual_file))
+    fs::remove(virtual_file);
+
   left_output_file  = out_prefix+"-L.tif";
   right_output_file = out_prefix+"-R.tif";
   std::string cmd1, cmd2;
@@ -153,13 +160,9 @@ void stereo_preprocessing(bool adjust_left_image_size, ASPGlobalOptions& opt) {
                                         opt.in_file1,    opt.in_file2,
                                         left_image_file, right_image_file);
 
-  boost::shared_ptr<DiskImageResource>
-    left_rsrc (vw::DiskImageResourcePtr(left_image_file)),
-    right_rsrc(vw::DiskImageResourcePtr(right_image_file));
-
-  // Load the normalized images.
-  DiskImageView<PixelGray<float> > left_image (left_rsrc ),
-                                   right_image(right_rsrc);
+  // Load the normalized images. These may be created on the fly.
+  ImageViewRef<PixelGray<float>> left_image, right_image;
+  asp::open_aligned_images(opt.out_prefix, left_image, right_image);
 
   // If we crop the images, we must always rebuild the masks
   // and subsample the images and masks.
@@ -201,8 +204,8 @@ void stereo_preprocessing(bool adjust_left_image_size, ASPGlobalOptions& opt) {
   }
 
   cartography::GeoReference left_georef, right_georef;
-  bool has_left_georef  = read_georeference(left_georef,  left_image_file );
-  bool has_right_georef = read_georeference(right_georef, right_image_file);
+  bool has_left_georef  = asp::read_aligned_image_georef(opt.out_prefix, "L", left_georef);
+  bool has_right_georef = asp::read_aligned_image_georef(opt.out_prefix, "R", right_georef);
 
   // The output no-data value must be < 0 as the images are scaled to around [0, 1].
   bool  has_nodata    = true;
@@ -230,10 +233,8 @@ void stereo_preprocessing(bool adjust_left_image_size, ASPGlobalOptions& opt) {
     // Read the no-data values of L.tif and R.tif.
     float left_nodata_value  = std::numeric_limits<float>::quiet_NaN();
     float right_nodata_value = std::numeric_limits<float>::quiet_NaN();
-    if ( left_rsrc->has_nodata_read() )
-      left_nodata_value  = left_rsrc->nodata_read();
-    if ( right_rsrc->has_nodata_read() )
-      right_nodata_value = right_rsrc->nodata_read();
+    asp::read_aligned_image_nodata(opt.out_prefix, "L", left_nodata_value);
+    asp::read_aligned_image_nodata(opt.out_prefix, "R", right_nodata_value);
 
     // We need to treat the following special case: if the user
     // skipped image normalization, so we are still using the original
@@ -30,6 +30,8 @@
 #include <vw/FileIO/DiskImageResourceOpenEXR.h>
 #include <vw/Image/InpaintView.h>
 #include <asp/Sessions/StereoSession.h>
+#include <asp/Core/VirtualAlignedImages.h>
+#include <asp/Core/SharedTileCache.h>
 
 #include <xercesc/util/PlatformUtils.hpp>
 
@@ -265,25 +267,23 @@ void stereo_refinement(ASPGlobalOptions const& opt) {
   ImageViewRef<PixelGray<float>> left_image, right_image;
   ImageViewRef<PixelMask<Vector2f> > input_disp;
   ImageViewRef<PixelMask<Vector2f> > sub_disp;
-  string left_image_file  = opt.out_prefix+"-L.tif";
-  string right_image_file = opt.out_prefix+"-R.tif";
   string left_mask_file   = opt.out_prefix+"-lMask.tif";
   string right_mask_file  = opt.out_prefix+"-rMask.tif";
 
   int kernel_size = std::max(stereo_settings().subpixel_kernel[0],
                              stereo_settings().subpixel_kernel[1]);
   
-  left_image  = DiskImageView<PixelGray<float>>(left_image_file);
-  right_image = DiskImageView<PixelGray<float>>(right_image_file);
+  // These may be created on the fly
+  asp::open_aligned_images(opt.out_prefix, left_image, right_image);
   
   // It is better to fill no-data pixels with an average from
   // neighbors than to use no-data values in processing. This is a
   // temporary band-aid solution.
   float left_nodata_val = -std::numeric_limits<float>::max();
-  if (vw::read_nodata_val(left_image_file, left_nodata_val))
+  if (asp::read_aligned_image_nodata(opt.out_prefix, "L", left_nodata_val))
     vw_out() << "Left image nodata: " << left_nodata_val << std::endl;
   float right_nodata_val = -std::numeric_limits<float>::max();
-  if (vw::read_nodata_val(right_image_file, right_nodata_val))
+  if (asp::read_aligned_image_nodata(opt.out_prefix, "R", right_nodata_val))
     vw_out() << "Right image nodata: " << right_nodata_val << std::endl;
   
   left_image = apply_mask(vw::fill_nodata_with_avg
@@ -301,11 +301,12 @@ void stereo_refinement(ASPGlobalOptions const& opt) {
     // Read the stereo_corr output file
     boost::shared_ptr<DiskImageResource> rsrc(DiskImageResourcePtr(disp_file));
     ChannelTypeEnum disp_data_type = rsrc->channel_type();
+    std::string cache_dir = stereo_settings().shared_tile_cache_dir;
     if (disp_data_type == VW_CHANNEL_INT32)
       input_disp = pixel_cast<PixelMask<Vector2f> >
-        (DiskImageView< PixelMask<Vector2i> >(disp_file));
+        (asp::open_shared_cached_image< PixelMask<Vector2i> >(disp_file, cache_dir));
     else // File on disk is float
-      input_disp = DiskImageView< PixelMask<Vector2f> >(disp_file);
+      input_disp = asp::open_shared_cached_image< PixelMask<Vector2f> >(disp_file, cache_dir);
   }
   
   bool skip_img_norm = asp::skip_image_normalization(opt);
@@ -357,7 +358,7 @@ void stereo_refinement(ASPGlobalOptions const& opt) {
            stereo_settings().trans_crop_win);
   
   cartography::GeoReference left_georef;
-  bool   has_left_georef = read_georeference(left_georef,  opt.out_prefix + "-L.tif");
+  bool   has_left_georef = asp::read_aligned_image_georef(opt.out_prefix, "L", left_georef);
   bool   has_nodata      = false;
   double nodata          = -32768.0;
 
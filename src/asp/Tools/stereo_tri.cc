@@ -25,8 +25,11 @@
 #include <vw/InterestPoint/Matcher.h>
 
 #include <asp/Camera/RPCModel.h>
+#include <asp/Camera/RayGridCameraModel.h>
 #include <asp/Core/DisparityProcessing.h>
 #include <asp/Core/Bathymetry.h>
+#include <asp/Core/QuantileSketch.h>
+#include <asp/Core/PointCloudCollection.h>
 #include <asp/Tools/stereo.h>
 #include <asp/Tools/jitter_adjust.h>
 #include <asp/Tools/ccd_adjust.h>
@@ -56,6 +59,9 @@ class StereoTXAndErrorView:
   public ImageViewBase<StereoTXAndErrorView> {
   std::vector<DispImageType>    m_disparity_maps;
   std::vector<vw::TransformPtr> m_transforms; // e.g., map-projection or homography to undo
+  std::vector<const vw::camera::CameraModel *> m_cameras; // exact cameras
+  bool                          m_use_least_squares;
+  double                        m_angle_tol;
   vw::stereo::StereoModel       m_stereo_model;
   asp::BathyStereoModel         m_bathy_model;
   bool                          m_is_map_projected;
@@ -64,6 +70,10 @@ class StereoTXAndErrorView:
   ImageViewRef<PixelMask<float>> m_left_aligned_bathy_mask;
   ImageViewRef<PixelMask<float>> m_right_aligned_bathy_mask;
 
+  // Per-tile cameras interpolating rays on a grid, if in use. Here
+  // m_stereo_model points to these, so they must be kept alive.
+  std::vector<boost::shared_ptr<vw::camera::CameraModel>> m_ray_grid_cams;
+
   typedef typename DispImageType::pixel_type DPixelT;
 
 public:
@@ -75,7 +85,8 @@ public:
   /// Constructor
   StereoTXAndErrorView(std::vector<DispImageType>    const& disparity_maps,
                        std::vector<vw::TransformPtr> const& transforms,
-                       vw::stereo::StereoModel       const& stereo_model,
+                       std::vector<const vw::camera::CameraModel *> const& cameras,
+                       bool use_least_squares, double angle_tol,
                        asp::BathyStereoModel         const& bathy_model,
                        bool is_map_projected,
                        bool bathy_correct, OUTPUT_CLOUD_TYPE cloud_type,
@@ -83,7 +94,10 @@ public:
                        ImageViewRef<PixelMask<float>> right_aligned_bathy_mask):
     m_disparity_maps(disparity_maps),
     m_transforms(transforms),
-    m_stereo_model(stereo_model),
+    m_cameras(cameras),
+    m_use_least_squares(use_least_squares),
+    m_angle_tol(angle_tol),
+    m_stereo_model(cameras, use_least_squares, angle_tol),
     m_bathy_model(bathy_model),
     m_is_map_projected(is_map_projected),
     m_bathy_correct(bathy_correct),
@@ -212,6 +226,48 @@ public:
 
 private:
 
+  // Make the stereo model use cameras which interpolate the rays on a
+  // grid over the given boxes in camera pixel coordinates. Do so only
+  // if building the grid takes fewer exact camera calls than
+  // triangulating every pixel in the tile.
+  void use_ray_grid_cameras(std::vector<BBox2i> const& cam_boxes, BBox2i const& tile) {
+
+    int spacing = stereo_settings().ray_grid_spacing;
+    double tile_area = double(tile.width()) * double(tile.height());
+    
+    m_ray_grid_cams.clear();
+    std::vector<const vw::camera::CameraModel *> grid_cam_ptrs;
+    for (size_t c = 0; c < m_cameras.size(); c++) {
+      BBox2i box = cam_boxes[c];
+      double num_nodes = 0.0;
+      if (!box.empty())
+        num_nodes = (box.width()/double(spacing) + 2.0) * (box.height()/double(spacing) + 2.0);
+      if (box.empty() || 2.0 * num_nodes > tile_area) {
+        grid_cam_ptrs.push_back(m_cameras[c]); // not worth it, use the exact camera
+        continue;
+      }
+      boost::shared_ptr<vw::camera::CameraModel> grid_cam
+        (new asp::RayGridCameraModel(m_cameras[c], box, spacing,
+                                     stereo_settings().ray_grid_max_pixel_error,
+                                     stereo_settings().ray_grid_max_center_error));
+      m_ray_grid_cams.push_back(grid_cam);
+      grid_cam_ptrs.push_back(grid_cam.get());
+    }
+    
+    m_stereo_model = vw::stereo::StereoModel(grid_cam_ptrs, m_use_least_squares, m_angle_tol);
+  }
+
+  // The box in camera pixel coordinates corresponding to the given
+  // box in aligned or map-projected coordinates, with some padding.
+  // Pixels outside of it will use the exact camera anyway.
+  static BBox2i camera_pixel_box(vw::TransformPtr const& trans, BBox2i const& bbox) {
+    if (bbox.empty())
+      return BBox2i();
+    BBox2i cam_box = trans->reverse_bbox(bbox);
+    cam_box.expand(2);
+    return cam_box;
+  }
+
   // Find the region associated with the right image that we need to bring in memory
   // based on the disparity 
   BBox2i calc_right_bbox(BBox2i const& left_bbox, ImageView<DPixelT> const& disparity) const {
@@ -229,8 +285,17 @@ private:
     ImageViewRef<PixelMask<float>> in_memory_left_aligned_bathy_mask;
     ImageViewRef<PixelMask<float>> in_memory_right_aligned_bathy_mask;
     
+    // The regions seen by each camera, if using interpolated rays.
+    // The bathy stereo model always uses the exact cameras.
+    bool use_ray_grid = (stereo_settings().ray_grid_spacing > 0 && !m_bathy_correct);
+    std::vector<BBox2i> cam_boxes;
+    
     // Code for NON-MAP-PROJECTED session types.
     if (m_is_map_projected == false) {
+
+      if (use_ray_grid)
+        cam_boxes.push_back(camera_pixel_box(transforms[0], bbox));
+      
       // We explicitly bring in-memory the disparities for the current box
       // to speed up processing later, and then we pretend this is the entire
       // image by virtually enlarging it using a CropView.
@@ -241,6 +306,13 @@ private:
                                                    cols(), rows());
         disparity_cropviews.push_back(cropview_clip);
 
+        if (use_ray_grid) {
+          BBox2i right_bbox;
+          if (!stereo::get_disparity_range(clip).empty())
+            right_bbox = calc_right_bbox(bbox, clip);
+          cam_boxes.push_back(camera_pixel_box(transforms[p+1], right_bbox));
+        }
+
         if (m_bathy_correct) {
           // Bring the needed parts of the bathy masks in memory as well.
           // We assume no multiview for stereo with bathy correction.
@@ -261,11 +333,15 @@ private:
         }
       }
 
-      return prerasterize_type(disparity_cropviews, transforms,
-                               m_stereo_model, m_bathy_model,
+      prerasterize_type result(disparity_cropviews, transforms,
+                               m_cameras, m_use_least_squares, m_angle_tol,
+                               m_bathy_model,
                                m_is_map_projected, m_bathy_correct, m_cloud_type,
                                in_memory_left_aligned_bathy_mask,
                                in_memory_right_aligned_bathy_mask);
+      if (use_ray_grid)
+        result.use_ray_grid_cameras(cam_boxes, bbox);
+      return result;
     }
 
     // Code for MAP-PROJECTED session types.
@@ -282,7 +358,11 @@ private:
       transforms_copy[i] = vw::cartography::mapproj_trans_copy(transforms[i]);
 
     // As a side effect, this call makes transforms_copy create a local cache we want later
-    transforms_copy[0]->reverse_bbox(bbox); 
+    BBox2i left_cam_box = transforms_copy[0]->reverse_bbox(bbox); 
+    if (use_ray_grid) {
+      left_cam_box.expand(2);
+      cam_boxes.push_back(left_cam_box);
+    }
     if (transforms_copy.size() != m_disparity_maps.size() + 1){
       vw_throw( ArgumentErr() << "In multi-view triangulation, "
                 << "the number of disparities must be one less "
@@ -322,13 +402,24 @@ private:
       
       // Also cache the data for subsequent transforms
       // As a side effect this call makes transforms_copy create a local cache we want later
-      transforms_copy[p+1]->reverse_bbox(right_bbox);
+      BBox2i right_cam_box = transforms_copy[p+1]->reverse_bbox(right_bbox);
+      if (use_ray_grid) {
+        if (stereo::get_disparity_range(clip).empty())
+          right_cam_box = BBox2i();
+        else
+          right_cam_box.expand(2);
+        cam_boxes.push_back(right_cam_box);
+      }
     }
 
-    return prerasterize_type(disparity_cropviews, transforms_copy,
-                             m_stereo_model, m_bathy_model,
+    prerasterize_type result(disparity_cropviews, transforms_copy,
+                             m_cameras, m_use_least_squares, m_angle_tol,
+                             m_bathy_model,
                              m_is_map_projected, m_bathy_correct, m_cloud_type,
                              in_memory_left_aligned_bathy_mask, in_memory_right_aligned_bathy_mask);
+    if (use_ray_grid)
+      result.use_ray_grid_cameras(cam_boxes, bbox);
+    return result;
   } // End function PreRasterHelper() maprojected version
 }; // End class StereoTXAndErrorView
 
@@ -336,7 +427,8 @@ private:
 StereoTXAndErrorView
 stereo_error_triangulate(std::vector<DispImageType> const& disparities,
                          std::vector<vw::TransformPtr>  const& transforms,
-                         vw::stereo::StereoModel        const& stereo_model,
+                         std::vector<const vw::camera::CameraModel *> const& cameras,
+                         bool use_least_squares, double angle_tol,
                          asp::BathyStereoModel          const& bathy_model,
                          bool is_map_projected,
                          bool bathy_correct,
@@ -345,7 +437,8 @@ stereo_error_triangulate(std::vector<DispImageType> const& disparities,
                          ImageViewRef<PixelMask<float>> right_aligned_bathy_mask) {
   
   typedef StereoTXAndErrorView result_type;
-  return result_type(disparities, transforms, stereo_model, bathy_model,
+  return result_type(disparities, transforms, cameras, use_least_squares, angle_tol,
+                     bathy_model,
                      is_map_projected, bathy_correct, cloud_type,
                      left_aligned_bathy_mask, right_aligned_bathy_mask);
 }
@@ -382,11 +475,17 @@ void save_point_cloud(Vector3 const& shift, ImageT const& point_cloud,
   bool has_nodata = false;
   double nodata = -std::numeric_limits<float>::max(); // smallest float
 
+  // Find the block extents and statistics while writing the cloud, and
+  // save them as its index, for later tools.
+  asp::PointCloudIndexer indexer;
+  if (fs::exists(asp::point_cloud_index_file(point_cloud_file)))
+    fs::remove(asp::point_cloud_index_file(point_cloud_file)); // will be stale
+
   if (opt.session->supports_multi_threading()){
     asp::block_write_approx_gdal_image
       (point_cloud_file, shift,
        stereo_settings().point_cloud_rounding_error,
-       point_cloud,
+       asp::index_point_cloud_view(point_cloud, &indexer),
        has_georef, georef, has_nodata, nodata,
        opt, TerminalProgressCallback("asp", "\t--> Triangulating: "));
   }else{
@@ -394,31 +493,32 @@ void save_point_cloud(Vector3 const& shift, ImageT const& point_cloud,
     asp::write_approx_gdal_image
       (point_cloud_file, shift,
        stereo_settings().point_cloud_rounding_error,
-       point_cloud,
+       asp::index_point_cloud_view(point_cloud, &indexer),
        has_georef, georef, has_nodata, nodata,
        opt, TerminalProgressCallback("asp", "\t--> Triangulating: "));
   }
+
+  indexer.write(point_cloud_file,
+                vw::math::VectorSize<typename ImageT::pixel_type>::value,
+                Vector2i(point_cloud.cols(), point_cloud.rows()));
 }
 
 // TODO(oalexan1): Move this to some low-level utils file  
-Vector3 find_approx_points_median(std::vector<Vector3> const& points){
+Vector3 find_approx_points_median(std::vector<asp::QuantileSketch> const& coords){
 
   // Find the median of the x coordinates of points, then of y, then of
   // z. Perturb the median a bit to ensure it is never exactly on top
   // of a real point, as in such a case after subtraction of that
   // point from median we'd get the zero vector which by convention
-  // is invalid.
+  // is invalid. The coordinates are kept in quantile sketches, so
+  // the points need not be stored.
 
-  if (points.empty())
+  if (coords.size() != 3 || coords[0].empty())
     return Vector3();
 
   Vector3 median;
-  std::vector<double> V(points.size());
   for (int i = 0; i < (int)median.size(); i++){
-    for (int p = 0; p < (int)points.size(); p++) V[p] = points[p][i];
-    sort(V.begin(), V.end());
-    median[i] = V[points.size()/2];
-
+    median[i] = coords[i].value_at_rank(coords[i].size()/2);
     median[i] += median[i]*1e-10*rand()/double(RAND_MAX);
   }
 
@@ -440,7 +540,7 @@ Vector3 find_point_cloud_center(Vector2i const& tile_size,
   int numx = (int)ceil(point_cloud.cols()/double(tile_size[0]));
   int numy = (int)ceil(point_cloud.rows()/double(tile_size[1]));
 
-  std::vector<Vector3> points;
+  std::vector<asp::QuantileSketch> coords(3);
   // Trace an ever growing square "ring"
   for (int r = 0; r <= std::max(numx/2, numy/2); r++){
     
@@ -471,20 +571,21 @@ Vector3 find_point_cloud_center(Vector2i const& tile_size,
             Vector3 xyz = subvector(cropped_cloud(px, py), 0, 3);
             if (xyz == Vector3())
               continue;
-            points.push_back(xyz);
+            for (int i = 0; i < 3; i++)
+              coords[i].add(xyz[i]);
           }
         }
 
         // Stop if we have enough points to do a reliable mean estimation
-        if (points.size() > 100)
-          return find_approx_points_median(points);
+        if (coords[0].size() > 100)
+          return find_approx_points_median(coords);
 
       }// end y loop
     }// end x loop
   }// end r loop
 
   // Have to use what we've got
-  return find_approx_points_median(points);
+  return find_approx_points_median(coords);
 }
 
 // TODO(oalexan1): Move this to some low-level new util file
@@ -707,14 +808,22 @@ void stereo_triangulation(std::string const& output_prefix,
     bool bathy_correct = opt_vec[0].session->do_bathymetry();
     if (bathy_correct && !stereo_settings().skip_point_cloud_center_comp)
       opt_vec[0].session->align_bathy_masks(opt_vec[0]);
+
+    if (stereo_settings().ray_grid_spacing > 0) {
+      if (bathy_correct)
+        vw_out(WarningMessage) << "Option --ray-grid-spacing is ignored with bathymetry "
+                               << "correction.\n";
+      else
+        vw_out() << "\t--> Interpolating camera rays on a grid with spacing of "
+                 << stereo_settings().ray_grid_spacing << " pixels." << std::endl;
+    }
     
     // Create both a regular stereo model and a bathy stereo
     // model. Will use the latter only if we do bathymetry. This way
     // the regular stereo model and bathy stereo model can have
     // different interfaces and the former need not know about the
-    // latter. Templates are avoided too.
-    vw::stereo::StereoModel stereo_model(camera_ptrs, stereo_settings().use_least_squares,
-                                         angle_tol);
+    // latter. Templates are avoided too. The regular stereo model is
+    // created in the view, as it may need per-tile cameras.
     asp::BathyStereoModel bathy_stereo_model(camera_ptrs, stereo_settings().use_least_squares,
                                              angle_tol);
     
@@ -757,7 +866,8 @@ void stereo_triangulation(std::string const& output_prefix,
     vw_out() << "\t--> Generating a 3D point cloud." << std::endl;
     ImageViewRef<Vector6> point_cloud = per_pixel_filter
         (stereo_error_triangulate
-         (disparity_maps, transforms, stereo_model, bathy_stereo_model,
+         (disparity_maps, transforms, camera_ptrs, stereo_settings().use_least_squares,
+          angle_tol, bathy_stereo_model,
           is_map_projected, bathy_correct,
           cloud_type, left_aligned_bathy_mask, right_aligned_bathy_mask),
          universe_radius_func);